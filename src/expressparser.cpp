@@ -12,6 +12,7 @@ QString ExpressParser::trimSemicolon(const QString &s) {
 bool ExpressParser::parseFile(const QString &filePath, QString* err)
 {
     classes_.clear();
+    types_.clear();
 
     QFile f(filePath);
     if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) {
@@ -31,16 +32,52 @@ bool ExpressParser::parseFile(const QString &filePath, QString* err)
         QRegularExpression::CaseInsensitiveOption);
     QRegularExpression reSubtype(R"(^\s*SUBTYPE\s+OF\s*\(\s*([A-Za-z_][A-Za-z0-9_]*)\s*\)\s*;?)", QRegularExpression::CaseInsensitiveOption);
     QRegularExpression reAttrLine(R"(^\s*([A-Za-z_][A-Za-z0-9_]*)\s*:\s*(.+);$)");
+    QRegularExpression reType(R"(^\s*TYPE\s+([A-Za-z_][A-Za-z0-9_]*)\s*=\s*(.*)$)", QRegularExpression::CaseInsensitiveOption);
+    QRegularExpression reEnum(R"(^ENUMERATION\s+OF\s*\((.*)\)$)", QRegularExpression::CaseInsensitiveOption);
 
     bool inEntity = false;
     QString current;
     QStringList attrLines;
     QString parent;
 
+    bool inType = false;
+    QString typeName;
+    QString typeBody;
+
     while (!in.atEnd()) {
         QString line = in.readLine();
 
+        // TYPE ... END_TYPE; 块：枚举可能跨多行，先拼接再解析
+        if (inType) {
+            if (!line.trimmed().startsWith("END_TYPE", Qt::CaseInsensitive)) {
+                typeBody += QLatin1Char(' ') + line.trimmed();
+                continue;
+            }
+            ExpTypeInfo ti;
+            ti.name = typeName;
+            const QString body = trimSemicolon(typeBody);
+            auto em = reEnum.match(body);
+            if (em.hasMatch()) {
+                for (const QString& v : em.captured(1).split(',', Qt::SkipEmptyParts)) {
+                    if (!v.trimmed().isEmpty()) ti.enumValues << v.trimmed();
+                }
+            }
+            else {
+                ti.underlying = body;
+            }
+            types_.insert(ti.name, ti);
+            inType = false;
+            continue;
+        }
+
         if (!inEntity) {
+            auto tm = reType.match(line);
+            if (tm.hasMatch()) {
+                inType = true;
+                typeName = tm.captured(1);
+                typeBody = tm.captured(2).trimmed();
+                continue;
+            }
             auto m = reEntity.match(line);
             if (m.hasMatch()) {
                 inEntity = true;
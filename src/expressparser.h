@@ -11,6 +11,7 @@
  * - 解析 ENTITY 名称
  * - 解析 SUBTYPE OF(父类)
  * - 解析属性行（形如：  Name : Type; ）
+ * - 解析 TYPE 定义：别名（TYPE GfcDouble = REAL;）与枚举（ENUMERATION OF (...)）
  * 注意：为简化语法，本解析器不求覆盖全部 EXPRESS 语法，仅按常见格式提取。
  */
 
@@ -20,15 +21,23 @@ struct ExpClassInfo {
     QStringList attributes;    // 原始属性定义行（去掉末尾分号）
 };
 
+struct ExpTypeInfo {
+    QString name;
+    QString underlying;        // 别名的底层类型（如 REAL、GfcString）；枚举时为空
+    QStringList enumValues;    // ENUMERATION OF 的枚举项（保持声明顺序）
+};
+
 class ExpressParser {
 public:
     bool parseFile(const QString& filePath, QString* err = nullptr);
 
     const QHash<QString, ExpClassInfo>& classes() const { return classes_; }
+    const QHash<QString, ExpTypeInfo>& types() const { return types_; }
     QHash<QString, QSet<QString>> buildChildrenMap() const;
 
 private:
     QHash<QString, ExpClassInfo> classes_;
+    QHash<QString, ExpTypeInfo> types_;
 
     static QString trimSemicolon(const QString& s);
 };
@@ -0,0 +1,616 @@
+#include "gfcbinary.h"
+#include "gfcindex.h"
+#include "gfcnumber.h"
+#include "perftrace.h"
+
+#include <QHash>
+#include <QtEndian>
+#include <QtConcurrent/QtConcurrentMap>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+enum Tag : quint8 {
+    TagNull = 0,      // $
+    TagDerived = 1,   // *
+    TagInt = 2,       // zigzag varint
+    TagReal = 3,      // 8 字节小端 IEEE double
+    TagString = 4,    // 字符串表下标（引号内原文，含 '' 转义）
+    TagRef = 5,       // varint 实例号
+    TagEnum = 6,      // 字符串表下标（两点之间的名称）
+    TagList = 7,      // varint 个数 + 元素
+    TagTyped = 8,     // 字符串表下标（类型名）+ varint 个数 + 元素，如 GFCLABEL('x')
+    TagRaw = 9        // 字符串表下标（原文），非最短写法的数值、二进制 "..." 等
+};
+
+// ---- varint ----
+
+void putVarint(QByteArray& out, quint64 v)
+{
+    while (v >= 0x80) { out += char(quint8(v) | 0x80); v >>= 7; }
+    out += char(quint8(v));
+}
+
+void putSVarint(QByteArray& out, qint64 v)
+{
+    putVarint(out, (quint64(v) << 1) ^ quint64(v >> 63));
+}
+
+bool getVarint(const char*& p, const char* e, quint64& v)
+{
+    v = 0;
+    for (int shift = 0; p < e && shift < 64; shift += 7) {
+        const quint8 b = quint8(*p++);
+        v |= quint64(b & 0x7F) << shift;
+        if (!(b & 0x80)) return true;
+    }
+    return false;
+}
+
+bool getSVarint(const char*& p, const char* e, qint64& v)
+{
+    quint64 u = 0;
+    if (!getVarint(p, e, u)) return false;
+    v = qint64(u >> 1) ^ -qint64(u & 1);
+    return true;
+}
+
+void putBytes(QByteArray& out, const QByteArray& b)
+{
+    putVarint(out, quint64(b.size()));
+    out += b;
+}
+
+bool getBytes(const char*& p, const char* e, QByteArray& b)
+{
+    quint64 n = 0;
+    if (!getVarint(p, e, n) || quint64(e - p) < n) return false;
+    b = QByteArray(p, int(n));
+    p += n;
+    return true;
+}
+
+// ---- 文本参数 -> 二进制值 ----
+
+class ValueEncoder {
+public:
+    ValueEncoder(QVector<QByteArray>* strings, QHash<QByteArray, int>* stringIds)
+        : strings_(strings), stringIds_(stringIds) {}
+
+    // 编码参数区（括号内）：个数 + 各值
+    bool encodeArgs(const char* p, const char* e, QByteArray& out)
+    {
+        QByteArray body;
+        int count = 0;
+        if (!encodeList(p, e, body, count) || p != e) return false;
+        putVarint(out, quint64(count));
+        out += body;
+        return true;
+    }
+
+private:
+    QVector<QByteArray>* strings_;
+    QHash<QByteArray, int>* stringIds_;
+
+    static bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+    static const char* skip(const char* p, const char* e) { while (p < e && isSpace(*p)) ++p; return p; }
+    static bool isNameChar(char c)
+    {
+        return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_';
+    }
+
+    int stringId(const char* b, const char* e)
+    {
+        const QByteArray key = QByteArray::fromRawData(b, int(e - b));
+        auto it = stringIds_->constFind(key);
+        if (it != stringIds_->constEnd()) return it.value();
+        const QByteArray owned(b, int(e - b));
+        const int id = strings_->size();
+        strings_->push_back(owned);
+        stringIds_->insert(owned, id);
+        return id;
+    }
+
+    // 逗号分隔的值，直到 e 或未配对的 ')'
+    bool encodeList(const char*& p, const char* e, QByteArray& out, int& count)
+    {
+        count = 0;
+        p = skip(p, e);
+        if (p >= e || *p == ')') return true;
+        for (;;) {
+            if (!encodeValue(p, e, out)) return false;
+            ++count;
+            p = skip(p, e);
+            if (p < e && *p == ',') { ++p; continue; }
+            return true;
+        }
+    }
+
+    bool encodeValue(const char*& p, const char* e, QByteArray& out)
+    {
+        p = skip(p, e);
+        if (p >= e) return false;
+        const char c = *p;
+
+        if (c == '$') { ++p; out += char(TagNull); return true; }
+        if (c == '*') { ++p; out += char(TagDerived); return true; }
+
+        if (c == '#') {
+            const char* q = ++p;
+            quint64 id = 0;
+            while (p < e && *p >= '0' && *p <= '9') id = id * 10 + quint64(*p++ - '0');
+            if (p == q) return false;
+            out += char(TagRef);
+            putVarint(out, id);
+            return true;
+        }
+
+        if (c == '\'') {
+            const char* b = ++p;
+            while (p < e) {
+                if (*p == '\'') {
+                    if (p + 1 < e && p[1] == '\'') { p += 2; continue; }
+                    break;
+                }
+                ++p;
+            }
+            if (p >= e) return false;
+            out += char(TagString);
+            putVarint(out, quint64(stringId(b, p)));
+            ++p;
+            return true;
+        }
+
+        if (c == '"') {
+            const char* b = p++;
+            while (p < e && *p != '"') ++p;
+            if (p >= e) return false;
+            ++p;
+            out += char(TagRaw);
+            putVarint(out, quint64(stringId(b, p)));
+            return true;
+        }
+
+        if (c == '(') {
+            ++p;
+            QByteArray body;
+            int n = 0;
+            if (!encodeList(p, e, body, n) || p >= e || *p != ')') return false;
+            ++p;
+            out += char(TagList);
+            putVarint(out, quint64(n));
+            out += body;
+            return true;
+        }
+
+        // .ENUM.（'.' 后接数字的是实数 .5）
+        if (c == '.' && p + 1 < e && !(p[1] >= '0' && p[1] <= '9')) {
+            const char* b = ++p;
+            while (p < e && *p != '.') ++p;
+            if (p >= e) return false;
+            out += char(TagEnum);
+            putVarint(out, quint64(stringId(b, p)));
+            ++p;
+            return true;
+        }
+
+        if ((c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.') {
+            const char* b = p;
+            bool isReal = false;
+            while (p < e && ((*p >= '0' && *p <= '9') || *p == '.' || *p == 'E' || *p == 'e'
+                             || *p == '+' || *p == '-')) {
+                if (*p == '.' || *p == 'E' || *p == 'e') isReal = true;
+                ++p;
+            }
+            return encodeNumber(b, p, isReal, out);
+        }
+
+        // 带类型名的值：NAME(...)
+        if (isNameChar(c)) {
+            const char* b = p;
+            while (p < e && isNameChar(*p)) ++p;
+            const char* nameEnd = p;
+            p = skip(p, e);
+            if (p >= e || *p != '(') return false;
+            ++p;
+            QByteArray body;
+            int n = 0;
+            if (!encodeList(p, e, body, n) || p >= e || *p != ')') return false;
+            ++p;
+            out += char(TagTyped);
+            putVarint(out, quint64(stringId(b, nameEnd)));
+            putVarint(out, quint64(n));
+            out += body;
+            return true;
+        }
+        return false;
+    }
+
+    // 只有文本恰为规范写法时才存数值，否则存原文，还原时逐字一致
+    bool encodeNumber(const char* b, const char* e, bool isReal, QByteArray& out)
+    {
+        char buf[gfc::kRealBufSize];
+        if (isReal) {
+            double v = 0;
+            if (gfc::parseRealExact(b, e, v)) {
+                const int n = gfc::formatReal(v, buf);
+                if (n == int(e - b) && std::memcmp(buf, b, std::size_t(n)) == 0) {
+                    quint64 bits = 0;
+                    std::memcpy(&bits, &v, sizeof(bits));
+                    out += char(TagReal);
+                    char le[8];
+                    qToLittleEndian(bits, le);
+                    out.append(le, 8);
+                    return true;
+                }
+            }
+        }
+        else {
+            std::int64_t v = 0;
+            if (gfc::parseInteger(b, e, v) == e) {
+                const int n = gfc::formatInteger(v, buf);
+                if (n == int(e - b) && std::memcmp(buf, b, std::size_t(n)) == 0) {
+                    out += char(TagInt);
+                    putSVarint(out, v);
+                    return true;
+                }
+            }
+        }
+        out += char(TagRaw);
+        putVarint(out, quint64(stringId(b, e)));
+        return true;
+    }
+};
+
+// ---- 二进制值 -> 文本 ----
+
+class ValueDecoder {
+public:
+    explicit ValueDecoder(const QVector<QByteArray>& strings) : strings_(strings) {}
+
+    bool decodeList(const char*& p, const char* e, QByteArray& out)
+    {
+        quint64 n = 0;
+        if (!getVarint(p, e, n)) return false;
+        for (quint64 i = 0; i < n; ++i) {
+            if (i) out += ',';
+            if (!decodeValue(p, e, out)) return false;
+        }
+        return true;
+    }
+
+private:
+    const QVector<QByteArray>& strings_;
+
+    bool str(const char*& p, const char* e, const QByteArray*& s)
+    {
+        quint64 id = 0;
+        if (!getVarint(p, e, id) || id >= quint64(strings_.size())) return false;
+        s = &strings_[int(id)];
+        return true;
+    }
+
+    bool decodeValue(const char*& p, const char* e, QByteArray& out)
+    {
+        if (p >= e) return false;
+        const quint8 tag = quint8(*p++);
+        const QByteArray* s = nullptr;
+        char buf[gfc::kRealBufSize];
+        switch (tag) {
+        case TagNull: out += '$'; return true;
+        case TagDerived: out += '*'; return true;
+        case TagInt: {
+            qint64 v = 0;
+            if (!getSVarint(p, e, v)) return false;
+            out.append(buf, gfc::formatInteger(v, buf));
+            return true;
+        }
+        case TagReal: {
+            if (e - p < 8) return false;
+            const quint64 bits = qFromLittleEndian<quint64>(p);
+            p += 8;
+            double v = 0;
+            std::memcpy(&v, &bits, sizeof(v));
+            out.append(buf, gfc::formatReal(v, buf));
+            return true;
+        }
+        case TagString:
+            if (!str(p, e, s)) return false;
+            out += '\''; out += *s; out += '\'';
+            return true;
+        case TagRef: {
+            quint64 id = 0;
+            if (!getVarint(p, e, id)) return false;
+            out += '#';
+            out.append(buf, gfc::formatInteger(qint64(id), buf));
+            return true;
+        }
+        case TagEnum:
+            if (!str(p, e, s)) return false;
+            out += '.'; out += *s; out += '.';
+            return true;
+        case TagList:
+            out += '(';
+            if (!decodeList(p, e, out)) return false;
+            out += ')';
+            return true;
+        case TagTyped:
+            if (!str(p, e, s)) return false;
+            out += *s;
+            out += '(';
+            if (!decodeList(p, e, out)) return false;
+            out += ')';
+            return true;
+        case TagRaw:
+            if (!str(p, e, s)) return false;
+            out += *s;
+            return true;
+        default:
+            return false;
+        }
+    }
+};
+
+} // namespace
+
+bool GfcBinary::isBinary(const QByteArray& head)
+{
+    return head.size() >= 5 && std::memcmp(head.constData(), kMagic, 4) == 0;
+}
+
+bool GfcBinary::encode(const GfcIndex& index, QByteArray* out, QString* err)
+{
+    GFC_PERF_SCOPE("二进制编码");
+    const QByteArray& data = index.data();
+    const int classes = index.classCount();
+
+    QVector<QByteArray> strings;
+    QHash<QByteArray, int> stringIds;
+    ValueEncoder enc(&strings, &stringIds);
+
+    // 类名先进字符串表
+    QVector<int> classNameIds(classes);
+    for (int c = 0; c < classes; ++c) {
+        const QByteArray& n = index.className(c);
+        classNameIds[c] = stringIds.value(n, -1);
+        if (classNameIds[c] < 0) {
+            classNameIds[c] = strings.size();
+            strings.push_back(n);
+            stringIds.insert(n, classNameIds[c]);
+        }
+    }
+
+    QVector<QByteArray> sections(classes);
+    QVector<qint64> lastId(classes, 0);
+    QVector<int> counts(classes, 0);
+    QByteArray order;
+    order.reserve(index.size());
+
+    for (int row = 0; row < index.size(); ++row) {
+        const GfcIndexEntry& en = index.at(row);
+        QByteArray& sec = sections[en.cls];
+        putSVarint(sec, en.id - lastId[en.cls]);
+        lastId[en.cls] = en.id;
+        ++counts[en.cls];
+        putVarint(order, quint64(en.cls));
+
+        const char* p = data.constData() + en.argsBegin;
+        const char* e = data.constData() + en.argsEnd;
+        if (!enc.encodeArgs(p, e, sec)) {
+            if (err) *err = QStringLiteral("#%1 的参数无法编码").arg(en.id);
+            return false;
+        }
+    }
+
+    // 实例间分隔符：取第一处间隔；与之不同的间隔（注释、多余空行等）逐处原样保存
+    bool crlf = false;
+    if (index.size() >= 2) {
+        const qint64 gapBegin = index.at(0).end;
+        crlf = data.mid(int(gapBegin), int(index.at(1).begin - gapBegin)).endsWith("\r\n");
+    }
+    const QByteArray sep = crlf ? "\r\n" : "\n";
+    QByteArray gaps;
+    int gapCount = 0;
+    int lastGap = 0;
+    for (int row = 1; row < index.size(); ++row) {
+        const qint64 b = index.at(row - 1).end;
+        const qint64 len = index.at(row).begin - b;
+        if (len == sep.size() && std::memcmp(data.constData() + b, sep.constData(), std::size_t(len)) == 0) continue;
+        putVarint(gaps, quint64(row - lastGap));
+        putBytes(gaps, data.mid(int(b), int(len)));
+        lastGap = row;
+        ++gapCount;
+    }
+
+    QByteArray& o = *out;
+    o.clear();
+    o.append(kMagic, 4);
+    o += char(kVersion);
+    o += char(crlf ? 1 : 0);
+    putBytes(o, data.left(int(index.headerEnd())));
+    putBytes(o, data.mid(int(index.trailerBegin())));
+
+    putVarint(o, quint64(strings.size()));
+    for (const QByteArray& s : strings) putBytes(o, s);
+
+    putVarint(o, quint64(classes));
+    qint64 offset = 0;
+    for (int c = 0; c < classes; ++c) {
+        putVarint(o, quint64(classNameIds[c]));
+        putSVarint(o, index.schemaEntity(c));
+        putVarint(o, quint64(counts[c]));
+        putVarint(o, quint64(offset));
+        putVarint(o, quint64(sections[c].size()));
+        offset += sections[c].size();
+    }
+    putVarint(o, quint64(index.size()));
+    putBytes(o, order);
+    putVarint(o, quint64(gapCount));
+    o += gaps;
+    for (const QByteArray& sec : sections) o += sec;
+    return true;
+}
+
+bool GfcBinaryReader::open(const QByteArray& data, QString* err)
+{
+    GFC_PERF_SCOPE("二进制读取目录");
+    *this = GfcBinaryReader();
+    data_ = data;
+    auto fail = [err](const QString& what) {
+        if (err) *err = what;
+        return false;
+    };
+    if (!GfcBinary::isBinary(data_)) return fail(QStringLiteral("不是 GFC 二进制文件"));
+    if (data_.size() < 6) return fail(QStringLiteral("文件被截断"));
+    const quint8 version = quint8(data_[4]);
+    if (version < 1 || version > GfcBinary::kVersion) return fail(QStringLiteral("不支持的二进制版本：%1").arg(int(version)));
+    crlf_ = (data_[5] & 1) != 0;
+
+    const char* p = data_.constData() + 6;
+    const char* e = data_.constData() + data_.size();
+    quint64 n = 0;
+    if (!getBytes(p, e, header_) || !getBytes(p, e, trailer_)) return fail(QStringLiteral("文件被截断"));
+
+    if (!getVarint(p, e, n) || n > quint64(e - p)) return fail(QStringLiteral("字符串表损坏"));
+    strings_.resize(int(n));
+    for (QByteArray& s : strings_) {
+        if (!getBytes(p, e, s)) return fail(QStringLiteral("字符串表损坏"));
+    }
+
+    // 目录里的数值来自文件，先检查范围再收窄；每个实例至少占两个字节（编号差值与参数个数），个数不会超过段长
+    if (!getVarint(p, e, n) || n > quint64(e - p)) return fail(QStringLiteral("段目录损坏"));
+    sections_.resize(int(n));
+    qint64 counted = 0;
+    for (Section& s : sections_) {
+        quint64 name = 0, count = 0, off = 0, len = 0;
+        qint64 entity = -1;
+        if (!getVarint(p, e, name) || !getSVarint(p, e, entity) || !getVarint(p, e, count)
+            || !getVarint(p, e, off) || !getVarint(p, e, len) || name >= quint64(strings_.size())
+            || entity < -1 || entity > std::numeric_limits<int>::max()
+            || off > quint64(e - p) || len > quint64(e - p) || count > len) {
+            return fail(QStringLiteral("段目录损坏"));
+        }
+        s.name = int(name);
+        s.entity = int(entity);
+        s.count = int(count);
+        s.offset = qint64(off);
+        s.length = qint64(len);
+        counted += s.count;
+    }
+    if (!getVarint(p, e, n) || n != quint64(counted)) return fail(QStringLiteral("段目录损坏"));
+    total_ = int(n);
+    if (!getBytes(p, e, order_) || total_ > order_.size()) return fail(QStringLiteral("顺序流损坏"));
+
+    if (version >= 2) {
+        if (!getVarint(p, e, n) || n > quint64(e - p) || n > quint64(total_)) return fail(QStringLiteral("间隔表损坏"));
+        gaps_.resize(int(n));
+        qint64 row = 0;
+        for (Gap& g : gaps_) {
+            quint64 delta = 0;
+            if (!getVarint(p, e, delta) || delta == 0 || delta >= quint64(total_ - row) || !getBytes(p, e, g.text)) {
+                return fail(QStringLiteral("间隔表损坏"));
+            }
+            row += qint64(delta);
+            g.row = int(row);
+        }
+    }
+
+    dataBegin_ = p - data_.constData();
+    for (const Section& s : sections_) {
+        if (s.offset > e - p || s.length > e - p - s.offset) return fail(QStringLiteral("数据段越界"));
+    }
+    return true;
+}
+
+bool GfcBinaryReader::decodeClass(int cls, QVector<qint64>* ids, QByteArray* text,
+                                  QVector<int>* offsets, QString* err) const
+{
+    const Section& s = sections_[cls];
+    const char* p = data_.constData() + dataBegin_ + s.offset;
+    const char* e = p + s.length;
+    const QByteArray& name = strings_[s.name];
+
+    ValueDecoder dec(strings_);
+    ids->clear();
+    offsets->clear();
+    text->clear();
+    ids->reserve(s.count);
+    offsets->reserve(s.count + 1);
+    text->reserve(int(qMin<qint64>(s.length * 3, std::numeric_limits<int>::max() / 2)));
+    auto corrupt = [&]() {
+        if (err) *err = QStringLiteral("类段 %1 数据损坏").arg(QString::fromLatin1(name));
+        return false;
+    };
+
+    char buf[24];
+    qint64 id = 0;
+    for (int i = 0; i < s.count; ++i) {
+        qint64 delta = 0;
+        if (!getSVarint(p, e, delta)) return corrupt();
+        id += delta;
+        ids->push_back(id);
+        offsets->push_back(text->size());
+        *text += '#';
+        text->append(buf, gfc::formatInteger(id, buf));
+        *text += '=';
+        *text += name;
+        *text += '(';
+        if (!dec.decodeList(p, e, *text)) return corrupt();
+        *text += ");";
+    }
+    if (p != e) return corrupt();
+    offsets->push_back(text->size());
+    return true;
+}
+
+QByteArray GfcBinaryReader::toText(QString* err) const
+{
+    GFC_PERF_SCOPE("二进制解码为文本");
+    struct Decoded {
+        QVector<qint64> ids;
+        QByteArray text;
+        QVector<int> offsets;
+        QString err;
+        bool ok = false;
+    };
+    QVector<Decoded> parts(sections_.size());
+    QVector<int> which(sections_.size());
+    for (int c = 0; c < which.size(); ++c) which[c] = c;
+    QtConcurrent::blockingMap(which, [this, &parts](int c) {
+        Decoded& d = parts[c];
+        d.ok = decodeClass(c, &d.ids, &d.text, &d.offsets, &d.err);
+    });
+    qint64 bytes = header_.size() + trailer_.size();
+    for (const Gap& g : gaps_) bytes += g.text.size();
+    for (const Decoded& d : parts) {
+        if (!d.ok) {
+            if (err) *err = d.err;
+            return QByteArray();
+        }
+        bytes += d.text.size() + d.ids.size() * (crlf_ ? 2 : 1);
+    }
+
+    // 按顺序流交错拼接
+    QByteArray out;
+    out.reserve(int(bytes));
+    out += header_;
+    QVector<int> next(sections_.size(), 0);
+    int gap = 0;
+    const char* p = order_.constData();
+    const char* e = p + order_.size();
+    for (int i = 0; i < total_; ++i) {
+        quint64 c = 0;
+        if (!getVarint(p, e, c) || c >= quint64(parts.size()) || next[int(c)] >= parts[int(c)].ids.size()) {
+            if (err) *err = QStringLiteral("顺序流损坏");
+            return QByteArray();
+        }
+        const Decoded& d = parts[int(c)];
+        const int k = next[int(c)]++;
+        if (gap < gaps_.size() && gaps_[gap].row == i) out += gaps_[gap++].text;
+        else if (i) out += crlf_ ? "\r\n" : "\n";
+        out.append(d.text.constData() + d.offsets[k], d.offsets[k + 1] - d.offsets[k]);
+    }
+    out += trailer_;
+    return out;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+class GfcIndex;
+
+/**
+ * GFC 二进制容器（.gfcb），与文本 .gfc 无损互转：
+ * - 类表：文件内类名 + Schema 实体下标；每类一个数据段，段目录记录偏移/长度，可按类随机读取
+ * - 实例编号按段内差值 zigzag varint；引用为 varint；实数为原始 IEEE double；
+ *   字符串与枚举名进全局去重字符串表
+ * - 实例在原文件中的交错顺序单独存为一条类下标流，还原文本时顺序不变
+ * - 实数/整数只在其文本恰为最短往返写法时转为二进制数值，否则按原文保存，保证逐字还原
+ * - 实例间的间隔与首处不同时（注释、多余空行等）按实例位置原样保存（版本 2 起）
+ * HEADER 段与结尾段原样保存；只有实例参数区内的空白会被规整，参数区内的注释无法编码。
+ */
+
+class GfcBinary {
+public:
+    static constexpr char kMagic[4] = { 'G', 'F', 'C', 'B' };
+    static constexpr quint8 kVersion = 2;   // 1：无间隔表，仍可读取
+
+    static bool isBinary(const QByteArray& head);
+
+    // 由字节索引编码；index 需已 build 成功
+    static bool encode(const GfcIndex& index, QByteArray* out, QString* err = nullptr);
+};
+
+class GfcBinaryReader {
+public:
+    bool open(const QByteArray& data, QString* err = nullptr);
+
+    const QByteArray& header() const { return header_; }
+    const QByteArray& trailer() const { return trailer_; }
+    int instanceCount() const { return total_; }
+
+    int classCount() const { return sections_.size(); }
+    QByteArray className(int cls) const { return strings_.value(sections_[cls].name); }
+    int schemaEntity(int cls) const { return sections_[cls].entity; }
+    int classInstanceCount(int cls) const { return sections_[cls].count; }
+
+    // 随机读取一个类段：按段内顺序给出实例号与 "#id=CLASS(...);" 文本（offsets 为每个实例的起点，末尾多一个总长）
+    bool decodeClass(int cls, QVector<qint64>* ids, QByteArray* text, QVector<int>* offsets,
+                     QString* err = nullptr) const;
+
+    // 还原整份文本（各类段并行解码，再按顺序流交错拼接）
+    QByteArray toText(QString* err = nullptr) const;
+
+private:
+    struct Section {
+        int name = 0;        // 字符串表下标
+        int entity = -1;
+        int count = 0;
+        qint64 offset = 0;   // 相对数据区起点
+        qint64 length = 0;
+    };
+    struct Gap {
+        int row = 0;         // 该间隔位于第 row-1 与第 row 个实例之间
+        QByteArray text;
+    };
+
+    QByteArray data_;
+    QByteArray header_;
+    QByteArray trailer_;
+    QVector<QByteArray> strings_;
+    QVector<Section> sections_;
+    QByteArray order_;
+    QVector<Gap> gaps_;
+    qint64 dataBegin_ = 0;
+    int total_ = 0;
+    bool crlf_ = false;
+};
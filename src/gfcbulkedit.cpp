@@ -0,0 +1,131 @@
+#include "gfcbulkedit.h"
+#include "gfcindex.h"
+#include "gfcparallel.h"
+#include "gfctyped.h"
+#include "perftrace.h"
+#include "schemacache.h"
+
+#include <QElapsedTimer>
+#include <string>
+#include <vector>
+
+namespace {
+
+// 一处替换：[begin, end) 为原参数值的字节区间
+struct Span {
+    qint64 begin;
+    qint64 end;
+};
+
+} // namespace
+
+bool GfcBulkEdit::parseAssignment(const QString& text, QString* attribute, QByteArray* value, QString* err)
+{
+    const int eq = text.indexOf(QLatin1Char('='));
+    if (eq < 0) {
+        if (err) *err = QStringLiteral("应为“属性名 = 值”");
+        return false;
+    }
+    *attribute = text.left(eq).trimmed();
+    *value = text.mid(eq + 1).trimmed().toUtf8();
+    if (attribute->isEmpty()) {
+        if (err) *err = QStringLiteral("缺少属性名");
+        return false;
+    }
+    return checkValue(*value, err);
+}
+
+bool GfcBulkEdit::checkValue(const QByteArray& value, QString* err)
+{
+    const char c = value.isEmpty() ? '\0' : value.at(0);
+    const bool leading = c == '\'' || c == '$' || c == '*' || c == '#' || c == '.' || c == '(' || c == '+' || c == '-'
+        || (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z');
+    gfc::ArgReader r(std::string_view(value.constData(), size_t(value.size())));
+    std::string raw;
+    if (!leading || !r.readRaw(raw) || !r.finish()) {
+        if (err) *err = QStringLiteral("取值须为单个参数值，如 'C35'、3.6、.T.、#12、$");
+        return false;
+    }
+    return true;
+}
+
+bool GfcBulkEdit::apply(const GfcIndex& index, const CompiledSchema& schema, const QVector<int>& rows,
+                        const QString& attribute, const QByteArray& value, QByteArray* out, Stats* stats,
+                        QString* err)
+{
+    GFC_PERF_SCOPE("批量改属性");
+    QElapsedTimer timer;
+    timer.start();
+    if (!checkValue(value, err)) return false;
+
+    // 文件类 → 参数位置
+    QVector<int> slotOf(index.classCount(), -1);
+    bool known = false;
+    for (int c = 0; c < index.classCount(); ++c) {
+        const int e = index.schemaEntity(c);
+        if (e >= 0) slotOf[c] = schema.attributeIndex(e, attribute);
+    }
+    for (int e = 0; e < schema.entityCount() && !known; ++e) known = schema.attributeIndex(e, attribute) >= 0;
+    if (!known) {
+        if (err) *err = QStringLiteral("Schema 中没有名为 %1 的属性").arg(attribute);
+        return false;
+    }
+
+    const std::string_view target(value.constData(), size_t(value.size()));
+    const int n = rows.size();
+    const int parts = gfc::partsFor(n);
+    std::vector<std::vector<Span>> spansOf(static_cast<size_t>(parts));
+    QVector<int> unchangedOf(parts, 0), missingOf(parts, 0);
+    gfc::parallelParts(n, parts, [&](int b, int e, int part) {
+        std::vector<Span>& spans = spansOf[size_t(part)];
+        std::string raw;
+        for (int i = b; i < e; ++i) {
+            const GfcIndexEntry& en = index.at(rows[i]);
+            const int slot = slotOf[en.cls];
+            gfc::ArgReader r(index.args(rows[i]));
+            if (slot < 0 || !r.skipValues(slot) || !r.readRaw(raw)) {
+                ++missingOf[part];
+                continue;
+            }
+            // readRaw 含值后的空白，一并替换
+            size_t len = raw.size();
+            while (len > 0 && (raw[len - 1] == ' ' || raw[len - 1] == '\t' || raw[len - 1] == '\r' || raw[len - 1] == '\n')) --len;
+            if (std::string_view(raw.data(), len) == target) {
+                ++unchangedOf[part];
+                continue;
+            }
+            const qint64 end = en.argsBegin + qint64(r.offset());
+            spans.push_back({ end - qint64(raw.size()), end - qint64(raw.size() - len) });
+        }
+    });
+
+    Stats st;
+    st.instances = n;
+    for (int p = 0; p < parts; ++p) {
+        st.changed += int(spansOf[size_t(p)].size());
+        st.unchanged += unchangedOf[p];
+        st.missing += missingOf[p];
+        for (const Span& s : spansOf[size_t(p)]) st.bytesDelta += value.size() - (s.end - s.begin);
+    }
+
+    // 行号升序即字节序：按段顺序拼接
+    if (st.changed > 0) {
+        const QByteArray& data = index.data();
+        QByteArray result;
+        result.reserve(int(data.size() + st.bytesDelta));
+        qint64 at = 0;
+        for (const std::vector<Span>& spans : spansOf) {
+            for (const Span& s : spans) {
+                result.append(data.constData() + at, int(s.begin - at));
+                result.append(value);
+                at = s.end;
+            }
+        }
+        result.append(data.constData() + at, int(data.size() - at));
+        *out = result;
+    }
+    st.elapsedMs = timer.elapsed();
+    if (stats) *stats = st;
+    PerfTrace::instance().setCounter(QStringLiteral("批量改属性"), st.changed);
+    return true;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+class CompiledSchema;
+class GfcIndex;
+
+/**
+ * 批量改属性：把选中实例（通常为 GfcQuery 的结果）的某个 Schema 属性统一设为一个 STEP 值。
+ * - 参数位置按 Schema 展平属性表逐文件类预查（子类各自的位置不同）；类中没有该属性的实例跳过
+ * - 各实例的替换字节区间分段并行算出（只扫到目标参数为止），再按行序一次拼出新文本，
+ *   交给编辑器整体替换：一次撤销、一次重新分析
+ * - 取值原样写入，只校验为单个完整的参数值（'文本'、数、.枚举.、#id、$、列表、类型值），不按属性类型校验
+ */
+
+class GfcBulkEdit {
+public:
+    struct Stats {
+        int instances = 0;        // 选中的实例
+        int changed = 0;
+        int unchanged = 0;        // 已是该值
+        int missing = 0;          // 类中无此属性，或参数个数不足
+        qint64 bytesDelta = 0;    // 新文本与原文本的字节差
+        qint64 elapsedMs = 0;
+    };
+
+    // "属性名 = 值"，如 Val = 'C35'、Height = 3.6、Representations = $
+    static bool parseAssignment(const QString& text, QString* attribute, QByteArray* value, QString* err);
+    static bool checkValue(const QByteArray& value, QString* err);
+
+    // rows 为行号（升序）；changed 为 0 时 out 不变
+    static bool apply(const GfcIndex& index, const CompiledSchema& schema, const QVector<int>& rows,
+                      const QString& attribute, const QByteArray& value, QByteArray* out, Stats* stats,
+                      QString* err = nullptr);
+};
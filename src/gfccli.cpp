@@ -0,0 +1,963 @@
+#include "gfccli.h"
+#include "gfcbulkedit.h"
+#include "gfcdedupe.h"
+#include "gfcdiff.h"
+#include "gfcextract.h"
+#include "gfcfileio.h"
+#include "gfcgeometry.h"
+#include "gfcindex.h"
+#include "gfcmerge.h"
+#include "gfcmesh.h"
+#include "gfcpurge.h"
+#include "gfcquantity.h"
+#include "gfcquery.h"
+#include "gfcrenumber.h"
+#include "gfcsidecar.h"
+#include "gfcspatial.h"
+#include "gfcsqlite.h"
+#include "gfctableexport.h"
+#include "gfcvalueindex.h"
+#include "gfcweld.h"
+#include "schemacache.h"
+
+#include "gfc_entities.h"
+
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QTextStream>
+#include <cstring>
+#include <string>
+
+namespace {
+
+const char* const kCommands[] = { "convert", "diff", "merge", "renumber", "purge", "dedupe", "weld", "geometry", "mesh", "spatial", "lookup", "query", "set", "extract", "ndjson", "csv", "sqlite", "quantity", "typed" };
+
+QTextStream& out()
+{
+    static QTextStream ts(stdout);
+    return ts;
+}
+
+QTextStream& err()
+{
+    static QTextStream ts(stderr);
+    return ts;
+}
+
+// 构建期嵌入的 Schema：run() 分派子命令前读入一次，读入失败直接报错退出
+CompiledSchema& embeddedSchemaStorage()
+{
+    static CompiledSchema schema;
+    return schema;
+}
+
+const CompiledSchema& embeddedSchema()
+{
+    return embeddedSchemaStorage();
+}
+
+int runConvert(const QStringList& pos)
+{
+    if (pos.size() != 2) {
+        err() << "usage: GFCEditor convert <input> <output>   (.gfc / .gfcb, optionally + .gz / .zst)\n";
+        return 2;
+    }
+    QElapsedTimer t;
+    t.start();
+
+    QByteArray utf8;
+    QString e;
+    if (!GfcFileIO::readText(pos[0], &utf8, &e)) {
+        err() << e << "\n";
+        return 1;
+    }
+    const CompiledSchema schema = embeddedSchema();
+    GfcIndex index;
+    if (!index.build(utf8, &schema, &e)) {
+        err() << pos[0] << ": " << e << "\n";
+        return 1;
+    }
+    if (!GfcFileIO::writeText(QString::fromUtf8(utf8), pos[1], schema, GfcWriter::Options(), &e)) {
+        err() << e << "\n";
+        return 1;
+    }
+    out() << QStringLiteral("%1 -> %2：%3 个实例，%4 -> %5 字节，用时 %6 ms\n")
+                 .arg(pos[0], pos[1]).arg(index.size())
+                 .arg(QFileInfo(pos[0]).size()).arg(QFileInfo(pos[1]).size()).arg(t.elapsed());
+    return 0;
+}
+
+int runDiff(const QStringList& pos)
+{
+    if (pos.size() != 2) {
+        err() << "usage: GFCEditor diff <a> <b>\n";
+        return 2;
+    }
+    QByteArray a, b;
+    QString e;
+    if (!GfcFileIO::readText(pos[0], &a, &e) || !GfcFileIO::readText(pos[1], &b, &e)) {
+        err() << e << "\n";
+        return 2;
+    }
+    const CompiledSchema schema = embeddedSchema();
+    GfcDiff diff;
+    if (!diff.compare(a, b, &schema, &e)) {
+        err() << e << "\n";
+        return 2;
+    }
+
+    // 按类汇总（只列有差异的类）；退出码 0 相同、1 有差异、2 出错，便于脚本判断
+    int changed = 0, added = 0, removed = 0;
+    out() << QStringLiteral("%1\t%2\t%3\t%4\t%5\n")
+                 .arg(QStringLiteral("class"), QStringLiteral("same"), QStringLiteral("changed"),
+                      QStringLiteral("added"), QStringLiteral("removed"));
+    for (const GfcDiffClass& c : diff.classes()) {
+        changed += c.changed;
+        added += c.added;
+        removed += c.removed;
+        if (c.changed + c.added + c.removed == 0) continue;
+        out() << QStringLiteral("%1\t%2\t%3\t%4\t%5\n")
+                     .arg(QString::fromLatin1(c.name)).arg(c.same).arg(c.changed).arg(c.added).arg(c.removed);
+    }
+    out() << QStringLiteral("相同 %1，修改 %2，新增 %3，删除 %4，用时 %5 ms\n")
+                 .arg(diff.sameCount()).arg(changed).arg(added).arg(removed).arg(diff.elapsedMs());
+    return diff.items().isEmpty() ? 0 : 1;
+}
+
+int runMerge(const QStringList& pos, bool unify, const QString& unifyClasses)
+{
+    if (pos.size() < 3) {
+        err() << "usage: GFCEditor merge <input1> <input2> [...] <output> [--unify] [--unify-classes A,B,...]\n";
+        return 2;
+    }
+    QStringList inputs = pos;
+    const QString output = inputs.takeLast();
+
+    GfcMerge::Options opt;
+    opt.unify = unify || !unifyClasses.isEmpty();
+    if (!unifyClasses.isEmpty()) opt.unifyRoots = unifyClasses.split(QLatin1Char(','), Qt::SkipEmptyParts);
+
+    GfcMerge::Stats st;
+    QString e;
+    if (!GfcMerge::merge(inputs, output, embeddedSchema(), opt, &st, &e)) {
+        err() << e << "\n";
+        return 1;
+    }
+    for (int i = 0; i < inputs.size(); ++i) {
+        out() << QStringLiteral("%1\t+%2\n").arg(inputs[i]).arg(st.offsets.value(i));
+    }
+    out() << QStringLiteral("-> %1：%2 个实例（合并共享实体 %3），最大编号 #%4，%5 字节，用时 %6 ms\n")
+                 .arg(output).arg(st.instances).arg(st.unified).arg(st.maxId).arg(st.bytesOut).arg(st.elapsedMs);
+    return 0;
+}
+
+int runRenumber(const QStringList& pos, bool topological)
+{
+    if (pos.size() != 2) {
+        err() << "usage: GFCEditor renumber <input> <output> [--topological]\n";
+        return 2;
+    }
+    QElapsedTimer t;
+    t.start();
+    QByteArray utf8;
+    QString e;
+    if (!GfcFileIO::readText(pos[0], &utf8, &e)) {
+        err() << e << "\n";
+        return 1;
+    }
+    const CompiledSchema schema = embeddedSchema();
+    GfcIndex index;
+    QByteArray result;
+    GfcRenumber::Stats st;
+    if (!index.build(utf8, &schema, &e)
+        || !GfcRenumber::renumber(index, topological ? GfcRenumber::Topological : GfcRenumber::FileOrder, &result, &st, &e)) {
+        err() << pos[0] << ": " << e << "\n";
+        return 1;
+    }
+    if (!GfcFileIO::writeText(QString::fromUtf8(result), pos[1], schema, GfcWriter::Options(), &e)) {
+        err() << e << "\n";
+        return 1;
+    }
+    out() << QStringLiteral("%1 -> %2：%3 个实例，%4 个编号变化，%5 个移动，改写引用 %6 处，用时 %7 ms\n")
+                 .arg(pos[0], pos[1]).arg(st.instances).arg(st.idsChanged).arg(st.moved).arg(st.refs).arg(t.elapsed());
+    return 0;
+}
+
+int runPurge(const QStringList& pos, const QString& roots, bool dryRun)
+{
+    if (pos.size() != (dryRun ? 1 : 2)) {
+        err() << "usage: GFCEditor purge <input> <output> [--roots <classes>]\n"
+                 "       GFCEditor purge <input> --dry-run [--roots <classes>]\n";
+        return 2;
+    }
+    QElapsedTimer t;
+    t.start();
+    QByteArray utf8;
+    QString e;
+    if (!GfcFileIO::readText(pos[0], &utf8, &e)) {
+        err() << e << "\n";
+        return 1;
+    }
+    const CompiledSchema schema = embeddedSchema();
+    GfcIndex index;
+    if (!index.build(utf8, &schema, &e)) {
+        err() << pos[0] << ": " << e << "\n";
+        return 1;
+    }
+    const QStringList rootList = roots.isEmpty() ? GfcPurge::defaultRoots()
+                                                 : roots.split(QLatin1Char(','), Qt::SkipEmptyParts);
+    GfcPurge::Plan plan;
+    QStringList unknown;
+    GfcPurge::mark(index, schema, rootList, &plan, &unknown);
+    if (!unknown.isEmpty()) err() << "unknown root classes ignored: " << unknown.join(QStringLiteral(", ")) << "\n";
+
+    for (const GfcPurge::ClassStat& cs : plan.classes) {
+        out() << QStringLiteral("%1\t%2/%3\t%4 bytes\n")
+                     .arg(QString::fromLatin1(cs.name)).arg(cs.removed).arg(cs.total).arg(cs.bytes);
+    }
+    if (!dryRun) {
+        const QByteArray result = GfcPurge::apply(index, plan.keep);
+        if (!GfcFileIO::writeText(QString::fromUtf8(result), pos[1], schema, GfcWriter::Options(), &e)) {
+            err() << e << "\n";
+            return 1;
+        }
+    }
+    out() << QStringLiteral("%1：根实例 %2 个，不可达 %3 / %4 个实例，%5 字节%6，用时 %7 ms\n")
+                 .arg(pos[0]).arg(plan.roots).arg(plan.removed).arg(index.size()).arg(plan.bytes)
+                 .arg(dryRun ? QString() : QStringLiteral("，已写出 %1").arg(pos[1])).arg(t.elapsed());
+    return 0;
+}
+
+int runDedupe(const QStringList& pos, const QString& excluded, bool dryRun)
+{
+    if (pos.size() != (dryRun ? 1 : 2)) {
+        err() << "usage: GFCEditor dedupe <input> <output> [--exclude <classes>]\n"
+                 "       GFCEditor dedupe <input> --dry-run [--exclude <classes>]\n";
+        return 2;
+    }
+    QElapsedTimer t;
+    t.start();
+    QByteArray utf8;
+    QString e;
+    if (!GfcFileIO::readText(pos[0], &utf8, &e)) {
+        err() << e << "\n";
+        return 1;
+    }
+    const CompiledSchema schema = embeddedSchema();
+    GfcIndex index;
+    if (!index.build(utf8, &schema, &e)) {
+        err() << pos[0] << ": " << e << "\n";
+        return 1;
+    }
+    const QStringList excludedList = excluded.isEmpty() ? GfcDedupe::defaultExcludedRoots()
+                                                        : excluded.split(QLatin1Char(','), Qt::SkipEmptyParts);
+    GfcDedupe::Plan plan;
+    QStringList unknown;
+    GfcDedupe::analyze(index, schema, excludedList, &plan, &unknown);
+    if (!unknown.isEmpty()) err() << "unknown classes ignored: " << unknown.join(QStringLiteral(", ")) << "\n";
+
+    for (const GfcDedupe::ClassStat& cs : plan.classes) {
+        out() << QStringLiteral("%1\t%2/%3\t%4 bytes\n")
+                     .arg(QString::fromLatin1(cs.name)).arg(cs.duplicates).arg(cs.total).arg(cs.bytes);
+    }
+    qint64 refs = 0;
+    if (!dryRun) {
+        const QByteArray result = GfcDedupe::apply(index, plan.canon, &refs);
+        if (!GfcFileIO::writeText(QString::fromUtf8(result), pos[1], schema, GfcWriter::Options(), &e)) {
+            err() << e << "\n";
+            return 1;
+        }
+    }
+    out() << QStringLiteral("%1：重复 %2 / %3 个实例，节省约 %4 字节%5，用时 %6 ms\n")
+                 .arg(pos[0]).arg(plan.duplicates).arg(index.size()).arg(plan.bytes)
+                 .arg(dryRun ? QString() : QStringLiteral("，改写引用 %1 处，已写出 %2").arg(refs).arg(pos[1]))
+                 .arg(t.elapsed());
+    return 0;
+}
+
+int runWeld(const QStringList& pos, const QString& epsText, bool dryRun)
+{
+    bool ok = false;
+    const double eps = epsText.toDouble(&ok);
+    if (pos.size() != (dryRun ? 1 : 2) || !ok) {
+        err() << "usage: GFCEditor weld <input> <output> [--epsilon <eps>]\n"
+                 "       GFCEditor weld <input> --dry-run [--epsilon <eps>]\n";
+        return 2;
+    }
+    QElapsedTimer t;
+    t.start();
+    QByteArray utf8;
+    QString e;
+    if (!GfcFileIO::readText(pos[0], &utf8, &e)) {
+        err() << e << "\n";
+        return 1;
+    }
+    const CompiledSchema schema = embeddedSchema();
+    GfcIndex index;
+    QVector<int> canon;
+    GfcWeld::Stats st;
+    if (!index.build(utf8, &schema, &e) || !GfcWeld::analyze(index, schema, eps, &canon, &st, &e)) {
+        err() << pos[0] << ": " << e << "\n";
+        return 1;
+    }
+    qint64 refs = 0;
+    if (!dryRun) {
+        const QByteArray result = GfcDedupe::apply(index, canon, &refs);
+        if (!GfcFileIO::writeText(QString::fromUtf8(result), pos[1], schema, GfcWriter::Options(), &e)) {
+            err() << e << "\n";
+            return 1;
+        }
+    }
+    out() << QStringLiteral("%1：2D %2/%3，3D %4/%5 个点合并，最大移动 %6，节省约 %7 字节%8，用时 %9 ms\n")
+                 .arg(pos[0]).arg(st.welded[0]).arg(st.points[0]).arg(st.welded[1]).arg(st.points[1])
+                 .arg(st.maxShift, 0, 'g', 6).arg(st.bytes)
+                 .arg(dryRun ? QString() : QStringLiteral("，改写引用 %1 处，已写出 %2").arg(refs).arg(pos[1]))
+                 .arg(t.elapsed());
+    return 0;
+}
+
+int runGeometry(const QStringList& pos, const QString& csvPath)
+{
+    if (pos.size() != 1) {
+        err() << "usage: GFCEditor geometry <input> [--csv <elements.csv>]\n";
+        return 2;
+    }
+    QElapsedTimer t;
+    t.start();
+    QByteArray utf8;
+    QString e;
+    if (!GfcFileIO::readText(pos[0], &utf8, &e)) {
+        err() << e << "\n";
+        return 1;
+    }
+    const CompiledSchema schema = embeddedSchema();
+    GfcIndex index;
+    if (!index.build(utf8, &schema, &e)) {
+        err() << pos[0] << ": " << e << "\n";
+        return 1;
+    }
+    GfcGeometryEvaluator::Summary sum;
+    const QVector<GfcElementGeometry> results = GfcGeometryEvaluator(index, schema).evaluateAll(&sum);
+
+    if (!csvPath.isEmpty()) {
+        QByteArray csv("\xEF\xBB\xBF" "id,class,volume,area,min_x,min_y,min_z,max_x,max_y,max_z,skipped\n");
+        for (const GfcElementGeometry& g : results) {
+            const GfcIndexEntry& en = index.at(g.row);
+            csv += '#' + QByteArray::number(en.id) + ',' + index.className(en.cls) + ','
+                 + QByteArray::number(g.volume, 'g', 12) + ',' + QByteArray::number(g.area, 'g', 12);
+            for (int k = 0; k < 6; ++k) {
+                csv += ',';
+                if (!g.box.isEmpty()) csv += QByteArray::number(k < 3 ? g.box.min[k] : g.box.max[k - 3], 'g', 12);
+            }
+            csv += ',' + QByteArray::number(g.skipped) + '\n';
+        }
+        QFile f(csvPath);
+        if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate) || f.write(csv) != csv.size()) {
+            err() << csvPath << ": " << f.errorString() << "\n";
+            return 1;
+        }
+    }
+
+    out() << QStringLiteral("%1：构件 %2（完整 %3，部分 %4，无可计算形体 %5），总体积 %6，总表面积 %7，计算 %8 ms，总用时 %9 ms\n")
+                 .arg(pos[0]).arg(sum.elements).arg(sum.complete).arg(sum.partial).arg(sum.empty)
+                 .arg(sum.volume, 0, 'g', 10).arg(sum.area, 0, 'g', 10).arg(sum.elapsedMs).arg(t.elapsed());
+    if (!sum.box.isEmpty()) {
+        out() << QStringLiteral("包围盒 (%1, %2, %3) - (%4, %5, %6)\n")
+                     .arg(sum.box.min[0], 0, 'g', 8).arg(sum.box.min[1], 0, 'g', 8).arg(sum.box.min[2], 0, 'g', 8)
+                     .arg(sum.box.max[0], 0, 'g', 8).arg(sum.box.max[1], 0, 'g', 8).arg(sum.box.max[2], 0, 'g', 8);
+    }
+    for (auto it = sum.skippedClasses.constBegin(); it != sum.skippedClasses.constEnd(); ++it) {
+        out() << QStringLiteral("  跳过 %1 ×%2\n").arg(QString::fromLatin1(it.key())).arg(it.value());
+    }
+    return 0;
+}
+
+int runMesh(const QStringList& pos, const QString& tolText)
+{
+    bool ok = false;
+    const double tol = tolText.toDouble(&ok);
+    if (pos.size() != 2 || !ok || !(tol > 0)) {
+        err() << "usage: GFCEditor mesh <input> <output.obj|output.stl> [--tolerance <chord>]\n";
+        return 2;
+    }
+    QElapsedTimer t;
+    t.start();
+    QByteArray utf8;
+    QString e;
+    if (!GfcFileIO::readText(pos[0], &utf8, &e)) {
+        err() << e << "\n";
+        return 1;
+    }
+    const CompiledSchema schema = embeddedSchema();
+    GfcIndex index;
+    if (!index.build(utf8, &schema, &e)) {
+        err() << pos[0] << ": " << e << "\n";
+        return 1;
+    }
+    GfcMeshOptions opt;
+    opt.chordTolerance = tol;
+    GfcMeshExport::Stats st;
+    if (!GfcMeshExport::write(index, schema, pos[1], opt, &st, &e)) {
+        err() << e << "\n";
+        return 1;
+    }
+    out() << QStringLiteral("%1 -> %2：构件 %3/%4，顶点 %5，三角形 %6，共用截面 %7，%8 字节，网格化与写出 %9 ms，总用时 %10 ms\n")
+                 .arg(pos[0], pos[1]).arg(st.meshed).arg(st.elements).arg(st.vertices).arg(st.triangles)
+                 .arg(st.sections).arg(st.bytes).arg(st.elapsedMs).arg(t.elapsed());
+    for (auto it = st.skippedClasses.constBegin(); it != st.skippedClasses.constEnd(); ++it) {
+        out() << QStringLiteral("  跳过 %1 ×%2\n").arg(QString::fromLatin1(it.key())).arg(it.value());
+    }
+    return 0;
+}
+
+int runSpatial(const QStringList& pos)
+{
+    GfcSpatialIndex::Query query;
+    QString e;
+    if (pos.size() < 2 || !GfcSpatialIndex::parseQuery(pos.mid(1).join(QLatin1Char(' ')), &query, &e)) {
+        if (!e.isEmpty()) err() << e << "\n";
+        err() << "usage: GFCEditor spatial <input> \"box x0 y0 z0 x1 y1 z1\" | \"point x y z\" | \"knn x y z [k]\"\n";
+        return 2;
+    }
+    QElapsedTimer t;
+    t.start();
+    QByteArray utf8;
+    if (!GfcFileIO::readText(pos[0], &utf8, &e)) {
+        err() << e << "\n";
+        return 1;
+    }
+    const CompiledSchema schema = embeddedSchema();
+    GfcIndex index;
+    if (!index.build(utf8, &schema, &e)) {
+        err() << pos[0] << ": " << e << "\n";
+        return 1;
+    }
+
+    // 旁路索引内容键相符时直接读入，否则重建并写回
+    const QString sidecarPath = GfcSidecar::pathFor(pos[0]);
+    GfcSidecar sidecar;
+    GfcSpatialIndex sx;
+    QString source = QStringLiteral("旁路索引");
+    if (!sidecar.load(sidecarPath, GfcSidecar::contentKey(utf8))
+        || !sx.deserialize(sidecar.section(GfcSpatialIndex::sidecarTag()))) {
+        GfcSpatialIndex::BuildStats bs;
+        sx = GfcSpatialIndex::build(index, schema, &bs);
+        source = QStringLiteral("新建索引：构件 %1，入索引 %2（声明包围盒 %3），结点 %4，%5 ms")
+                     .arg(bs.elements).arg(bs.indexed).arg(bs.declared).arg(bs.nodes).arg(bs.elapsedMs);
+        sidecar.setSection(GfcSpatialIndex::sidecarTag(), sx.serialize());
+        if (!sidecar.save(sidecarPath, &e)) err() << e << "\n";
+    }
+
+    const QVector<GfcSpatialIndex::Hit> hits = sx.run(query);
+    for (const GfcSpatialIndex::Hit& h : hits) {
+        const int row = index.rowOf(h.id);
+        if (row < 0) continue;
+        out() << '#' << h.id << '\t' << QString::fromLatin1(index.className(index.at(row).cls));
+        if (query.kind == GfcSpatialIndex::Query::Nearest) out() << '\t' << QString::number(h.distance, 'g', 10);
+        out() << '\n';
+    }
+    out() << QStringLiteral("%1：命中 %2 个构件（%3），总用时 %4 ms\n").arg(pos[0]).arg(hits.size()).arg(source).arg(t.elapsed());
+    return 0;
+}
+
+int runLookup(const QStringList& pos)
+{
+    if (pos.size() < 2) {
+        err() << "usage: GFCEditor lookup <input> <value>[*] ...   (trailing * = prefix)\n";
+        return 2;
+    }
+    QElapsedTimer t;
+    t.start();
+    QByteArray utf8;
+    QString e;
+    if (!GfcFileIO::readText(pos[0], &utf8, &e)) {
+        err() << e << "\n";
+        return 1;
+    }
+    const CompiledSchema schema = embeddedSchema();
+    GfcIndex index;
+    if (!index.build(utf8, &schema, &e)) {
+        err() << pos[0] << ": " << e << "\n";
+        return 1;
+    }
+
+    bool loaded = false;
+    GfcValueIndex::Stats vs;
+    const GfcValueIndex vx = GfcValueIndex::loadOrBuild(index, GfcSidecar::pathFor(pos[0]), &loaded, &vs);
+    const QString source = loaded ? QStringLiteral("旁路索引")
+        : QStringLiteral("新建索引：字符串 %1，整值 %2，词 %3，出现 %4，%5 ms")
+              .arg(vs.strings).arg(vs.values).arg(vs.tokens).arg(vs.postings).arg(vs.elapsedMs);
+    out() << QStringLiteral("%1：%2\n").arg(pos[0], source);
+
+    for (QString term : pos.mid(1)) {
+        const bool prefix = term.endsWith(QLatin1Char('*'));
+        if (prefix) term.chop(1);
+        QElapsedTimer q;
+        q.start();
+        const QVector<GfcValueIndex::Posting> hits = vx.lookup(term, prefix);
+        const qint64 us = q.nsecsElapsed() / 1000;
+        for (const GfcValueIndex::Posting& h : hits) {
+            const GfcIndexEntry& en = index.at(h.row);
+            const int ent = index.schemaEntity(en.cls);
+            const QString attr = ent >= 0 && h.slot < schema.attributeCount(ent) ? schema.attribute(ent, h.slot).name
+                                                                                 : QStringLiteral("#%1").arg(h.slot);
+            out() << '#' << en.id << '\t' << QString::fromLatin1(index.className(en.cls)) << '\t' << attr << '\n';
+        }
+        out() << QStringLiteral("“%1%2”：%3 处，%4 µs\n").arg(term, prefix ? QStringLiteral("*") : QString()).arg(hits.size()).arg(us);
+    }
+    out() << QStringLiteral("总用时 %1 ms\n").arg(t.elapsed());
+    return 0;
+}
+
+int runQuery(const QStringList& pos)
+{
+    if (pos.size() != 2) {
+        err() << "usage: GFCEditor query <input> \"<Class|*> [where <condition>]\"\n";
+        return 2;
+    }
+    QElapsedTimer t;
+    t.start();
+    QByteArray utf8;
+    QString e;
+    if (!GfcFileIO::readText(pos[0], &utf8, &e)) {
+        err() << e << "\n";
+        return 1;
+    }
+    const CompiledSchema schema = embeddedSchema();
+    GfcQuery query;
+    if (!query.parse(pos[1], schema, &e)) {
+        err() << e << "\n";
+        return 2;
+    }
+    GfcIndex index;
+    if (!index.build(utf8, &schema, &e)) {
+        err() << pos[0] << ": " << e << "\n";
+        return 1;
+    }
+    if (query.usesRefs()) index.buildRefs();
+
+    // 旁路索引里已有取值索引时才用，不为一次查询新建
+    GfcValueIndex vx;
+    GfcSidecar sidecar;
+    const bool hasValues = sidecar.load(GfcSidecar::pathFor(pos[0]), GfcSidecar::contentKey(index.data()))
+        && vx.deserialize(sidecar.section(GfcValueIndex::sidecarTag()));
+
+    GfcQuery::Stats stats;
+    const bool ok = query.run(index, hasValues ? &vx : nullptr, [&index](const QVector<int>& rows) {
+        for (int row : rows) {
+            const GfcIndexEntry& en = index.at(row);
+            out() << '#' << en.id << '\t' << QString::fromLatin1(index.className(en.cls)) << '\n';
+        }
+        out().flush();
+        return true;
+    }, &stats, &e);
+    if (!ok) {
+        err() << e << "\n";
+        return 1;
+    }
+    out() << QStringLiteral("%1：命中 %2 个实例（候选 %3；%4），查询 %5 ms，总用时 %6 ms\n")
+                 .arg(pos[0]).arg(stats.matches).arg(stats.candidates).arg(stats.plan).arg(stats.elapsedMs).arg(t.elapsed());
+    return 0;
+}
+
+int runSet(const QStringList& pos, bool dryRun)
+{
+    if (pos.size() != (dryRun ? 3 : 4)) {
+        err() << "usage: GFCEditor set <input> <output> \"<query>\" \"<Attribute> = <value>\"\n"
+                 "       GFCEditor set <input> --dry-run \"<query>\" \"<Attribute> = <value>\"\n";
+        return 2;
+    }
+    const QString queryText = pos[pos.size() - 2];
+    const QString assignment = pos[pos.size() - 1];
+    QElapsedTimer t;
+    t.start();
+    QByteArray utf8;
+    QString e;
+    if (!GfcFileIO::readText(pos[0], &utf8, &e)) {
+        err() << e << "\n";
+        return 1;
+    }
+    const CompiledSchema schema = embeddedSchema();
+    GfcQuery query;
+    QString attribute;
+    QByteArray value;
+    if (!query.parse(queryText, schema, &e) || !GfcBulkEdit::parseAssignment(assignment, &attribute, &value, &e)) {
+        err() << e << "\n";
+        return 2;
+    }
+    GfcIndex index;
+    if (!index.build(utf8, &schema, &e)) {
+        err() << pos[0] << ": " << e << "\n";
+        return 1;
+    }
+    if (query.usesRefs()) index.buildRefs();
+
+    QVector<int> rows;
+    QByteArray result;
+    GfcBulkEdit::Stats st;
+    if (!query.run(index, nullptr, [&rows](const QVector<int>& chunk) {
+            rows += chunk;
+            return true;
+        }, nullptr, &e)
+        || !GfcBulkEdit::apply(index, schema, rows, attribute, value, &result, &st, &e)) {
+        err() << e << "\n";
+        return 1;
+    }
+    if (!dryRun && !GfcFileIO::writeText(QString::fromUtf8(st.changed ? result : utf8), pos[1], schema,
+                                         GfcWriter::Options(), &e)) {
+        err() << e << "\n";
+        return 1;
+    }
+    out() << QStringLiteral("%1：选中 %2 个实例，%3 改为 %4：%5 个，已是该值 %6 个，无此属性 %7 个%8，用时 %9 ms\n")
+                 .arg(pos[0]).arg(st.instances).arg(attribute, QString::fromUtf8(value)).arg(st.changed)
+                 .arg(st.unchanged).arg(st.missing)
+                 .arg(dryRun ? QString() : QStringLiteral("，已写出 %1").arg(pos[1])).arg(t.elapsed());
+    return 0;
+}
+
+int runExtract(const QStringList& pos, bool withRelations)
+{
+    if (pos.size() != 3) {
+        err() << "usage: GFCEditor extract <input> <output> \"<query>\"|\"#id ...\" [--with-relations]\n";
+        return 2;
+    }
+    QElapsedTimer t;
+    t.start();
+    QByteArray utf8;
+    QString e;
+    if (!GfcFileIO::readText(pos[0], &utf8, &e)) {
+        err() << e << "\n";
+        return 1;
+    }
+    const CompiledSchema schema = embeddedSchema();
+    const bool byQuery = !pos[2].trimmed().startsWith(QLatin1Char('#'));
+    GfcQuery query;
+    if (byQuery && !query.parse(pos[2], schema, &e)) {
+        err() << e << "\n";
+        return 2;
+    }
+    GfcIndex index;
+    if (!index.build(utf8, &schema, &e)) {
+        err() << pos[0] << ": " << e << "\n";
+        return 1;
+    }
+    index.buildRefs();
+    const qint64 loadMs = t.elapsed();
+
+    QVector<int> seeds;
+    if (byQuery) {
+        if (!query.run(index, nullptr, [&seeds](const QVector<int>& chunk) {
+                seeds += chunk;
+                return true;
+            }, nullptr, &e)) {
+            err() << e << "\n";
+            return 1;
+        }
+    }
+    else {
+        for (const QString& tok : pos[2].split(QLatin1Char('#'), Qt::SkipEmptyParts)) {
+            const int row = index.rowOf(tok.trimmed().toLongLong());
+            if (row >= 0) seeds << row;
+        }
+    }
+    GfcExtract::Options opt;
+    opt.withRelations = withRelations;
+    GfcExtract::Stats st;
+    if (!GfcExtract::extract(index, schema, seeds, pos[1], opt, &st, &e)) {
+        err() << e << "\n";
+        return 1;
+    }
+    out() << QStringLiteral("%1 -> %2：起点 %3 个，闭包 %4 个实例（关系 %5 个，删去引用 %6 处），%7 字节；"
+                            "建索引 %8 ms，提取 %9 ms\n")
+                 .arg(pos[0], pos[1]).arg(st.seeds).arg(st.instances).arg(st.relations).arg(st.droppedRefs)
+                 .arg(st.bytesOut).arg(loadMs).arg(st.elapsedMs);
+    return 0;
+}
+
+// ndjson：<input> <output>；csv：<input> <dir>（每类一个 <类名>.csv）
+int runTables(const QStringList& pos, bool csv, const QString& classes)
+{
+    if (pos.size() != 2) {
+        err() << (csv ? "usage: GFCEditor csv <input> <dir> [--classes A,B]\n"
+                      : "usage: GFCEditor ndjson <input> <output[.gz|.zst]> [--classes A,B]\n");
+        return 2;
+    }
+    QElapsedTimer t;
+    t.start();
+    QByteArray utf8;
+    QString e;
+    if (!GfcFileIO::readText(pos[0], &utf8, &e)) {
+        err() << e << "\n";
+        return 1;
+    }
+    const CompiledSchema schema = embeddedSchema();
+    GfcIndex index;
+    if (!index.build(utf8, &schema, &e)) {
+        err() << pos[0] << ": " << e << "\n";
+        return 1;
+    }
+    const qint64 loadMs = t.elapsed();
+    GfcTableExport::Options opt;
+    opt.classes = classes.split(QLatin1Char(','), Qt::SkipEmptyParts);
+    GfcTableExport::Stats st;
+    const bool ok = csv ? GfcTableExport::writeCsvTables(index, schema, pos[1], QStringLiteral(".csv"), opt, &st, &e)
+                        : GfcTableExport::writeNdjson(index, schema, pos[1], opt, &st, &e);
+    if (!ok) {
+        err() << e << "\n";
+        return 1;
+    }
+    out() << QStringLiteral("%1 -> %2：实例 %3，类 %4，文件 %5，%6 字节；建索引 %7 ms，导出 %8 ms\n")
+                 .arg(pos[0], pos[1]).arg(st.instances).arg(st.classes).arg(st.files).arg(st.bytesOut)
+                 .arg(loadMs).arg(st.elapsedMs);
+    return 0;
+}
+
+int runSqlite(const QStringList& pos, const QString& classes)
+{
+    if (pos.size() != 2) {
+        err() << "usage: GFCEditor sqlite <input> <output.sqlite> [--classes A,B]\n";
+        return 2;
+    }
+    if (!GfcSqliteExport::available()) {
+        err() << "本版本未启用 SQLite 支持\n";
+        return 1;
+    }
+    QElapsedTimer t;
+    t.start();
+    QByteArray utf8;
+    QString e;
+    if (!GfcFileIO::readText(pos[0], &utf8, &e)) {
+        err() << e << "\n";
+        return 1;
+    }
+    const CompiledSchema schema = embeddedSchema();
+    GfcIndex index;
+    if (!index.build(utf8, &schema, &e)) {
+        err() << pos[0] << ": " << e << "\n";
+        return 1;
+    }
+    const qint64 loadMs = t.elapsed();
+    GfcSqliteExport::Options opt;
+    opt.classes = classes.split(QLatin1Char(','), Qt::SkipEmptyParts);
+    GfcSqliteExport::Stats st;
+    if (!GfcSqliteExport::write(index, schema, pos[1], opt, &st, &e)) {
+        err() << e << "\n";
+        return 1;
+    }
+    out() << QStringLiteral("%1 -> %2：实例 %3，表 %4，链接 %5，索引 %6，%7 字节；建索引 %8 ms，导出 %9 ms\n")
+                 .arg(pos[0], pos[1]).arg(st.instances).arg(st.tables).arg(st.links).arg(st.indexes)
+                 .arg(st.bytesOut).arg(loadMs).arg(st.elapsedMs);
+    return 0;
+}
+
+int runQuantity(const QStringList& pos, const QString& csvPath)
+{
+    if (pos.size() != 1) {
+        err() << "usage: GFCEditor quantity <input> [--csv <report.csv>]\n";
+        return 2;
+    }
+    QElapsedTimer t;
+    t.start();
+    QByteArray utf8;
+    QString e;
+    if (!GfcFileIO::readText(pos[0], &utf8, &e)) {
+        err() << e << "\n";
+        return 1;
+    }
+    const CompiledSchema schema = embeddedSchema();
+    GfcIndex index;
+    if (!index.build(utf8, &schema, &e)) {
+        err() << pos[0] << ": " << e << "\n";
+        return 1;
+    }
+    GfcQuantityReport::Options opt;
+    GfcQuantityReport::Result res;
+    if (!GfcQuantityReport::compute(index, schema, &res, opt, &e)) {
+        err() << e << "\n";
+        return 1;
+    }
+    if (!csvPath.isEmpty()) {
+        const QByteArray csv = GfcQuantityReport::toCsv(res, opt);
+        QFile f(csvPath);
+        if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate) || f.write(csv) != csv.size()) {
+            err() << csvPath << ": " << f.errorString() << "\n";
+            return 1;
+        }
+    }
+
+    out() << QStringLiteral("%1：明细 %2 条，汇总 %3 条，分组 %4，不符或无汇总 %5；汇总 %6 ms，总用时 %7 ms\n")
+                 .arg(pos[0]).arg(res.details).arg(res.totals).arg(res.groups.size()).arg(res.mismatches)
+                 .arg(res.elapsedMs).arg(t.elapsed());
+    static const char* const kKind[] = { "定额", "清单", "钢筋" };
+    for (const GfcQuantityGroup& g : res.groups) {
+        if (g.matches(opt.tolerance)) continue;
+        const QString key = g.kind == GfcQuantityGroup::Steel ? QStringLiteral("%1 Φ%2").arg(g.code).arg(g.dia) : g.code;
+        out() << QStringLiteral("  %1 %2 %3：明细合计 %4，汇总 %5\n")
+                     .arg(QString::fromUtf8(kKind[g.kind]), key, g.name)
+                     .arg(g.quantity, 0, 'g', 12)
+                     .arg(g.hasTotal ? QString::number(g.total, 'g', 12) : QStringLiteral("无"));
+    }
+    return 0;
+}
+
+// 生成的类型化编解码自检：decode -> encode -> decode -> encode，两次编码须一致
+using TypedRoundTrip = bool (*)(std::string_view args, std::string& once, std::string& twice);
+
+template<class E> bool typedRoundTrip(std::string_view args, std::string& once, std::string& twice)
+{
+    E first;
+    E second;
+    if (!gfc::decode(args, first)) return false;
+    once = gfc::encode(first);
+    if (!gfc::decode(once, second)) return false;
+    twice = gfc::encode(second);
+    return true;
+}
+
+QHash<QString, TypedRoundTrip> typedCodecs()
+{
+    QHash<QString, TypedRoundTrip> table;
+#define GFC_TYPED_CODEC(E) \
+    table.insert(QString::fromLatin1(gfc::EntityTraits<gfc::E>::name.data(), int(gfc::EntityTraits<gfc::E>::name.size())), \
+                 &typedRoundTrip<gfc::E>);
+    GFC_FOR_EACH_ENTITY(GFC_TYPED_CODEC)
+#undef GFC_TYPED_CODEC
+    return table;
+}
+
+int runTyped(const QStringList& pos)
+{
+    if (pos.size() != 1) {
+        err() << "usage: GFCEditor typed <input>\n";
+        return 2;
+    }
+    QElapsedTimer t;
+    t.start();
+    QByteArray utf8;
+    QString e;
+    if (!GfcFileIO::readText(pos[0], &utf8, &e)) {
+        err() << e << "\n";
+        return 1;
+    }
+    const CompiledSchema schema = embeddedSchema();
+    GfcIndex index;
+    if (!index.build(utf8, &schema, &e)) {
+        err() << pos[0] << ": " << e << "\n";
+        return 1;
+    }
+
+    const QHash<QString, TypedRoundTrip> table = typedCodecs();
+    QVector<TypedRoundTrip> codec(index.classCount(), nullptr);
+    for (int c = 0; c < index.classCount(); ++c) {
+        const int ent = index.schemaEntity(c);
+        if (ent >= 0) codec[c] = table.value(schema.name(ent));
+    }
+
+    // 解码失败与往返不一致各列前几条，便于定位生成器回归
+    int checked = 0, failed = 0, unstable = 0, skipped = 0;
+    std::string once, twice;
+    for (int r = 0; r < index.size(); ++r) {
+        const GfcIndexEntry& en = index.at(r);
+        const TypedRoundTrip f = codec[en.cls];
+        if (!f) {
+            ++skipped;
+            continue;
+        }
+        ++checked;
+        const char* problem = nullptr;
+        if (!f(index.args(r), once, twice)) {
+            ++failed;
+            problem = "decode failed";
+        }
+        else if (once != twice) {
+            ++unstable;
+            problem = "round-trip differs";
+        }
+        if (problem && failed + unstable <= 20) {
+            out() << '#' << en.id << '\t' << QString::fromLatin1(index.className(en.cls)) << '\t' << problem << '\n';
+        }
+    }
+    out() << QStringLiteral("%1：类型化实体 %2 个（生成类型 %3 种），解码失败 %4，往返不一致 %5，Schema 外 %6，用时 %7 ms\n")
+                 .arg(pos[0]).arg(checked).arg(table.size()).arg(failed).arg(unstable).arg(skipped).arg(t.elapsed());
+    return failed + unstable == 0 ? 0 : 1;
+}
+
+} // namespace
+
+bool GfcCli::isCliInvocation(int argc, char* argv[])
+{
+    if (argc < 2) return false;
+    for (const char* c : kCommands) {
+        if (std::strcmp(argv[1], c) == 0) return true;
+    }
+    return false;
+}
+
+int GfcCli::run(const QStringList& args)
+{
+    QCommandLineParser parser;
+    parser.setApplicationDescription(QStringLiteral("GFC Editor 命令行模式"));
+    parser.addHelpOption();
+    parser.addPositionalArgument(QStringLiteral("command"), QStringLiteral("子命令：convert | diff | merge | renumber | purge | dedupe | weld | geometry | mesh | spatial | lookup | query | set | extract | ndjson | csv | sqlite | quantity | typed"));
+    const QCommandLineOption unifyOpt(QStringLiteral("unify"), QStringLiteral("merge：合并各文件中相同的项目/空间结构/几何实体"));
+    const QCommandLineOption unifyClassesOpt(QStringLiteral("unify-classes"),
+        QStringLiteral("merge：参与合并的根类（逗号分隔，含子类）"), QStringLiteral("classes"));
+    const QCommandLineOption topoOpt(QStringLiteral("topological"), QStringLiteral("renumber：按拓扑顺序重排（被引用的实例在前）"));
+    parser.addOption(unifyOpt);
+    parser.addOption(unifyClassesOpt);
+    const QCommandLineOption rootsOpt(QStringLiteral("roots"),
+        QStringLiteral("purge：根类（逗号分隔，含子类），默认 GfcProject,GfcRelationShip"), QStringLiteral("classes"));
+    const QCommandLineOption excludeOpt(QStringLiteral("exclude"),
+        QStringLiteral("dedupe：不参与合并的类（逗号分隔，含子类），默认 GfcObject,GfcRelationShip"), QStringLiteral("classes"));
+    const QCommandLineOption epsOpt(QStringLiteral("epsilon"), QStringLiteral("weld：容差，默认 1e-6"), QStringLiteral("eps"),
+                                    QStringLiteral("1e-6"));
+    const QCommandLineOption dryRunOpt(QStringLiteral("dry-run"), QStringLiteral("purge/dedupe/weld/set：只报告，不写出"));
+    parser.addOption(topoOpt);
+    parser.addOption(rootsOpt);
+    parser.addOption(excludeOpt);
+    parser.addOption(epsOpt);
+    const QCommandLineOption csvOpt(QStringLiteral("csv"), QStringLiteral("geometry：逐构件结果写出为 CSV；quantity：汇总报表写出为 CSV"), QStringLiteral("file"));
+    parser.addOption(dryRunOpt);
+    const QCommandLineOption tolOpt(QStringLiteral("tolerance"), QStringLiteral("mesh：圆弧弦高容差，默认 1"), QStringLiteral("chord"),
+                                    QStringLiteral("1"));
+    parser.addOption(csvOpt);
+    parser.addOption(tolOpt);
+    const QCommandLineOption relOpt(QStringLiteral("with-relations"), QStringLiteral("extract：同时带上引用起点实例的关系实例"));
+    parser.addOption(relOpt);
+    const QCommandLineOption classesOpt(QStringLiteral("classes"),
+        QStringLiteral("ndjson/csv/sqlite：只导出这些类（逗号分隔，含子类）"), QStringLiteral("classes"));
+    parser.addOption(classesOpt);
+    parser.process(args);
+
+    QStringList pos = parser.positionalArguments();
+    const QString cmd = pos.takeFirst();
+    QString schemaErr;
+    if (!embeddedSchemaStorage().deserialize(CompiledSchema::embeddedBlob(), &schemaErr)) {
+        err() << "embedded schema: " << schemaErr << "\n";
+        return 1;
+    }
+    if (cmd == QLatin1String("convert")) return runConvert(pos);
+    if (cmd == QLatin1String("diff")) return runDiff(pos);
+    if (cmd == QLatin1String("merge")) return runMerge(pos, parser.isSet(unifyOpt), parser.value(unifyClassesOpt));
+    if (cmd == QLatin1String("renumber")) return runRenumber(pos, parser.isSet(topoOpt));
+    if (cmd == QLatin1String("weld")) return runWeld(pos, parser.value(epsOpt), parser.isSet(dryRunOpt));
+    if (cmd == QLatin1String("dedupe")) return runDedupe(pos, parser.value(excludeOpt), parser.isSet(dryRunOpt));
+    if (cmd == QLatin1String("purge")) return runPurge(pos, parser.value(rootsOpt), parser.isSet(dryRunOpt));
+    if (cmd == QLatin1String("geometry")) return runGeometry(pos, parser.value(csvOpt));
+    if (cmd == QLatin1String("mesh")) return runMesh(pos, parser.value(tolOpt));
+    if (cmd == QLatin1String("spatial")) return runSpatial(pos);
+    if (cmd == QLatin1String("lookup")) return runLookup(pos);
+    if (cmd == QLatin1String("query")) return runQuery(pos);
+    if (cmd == QLatin1String("set")) return runSet(pos, parser.isSet(dryRunOpt));
+    if (cmd == QLatin1String("extract")) return runExtract(pos, parser.isSet(relOpt));
+    if (cmd == QLatin1String("ndjson")) return runTables(pos, false, parser.value(classesOpt));
+    if (cmd == QLatin1String("csv")) return runTables(pos, true, parser.value(classesOpt));
+    if (cmd == QLatin1String("sqlite")) return runSqlite(pos, parser.value(classesOpt));
+    if (cmd == QLatin1String("quantity")) return runQuantity(pos, parser.value(csvOpt));
+    if (cmd == QLatin1String("typed")) return runTyped(pos);
+    err() << "unknown command: " << cmd << "\n";
+    return 2;
+}
@@ -0,0 +1,17 @@
+#pragma once
+#include <QStringList>
+
+/**
+ * 命令行模式（不创建窗口）：GFCEditor <子命令> [参数...]
+ *   convert <输入> <输出>    文本 .gfc 与二进制 .gfcb 互转，可加 .gz/.zst 压缩（按输出扩展名决定格式）
+ *   diff <A> <B>             语义比较（与 #id 编号无关），按类输出相同/修改/新增/删除；退出码 0 相同、1 有差异、2 出错
+ *   merge <输入...> <输出>   流式合并多个文件，编号区间互不重叠；--unify 合并共享的项目/空间结构/几何实体
+ *   renumber <输入> <输出>   紧凑重新编号为 #1..#n；--topological 时被引用的实例排在前面
+ * 子命令使用构建期嵌入的 Schema。
+ */
+
+class GfcCli {
+public:
+    static bool isCliInvocation(int argc, char* argv[]);
+    static int run(const QStringList& args);   // args 同 QCoreApplication::arguments()
+};
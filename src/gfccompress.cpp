@@ -0,0 +1,453 @@
+#include "gfccompress.h"
+#include "perftrace.h"
+
+#include <QIODevice>
+#include <QThread>
+#include <QVector>
+#include <QtConcurrent/QtConcurrentMap>
+#include <cstring>
+#include <memory>
+
+#ifdef GFC_HAVE_ZLIB
+#include <zlib.h>
+#endif
+#ifdef GFC_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+namespace {
+
+#if defined(GFC_HAVE_ZLIB) || defined(GFC_HAVE_ZSTD)
+
+constexpr qint64 kOutChunk = 4 << 20;   // 流式解压每次交给 sink 的最大字节数
+constexpr qint64 kInChunk = 1 << 20;    // 每次从设备读取的压缩数据
+constexpr qint64 kMaxFrame = 64 << 20;  // 并行解压单块（压缩前后）的上限；头部声称更大时改走流式
+
+// 从设备按块拉取压缩数据；返回读到的字节数，0 为结束，-1 为出错
+using Pull = std::function<qint64(char* buf, qint64 max)>;
+
+// 先交出已读入但未切分的 rest，再继续从设备读取
+Pull pullFrom(QByteArray rest, QIODevice* in)
+{
+    auto pos = std::make_shared<qint64>(0);
+    return [rest, pos, in](char* buf, qint64 max) -> qint64 {
+        if (*pos < rest.size()) {
+            const qint64 n = qMin(max, qint64(rest.size()) - *pos);
+            std::memcpy(buf, rest.constData() + *pos, size_t(n));
+            *pos += n;
+            return n;
+        }
+        return in->read(buf, max);
+    };
+}
+
+struct Block {
+    qint64 offset = 0;       // 在压缩输入中的偏移（用于报错）
+    QByteArray in;           // 本块的压缩数据
+    QByteArray out;
+    QString err;
+    bool ok = false;
+};
+
+// 一批块并行解压后按序交给 sink
+template <class DecodeOne>
+bool decodeBatch(QVector<Block>& blocks, const GfcCompress::Sink& sink, QString* err, DecodeOne& decodeOne)
+{
+    GFC_PERF_SCOPE("并行解压");
+    QtConcurrent::blockingMap(blocks, [&decodeOne](Block& b) { b.ok = decodeOne(b); });
+    for (Block& b : blocks) {
+        if (!b.ok) {
+            if (err) *err = b.err;
+            return false;
+        }
+        if (!sink(b.out.constData(), b.out.size())) return false;
+    }
+    blocks.clear();
+    return true;
+}
+
+/*
+ * 可切分的多块输入：按 kInChunk 从设备读入，切出完整的块，攒满一批（线程数 x 2）并行解压，
+ * 缓冲与批次都有上限。measure(p, n, eof) 返回首块长度（>0）、0（需要更多数据）或 -1（不可切分）；
+ * 遇到不可切分的块时，已读入的剩余部分连同设备余下内容改走 stream。
+ */
+template <class Measure, class DecodeOne, class Stream>
+bool decodeFramed(QIODevice* in, const GfcCompress::Sink& sink, QString* err,
+                  Measure measure, DecodeOne decodeOne, Stream stream)
+{
+    const int batch = qMax(1, QThread::idealThreadCount() * 2);
+    QVector<Block> blocks;
+    QByteArray buf;
+    qint64 pos = 0;          // buf 内已切出的部分
+    qint64 base = 0;         // buf[0] 在输入中的偏移
+    bool eof = false;
+    for (;;) {
+        for (;;) {
+            const qint64 n = pos < buf.size() ? measure(buf.constData() + pos, buf.size() - pos, eof) : 0;
+            if (n == 0 && !(eof && pos < buf.size())) break;
+            if (n <= 0) {   // 不可切分，或输入末尾有残缺的块（由流式解压报告）
+                if (!blocks.isEmpty() && !decodeBatch(blocks, sink, err, decodeOne)) return false;
+                return stream(pullFrom(buf.mid(int(pos)), in), sink, err);
+            }
+            Block b;
+            b.offset = base + pos;
+            b.in = buf.mid(int(pos), int(n));
+            blocks << b;
+            pos += n;
+            if (blocks.size() >= batch && !decodeBatch(blocks, sink, err, decodeOne)) return false;
+        }
+        if (eof) break;
+        base += pos;
+        buf.remove(0, int(pos));
+        pos = 0;
+        if (buf.size() > kMaxFrame) {   // 块过大或缺少可切分的边界
+            if (!blocks.isEmpty() && !decodeBatch(blocks, sink, err, decodeOne)) return false;
+            return stream(pullFrom(buf, in), sink, err);
+        }
+        const int have = buf.size();
+        buf.resize(int(have + kInChunk));
+        const qint64 got = in->read(buf.data() + have, kInChunk);
+        if (got < 0) {
+            if (err) *err = QStringLiteral("读取压缩数据失败");
+            return false;
+        }
+        buf.resize(int(have + got));
+        eof = got == 0;
+    }
+    return blocks.isEmpty() || decodeBatch(blocks, sink, err, decodeOne);
+}
+
+#endif
+
+#ifdef GFC_HAVE_ZLIB
+
+// gzip 成员：ID1 ID2 CM FLG MTIME(4) XFL OS | XLEN(2) 'G' 'F' LEN(2)=4 成员总长(4) | deflate | CRC32 ISIZE
+constexpr int kGzFixed = 10;
+constexpr int kGzExtra = 2 + 8;
+
+quint32 rd32(const uchar* p) { return quint32(p[0]) | quint32(p[1]) << 8 | quint32(p[2]) << 16 | quint32(p[3]) << 24; }
+void wr32(char* p, quint32 v) { for (int i = 0; i < 4; ++i) p[i] = char((v >> (8 * i)) & 0xFF); }
+
+// 返回成员头长度（失败 -1）；gfSize 为 "GF" 子字段记录的成员总长，没有则为 0
+qint64 parseGzipHeader(const uchar* p, qint64 n, quint32* gfSize)
+{
+    *gfSize = 0;
+    if (n < kGzFixed || p[0] != 0x1f || p[1] != 0x8b || p[2] != 8) return -1;
+    const uchar flg = p[3];
+    qint64 pos = kGzFixed;
+    if (flg & 0x04) {                       // FEXTRA
+        if (n < pos + 2) return -1;
+        const qint64 xlen = p[pos] | p[pos + 1] << 8;
+        pos += 2;
+        if (n < pos + xlen) return -1;
+        for (qint64 q = pos; q + 4 <= pos + xlen;) {
+            const qint64 len = p[q + 2] | p[q + 3] << 8;
+            if (p[q] == 'G' && p[q + 1] == 'F' && len == 4 && q + 8 <= pos + xlen) *gfSize = rd32(p + q + 4);
+            q += 4 + len;
+        }
+        pos += xlen;
+    }
+    for (uchar bit : { uchar(0x08), uchar(0x10) }) {   // FNAME / FCOMMENT：以 0 结尾
+        if (!(flg & bit)) continue;
+        while (pos < n && p[pos]) ++pos;
+        ++pos;
+    }
+    if (flg & 0x02) pos += 2;               // FHCRC
+    return pos <= n ? pos : -1;
+}
+
+QByteArray gzipMember(const QByteArray& block, QString* err)
+{
+    z_stream zs{};
+    if (deflateInit2(&zs, 6, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        if (err) *err = QStringLiteral("zlib 初始化失败");
+        return QByteArray();
+    }
+    const qint64 head = kGzFixed + kGzExtra;
+    const uLong bound = deflateBound(&zs, uLong(block.size()));
+    QByteArray out(int(head + qint64(bound) + 8), Qt::Uninitialized);
+    zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(block.constData()));
+    zs.avail_in = uInt(block.size());
+    zs.next_out = reinterpret_cast<Bytef*>(out.data() + head);
+    zs.avail_out = uInt(bound);
+    const int rc = deflate(&zs, Z_FINISH);
+    const qint64 deflated = qint64(zs.total_out);
+    deflateEnd(&zs);
+    if (rc != Z_STREAM_END) {
+        if (err) *err = QStringLiteral("gzip 压缩失败");
+        return QByteArray();
+    }
+
+    const qint64 total = head + deflated + 8;
+    char* h = out.data();
+    const char fixed[kGzFixed] = { char(0x1f), char(0x8b), 8, 0x04, 0, 0, 0, 0, 0, char(0xff) };
+    std::memcpy(h, fixed, kGzFixed);
+    h[10] = 8; h[11] = 0;                   // XLEN
+    h[12] = 'G'; h[13] = 'F'; h[14] = 4; h[15] = 0;
+    wr32(h + 16, quint32(total));
+    char* t = out.data() + head + deflated;
+    wr32(t, quint32(crc32(0L, reinterpret_cast<const Bytef*>(block.constData()), uInt(block.size()))));
+    wr32(t + 4, quint32(block.size()));
+    out.resize(int(total));
+    return out;
+}
+
+// 本程序写出的成员（带 "GF" 长度且 ISIZE 不超过 kMaxFrame）可切分；其余交给流式解压
+qint64 measureGzipMember(const char* data, qint64 n, bool eof)
+{
+    const uchar* p = reinterpret_cast<const uchar*>(data);
+    quint32 gf = 0;
+    if (parseGzipHeader(p, qMin<qint64>(n, 4096), &gf) < 0) return !eof && n < 4096 ? 0 : -1;
+    if (gf < kGzFixed + 8 || gf > kMaxFrame) return -1;
+    if (n < gf) return eof ? -1 : 0;
+    return rd32(p + gf - 4) <= quint32(kMaxFrame) ? qint64(gf) : -1;
+}
+
+bool inflateMember(Block& b)
+{
+    const uchar* p = reinterpret_cast<const uchar*>(b.in.constData());
+    const qint64 size = b.in.size();
+    quint32 gf = 0;
+    const qint64 head = parseGzipHeader(p, size, &gf);
+    if (head < 0 || size < head + 8) {
+        b.err = QStringLiteral("gzip 成员头损坏（偏移 %1）").arg(b.offset);
+        return false;
+    }
+    const quint32 crc = rd32(p + size - 8);
+    const quint32 isize = rd32(p + size - 4);   // measureGzipMember 已保证不超过 kMaxFrame
+    b.out.resize(int(isize));
+
+    z_stream zs{};
+    inflateInit2(&zs, -15);
+    zs.next_in = const_cast<Bytef*>(p + head);
+    zs.avail_in = uInt(size - head - 8);
+    zs.next_out = reinterpret_cast<Bytef*>(b.out.data());
+    zs.avail_out = uInt(isize);
+    const int rc = inflate(&zs, Z_FINISH);
+    const uLong produced = zs.total_out;
+    inflateEnd(&zs);
+    if (rc != Z_STREAM_END || produced != isize
+        || crc32(0L, reinterpret_cast<const Bytef*>(b.out.constData()), uInt(isize)) != crc) {
+        b.err = QStringLiteral("gzip 数据损坏（偏移 %1）").arg(b.offset);
+        return false;
+    }
+    return true;
+}
+
+// 流式解压（支持多成员 gzip）
+bool gunzipStream(const Pull& pull, const GfcCompress::Sink& sink, QString* err)
+{
+    GFC_PERF_SCOPE("流式解压 gzip");
+    z_stream zs{};
+    if (inflateInit2(&zs, 15 + 16) != Z_OK) {
+        if (err) *err = QStringLiteral("zlib 初始化失败");
+        return false;
+    }
+    QByteArray inBuf(int(kInChunk), Qt::Uninitialized);
+    QByteArray outBuf(int(kOutChunk), Qt::Uninitialized);
+    bool complete = false;   // 最近一个成员是否完整结束
+    bool ok = true;
+    for (;;) {
+        if (zs.avail_in == 0) {
+            const qint64 n = pull(inBuf.data(), kInChunk);
+            if (n < 0) { if (err) *err = QStringLiteral("读取压缩数据失败"); ok = false; break; }
+            if (n == 0) break;
+            zs.next_in = reinterpret_cast<Bytef*>(inBuf.data());
+            zs.avail_in = uInt(n);
+        }
+        zs.next_out = reinterpret_cast<Bytef*>(outBuf.data());
+        zs.avail_out = uInt(kOutChunk);
+        const int rc = inflate(&zs, Z_NO_FLUSH);
+        const qint64 produced = kOutChunk - zs.avail_out;
+        if (produced > 0 && !sink(outBuf.constData(), produced)) { ok = false; break; }
+        if (rc == Z_STREAM_END) {
+            complete = true;
+            inflateReset(&zs);      // 下一个成员（多成员 gzip）
+            continue;
+        }
+        if (rc != Z_OK && !(rc == Z_BUF_ERROR && zs.avail_in == 0)) {
+            if (err) *err = QStringLiteral("gzip 数据损坏：%1").arg(QString::fromLatin1(zs.msg ? zs.msg : ""));
+            ok = false;
+            break;
+        }
+        complete = false;
+    }
+    inflateEnd(&zs);
+    if (ok && !complete) {
+        if (err) *err = QStringLiteral("gzip 数据被截断");
+        ok = false;
+    }
+    return ok;
+}
+
+bool gunzip(QIODevice* in, const GfcCompress::Sink& sink, QString* err)
+{
+    return decodeFramed(in, sink, err, measureGzipMember, inflateMember, gunzipStream);
+}
+
+#endif // GFC_HAVE_ZLIB
+
+#ifdef GFC_HAVE_ZSTD
+
+bool unzstdStream(const Pull& pull, const GfcCompress::Sink& sink, QString* err)
+{
+    GFC_PERF_SCOPE("流式解压 zstd");
+    ZSTD_DStream* ds = ZSTD_createDStream();
+    ZSTD_initDStream(ds);
+    QByteArray inBuf(int(kInChunk), Qt::Uninitialized);
+    QByteArray outBuf(int(kOutChunk), Qt::Uninitialized);
+    ZSTD_inBuffer in{ inBuf.constData(), 0, 0 };
+    size_t last = 0;
+    bool ok = true;
+    for (;;) {
+        if (in.pos == in.size) {
+            const qint64 n = pull(inBuf.data(), kInChunk);
+            if (n < 0) { if (err) *err = QStringLiteral("读取压缩数据失败"); ok = false; break; }
+            if (n == 0) break;
+            in = ZSTD_inBuffer{ inBuf.constData(), size_t(n), 0 };
+        }
+        ZSTD_outBuffer out{ outBuf.data(), size_t(kOutChunk), 0 };
+        last = ZSTD_decompressStream(ds, &out, &in);
+        if (ZSTD_isError(last)) {
+            if (err) *err = QStringLiteral("zstd 数据损坏：%1").arg(QString::fromLatin1(ZSTD_getErrorName(last)));
+            ok = false;
+            break;
+        }
+        if (out.pos > 0 && !sink(outBuf.constData(), qint64(out.pos))) { ok = false; break; }
+    }
+    // 输入读完但帧内仍有缓存的输出
+    while (ok && last != 0) {
+        ZSTD_outBuffer out{ outBuf.data(), size_t(kOutChunk), 0 };
+        last = ZSTD_decompressStream(ds, &out, &in);
+        if (ZSTD_isError(last) || out.pos == 0) {
+            if (err) *err = QStringLiteral("zstd 数据被截断");
+            ok = false;
+            break;
+        }
+        if (!sink(outBuf.constData(), qint64(out.pos))) ok = false;
+    }
+    ZSTD_freeDStream(ds);
+    return ok;
+}
+
+// zstd 帧可在压缩数据上直接切分（只读帧头/块头）；记录了原始长度且不超过 kMaxFrame 的帧并行解压
+qint64 measureZstdFrame(const char* p, qint64 n, bool eof)
+{
+    constexpr qint64 kHeaderMax = 18;   // ZSTD_FRAMEHEADERSIZE_MAX（只在静态链接 API 中声明）
+    if (n < kHeaderMax && !eof) return 0;
+    const unsigned long long cs = ZSTD_getFrameContentSize(p, size_t(n));
+    if (cs == ZSTD_CONTENTSIZE_UNKNOWN || cs == ZSTD_CONTENTSIZE_ERROR || cs > quint64(kMaxFrame)) return -1;
+    const size_t size = ZSTD_findFrameCompressedSize(p, size_t(n));
+    if (ZSTD_isError(size)) return eof ? -1 : 0;
+    return qint64(size);
+}
+
+bool decodeZstdFrame(Block& b)
+{
+    // measureZstdFrame 已保证原始长度已知且不超过 kMaxFrame
+    b.out.resize(int(ZSTD_getFrameContentSize(b.in.constData(), size_t(b.in.size()))));
+    const size_t r = ZSTD_decompress(b.out.data(), size_t(b.out.size()), b.in.constData(), size_t(b.in.size()));
+    if (ZSTD_isError(r) || r != size_t(b.out.size())) {
+        b.err = QStringLiteral("zstd 数据损坏（偏移 %1）").arg(b.offset);
+        return false;
+    }
+    return true;
+}
+
+bool unzstd(QIODevice* in, const GfcCompress::Sink& sink, QString* err)
+{
+    return decodeFramed(in, sink, err, measureZstdFrame, decodeZstdFrame, unzstdStream);
+}
+
+#endif // GFC_HAVE_ZSTD
+
+} // namespace
+
+GfcCompress::Codec GfcCompress::detect(const QByteArray& head)
+{
+    if (head.size() >= 2 && uchar(head[0]) == 0x1f && uchar(head[1]) == 0x8b) return Gzip;
+    if (head.size() >= 4 && uchar(head[0]) == 0x28 && uchar(head[1]) == 0xb5
+        && uchar(head[2]) == 0x2f && uchar(head[3]) == 0xfd) return Zstd;
+    return None;
+}
+
+GfcCompress::Codec GfcCompress::codecForPath(const QString& path)
+{
+    if (path.endsWith(QLatin1String(".gz"), Qt::CaseInsensitive)) return Gzip;
+    if (path.endsWith(QLatin1String(".zst"), Qt::CaseInsensitive)) return Zstd;
+    return None;
+}
+
+QString GfcCompress::stripCodecSuffix(const QString& path)
+{
+    switch (codecForPath(path)) {
+    case Gzip: return path.left(path.size() - 3);
+    case Zstd: return path.left(path.size() - 4);
+    default: return path;
+    }
+}
+
+bool GfcCompress::available(Codec codec)
+{
+    switch (codec) {
+    case None: return true;
+#ifdef GFC_HAVE_ZLIB
+    case Gzip: return true;
+#endif
+#ifdef GFC_HAVE_ZSTD
+    case Zstd: return true;
+#endif
+    default: return false;
+    }
+}
+
+QString GfcCompress::codecName(Codec codec)
+{
+    switch (codec) {
+    case Gzip: return QStringLiteral("gzip");
+    case Zstd: return QStringLiteral("zstd");
+    default: return QStringLiteral("无");
+    }
+}
+
+QByteArray GfcCompress::compressBlock(const QByteArray& block, Codec codec, QString* err)
+{
+    switch (codec) {
+    case None:
+        return block;
+#ifdef GFC_HAVE_ZLIB
+    case Gzip:
+        return gzipMember(block, err);
+#endif
+#ifdef GFC_HAVE_ZSTD
+    case Zstd: {
+        QByteArray out(int(ZSTD_compressBound(size_t(block.size()))), Qt::Uninitialized);
+        const size_t n = ZSTD_compress(out.data(), size_t(out.size()), block.constData(), size_t(block.size()), 3);
+        if (ZSTD_isError(n)) {
+            if (err) *err = QStringLiteral("zstd 压缩失败：%1").arg(QString::fromLatin1(ZSTD_getErrorName(n)));
+            return QByteArray();
+        }
+        out.resize(int(n));
+        return out;
+    }
+#endif
+    default:
+        if (err) *err = QStringLiteral("本版本未启用 %1 支持").arg(codecName(codec));
+        return QByteArray();
+    }
+}
+
+bool GfcCompress::decompress(QIODevice* in, Codec codec, const Sink& sink, QString* err)
+{
+    switch (codec) {
+#ifdef GFC_HAVE_ZLIB
+    case Gzip: return gunzip(in, sink, err);
+#endif
+#ifdef GFC_HAVE_ZSTD
+    case Zstd: return unzstd(in, sink, err);
+#endif
+    default:
+        if (err) *err = QStringLiteral("本版本未启用 %1 支持").arg(codecName(codec));
+        return false;
+    }
+}
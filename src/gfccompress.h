@@ -0,0 +1,34 @@
+#pragma once
+#include <QByteArray>
+#include <QString>
+#include <functional>
+
+class QIODevice;
+
+/**
+ * 透明压缩输入/输出（gzip 需 zlib，zstd 需 libzstd；构建时找到才启用）：
+ * - 按内容魔数识别压缩格式，按扩展名 .gz / .zst 选择写出格式
+ * - 写出：每个块（GfcWriter 的编码块）独立压缩为一个 gzip 成员 / zstd 帧，可并行；
+ *   gzip 成员头部带 "GF" 扩展子字段记录成员总长，读取时无需解压即可切分
+ * - 读取：按块从设备读入，本程序写出的多块文件切出完整块后分批并行解压、按序交给 sink；
+ *   其它 gzip/zstd 文件（单成员、外部工具生成）或块头声称超过 64 MB 的块按流式逐块解压，
+ *   不落盘、不整体缓存，内存占用与线程数成正比
+ */
+
+class GfcCompress {
+public:
+    enum Codec { None, Gzip, Zstd };
+
+    static Codec detect(const QByteArray& head);          // 至少给前 4 字节
+    static Codec codecForPath(const QString& path);       // 按扩展名
+    static QString stripCodecSuffix(const QString& path); // model.gfc.gz -> model.gfc
+    static bool available(Codec codec);
+    static QString codecName(Codec codec);
+
+    // 压缩一个独立块（gzip 成员 / zstd 帧）；可在多个线程同时调用
+    static QByteArray compressBlock(const QByteArray& block, Codec codec, QString* err = nullptr);
+
+    // 解压整个输入，依次把解压数据交给 sink（返回 false 中止）
+    using Sink = std::function<bool(const char* data, qint64 size)>;
+    static bool decompress(QIODevice* in, Codec codec, const Sink& sink, QString* err = nullptr);
+};
@@ -0,0 +1,249 @@
+#include "gfcdedupe.h"
+#include "gfcindex.h"
+#include "gfcparallel.h"
+#include "perftrace.h"
+#include "schemacache.h"
+
+#include <QHash>
+#include <algorithm>
+#include <climits>
+
+namespace {
+
+inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+inline bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+// 规范文本：类名 + 参数区（字符串外空白去掉，引用换成 '#' + 代表行号，悬空引用为 "#?id"）
+QByteArray canonicalText(const GfcIndex& ix, int row, const QVector<int>& canon)
+{
+    const QByteArray& cn = ix.className(ix.at(row).cls);
+    const std::string_view a = ix.args(row);
+    QByteArray key;
+    key.reserve(cn.size() + int(a.size()) + 2);
+    key += cn;
+    key += '(';
+    const char* p = a.data();
+    const char* e = p + a.size();
+    const int kn = ix.refCount(row);
+    int k = 0;
+    while (p < e) {
+        const char c = *p;
+        if (c == '\'') {
+            const char* s = p++;
+            while (p < e) {
+                if (*p++ == '\'') {
+                    if (p < e && *p == '\'') { ++p; continue; }
+                    break;
+                }
+            }
+            key.append(s, int(p - s));
+            continue;
+        }
+        ++p;
+        if (isSpace(c)) continue;
+        if (c == '#' && p < e && isDigit(*p)) {
+            qint64 id = 0;
+            while (p < e && isDigit(*p)) id = id * 10 + (*p++ - '0');
+            key += '#';
+            if (k < kn && ix.at(ix.ref(row, k)).id == id) {
+                gfc::appendNumber(key, canon[ix.ref(row, k++)]);
+            }
+            else {
+                key += '?';
+                gfc::appendNumber(key, id);
+            }
+            continue;
+        }
+        key += c;
+    }
+    return key;
+}
+
+} // namespace
+
+QStringList GfcDedupe::defaultExcludedRoots()
+{
+    return { QStringLiteral("GfcObject"), QStringLiteral("GfcRelationShip") };
+}
+
+void GfcDedupe::analyze(GfcIndex& ix, const CompiledSchema& schema, const QStringList& excludedRoots,
+                        Plan* plan, QStringList* unknownRoots)
+{
+    GFC_PERF_SCOPE("内容去重分析");
+    if (!ix.hasRefs()) ix.buildRefs();
+    const int n = ix.size();
+
+    QVector<int> roots;
+    for (const QString& name : excludedRoots) {
+        const int e = schema.find(name.trimmed());
+        if (e >= 0) roots << e;
+        else if (unknownRoots) *unknownRoots << name.trimmed();
+    }
+    QVector<quint8> eligibleClass(ix.classCount(), 0);
+    for (int c = 0; c < ix.classCount(); ++c) {
+        const int e = ix.schemaEntity(c);
+        if (e < 0) continue;
+        bool excluded = false;
+        for (int r : roots) {
+            if (schema.isSubtypeOf(e, r)) { excluded = true; break; }
+        }
+        eligibleClass[c] = excluded ? 0 : 1;
+    }
+
+    // 反向引用与未完成子节点计数，自底向上分层
+    QVector<int> pOff, parents;
+    ix.buildReferrers(&pOff, &parents);
+    QVector<int> pending(n);
+    for (int r = 0; r < n; ++r) pending[r] = ix.refCount(r);
+
+    QVector<int>& canon = plan->canon;
+    canon.resize(n);
+    for (int r = 0; r < n; ++r) canon[r] = r;
+    QVector<int> frontier;
+    for (int r = 0; r < n; ++r) {
+        if (pending[r] == 0) frontier << r;
+    }
+
+    QHash<QByteArray, int> table;
+    table.reserve(n);
+    int resolved = 0;
+    plan->excluded = 0;
+    while (!frontier.isEmpty()) {
+        // 同一层内按行号处理，使代表实例总是最先出现的那个
+        std::sort(frontier.begin(), frontier.end());
+        const int m = frontier.size();
+        QVector<QByteArray> keys(m);
+        gfc::parallelParts(m, m < 4096 ? 1 : gfc::partsFor(m, 2048), [&](int b, int e, int) {
+            for (int i = b; i < e; ++i) {
+                const int r = frontier[i];
+                if (eligibleClass[ix.at(r).cls]) keys[i] = canonicalText(ix, r, canon);
+            }
+        });
+        QVector<int> next;
+        for (int i = 0; i < m; ++i) {
+            const int r = frontier[i];
+            if (eligibleClass[ix.at(r).cls]) {
+                auto it = table.constFind(keys[i]);
+                if (it == table.constEnd()) table.insert(keys[i], r);
+                else canon[r] = it.value();
+            }
+            else {
+                ++plan->excluded;
+            }
+            for (int q = pOff[r]; q < pOff[r + 1]; ++q) {
+                if (--pending[parents[q]] == 0) next << parents[q];
+            }
+        }
+        resolved += m;
+        frontier.swap(next);
+    }
+    plan->cyclic = n - resolved;
+
+    // 汇总
+    plan->duplicates = 0;
+    plan->bytes = 0;
+    QVector<ClassStat> stats(ix.classCount());
+    for (int c = 0; c < ix.classCount(); ++c) stats[c].name = ix.className(c);
+    for (int r = 0; r < n; ++r) {
+        ClassStat& cs = stats[ix.at(r).cls];
+        ++cs.total;
+        if (canon[r] == r) continue;
+        const qint64 bytes = ix.spanEnd(r) - ix.at(r).begin;
+        ++cs.duplicates;
+        cs.bytes += bytes;
+        ++plan->duplicates;
+        plan->bytes += bytes;
+    }
+    plan->classes.clear();
+    for (const ClassStat& cs : stats) {
+        if (cs.duplicates) plan->classes << cs;
+    }
+    std::sort(plan->classes.begin(), plan->classes.end(),
+              [](const ClassStat& a, const ClassStat& b) { return a.bytes > b.bytes; });
+    PerfTrace::instance().setCounter(QStringLiteral("重复实例"), plan->duplicates);
+}
+
+QByteArray GfcDedupe::apply(const GfcIndex& ix, const QVector<int>& canon, qint64* refsRewritten)
+{
+    GFC_PERF_SCOPE("合并重复实例");
+    const int n = ix.size();
+    const QByteArray& data = ix.data();
+    const char* base = data.constData();
+    int last = n - 1;
+    while (last >= 0 && canon[last] != last) --last;
+
+    const int parts = gfc::partsFor(n, 2048);
+    QVector<QByteArray> pieces(parts);
+    QVector<qint64> refCounts(parts, 0);
+    gfc::parallelParts(n, parts, [&](int b, int e, int part) {
+        QByteArray& buf = pieces[part];
+        const qint64 approx = (e < n ? ix.at(e).begin : ix.trailerBegin()) - (b < n ? ix.at(b).begin : 0);
+        buf.reserve(int(qMin<qint64>(qMax<qint64>(approx, 0), INT_MAX / 2)));
+        qint64 refs = 0;
+        for (int r = b; r < e && r <= last; ++r) {
+            if (canon[r] != r) continue;
+            const GfcIndexEntry& en = ix.at(r);
+            // 保留的最后一个实例到 ';' 为止，其后直接接原结尾段
+            const qint64 stop = r == last ? en.end : ix.spanEnd(r);
+            const int kn = ix.refCount(r);
+            bool rewrite = false;
+            for (int k = 0; k < kn && !rewrite; ++k) rewrite = canon[ix.ref(r, k)] != ix.ref(r, k);
+            if (!rewrite) {
+                buf.append(base + en.begin, int(stop - en.begin));
+                continue;
+            }
+
+            const char* a = base + en.argsBegin;
+            const char* ae = base + en.argsEnd;
+            buf.append(base + en.begin, int(en.argsBegin - en.begin));
+            const char* run = a;
+            int k = 0;
+            bool inStr = false;
+            while (a < ae) {
+                const char c = *a;
+                if (inStr) {
+                    if (c == '\'') inStr = false;
+                    ++a;
+                    continue;
+                }
+                if (c == '\'') { inStr = true; ++a; continue; }
+                if (c != '#' || a + 1 >= ae || !isDigit(a[1])) { ++a; continue; }
+
+                const char* d = a + 1;
+                qint64 id = 0;
+                while (d < ae && isDigit(*d)) id = id * 10 + (*d++ - '0');
+                if (k < kn && ix.at(ix.ref(r, k)).id == id) {
+                    const int t = ix.ref(r, k++);
+                    if (canon[t] != t) {
+                        buf.append(run, int(a - run));
+                        buf += '#';
+                        gfc::appendNumber(buf, ix.at(canon[t]).id);
+                        ++refs;
+                        run = d;
+                    }
+                }
+                a = d;
+            }
+            buf.append(run, int(ae - run));
+            buf.append(ae, int(base + stop - ae));
+        }
+        refCounts[part] = refs;
+    });
+
+    QByteArray result;
+    qint64 total = ix.headerEnd() + (data.size() - ix.trailerBegin());
+    for (const QByteArray& p : pieces) total += p.size();
+    result.reserve(int(qMin<qint64>(total, INT_MAX)));
+    result.append(base, int(ix.headerEnd()));
+    for (QByteArray& p : pieces) {
+        result += p;
+        p.clear();
+    }
+    result.append(base + ix.trailerBegin(), int(data.size() - ix.trailerBegin()));
+
+    qint64 refs = 0;
+    for (qint64 c : refCounts) refs += c;
+    PerfTrace::instance().setCounter(QStringLiteral("改写引用"), refs);
+    if (refsRewritten) *refsRewritten = refs;
+    return result;
+}
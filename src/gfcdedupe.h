@@ -0,0 +1,46 @@
+#pragma once
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class CompiledSchema;
+class GfcIndex;
+
+/**
+ * 内容去重（哈希归并，hash-consing）：
+ * - 沿引用图自底向上分层：每层并行生成实例的规范文本（类名 + 去掉字符串外空白的参数，
+ *   引用换成目标的代表行号），再依次查归并表；规范文本完全相同即为重复，归并到最先出现的实例
+ * - 子实例先归并，父实例的规范文本随之相同，因此整棵相同的子图会一并归并
+ * - 排除类（含子类，默认 GfcObject 与关系实体）有独立身份，不参与归并，但其引用照样改写；
+ *   Schema 中没有的类与引用环上的实例同样不归并
+ * - apply：删除重复实例，改写所有引用重复实例的引用为代表实例（编号不变）
+ */
+
+class GfcDedupe {
+public:
+    struct ClassStat {
+        QByteArray name;       // 大写类名
+        int total = 0;
+        int duplicates = 0;
+        qint64 bytes = 0;      // 删除重复实例节省的字节（引用改写的长度变化不计）
+    };
+
+    struct Plan {
+        QVector<int> canon;              // 按行：代表实例的行号，canon[r] == r 表示保留
+        QVector<ClassStat> classes;      // 仅含有重复的类，按节省字节降序
+        int duplicates = 0;
+        qint64 bytes = 0;
+        int excluded = 0;                // 因排除类/未知类未参与的实例
+        int cyclic = 0;                  // 引用环上未参与的实例
+    };
+
+    static QStringList defaultExcludedRoots();
+
+    // 找不到的排除类名放入 unknownRoots（可空）
+    static void analyze(GfcIndex& index, const CompiledSchema& schema, const QStringList& excludedRoots,
+                        Plan* plan, QStringList* unknownRoots = nullptr);
+
+    // 删除重复实例并改写引用后的完整文本；refsRewritten 为改写的引用数
+    static QByteArray apply(const GfcIndex& index, const QVector<int>& canon, qint64* refsRewritten = nullptr);
+};
@@ -0,0 +1,348 @@
+#include "gfcdiff.h"
+#include "gfcparallel.h"
+#include "perftrace.h"
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
+
+namespace {
+
+inline bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+// FNV-1a 64 + splitmix 收尾
+struct Hasher {
+    quint64 h = 14695981039346656037ull;
+    void byte(unsigned char c) { h ^= c; h *= 1099511628211ull; }
+    void bytes(const char* p, qsizetype n) { while (n-- > 0) byte(static_cast<unsigned char>(*p++)); }
+    void u64(quint64 v) { for (int i = 0; i < 8; ++i) byte(static_cast<unsigned char>(v >> (i * 8))); }
+    quint64 done() const
+    {
+        quint64 z = h + 0x9e3779b97f4a7c15ull;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+        return z ^ (z >> 31);
+    }
+};
+
+// 逐行并行；量小时直接在当前线程完成
+template <class F>
+void parallelRows(int n, F&& f)
+{
+    gfc::parallelParts(n, n < 4096 ? 1 : gfc::maxParts(), [&f](int b, int e, int) {
+        for (int i = b; i < e; ++i) f(i);
+    });
+}
+
+// 类名 + 规范化参数；refHash(h, targetRow) 决定引用如何计入
+template <class RefHash>
+quint64 hashRow(const GfcIndex& ix, int row, RefHash&& refHash)
+{
+    Hasher h;
+    const QByteArray& cn = ix.className(ix.at(row).cls);
+    h.bytes(cn.constData(), cn.size());
+    h.byte('(');
+
+    const std::string_view a = ix.args(row);
+    const char* p = a.data();
+    const char* e = p + a.size();
+    const int kn = ix.refCount(row);
+    int k = 0;
+    while (p < e) {
+        const char c = *p++;
+        if (c == '\'') {
+            const char* s = p - 1;
+            while (p < e) {
+                if (*p == '\'') {
+                    if (p + 1 < e && p[1] == '\'') { p += 2; continue; }
+                    ++p;
+                    break;
+                }
+                ++p;
+            }
+            h.bytes(s, p - s);
+        }
+        else if (isSpace(c)) {
+            continue;
+        }
+        else if (c == '#' && p < e && isDigit(*p)) {
+            qint64 id = 0;
+            while (p < e && isDigit(*p)) { id = id * 10 + (*p - '0'); ++p; }
+            if (k < kn && ix.at(ix.ref(row, k)).id == id) {
+                refHash(h, ix.ref(row, k));
+                ++k;
+            }
+            else {
+                h.byte('#');   // 悬空引用：编号在两个文件间没有意义，只记“指向不存在的实例”
+                h.byte('?');
+            }
+        }
+        else {
+            h.byte(static_cast<unsigned char>(c));
+        }
+    }
+    return h.done();
+}
+
+// 类名 + 首个字符串参数（通常为 ID/名称）；没有字符串时为 0
+quint64 firstStringKey(const GfcIndex& ix, int row)
+{
+    const std::string_view a = ix.args(row);
+    const char* p = a.data();
+    const char* e = p + a.size();
+    while (p < e && *p != '\'') ++p;
+    if (p == e) return 0;
+    const char* s = ++p;
+    while (p < e) {
+        if (*p == '\'') {
+            if (p + 1 < e && p[1] == '\'') { p += 2; continue; }
+            break;
+        }
+        ++p;
+    }
+    if (p == s) return 0;   // 空串不足以区分
+    Hasher h;
+    const QByteArray& cn = ix.className(ix.at(row).cls);
+    h.bytes(cn.constData(), cn.size());
+    h.byte(0);
+    h.bytes(s, p - s);
+    return h.done() | 1;
+}
+
+struct Key {
+    quint64 k;
+    int row;
+    bool operator<(const Key& o) const { return k < o.k || (k == o.k && row < o.row); }
+};
+
+// 两侧键排序后归并：键相同的按行序两两配对；uniqueOnly 时只配对两侧都唯一的键
+template <class OnPair>
+void pairSorted(QVector<Key>& ka, QVector<Key>& kb, bool uniqueOnly, OnPair&& onPair)
+{
+    QFuture<void> f = QtConcurrent::run([&kb] { std::sort(kb.begin(), kb.end()); });
+    std::sort(ka.begin(), ka.end());
+    f.waitForFinished();
+
+    int i = 0, j = 0;
+    while (i < ka.size() && j < kb.size()) {
+        if (ka[i].k < kb[j].k) { ++i; continue; }
+        if (kb[j].k < ka[i].k) { ++j; continue; }
+        const quint64 k = ka[i].k;
+        int ie = i, je = j;
+        while (ie < ka.size() && ka[ie].k == k) ++ie;
+        while (je < kb.size() && kb[je].k == k) ++je;
+        if (!uniqueOnly || (ie - i == 1 && je - j == 1)) {
+            for (int x = i, y = j; x < ie && y < je; ++x, ++y) onPair(ka[x].row, kb[y].row);
+        }
+        i = ie;
+        j = je;
+    }
+}
+
+} // namespace
+
+QVector<quint64> GfcDiff::merkleHashes(GfcIndex& ix, QVector<quint64>* localOut)
+{
+    GFC_PERF_SCOPE("Merkle 哈希");
+    if (!ix.hasRefs()) ix.buildRefs();
+    const int n = ix.size();
+
+    QVector<quint64> local(n);
+    parallelRows(n, [&](int r) {
+        local[r] = hashRow(ix, r, [](Hasher& h, int) { h.byte('#'); });
+    });
+
+    // 反向引用（被谁引用）与未完成的子节点计数，用于自底向上分层
+    QVector<int> pOff, parents;
+    ix.buildReferrers(&pOff, &parents);
+    QVector<int> pending(n);
+    for (int r = 0; r < n; ++r) pending[r] = ix.refCount(r);
+
+    QVector<quint64> h(n);
+    QVector<quint8> done(n, 0);
+    QVector<int> frontier;
+    for (int r = 0; r < n; ++r) {
+        if (pending[r] == 0) frontier << r;
+    }
+    int resolved = 0;
+    while (!frontier.isEmpty()) {
+        parallelRows(frontier.size(), [&](int i) {
+            const int r = frontier[i];
+            h[r] = hashRow(ix, r, [&h](Hasher& hs, int t) { hs.u64(h[t]); });
+        });
+        QVector<int> next;
+        for (int r : frontier) {
+            done[r] = 1;
+            for (int q = pOff[r]; q < pOff[r + 1]; ++q) {
+                if (--pending[parents[q]] == 0) next << parents[q];
+            }
+        }
+        resolved += frontier.size();
+        frontier.swap(next);
+    }
+
+    // 引用环（及依赖环的实例）：未完成的目标改用局部哈希
+    if (resolved < n) {
+        QVector<int> rest;
+        for (int r = 0; r < n; ++r) {
+            if (!done[r]) rest << r;
+        }
+        QVector<quint64> tmp(rest.size());
+        parallelRows(rest.size(), [&](int i) {
+            tmp[i] = hashRow(ix, rest[i], [&](Hasher& hs, int t) { hs.u64(done[t] ? h[t] : local[t]); });
+        });
+        for (int i = 0; i < rest.size(); ++i) h[rest[i]] = tmp[i];
+        PerfTrace::instance().setCounter(QStringLiteral("环上实例"), rest.size());
+    }
+
+    if (localOut) *localOut = std::move(local);
+    return h;
+}
+
+bool GfcDiff::compare(const QByteArray& a, const QByteArray& b, const CompiledSchema* schema, QString* err)
+{
+    QElapsedTimer timer;
+    timer.start();
+    classes_.clear();
+    items_.clear();
+    same_ = 0;
+
+    {
+        GFC_PERF_SCOPE("建立索引");
+        QString errB;
+        bool okB = false;
+        QFuture<void> fb = QtConcurrent::run([&] { okB = b_.build(b, schema, &errB); });
+        QString errA;
+        const bool okA = a_.build(a, schema, &errA);
+        fb.waitForFinished();
+        if (!okA || !okB) {
+            if (err) *err = !okA ? QStringLiteral("文件 A：%1").arg(errA) : QStringLiteral("文件 B：%1").arg(errB);
+            return false;
+        }
+    }
+
+    QVector<quint64> localA, localB;
+    const QVector<quint64> hashA = merkleHashes(a_, &localA);
+    const QVector<quint64> hashB = merkleHashes(b_, &localB);
+    const int na = a_.size();
+    const int nb = b_.size();
+
+    partnerA_.fill(-1, na);
+    partnerB_.fill(-1, nb);
+    stateA_.fill(Removed, na);
+    stateB_.fill(Added, nb);
+
+    GFC_PERF_SCOPE("匹配实例");
+    auto collect = [](const GfcIndex& ix, const QVector<int>& partner, auto&& keyOf) {
+        QVector<Key> keys;
+        for (int r = 0; r < ix.size(); ++r) {
+            if (partner[r] >= 0) continue;
+            const quint64 k = keyOf(r);
+            if (k) keys.push_back({ k, r });
+        }
+        return keys;
+    };
+
+    // ① 内容完全相同
+    {
+        QVector<Key> ka(na), kb(nb);
+        for (int r = 0; r < na; ++r) ka[r] = { hashA[r], r };
+        for (int r = 0; r < nb; ++r) kb[r] = { hashB[r], r };
+        pairSorted(ka, kb, false, [this](int x, int y) {
+            partnerA_[x] = y;
+            partnerB_[y] = x;
+            stateA_[x] = stateB_[y] = Same;
+            ++same_;
+        });
+    }
+    auto markChanged = [this](int x, int y) {
+        partnerA_[x] = y;
+        partnerB_[y] = x;
+        stateA_[x] = stateB_[y] = Changed;
+    };
+    // ② 类 + 首个字符串参数，两侧唯一
+    {
+        QVector<Key> ka = collect(a_, partnerA_, [this](int r) { return firstStringKey(a_, r); });
+        QVector<Key> kb = collect(b_, partnerB_, [this](int r) { return firstStringKey(b_, r); });
+        pairSorted(ka, kb, true, markChanged);
+    }
+    // ③ 类 + 局部哈希（自身属性相同，仅引用内容不同）
+    {
+        QVector<Key> ka = collect(a_, partnerA_, [&localA](int r) { return localA[r]; });
+        QVector<Key> kb = collect(b_, partnerB_, [&localB](int r) { return localB[r]; });
+        pairSorted(ka, kb, false, markChanged);
+    }
+    // ④ 已配对的修改实例，其同位置引用的未配对同类实例也视为修改（自顶向下传播）
+    {
+        QVector<int> work;
+        for (int r = 0; r < na; ++r) {
+            if (stateA_[r] == Changed) work << r;
+        }
+        while (!work.isEmpty()) {
+            const int x = work.takeLast();
+            const int y = partnerA_[x];
+            const int kn = qMin(a_.refCount(x), b_.refCount(y));
+            for (int k = 0; k < kn; ++k) {
+                const int ta = a_.ref(x, k);
+                const int tb = b_.ref(y, k);
+                if (partnerA_[ta] >= 0 || partnerB_[tb] >= 0) continue;
+                if (a_.className(a_.at(ta).cls) != b_.className(b_.at(tb).cls)) continue;
+                markChanged(ta, tb);
+                work << ta;
+            }
+        }
+    }
+
+    // 按类汇总
+    QHash<QByteArray, int> classOf;
+    QVector<QByteArray> names;
+    for (int c = 0; c < a_.classCount(); ++c) names << a_.className(c);
+    for (int c = 0; c < b_.classCount(); ++c) names << b_.className(c);
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+    for (const QByteArray& nm : names) {
+        classOf.insert(nm, classes_.size());
+        GfcDiffClass dc;
+        dc.name = nm;
+        classes_ << dc;
+    }
+    QVector<int> mapA(a_.classCount()), mapB(b_.classCount());
+    for (int c = 0; c < a_.classCount(); ++c) mapA[c] = classOf.value(a_.className(c));
+    for (int c = 0; c < b_.classCount(); ++c) mapB[c] = classOf.value(b_.className(c));
+
+    for (int r = 0; r < na; ++r) {
+        GfcDiffClass& dc = classes_[mapA[a_.at(r).cls]];
+        if (stateA_[r] == Same) { ++dc.same; continue; }
+        GfcDiffItem it;
+        it.rowA = r;
+        if (stateA_[r] == Changed) {
+            it.kind = GfcDiffItem::Changed;
+            it.rowB = partnerA_[r];
+            it.ownChanged = localA[r] != localB[it.rowB];
+            ++dc.changed;
+        }
+        else {
+            it.kind = GfcDiffItem::Removed;
+            ++dc.removed;
+        }
+        dc.items << items_.size();
+        items_ << it;
+    }
+    for (int r = 0; r < nb; ++r) {
+        if (stateB_[r] != Added) continue;
+        GfcDiffClass& dc = classes_[mapB[b_.at(r).cls]];
+        GfcDiffItem it;
+        it.kind = GfcDiffItem::Added;
+        it.rowB = r;
+        ++dc.added;
+        dc.items << items_.size();
+        items_ << it;
+    }
+
+    elapsedMs_ = timer.elapsed();
+    PerfTrace::instance().setCounter(QStringLiteral("相同实例"), same_);
+    PerfTrace::instance().setCounter(QStringLiteral("差异项"), items_.size());
+    return true;
+}
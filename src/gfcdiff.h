@@ -0,0 +1,70 @@
+#pragma once
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+#include "gfcindex.h"
+
+class CompiledSchema;
+
+/**
+ * 两个 GFC 文件的语义比较（与 #id 编号无关）：
+ * - Merkle 哈希：实例哈希 = 类名 + 参数（去掉字符串外空白），其中每个 #n 替换为被引用实例的哈希；
+ *   按引用图自底向上分层，每层并行计算；环上的实例退化为用目标的局部哈希
+ * - 局部哈希：同上但引用只记作 '#'，用于区分“自身属性变化”和“仅引用内容变化”
+ * - 匹配：① Merkle 哈希相同即视为同一实例；② 剩余实例按“类 + 首个字符串参数”（ID/名称）配对；
+ *   ③ 再按“类 + 局部哈希”配对；④ 已配对实例在同一引用位置上的未配对同类实例随之配对；
+ *   ①之外配上的为修改，其余为新增/删除
+ * 两个文件的索引在结果对象里保存，便于并排显示实例文本。
+ */
+
+struct GfcDiffItem {
+    enum Kind : quint8 { Changed, Added, Removed };
+    Kind kind = Changed;
+    bool ownChanged = false;   // Changed：自身属性不同（否则仅被引用的内容不同）
+    int rowA = -1;
+    int rowB = -1;
+};
+
+struct GfcDiffClass {
+    QByteArray name;           // 大写类名
+    int same = 0;
+    int changed = 0;
+    int added = 0;
+    int removed = 0;
+    QVector<int> items;        // GfcDiff::items() 下标
+};
+
+class GfcDiff {
+public:
+    enum State : quint8 { Same, Changed, Added, Removed };
+
+    // a、b 为 UTF-8 文本；schema 仅用于类表映射，可空
+    bool compare(const QByteArray& a, const QByteArray& b, const CompiledSchema* schema = nullptr,
+                 QString* err = nullptr);
+
+    const GfcIndex& indexA() const { return a_; }
+    const GfcIndex& indexB() const { return b_; }
+    const QVector<GfcDiffClass>& classes() const { return classes_; }   // 按类名排序
+    const QVector<GfcDiffItem>& items() const { return items_; }
+
+    State stateA(int row) const { return State(stateA_[row]); }
+    State stateB(int row) const { return State(stateB_[row]); }
+    int partnerA(int row) const { return partnerA_[row]; }   // A 行对应的 B 行，-1 表示无
+    int partnerB(int row) const { return partnerB_[row]; }
+
+    int sameCount() const { return same_; }
+    qint64 elapsedMs() const { return elapsedMs_; }
+
+    // 单个索引的 Merkle 哈希（必要时先构建引用图）；local 非空时一并给出局部哈希
+    static QVector<quint64> merkleHashes(GfcIndex& index, QVector<quint64>* local = nullptr);
+
+private:
+    GfcIndex a_, b_;
+    QVector<GfcDiffClass> classes_;
+    QVector<GfcDiffItem> items_;
+    QVector<quint8> stateA_, stateB_;
+    QVector<int> partnerA_, partnerB_;
+    int same_ = 0;
+    qint64 elapsedMs_ = 0;
+};
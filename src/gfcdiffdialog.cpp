@@ -0,0 +1,244 @@
+#include "gfcdiffdialog.h"
+
+#include <QAbstractTableModel>
+#include <QColor>
+#include <QFontDatabase>
+#include <QHeaderView>
+#include <QLabel>
+#include <QPlainTextEdit>
+#include <QSplitter>
+#include <QTableView>
+#include <QTableWidget>
+#include <QTextBlock>
+#include <QTextCursor>
+#include <QTextEdit>
+#include <QVBoxLayout>
+
+namespace {
+
+const QColor kRemovedBg(255, 225, 225);
+const QColor kAddedBg(220, 245, 220);
+
+QString rowText(const GfcIndex& ix, int row)
+{
+    const std::string_view t = ix.text(row);
+    return QString::fromUtf8(t.data(), int(t.size()));
+}
+
+} // namespace
+
+// 差异项虚表：只保存所选类的下标列表，按需取文本
+class DiffItemModel : public QAbstractTableModel
+{
+public:
+    explicit DiffItemModel(const GfcDiff* diff, QObject* parent) : QAbstractTableModel(parent), diff_(diff) {}
+
+    void setItems(QVector<int> items)
+    {
+        beginResetModel();
+        items_ = std::move(items);
+        endResetModel();
+    }
+    int itemAt(int row) const { return items_.value(row, -1); }
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override { return parent.isValid() ? 0 : items_.size(); }
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override { return parent.isValid() ? 0 : 4; }
+
+    QVariant headerData(int section, Qt::Orientation o, int role) const override
+    {
+        if (o != Qt::Horizontal || role != Qt::DisplayRole) return QVariant();
+        static const char* const kHeaders[] = { "变化", "A", "B", "类" };
+        return QString::fromUtf8(kHeaders[section]);
+    }
+
+    QVariant data(const QModelIndex& idx, int role) const override
+    {
+        const GfcDiffItem& it = diff_->items()[items_[idx.row()]];
+        if (role == Qt::BackgroundRole) {
+            if (it.kind == GfcDiffItem::Added) return kAddedBg;
+            if (it.kind == GfcDiffItem::Removed) return kRemovedBg;
+            return QVariant();
+        }
+        if (role != Qt::DisplayRole) return QVariant();
+        switch (idx.column()) {
+        case 0:
+            if (it.kind == GfcDiffItem::Added) return QStringLiteral("新增");
+            if (it.kind == GfcDiffItem::Removed) return QStringLiteral("删除");
+            return it.ownChanged ? QStringLiteral("修改") : QStringLiteral("修改（引用内容）");
+        case 1:
+            return it.rowA >= 0 ? QStringLiteral("#%1").arg(diff_->indexA().at(it.rowA).id) : QString();
+        case 2:
+            return it.rowB >= 0 ? QStringLiteral("#%1").arg(diff_->indexB().at(it.rowB).id) : QString();
+        case 3: {
+            const GfcIndex& ix = it.rowA >= 0 ? diff_->indexA() : diff_->indexB();
+            const int row = it.rowA >= 0 ? it.rowA : it.rowB;
+            return QString::fromLatin1(ix.className(ix.at(row).cls));
+        }
+        }
+        return QVariant();
+    }
+
+private:
+    const GfcDiff* diff_;
+    QVector<int> items_;
+};
+
+GfcDiffDialog::GfcDiffDialog(QSharedPointer<GfcDiff> diff, const QString& nameA, const QString& nameB,
+                             QWidget* parent)
+    : QDialog(parent), diff_(std::move(diff))
+{
+    setWindowTitle(QStringLiteral("语义比较"));
+    setAttribute(Qt::WA_DeleteOnClose);
+    resize(1100, 720);
+
+    int changed = 0, added = 0, removed = 0;
+    for (const GfcDiffClass& c : diff_->classes()) {
+        changed += c.changed;
+        added += c.added;
+        removed += c.removed;
+    }
+    auto* summary = new QLabel(
+        QStringLiteral("A：%1（%2 个实例）　B：%3（%4 个实例）\n相同 %5，修改 %6，新增 %7，删除 %8，用时 %9 ms")
+            .arg(nameA).arg(diff_->indexA().size()).arg(nameB).arg(diff_->indexB().size())
+            .arg(diff_->sameCount()).arg(changed).arg(added).arg(removed).arg(diff_->elapsedMs()),
+        this);
+
+    // 类汇总
+    classTable_ = new QTableWidget(this);
+    classTable_->setColumnCount(5);
+    classTable_->setHorizontalHeaderLabels({ QStringLiteral("类"), QStringLiteral("相同"), QStringLiteral("修改"),
+                                             QStringLiteral("新增"), QStringLiteral("删除") });
+    classTable_->setSelectionBehavior(QAbstractItemView::SelectRows);
+    classTable_->setSelectionMode(QAbstractItemView::SingleSelection);
+    classTable_->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    classTable_->verticalHeader()->setVisible(false);
+
+    auto setRow = [this](int row, const QString& name, int same, int ch, int add, int rm) {
+        classTable_->setItem(row, 0, new QTableWidgetItem(name));
+        const int vals[] = { same, ch, add, rm };
+        for (int c = 0; c < 4; ++c) {
+            auto* it = new QTableWidgetItem;
+            it->setData(Qt::DisplayRole, vals[c]);
+            it->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+            classTable_->setItem(row, c + 1, it);
+        }
+    };
+    const QVector<GfcDiffClass>& classes = diff_->classes();
+    classTable_->setRowCount(classes.size() + 1);
+    setRow(0, QStringLiteral("（全部）"), diff_->sameCount(), changed, added, removed);
+    for (int i = 0; i < classes.size(); ++i) {
+        const GfcDiffClass& c = classes[i];
+        setRow(i + 1, QString::fromLatin1(c.name), c.same, c.changed, c.added, c.removed);
+        classTable_->item(i + 1, 0)->setData(Qt::UserRole, i);
+    }
+    classTable_->resizeColumnsToContents();
+
+    // 差异项
+    itemModel_ = new DiffItemModel(diff_.data(), this);
+    itemView_ = new QTableView(this);
+    itemView_->setModel(itemModel_);
+    itemView_->setSelectionBehavior(QAbstractItemView::SelectRows);
+    itemView_->setSelectionMode(QAbstractItemView::SingleSelection);
+    itemView_->verticalHeader()->setVisible(false);
+    itemView_->verticalHeader()->setDefaultSectionSize(fontMetrics().height() + 4);
+    itemView_->horizontalHeader()->setStretchLastSection(true);
+
+    // 并排文本
+    const QFont mono = QFontDatabase::systemFont(QFontDatabase::FixedFont);
+    auto makeView = [this, &mono]() {
+        auto* v = new QPlainTextEdit(this);
+        v->setReadOnly(true);
+        v->setLineWrapMode(QPlainTextEdit::NoWrap);
+        v->setFont(mono);
+        return v;
+    };
+    viewA_ = makeView();
+    viewB_ = makeView();
+
+    auto* top = new QSplitter(Qt::Horizontal, this);
+    top->addWidget(classTable_);
+    top->addWidget(itemView_);
+    top->setStretchFactor(1, 1);
+    auto* bottom = new QSplitter(Qt::Horizontal, this);
+    bottom->addWidget(viewA_);
+    bottom->addWidget(viewB_);
+    auto* split = new QSplitter(Qt::Vertical, this);
+    split->addWidget(top);
+    split->addWidget(bottom);
+
+    auto* lay = new QVBoxLayout(this);
+    lay->addWidget(summary);
+    lay->addWidget(split, 1);
+
+    connect(classTable_, &QTableWidget::currentCellChanged, this,
+        [this](int row, int, int prevRow, int) { if (row != prevRow) showClass(row); });
+    connect(itemView_->selectionModel(), &QItemSelectionModel::currentRowChanged, this,
+        [this](const QModelIndex& cur, const QModelIndex&) { showItem(cur.row()); });
+    connect(itemView_, &QTableView::doubleClicked, this, [this](const QModelIndex& idx) {
+        const int i = itemModel_->itemAt(idx.row());
+        if (i < 0) return;
+        const GfcDiffItem& it = diff_->items()[i];
+        if (it.rowA >= 0) emit instanceActivated(diff_->indexA().at(it.rowA).id);
+    });
+
+    classTable_->setCurrentCell(0, 0);
+}
+
+void GfcDiffDialog::showClass(int classRow)
+{
+    if (classRow < 0) return;
+    QVector<int> items;
+    if (classRow == 0) {
+        items.resize(diff_->items().size());
+        for (int i = 0; i < items.size(); ++i) items[i] = i;
+    }
+    else {
+        items = diff_->classes()[classTable_->item(classRow, 0)->data(Qt::UserRole).toInt()].items;
+    }
+    itemModel_->setItems(std::move(items));
+    viewA_->clear();
+    viewB_->clear();
+    if (itemModel_->rowCount() > 0) itemView_->setCurrentIndex(itemModel_->index(0, 0));
+}
+
+void GfcDiffDialog::showItem(int itemRow)
+{
+    const int i = itemModel_->itemAt(itemRow);
+    if (i < 0) return;
+    const GfcDiffItem& it = diff_->items()[i];
+    fillSide(viewA_, diff_->indexA(), it.rowA, true);
+    fillSide(viewB_, diff_->indexB(), it.rowB, false);
+}
+
+// 实例本身 + 直接引用的实例（缩进一级）；与另一侧不同的行着色
+void GfcDiffDialog::fillSide(QPlainTextEdit* view, const GfcIndex& ix, int row, bool sideA)
+{
+    view->clear();
+    view->setExtraSelections({});
+    if (row < 0) return;
+
+    QStringList lines;
+    QVector<int> rows;
+    lines << rowText(ix, row);
+    rows << row;
+    for (int k = 0, kn = ix.refCount(row); k < kn; ++k) {
+        const int t = ix.ref(row, k);
+        if (rows.contains(t)) continue;
+        lines << QStringLiteral("    ") + rowText(ix, t);
+        rows << t;
+    }
+    view->setPlainText(lines.join(QLatin1Char('\n')));
+
+    QList<QTextEdit::ExtraSelection> sels;
+    const QColor bg = sideA ? kRemovedBg : kAddedBg;
+    for (int l = 0; l < rows.size(); ++l) {
+        const GfcDiff::State st = sideA ? diff_->stateA(rows[l]) : diff_->stateB(rows[l]);
+        if (st == GfcDiff::Same) continue;
+        QTextEdit::ExtraSelection s;
+        s.cursor = QTextCursor(view->document()->findBlockByNumber(l));
+        s.format.setBackground(bg);
+        s.format.setProperty(QTextFormat::FullWidthSelection, true);
+        sels << s;
+    }
+    view->setExtraSelections(sels);
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include <QDialog>
+#include <QSharedPointer>
+
+#include "gfcdiff.h"
+
+class QLabel;
+class QPlainTextEdit;
+class QTableView;
+class QTableWidget;
+class DiffItemModel;
+
+/**
+ * 语义比较结果窗口（非模态）：
+ * - 左上：按类汇总（相同/修改/新增/删除），首行为“全部”
+ * - 右上：所选类的差异项（虚表，百万级也可滚动）
+ * - 下方：A/B 并排显示实例及其直接引用的实例文本，不同的行着色
+ * 双击差异项时发出 instanceActivated（A 侧 #id，A 为当前文档时用于跳转）。
+ */
+
+class GfcDiffDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    GfcDiffDialog(QSharedPointer<GfcDiff> diff, const QString& nameA, const QString& nameB,
+                  QWidget* parent = nullptr);
+
+signals:
+    void instanceActivated(qint64 idA);
+
+private:
+    void showClass(int classRow);
+    void showItem(int itemRow);
+    void fillSide(QPlainTextEdit* view, const GfcIndex& ix, int row, bool sideA);
+
+    QSharedPointer<GfcDiff> diff_;
+    QTableWidget* classTable_ = nullptr;
+    QTableView* itemView_ = nullptr;
+    DiffItemModel* itemModel_ = nullptr;
+    QPlainTextEdit* viewA_ = nullptr;
+    QPlainTextEdit* viewB_ = nullptr;
+};
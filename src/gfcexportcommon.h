@@ -0,0 +1,225 @@
+#pragma once
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <cmath>
+#include <string>
+#include <string_view>
+
+#include "gfcindex.h"
+#include "gfcnumber.h"
+#include "gfctyped.h"
+#include "schemacache.h"
+
+/**
+ * 表格类导出（NDJSON/CSV、SQLite）共用的参数值处理：
+ * - forEachValue：按顶层逗号切分参数区（括号、字符串平衡）
+ * - appendJson：一个 STEP 参数值写为 JSON（引用为目标 id，$ 为 null，.T./.F. 为 true/false，
+ *   类型值取内值，数值规整为 JSON 写法）；appendCsvText：按 RFC 4180 加引号
+ * - selectClasses：按类名（含子类）筛选文件类
+ */
+
+namespace gfc {
+
+inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+inline bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+inline std::string_view trim(std::string_view s)
+{
+    while (!s.empty() && isSpace(s.front())) s.remove_prefix(1);
+    while (!s.empty() && isSpace(s.back())) s.remove_suffix(1);
+    return s;
+}
+
+// 逐个顶层值（括号、字符串平衡），去掉两端空白；空串不产生值
+template <class F>
+void forEachValue(std::string_view s, F&& f)
+{
+    if (trim(s).empty()) return;
+    int depth = 0;
+    bool inStr = false;
+    size_t start = 0;
+    for (size_t i = 0; i < s.size(); ++i) {
+        const char c = s[i];
+        if (inStr) {
+            if (c == '\'') inStr = false;   // '' 视为相邻的两段，效果相同
+            continue;
+        }
+        if (c == '\'') inStr = true;
+        else if (c == '(') ++depth;
+        else if (c == ')') --depth;
+        else if (c == ',' && depth == 0) {
+            f(trim(s.substr(start, i - start)));
+            start = i + 1;
+        }
+    }
+    f(trim(s.substr(start)));
+}
+
+// 类型值 GFCLABEL('x') 的括号内部；不是类型值返回 false
+inline bool typedInner(std::string_view v, std::string_view* inner)
+{
+    const size_t open = v.find('(');
+    if (open == std::string_view::npos || open == 0 || v.back() != ')' || isDigit(v[0]) || v[0] == '-' || v[0] == '+')
+        return false;
+    *inner = v.substr(open + 1, v.size() - open - 2);
+    return true;
+}
+
+// -?(0|[1-9][0-9]*)(\.[0-9]+)?([eE][+-]?[0-9]+)?
+inline bool isJsonNumber(std::string_view s)
+{
+    size_t i = 0;
+    const size_t n = s.size();
+    if (i < n && s[i] == '-') ++i;
+    if (i >= n || !isDigit(s[i])) return false;
+    if (s[i] == '0') ++i;
+    else while (i < n && isDigit(s[i])) ++i;
+    if (i < n && s[i] == '.') {
+        if (++i >= n || !isDigit(s[i])) return false;
+        while (i < n && isDigit(s[i])) ++i;
+    }
+    if (i < n && (s[i] == 'e' || s[i] == 'E')) {
+        if (++i < n && (s[i] == '+' || s[i] == '-')) ++i;
+        if (i >= n || !isDigit(s[i])) return false;
+        while (i < n && isDigit(s[i])) ++i;
+    }
+    return i == n;
+}
+
+// STEP 数值规整为 JSON 写法（3. -> 3.0，1.E-05 -> 1.0E-05）；不是数值返回 false，非有限值写 null
+inline bool appendJsonNumber(std::string_view v, QByteArray& out)
+{
+    if (isJsonNumber(v)) {
+        out.append(v.data(), int(v.size()));
+        return true;
+    }
+    double d = 0;
+    if (!parseRealExact(v.data(), v.data() + v.size(), d)) return false;
+    if (!std::isfinite(d)) {
+        out += "null";
+        return true;
+    }
+    char buf[kRealBufSize];
+    const int n = formatReal(d, buf);
+    for (int i = 0; i < n; ++i) {
+        out += buf[i];
+        if (buf[i] == '.' && (i + 1 == n || !isDigit(buf[i + 1]))) out += '0';
+    }
+    return true;
+}
+
+inline void appendJsonString(std::string_view s, QByteArray& out)
+{
+    static const char kHex[] = "0123456789abcdef";
+    out += '"';
+    for (char c : s) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (uchar(c) < 0x20) {
+                out += "\\u00";
+                out += kHex[uchar(c) >> 4];
+                out += kHex[uchar(c) & 15];
+            }
+            else {
+                out += c;
+            }
+        }
+    }
+    out += '"';
+}
+
+inline void appendCsvText(std::string_view s, QByteArray& out)
+{
+    if (s.find_first_of(",\"\r\n") == std::string_view::npos) {
+        out.append(s.data(), int(s.size()));
+        return;
+    }
+    out += '"';
+    for (char c : s) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    out += '"';
+}
+
+// 一个参数值写为 JSON；tmp 为解码字符串的复用缓冲
+inline void appendJson(std::string_view v, QByteArray& out, std::string& tmp)
+{
+    if (v.empty() || v[0] == '$' || v[0] == '*') {
+        out += "null";
+        return;
+    }
+    switch (v[0]) {
+    case '\'': {
+        ArgReader r(v);
+        if (!r.readString(tmp)) tmp.assign(v);
+        appendJsonString(tmp, out);
+        return;
+    }
+    case '.': {
+        const std::string_view name = v.size() >= 2 ? v.substr(1, v.size() - 2) : std::string_view();
+        if (name == "T" || name == "TRUE") out += "true";
+        else if (name == "F" || name == "FALSE") out += "false";
+        else if (name == "U" || name == "UNKNOWN") out += "null";
+        else appendJsonString(name, out);
+        return;
+    }
+    case '#': {
+        size_t i = 1;
+        while (i < v.size() && isSpace(v[i])) ++i;
+        out.append(v.data() + i, int(v.size() - i));
+        return;
+    }
+    case '(': {
+        out += '[';
+        bool first = true;
+        forEachValue(v.substr(1, v.size() >= 2 ? v.size() - 2 : 0), [&](std::string_view item) {
+            if (!first) out += ',';
+            first = false;
+            appendJson(item, out, tmp);
+        });
+        out += ']';
+        return;
+    }
+    default:
+        break;
+    }
+    // 类型值 GFCLABEL('x')：取内值（多个时为数组）
+    std::string_view inner;
+    if (typedInner(v, &inner)) {
+        int count = 0;
+        forEachValue(inner, [&](std::string_view) { ++count; });
+        if (count == 1) appendJson(trim(inner), out, tmp);
+        else appendJson(v.substr(v.find('(')), out, tmp);
+        return;
+    }
+    if (!appendJsonNumber(v, out)) appendJsonString(v, out);
+}
+
+// 导出的类：classes 为空时全部；否则按名称含子类
+inline bool selectClasses(const GfcIndex& ix, const CompiledSchema& schema, const QStringList& classes,
+                          QVector<quint8>* ok, QString* err)
+{
+    ok->fill(classes.isEmpty() ? 1 : 0, ix.classCount());
+    for (const QString& name : classes) {
+        const int base = schema.find(name.trimmed());
+        if (base < 0) {
+            if (err) *err = QStringLiteral("Schema 中没有类 %1").arg(name.trimmed());
+            return false;
+        }
+        for (int c = 0; c < ix.classCount(); ++c) {
+            const int e = ix.schemaEntity(c);
+            if (e >= 0 && schema.isSubtypeOf(e, base)) (*ok)[c] = 1;
+        }
+    }
+    return true;
+}
+
+} // namespace gfc
@@ -0,0 +1,235 @@
+#include "gfcextract.h"
+#include "gfccompress.h"
+#include "gfcindex.h"
+#include "gfcparallel.h"
+#include "perftrace.h"
+#include "schemacache.h"
+
+#include <QElapsedTimer>
+#include <string_view>
+
+namespace {
+
+inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+inline bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+// 文件类 → 是否为 root 的子类
+QVector<quint8> classesUnder(const GfcIndex& ix, const CompiledSchema& schema, const char* root)
+{
+    QVector<quint8> out(ix.classCount(), 0);
+    const int base = schema.find(QString::fromLatin1(root));
+    if (base < 0) return out;
+    for (int c = 0; c < ix.classCount(); ++c) {
+        const int e = ix.schemaEntity(c);
+        out[c] = e >= 0 && schema.isSubtypeOf(e, base);
+    }
+    return out;
+}
+
+const char kDefaultHeader[] =
+    "HEADER;\n"
+    "FILE_DESCRIPTION(('GFC3X4'),'65001');\n"
+    "FILE_NAME('');\n"
+    "FILE_SCHEMA(('GFC3X4'));\n"
+    "ENDSEC;\n"
+    "DATA;\n";
+
+} // namespace
+
+QVector<int> GfcExtract::closure(const GfcIndex& ix, const CompiledSchema& schema, const QVector<int>& seeds,
+                                 bool withRelations, Stats* stats)
+{
+    GFC_PERF_SCOPE("引用闭包");
+    const int n = ix.size();
+    QVector<quint8> keep(n, 0), seed(n, 0);
+    QVector<int> queue;
+    for (int r : seeds) {
+        if (r < 0 || r >= n || seed[r]) continue;
+        seed[r] = keep[r] = 1;
+        queue << r;
+    }
+    int relations = 0;
+
+    if (withRelations && !queue.isEmpty()) {
+        // 关系实例只占少数：并行扫一遍，找出引用了种子的
+        const QVector<quint8> relClass = classesUnder(ix, schema, "GfcRelationShip");
+        const QVector<quint8> objClass = classesUnder(ix, schema, "GfcObject");
+        const int parts = gfc::partsFor(n);
+        QVector<QVector<int>> found(parts);
+        gfc::parallelParts(n, parts, [&](int b, int e, int part) {
+            for (int r = b; r < e; ++r) {
+                if (!relClass[ix.at(r).cls] || seed[r]) continue;
+                for (int k = 0; k < ix.refCount(r); ++k) {
+                    if (seed[ix.ref(r, k)]) {
+                        found[part] << r;
+                        break;
+                    }
+                }
+            }
+        });
+        QVector<int> rels;
+        for (const QVector<int>& f : found) rels += f;
+        relations = rels.size();
+        // 关系本身保留；其引用中非种子的对象不跟进，其余（属性集等）照常进入闭包
+        for (int r : rels) keep[r] = 1;
+        for (int r : rels) {
+            for (int k = 0; k < ix.refCount(r); ++k) {
+                const int t = ix.ref(r, k);
+                if (keep[t] || objClass[ix.at(t).cls]) continue;
+                keep[t] = 1;
+                queue << t;
+            }
+        }
+    }
+
+    for (int head = 0; head < queue.size(); ++head) {
+        const int r = queue[head];
+        for (int k = 0; k < ix.refCount(r); ++k) {
+            const int t = ix.ref(r, k);
+            if (keep[t]) continue;
+            keep[t] = 1;
+            queue << t;
+        }
+    }
+
+    QVector<int> rows;
+    for (int r = 0; r < n; ++r) {
+        if (keep[r]) rows << r;
+    }
+    if (stats) {
+        stats->seeds = 0;
+        for (quint8 s : seed) stats->seeds += s;
+        stats->instances = rows.size();
+        stats->relations = relations;
+    }
+    return rows;
+}
+
+bool GfcExtract::extract(const GfcIndex& ix, const CompiledSchema& schema, const QVector<int>& seeds,
+                         const QString& output, const Options& opt, Stats* stats, QString* err)
+{
+    GFC_PERF_SCOPE("提取引用闭包");
+    QElapsedTimer timer;
+    timer.start();
+    if (!ix.hasRefs()) {
+        if (err) *err = QStringLiteral("需要引用图（先 buildRefs）");
+        return false;
+    }
+    Stats st;
+    const QVector<int> rows = closure(ix, schema, seeds, opt.withRelations, &st);
+    if (rows.isEmpty()) {
+        if (err) *err = QStringLiteral("没有选中实例");
+        return false;
+    }
+
+    GfcWriter::Options wopt = opt.write;
+    wopt.compression = GfcCompress::codecForPath(output);
+    if (!GfcCompress::available(wopt.compression)) {
+        if (err) *err = QStringLiteral("本版本未启用 %1 支持").arg(GfcCompress::codecName(wopt.compression));
+        return false;
+    }
+
+    // 按原顺序压缩编号；0 表示未带上
+    QVector<qint64> newId(ix.size(), 0);
+    for (int i = 0; i < rows.size(); ++i) newId[rows[i]] = i + 1;
+
+    const QByteArray& data = ix.data();
+    const char* base = data.constData();
+    const int m = rows.size();
+    const int parts = gfc::partsFor(m, 2048);
+    QVector<QByteArray> pieces(parts);
+    QVector<qint64> dropped(parts, 0);
+    gfc::parallelParts(m, parts, [&](int b, int e, int part) {
+        QByteArray& buf = pieces[part];
+        for (int i = b; i < e; ++i) {
+            const int r = rows[i];
+            const GfcIndexEntry& en = ix.at(r);
+            buf += '#';
+            gfc::appendNumber(buf, newId[r]);
+            const char* p = base + en.begin + 1;
+            while (isDigit(*p)) ++p;
+            buf.append(p, int(base + en.argsBegin - p));
+
+            const char* a = base + en.argsBegin;
+            const char* ae = base + en.argsEnd;
+            const char* run = a;
+            const int kn = ix.refCount(r);
+            int k = 0, depth = 0;
+            bool inStr = false;
+            while (a < ae) {
+                const char c = *a;
+                if (inStr) {
+                    if (c == '\'') inStr = false;
+                    ++a;
+                    continue;
+                }
+                if (c == '\'') { inStr = true; ++a; continue; }
+                if (c == '(') ++depth;
+                else if (c == ')') --depth;
+                if (c != '#' || a + 1 >= ae || !isDigit(a[1])) { ++a; continue; }
+
+                buf.append(run, int(a - run));
+                const char* d = a + 1;
+                qint64 id = 0;
+                while (d < ae && isDigit(*d)) id = id * 10 + (*d++ - '0');
+                const int t = k < kn && ix.at(ix.ref(r, k)).id == id ? ix.ref(r, k++) : -1;
+                if (t >= 0 && newId[t]) {
+                    buf += '#';
+                    gfc::appendNumber(buf, newId[t]);
+                }
+                else if (depth == 0) {
+                    buf += '$';
+                    ++dropped[part];
+                }
+                else {
+                    // 列表项：连同一个分隔逗号删去
+                    int len = buf.size();
+                    while (len > 0 && isSpace(buf[len - 1])) --len;
+                    if (len > 0 && buf[len - 1] == ',') {
+                        buf.truncate(len - 1);
+                    }
+                    else {
+                        while (d < ae && isSpace(*d)) ++d;
+                        if (d < ae && *d == ',') ++d;
+                    }
+                    ++dropped[part];
+                }
+                a = run = d;
+            }
+            buf.append(run, int(ae - run));
+            buf.append(ae, int(base + en.end - ae));   // ")...;"
+            buf += '\n';
+        }
+    });
+
+    const std::string_view head(base, size_t(ix.headerEnd()));
+    const std::string_view tail(base + ix.trailerBegin(), size_t(data.size() - ix.trailerBegin()));
+    GfcStreamWriter out;
+    if (!out.open(output, wopt, err)) return false;
+    bool ok = head.find("DATA;") != std::string_view::npos ? out.write(head.data(), qint64(head.size()))
+                                                          : out.write(kDefaultHeader, qint64(sizeof(kDefaultHeader) - 1));
+    for (QByteArray& p : pieces) {
+        ok = ok && out.write(p);
+        p.clear();
+    }
+    if (tail.find("ENDSEC") != std::string_view::npos) {
+        size_t s = 0;
+        while (s < tail.size() && isSpace(tail[s])) ++s;   // 实例后已换行
+        ok = ok && out.write(tail.data() + s, qint64(tail.size() - s));
+    }
+    else {
+        ok = ok && out.write("ENDSEC;\n", 8);
+    }
+    if (!ok) {
+        if (err) *err = out.errorString();
+        return false;
+    }
+    if (!out.commit(err)) return false;
+
+    for (qint64 d : dropped) st.droppedRefs += d;
+    st.bytesOut = out.bytesWritten();
+    st.elapsedMs = timer.elapsed();
+    if (stats) *stats = st;
+    PerfTrace::instance().setCounter(QStringLiteral("提取实例"), st.instances);
+    return true;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <QString>
+#include <QVector>
+
+#include "gfcwriter.h"
+
+class CompiledSchema;
+class GfcIndex;
+
+/**
+ * 引用闭包提取：选中的实例连同它（传递地）引用的全部实例写成一个独立的 GFC 文件（问题复现、局部交付）。
+ * - 闭包：在引用图上从种子广度优先；可选把引用了种子的关系实例（GfcRelationShip 及子类）一并带上，
+ *   并跟进它们的引用，但不跟进到关系所指的其它对象（GfcObject 及子类的非种子实例）
+ * - 输出按原文件顺序、编号压缩为 #1..#n；指向未带上实例的引用在列表中删去该项，单值处写 $
+ * - HEADER 沿用原文件（原文没有时写默认头段）；实例分段并行改写后按序流式写出，压缩由扩展名决定
+ */
+
+struct GfcExtractOptions {
+    bool withRelations = false;
+    GfcWriter::Options write;
+};
+
+class GfcExtract {
+public:
+    using Options = GfcExtractOptions;
+
+    struct Stats {
+        int seeds = 0;
+        int instances = 0;        // 写出的实例
+        int relations = 0;        // 因引用种子而带上的关系实例
+        qint64 droppedRefs = 0;   // 删去或改为 $ 的引用
+        qint64 bytesOut = 0;
+        qint64 elapsedMs = 0;
+    };
+
+    // 闭包行号（升序）；index 需已 buildRefs()
+    static QVector<int> closure(const GfcIndex& index, const CompiledSchema& schema, const QVector<int>& seeds,
+                                bool withRelations, Stats* stats = nullptr);
+
+    static bool extract(const GfcIndex& index, const CompiledSchema& schema, const QVector<int>& seeds,
+                        const QString& output, const Options& opt = Options(), Stats* stats = nullptr,
+                        QString* err = nullptr);
+};
@@ -0,0 +1,74 @@
+#include "gfcfileio.h"
+#include "gfcbinary.h"
+#include "gfcindex.h"
+#include "perftrace.h"
+
+#include <QFile>
+
+bool GfcFileIO::isBinaryPath(const QString& path)
+{
+    return GfcCompress::stripCodecSuffix(path).endsWith(QLatin1String(".gfcb"), Qt::CaseInsensitive);
+}
+
+bool GfcFileIO::readText(const QString& path, QByteArray* utf8, QString* err)
+{
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) {
+        if (err) *err = QStringLiteral("无法打开文件：%1").arg(path);
+        return false;
+    }
+    QByteArray raw;
+    const GfcCompress::Codec codec = GfcCompress::detect(f.peek(4));
+    if (codec != GfcCompress::None) {
+        // 压缩输入：边读边解压，解压数据逐块追加，不落盘
+        GFC_PERF_SCOPE("解压");
+        raw.reserve(int(qMin<qint64>(f.size() * 4, 1 << 30)));
+        const bool ok = GfcCompress::decompress(&f, codec, [&raw](const char* d, qint64 n) {
+            raw.append(d, int(n));
+            return true;
+        }, err);
+        if (!ok) return false;
+        PerfTrace::instance().setCounter(QStringLiteral("压缩字节数"), f.size());
+    }
+    else {
+        GFC_PERF_SCOPE("读取文件");
+        raw = f.readAll();
+    }
+    PerfTrace::instance().setCounter(QStringLiteral("文件字节数"), raw.size());
+
+    if (GfcBinary::isBinary(raw)) {
+        // 二进制容器先还原为文本，之后与 .gfc 走同一条索引/模型流程
+        GfcBinaryReader reader;
+        if (!reader.open(raw, err)) return false;
+        raw = reader.toText(err);
+        if (raw.isEmpty()) return false;
+    }
+    {
+        GFC_PERF_SCOPE("换行规整");
+        if (raw.startsWith("\xEF\xBB\xBF")) raw.remove(0, 3);   // 与 QTextStream 一致：去掉 BOM
+        if (raw.contains('\r')) raw.replace("\r\n", "\n");     // 与原 QIODevice::Text 读取一致
+    }
+    *utf8 = raw;
+    return true;
+}
+
+bool GfcFileIO::writeText(const QString& text, const QString& path, const CompiledSchema& schema,
+                          const GfcWriter::Options& opt, QString* err)
+{
+    // model.gfc.gz / model.gfcb.zst：扩展名决定压缩格式，去掉压缩后缀的部分决定文本或二进制
+    GfcWriter::Options o = opt;
+    o.compression = GfcCompress::codecForPath(path);
+    if (!GfcCompress::available(o.compression)) {
+        if (err) *err = QStringLiteral("本版本未启用 %1 支持").arg(GfcCompress::codecName(o.compression));
+        return false;
+    }
+    if (!isBinaryPath(path)) return GfcWriter::writeTextAtomic(text, path, o, err);
+
+    GfcIndex index;
+    QByteArray bin;
+    if (!index.build(text.toUtf8(), &schema, err) || !GfcBinary::encode(index, &bin, err)) return false;
+    // 二进制按固定大小切块，压缩时各块可并行
+    const int block = 4 << 20;
+    const int count = qMax(1, int((qint64(bin.size()) + block - 1) / block));
+    return GfcWriter::writeChunksAtomic(count, [&bin, block](int i) { return bin.mid(i * block, block); }, path, o, err);
+}
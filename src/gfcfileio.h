@@ -0,0 +1,23 @@
+#pragma once
+#include <QByteArray>
+#include <QString>
+
+#include "gfcwriter.h"
+
+class CompiledSchema;
+
+/**
+ * GFC 文件读写入口（编辑器与命令行共用）：
+ * - readText：按内容识别 gzip/zstd 压缩与文本 .gfc / 二进制 .gfcb，统一还原为 UTF-8 文本（去 BOM，\r\n 规整为 \n）
+ * - writeText：按扩展名选择写出格式（.gfcb 为二进制，其余为文本；再加 .gz/.zst 则压缩），经 GfcWriter 原子替换目标文件
+ */
+
+class GfcFileIO {
+public:
+    static bool readText(const QString& path, QByteArray* utf8, QString* err = nullptr);
+
+    static bool writeText(const QString& text, const QString& path, const CompiledSchema& schema,
+                          const GfcWriter::Options& opt = GfcWriter::Options(), QString* err = nullptr);
+
+    static bool isBinaryPath(const QString& path);
+};
@@ -0,0 +1,490 @@
+#include "gfcgeometry.h"
+#include "gfcindex.h"
+#include "gfcparallel.h"
+#include "gfctyped.h"
+#include "perftrace.h"
+#include "schemacache.h"
+
+#include <QElapsedTimer>
+#include <QThread>
+#include <cmath>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+struct Vec3 {
+    double x, y, z;
+};
+
+inline Vec3 cross(const Vec3& a, const Vec3& b)
+{
+    return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x };
+}
+inline double dot(const Vec3& a, const Vec3& b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+inline double norm(const Vec3& a) { return std::sqrt(dot(a, a)); }
+
+// 一批截面点 (u, v) 沿体 Z 轴拉伸 0..w 后经仿射变换的包围盒：逐列紧凑循环（无分支，便于向量化）；
+// 两端面只差平移 m[k][2] * w，截面点只需变换一次
+void boundsOfPrism(const double m[3][4], const std::vector<double>& us, const std::vector<double>& vs, double w,
+                   GfcAabb* box)
+{
+    const int n = int(us.size());
+    if (n == 0) return;
+    const double* u = us.data();
+    const double* v = vs.data();
+    for (int k = 0; k < 3; ++k) {
+        const double a = m[k][0], b = m[k][1];
+        double lo = a * u[0] + b * v[0];
+        double hi = lo;
+        for (int i = 1; i < n; ++i) {
+            const double x = a * u[i] + b * v[i];
+            lo = x < lo ? x : lo;
+            hi = x > hi ? x : hi;
+        }
+        const double shift = m[k][2] * w;
+        lo += m[k][3] + qMin(0.0, shift);
+        hi += m[k][3] + qMax(0.0, shift);
+        if (lo < box->min[k]) box->min[k] = lo;
+        if (hi > box->max[k]) box->max[k] = hi;
+    }
+}
+
+inline Vec3 column(const double m[3][4], int c) { return { m[0][c], m[1][c], m[2][c] }; }
+
+// 拉伸体：截面积 × 长度 × |det|；两端面 + 侧面；包围盒取截面关键点在两端的像
+void measureExtruded(const GfcSolid& solid, const std::vector<GfcSectionLoop>& loops, GfcElementGeometry* g)
+{
+    const double (&m)[3][4] = solid.world;
+    const Vec3 a = column(m, 0), b = column(m, 1), c = column(m, 2);
+    const double len = solid.len;
+    const double det = std::fabs(dot(a, cross(b, c)));
+    const double capScale = norm(cross(a, b));
+    // 截面平面内保角（a ⟂ b、|a| = |b|）且拉伸方向垂直于截面时，侧面积按周长精确计算
+    const double la = norm(a), lb = norm(b), lc = norm(c);
+    const double tol = 1e-9 * qMax(1.0, la * lb);
+    const bool conformal = std::fabs(dot(a, b)) < tol && std::fabs(la - lb) < tol * qMax(1.0, la)
+                           && std::fabs(dot(a, c)) < tol * qMax(1.0, lc) && std::fabs(dot(b, c)) < tol * qMax(1.0, lc);
+
+    double outer = 0, holes = 0, lateral = 0;
+    std::vector<double> us, vs;
+    for (const GfcSectionLoop& ring : loops) {
+        double signedArea = 0;
+        for (const GfcSectionSegment& s : ring) {
+            if (!s.arc) {
+                signedArea += 0.5 * (s.x0 * s.y1 - s.x1 * s.y0);
+                const double dx = s.x1 - s.x0, dy = s.y1 - s.y0;
+                const Vec3 d = { a.x * dx + b.x * dy, a.y * dx + b.y * dy, a.z * dx + b.z * dy };
+                lateral += norm(cross(d, c));
+                us.push_back(s.x0); vs.push_back(s.y0);
+                us.push_back(s.x1); vs.push_back(s.y1);
+                continue;
+            }
+            const double dphi = s.phi1 - s.phi0;
+            signedArea += 0.5 * (s.r * s.r * dphi + s.r * s.cx * (std::sin(s.phi1) - std::sin(s.phi0))
+                                 - s.r * s.cy * (std::cos(s.phi1) - std::cos(s.phi0)));
+            if (conformal) {
+                lateral += s.r * std::fabs(dphi) * la * lc;
+            }
+            else {
+                const int n = qMax(16, int(std::ceil(std::fabs(dphi) / (gfc::kPi / 64))));
+                const double h = dphi / n;
+                for (int i = 0; i < n; ++i) {
+                    const double phi = s.phi0 + (i + 0.5) * h;
+                    const double tx = -s.r * std::sin(phi), ty = s.r * std::cos(phi);
+                    const Vec3 d = { a.x * tx + b.x * ty, a.y * tx + b.y * ty, a.z * tx + b.z * ty };
+                    lateral += norm(cross(d, c)) * std::fabs(h);
+                }
+            }
+            // 端点与各世界轴上的极值点（落在圆弧范围内的）
+            us.push_back(s.x0); vs.push_back(s.y0);
+            us.push_back(s.x1); vs.push_back(s.y1);
+            const double lo = qMin(s.phi0, s.phi1), span = std::fabs(dphi);
+            for (int k = 0; k < 3; ++k) {
+                const double star = std::atan2(m[k][1], m[k][0]);
+                for (double phi : { star, star + gfc::kPi }) {
+                    double d = std::fmod(phi - lo, 2 * gfc::kPi);
+                    if (d < 0) d += 2 * gfc::kPi;
+                    if (d <= span || span >= 2 * gfc::kPi) {
+                        us.push_back(s.cx + s.r * std::cos(phi));
+                        vs.push_back(s.cy + s.r * std::sin(phi));
+                    }
+                }
+            }
+        }
+        const double area = std::fabs(signedArea);
+        if (area > outer) { holes += outer; outer = area; }
+        else holes += area;
+    }
+    const double sectionArea = qMax(0.0, outer - holes);
+    g->volume += sectionArea * std::fabs(len) * det;
+    g->area += 2 * sectionArea * capScale + std::fabs(len) * lateral;
+    boundsOfPrism(m, us, vs, len, &g->box);
+}
+
+void measureCuboid(const GfcSolid& solid, GfcElementGeometry* g)
+{
+    const double (&m)[3][4] = solid.world;
+    const double (&d)[3] = solid.dim;
+    const Vec3 a = column(m, 0), b = column(m, 1), c = column(m, 2);
+    const double dx = std::fabs(d[0]), dy = std::fabs(d[1]), dz = std::fabs(d[2]);
+    g->volume += std::fabs(dot(a, cross(b, c))) * dx * dy * dz;
+    g->area += 2 * (norm(cross(a, b)) * dx * dy + norm(cross(b, c)) * dy * dz + norm(cross(a, c)) * dx * dz);
+    const std::vector<double> us = { 0, d[0], 0, d[0] }, vs = { 0, 0, d[1], d[1] };
+    boundsOfPrism(m, us, vs, d[2], &g->box);
+}
+
+} // namespace
+
+// 3×4 仿射矩阵：列 0..2 为 X/Y/Z 轴，列 3 为原点
+struct GfcGeometryEvaluator::Affine {
+    double m[3][4] = { { 1, 0, 0, 0 }, { 0, 1, 0, 0 }, { 0, 0, 1, 0 } };
+
+    // this ∘ b
+    Affine operator*(const Affine& b) const
+    {
+        Affine r;
+        for (int i = 0; i < 3; ++i) {
+            for (int j = 0; j < 4; ++j) {
+                double s = j == 3 ? m[i][3] : 0;
+                for (int k = 0; k < 3; ++k) s += m[i][k] * b.m[k][j];
+                r.m[i][j] = s;
+            }
+        }
+        return r;
+    }
+};
+
+GfcGeometryEvaluator::GfcGeometryEvaluator(const GfcIndex& index, const CompiledSchema& schema)
+    : ix_(index), schema_(schema)
+{
+    auto entity = [this](const char* name) { return schema_.find(QString::fromLatin1(name)); };
+    auto attr = [this](int e, const char* name) { return e >= 0 ? schema_.attributeIndex(e, QString::fromLatin1(name)) : -1; };
+    eElement_ = entity("GfcElement");
+    eElementShape_ = entity("GfcElementShape");
+    eShape_ = entity("GfcShape");
+    eManifold_ = entity("GfcManifoldSolidShape");
+    eExtruded_ = entity("GfcExtrudedBody");
+    eCuboid_ = entity("GfcCuboidBody");
+    eCommonPolygon_ = entity("GfcCommonPolygon");
+    eCoedgeList_ = entity("GfcCoedgeList");
+    eLine_ = entity("GfcLine2d");
+    eArc_ = entity("GfcArc2d");
+    eCoord3_ = entity("GfcCoordinates3d");
+    eBox3_ = entity("GfcBox3d");
+    aShapes_ = attr(eElement_, "Shapes");
+    aShape_ = attr(eElementShape_, "Shape");
+    aLocal_ = attr(eShape_, "LocalCoordinate");
+    aBBox_ = attr(eShape_, "BoundingBox");
+    aBoxMin_ = attr(eBox3_, "Min");
+    aBoxMax_ = attr(eBox3_, "Max");
+    aOrigin_ = attr(eCoord3_, "Origin");
+    aAxisX_ = attr(eCoord3_, "X");
+    aAxisY_ = attr(eCoord3_, "Y");
+    aAxisZ_ = attr(eCoord3_, "Z");
+    aBody_ = attr(eManifold_, "Body");
+    aExtCoord_ = attr(eExtruded_, "Coordinate");
+    aLen_ = attr(eExtruded_, "Len");
+    aSection_ = attr(eExtruded_, "Section");
+    aCubCoord_ = attr(eCuboid_, "Coordinate");
+    aDim_ = attr(eCuboid_, "Dimension");
+    aLoops_ = attr(eCommonPolygon_, "Loops");
+    aCoedges_ = attr(eCoedgeList_, "Coedges");
+    aStart_ = attr(eLine_, "StartPt");
+    aEnd_ = attr(eLine_, "EndPt");
+    aCenter_ = attr(eArc_, "CenterPt");
+    aRadius_ = attr(eArc_, "Radius");
+    aRange_ = attr(eArc_, "Range");
+    aClock_ = attr(eArc_, "ClockSign");
+}
+
+int GfcGeometryEvaluator::rowOf(qint64 id, int entity) const
+{
+    const int row = ix_.rowOf(id);
+    if (row < 0 || entity < 0) return -1;
+    const int e = ix_.schemaEntity(ix_.at(row).cls);
+    return e >= 0 && schema_.isSubtypeOf(e, entity) ? row : -1;
+}
+
+bool GfcGeometryEvaluator::isElement(int row) const
+{
+    const int e = ix_.schemaEntity(ix_.at(row).cls);
+    return e >= 0 && eElement_ >= 0 && schema_.isSubtypeOf(e, eElement_);
+}
+
+bool GfcGeometryEvaluator::readRef(int row, int attr, qint64* id) const
+{
+    if (attr < 0) return false;
+    gfc::ArgReader r(ix_.args(row));
+    gfc::Ref ref;
+    if (!r.skipValues(attr) || r.readNull() || !r.readRef(ref)) return false;
+    *id = ref.id;
+    return true;
+}
+
+bool GfcGeometryEvaluator::readRefs(int row, int attr, std::vector<qint64>* ids) const
+{
+    ids->clear();
+    if (attr < 0) return false;
+    gfc::ArgReader r(ix_.args(row));
+    if (!r.skipValues(attr) || r.readNull()) return false;
+    if (!r.beginList()) return false;
+    gfc::Ref ref;
+    while (!r.atListEnd()) {
+        if (!r.readRef(ref)) return false;
+        ids->push_back(ref.id);
+    }
+    return r.endList();
+}
+
+bool GfcGeometryEvaluator::readDouble(int row, int attr, double* v) const
+{
+    if (attr < 0) return false;
+    gfc::ArgReader r(ix_.args(row));
+    return r.skipValues(attr) && !r.readNull() && r.readDouble(*v) && std::isfinite(*v);
+}
+
+bool GfcGeometryEvaluator::vec(qint64 id, int dims, double* out) const
+{
+    const int row = ix_.rowOf(id);
+    if (row < 0) return false;
+    gfc::ArgReader r(ix_.args(row));
+    for (int d = 0; d < dims; ++d) {
+        if (!r.readDouble(out[d]) || !std::isfinite(out[d])) return false;
+    }
+    return true;
+}
+
+// GfcCoordinates3d(Origin, X, Y, Z)；$ 的坐标系视为单位阵
+bool GfcGeometryEvaluator::frame(int row, int attr, Affine* a) const
+{
+    *a = Affine();
+    gfc::ArgReader probe(ix_.args(row));
+    if (attr < 0 || !probe.skipValues(attr)) return false;
+    if (probe.readNull()) return true;
+    qint64 id = -1;
+    if (!readRef(row, attr, &id)) return false;
+    const int fr = rowOf(id, eCoord3_);
+    if (fr < 0) return false;
+    const int attrs[4] = { aAxisX_, aAxisY_, aAxisZ_, aOrigin_ };   // 对应矩阵列 0..3
+    double v[3];
+    for (int col = 0; col < 4; ++col) {
+        qint64 vid = -1;
+        if (!readRef(fr, attrs[col], &vid) || !vec(vid, 3, v)) return false;
+        for (int k = 0; k < 3; ++k) a->m[k][col] = v[k];
+    }
+    return true;
+}
+
+int GfcGeometryEvaluator::solids(int row, std::vector<GfcSolid>* out, QByteArray* skippedClass) const
+{
+    out->clear();
+    std::vector<qint64> shapes;
+    if (!readRefs(row, aShapes_, &shapes)) return 0;
+    int skipped = 0;
+    for (qint64 id : shapes) {
+        const int es = rowOf(id, eElementShape_);
+        qint64 shapeId = -1;
+        QByteArray why;
+        GfcSolid s;
+        if (es < 0 || !readRef(es, aShape_, &shapeId) || !shapeSolid(shapeId, &s, &why)) {
+            ++skipped;
+            if (skippedClass && skippedClass->isEmpty()) {
+                const int r = ix_.rowOf(es < 0 ? id : shapeId);
+                *skippedClass = !why.isEmpty() ? why : r >= 0 ? ix_.className(ix_.at(r).cls) : QByteArray("#?");
+            }
+            continue;
+        }
+        out->push_back(s);
+    }
+    return skipped;
+}
+
+bool GfcGeometryEvaluator::shapeSolid(qint64 shapeId, GfcSolid* s, QByteArray* why) const
+{
+    const int shape = rowOf(shapeId, eManifold_);
+    if (shape < 0) return false;              // 其它形体类型：按类名提示
+    Affine local, coord;
+    qint64 bodyId = -1;
+    if (!frame(shape, aLocal_, &local) || !readRef(shape, aBody_, &bodyId)) return false;
+    if (const int body = rowOf(bodyId, eExtruded_); body >= 0) {
+        qint64 sectionId = -1;
+        if (!frame(body, aExtCoord_, &coord) || !readDouble(body, aLen_, &s->len)
+            || !readRef(body, aSection_, &sectionId)) {
+            return false;
+        }
+        s->kind = GfcSolid::Extruded;
+        s->section = rowOf(sectionId, eCommonPolygon_);
+        if (s->section < 0) {
+            const int r = ix_.rowOf(sectionId);
+            if (r >= 0) *why = ix_.className(ix_.at(r).cls);
+            return false;
+        }
+    }
+    else if (const int body = rowOf(bodyId, eCuboid_); body >= 0) {
+        qint64 dimId = -1;
+        if (!frame(body, aCubCoord_, &coord) || !readRef(body, aDim_, &dimId) || !vec(dimId, 3, s->dim)) return false;
+        s->kind = GfcSolid::Cuboid;
+    }
+    else {
+        const int r = ix_.rowOf(bodyId);
+        if (r >= 0) *why = ix_.className(ix_.at(r).cls);
+        return false;
+    }
+    const Affine world = local * coord;
+    std::memcpy(s->world, world.m, sizeof s->world);
+    return true;
+}
+
+bool GfcGeometryEvaluator::section(int row, std::vector<GfcSectionLoop>* loops, QByteArray* why) const
+{
+    loops->clear();
+    std::vector<qint64> ids, curves;
+    if (!readRefs(row, aLoops_, &ids)) return false;
+    for (qint64 lid : ids) {
+        const int loop = rowOf(lid, eCoedgeList_);
+        if (loop < 0 || !readRefs(loop, aCoedges_, &curves)) return false;
+        GfcSectionLoop segs;
+        for (qint64 cid : curves) {
+            GfcSectionSegment s;
+            double p[2], q[2];
+            if (const int line = rowOf(cid, eLine_); line >= 0) {
+                qint64 a = -1, b = -1;
+                if (!readRef(line, aStart_, &a) || !readRef(line, aEnd_, &b) || !vec(a, 2, p) || !vec(b, 2, q)) return false;
+                s.x0 = p[0]; s.y0 = p[1]; s.x1 = q[0]; s.y1 = q[1];
+            }
+            else if (const int arc = rowOf(cid, eArc_); arc >= 0) {
+                qint64 c = -1, range = -1;
+                double clock = 1;
+                if (!readRef(arc, aCenter_, &c) || !vec(c, 2, p) || !readDouble(arc, aRadius_, &s.r)
+                    || !readRef(arc, aRange_, &range) || !vec(range, 2, q) || !(s.r > 0)) {
+                    return false;
+                }
+                readDouble(arc, aClock_, &clock);
+                const double sign = clock > 0 ? 1 : -1;
+                s.arc = true;
+                s.cx = p[0]; s.cy = p[1];
+                s.phi0 = sign * q[0] / s.r;
+                s.phi1 = sign * q[1] / s.r;
+                s.x0 = s.cx + s.r * std::cos(s.phi0); s.y0 = s.cy + s.r * std::sin(s.phi0);
+                s.x1 = s.cx + s.r * std::cos(s.phi1); s.y1 = s.cy + s.r * std::sin(s.phi1);
+            }
+            else {
+                const int r = ix_.rowOf(cid);
+                if (r >= 0 && why) *why = ix_.className(ix_.at(r).cls);
+                return false;
+            }
+            segs.push_back(s);
+        }
+        if (!segs.empty()) loops->push_back(std::move(segs));
+    }
+    return !loops->empty();
+}
+
+GfcAabb GfcGeometryEvaluator::declaredBox(int row) const
+{
+    GfcAabb box;
+    std::vector<qint64> shapes;
+    if (!readRefs(row, aShapes_, &shapes)) return box;
+    for (qint64 id : shapes) {
+        const int es = rowOf(id, eElementShape_);
+        qint64 shapeId = -1, boxId = -1, minId = -1, maxId = -1;
+        if (es < 0 || !readRef(es, aShape_, &shapeId)) continue;
+        const int shape = rowOf(shapeId, eShape_);
+        Affine local;
+        if (shape < 0 || !readRef(shape, aBBox_, &boxId) || !frame(shape, aLocal_, &local)) continue;
+        const int b = rowOf(boxId, eBox3_);
+        double lo[3], hi[3];
+        if (b < 0 || !readRef(b, aBoxMin_, &minId) || !readRef(b, aBoxMax_, &maxId)
+            || !vec(minId, 3, lo) || !vec(maxId, 3, hi)) {
+            continue;
+        }
+        for (int c = 0; c < 8; ++c) {
+            const double p[3] = { c & 1 ? hi[0] : lo[0], c & 2 ? hi[1] : lo[1], c & 4 ? hi[2] : lo[2] };
+            double w[3];
+            for (int k = 0; k < 3; ++k) {
+                w[k] = local.m[k][0] * p[0] + local.m[k][1] * p[1] + local.m[k][2] * p[2] + local.m[k][3];
+            }
+            box.add(w[0], w[1], w[2]);
+        }
+    }
+    return box;
+}
+
+GfcElementGeometry GfcGeometryEvaluator::evaluate(int row) const
+{
+    GfcElementGeometry g;
+    g.row = row;
+    std::vector<GfcSolid> list;
+    std::vector<GfcSectionLoop> loops;
+    g.skipped = solids(row, &list, &g.skippedClass);
+    for (const GfcSolid& s : list) {
+        if (s.kind == GfcSolid::Cuboid) {
+            measureCuboid(s, &g);
+        }
+        else {
+            QByteArray why;
+            if (!section(s.section, &loops, &why)) {
+                ++g.skipped;
+                if (g.skippedClass.isEmpty()) g.skippedClass = !why.isEmpty() ? why : ix_.className(ix_.at(s.section).cls);
+                continue;
+            }
+            measureExtruded(s, loops, &g);
+        }
+        ++g.solids;
+    }
+    return g;
+}
+
+QVector<int> GfcGeometryEvaluator::elementRows() const
+{
+    QVector<int> rows;
+    QVector<quint8> elementClass(ix_.classCount(), 0);
+    for (int c = 0; c < ix_.classCount(); ++c) {
+        const int e = ix_.schemaEntity(c);
+        elementClass[c] = e >= 0 && eElement_ >= 0 && schema_.isSubtypeOf(e, eElement_);
+    }
+    for (int r = 0; r < ix_.size(); ++r) {
+        if (elementClass[ix_.at(r).cls]) rows << r;
+    }
+    return rows;
+}
+
+QVector<GfcElementGeometry> GfcGeometryEvaluator::evaluateAll(Summary* summary,
+                                                              const std::function<void(qint64, qint64)>& progress,
+                                                              const std::atomic<bool>* cancel) const
+{
+    GFC_PERF_SCOPE("几何量计算");
+    QElapsedTimer timer;
+    timer.start();
+    const QVector<int> rows = elementRows();
+    const int n = rows.size();
+    QVector<GfcElementGeometry> out(n);
+    const int batch = qMax(4096, QThread::idealThreadCount() * 1024);
+    for (int first = 0; first < n; first += batch) {
+        if (cancel && cancel->load(std::memory_order_relaxed)) return {};
+        const int m = qMin(batch, n - first);
+        gfc::parallelParts(m, gfc::partsFor(m, 256), [&](int b, int e, int) {
+            for (int i = first + b; i < first + e; ++i) out[i] = evaluate(rows[i]);
+        });
+        if (progress) progress(first + m, n);
+    }
+
+    if (summary) {
+        Summary s;
+        s.elements = n;
+        for (const GfcElementGeometry& g : out) {
+            if (g.solids == 0) ++s.empty;
+            else if (g.skipped) ++s.partial;
+            else ++s.complete;
+            s.volume += g.volume;
+            s.area += g.area;
+            if (!g.box.isEmpty()) s.box.unite(g.box);
+            if (g.skipped) ++s.skippedClasses[g.skippedClass];
+        }
+        s.elapsedMs = timer.elapsed();
+        *summary = s;
+    }
+    PerfTrace::instance().setCounter(QStringLiteral("构件"), n);
+    return out;
+}
@@ -0,0 +1,134 @@
+#pragma once
+#include <QByteArray>
+#include <QHash>
+#include <QVector>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+class CompiledSchema;
+class GfcIndex;
+
+/**
+ * 构件几何量计算（体积、表面积、世界坐标包围盒）：
+ *   GfcElement.Shapes → GfcElementShape.Shape → GfcManifoldSolidShape（LocalCoordinate, Body）
+ *   → GfcExtrudedBody（Coordinate, Len, Section）→ GfcCommonPolygon.Loops → GfcCoedgeList.Coedges
+ *   → GfcLine2d / GfcArc2d；另支持 GfcCuboidBody（Coordinate, Dimension）。
+ * - 坐标系：GfcCoordinates3d 组成 3×4 仿射矩阵，世界 = LocalCoordinate ∘ Body.Coordinate；
+ *   截面顶点按列批量变换（紧凑循环，便于编译器向量化）
+ * - 截面面积、周长按 Green 公式逐段闭式计算（直线/圆弧精确）；面积最大的环为外环，其余为洞
+ * - 圆弧：Range 为弧长参数（角度 = 参数 / 半径），ClockSign > 0 为逆时针；包围盒取圆弧在各轴的解析极值
+ * - 体积 = 截面积 × Len × |det|；表面积 = 两端面 + 侧面（侧面按边积分，非正交坐标系下圆弧数值积分）
+ * 属性位置按 Schema 查得（含继承属性），不依赖具体文件；不支持的形体/曲线记下类名并跳过。
+ * 逐构件并行计算，只读索引，无共享可写状态。
+ */
+
+namespace gfc {
+constexpr double kPi = 3.14159265358979323846;
+} // namespace gfc
+
+struct GfcAabb {
+    double min[3] = { 1e300, 1e300, 1e300 };
+    double max[3] = { -1e300, -1e300, -1e300 };
+
+    bool isEmpty() const { return min[0] > max[0]; }
+    void add(double x, double y, double z)
+    {
+        const double p[3] = { x, y, z };
+        for (int k = 0; k < 3; ++k) {
+            if (p[k] < min[k]) min[k] = p[k];
+            if (p[k] > max[k]) max[k] = p[k];
+        }
+    }
+    void unite(const GfcAabb& o)
+    {
+        for (int k = 0; k < 3; ++k) {
+            if (o.min[k] < min[k]) min[k] = o.min[k];
+            if (o.max[k] > max[k]) max[k] = o.max[k];
+        }
+    }
+};
+
+// 截面上的一段：直线 (x0, y0) → (x1, y1)，或圆弧（圆心 cx/cy、半径 r，角度 phi0 → phi1，已含方向）
+struct GfcSectionSegment {
+    bool arc = false;
+    double x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+    double cx = 0, cy = 0, r = 0, phi0 = 0, phi1 = 0;
+};
+using GfcSectionLoop = std::vector<GfcSectionSegment>;
+
+// 构件中一个可计算的实体（坐标系已合成到世界）
+struct GfcSolid {
+    enum Kind { Extruded, Cuboid };
+    Kind kind = Extruded;
+    double world[3][4] = {};      // 体坐标 → 世界：列 0..2 为 X/Y/Z 轴，列 3 为原点
+    int section = -1;             // Extruded：截面 GfcCommonPolygon 所在行
+    double len = 0;               // Extruded：沿 Z 轴的拉伸长度
+    double dim[3] = {};           // Cuboid：三向尺寸
+};
+
+struct GfcElementGeometry {
+    int row = -1;                 // 构件所在行
+    double volume = 0;
+    double area = 0;
+    GfcAabb box;
+    int solids = 0;               // 计算成功的形体数
+    int skipped = 0;              // 不支持或数据不完整而跳过的形体数
+    QByteArray skippedClass;      // 首个跳过的类名（大写），用于提示
+};
+
+class GfcGeometryEvaluator {
+public:
+    struct Summary {
+        int elements = 0;
+        int complete = 0;         // 全部形体都已计算
+        int partial = 0;          // 部分形体跳过
+        int empty = 0;            // 没有可计算的形体
+        double volume = 0;
+        double area = 0;
+        GfcAabb box;
+        QHash<QByteArray, int> skippedClasses;
+        qint64 elapsedMs = 0;
+    };
+
+    // index 与 schema 需在评估期间有效
+    GfcGeometryEvaluator(const GfcIndex& index, const CompiledSchema& schema);
+
+    bool isElement(int row) const;
+    QVector<int> elementRows() const;     // 全部 GfcElement（含子类）所在行，升序
+    GfcElementGeometry evaluate(int row) const;
+    // 文件中全部 GfcElement（含子类），按行序；分批并行，每批后报告进度（在调用线程），取消时返回空
+    QVector<GfcElementGeometry> evaluateAll(Summary* summary = nullptr,
+                                            const std::function<void(qint64 done, qint64 total)>& progress = {},
+                                            const std::atomic<bool>* cancel = nullptr) const;
+
+    // 构件的可计算实体；返回跳过的形体数，skippedClass 记下首个跳过的类名
+    int solids(int row, std::vector<GfcSolid>* out, QByteArray* skippedClass = nullptr) const;
+    // 截面各环（GfcCommonPolygon 所在行）；遇到不支持的曲线返回 false，why 为其类名
+    bool section(int row, std::vector<GfcSectionLoop>* loops, QByteArray* why = nullptr) const;
+    // 各形体声明的 GfcShape.BoundingBox（按 LocalCoordinate 变换八个角点）之并；没有声明时为空盒
+    GfcAabb declaredBox(int row) const;
+
+private:
+    struct Affine;
+
+    // id 对应的行，且类型为 entity（或其子类）；否则 -1
+    int rowOf(qint64 id, int entity) const;
+    bool readRef(int row, int attr, qint64* id) const;
+    bool readRefs(int row, int attr, std::vector<qint64>* ids) const;
+    bool readDouble(int row, int attr, double* v) const;
+    bool vec(qint64 id, int dims, double* out) const;
+    bool frame(int row, int attr, Affine* a) const;
+    bool shapeSolid(qint64 shapeId, GfcSolid* s, QByteArray* why) const;
+
+    const GfcIndex& ix_;
+    const CompiledSchema& schema_;
+    // 关心的实体与属性位置
+    int eElement_ = -1, eElementShape_ = -1, eShape_ = -1, eManifold_ = -1, eExtruded_ = -1, eCuboid_ = -1;
+    int eCommonPolygon_ = -1, eCoedgeList_ = -1, eLine_ = -1, eArc_ = -1, eCoord3_ = -1, eBox3_ = -1;
+    int aShapes_ = -1, aShape_ = -1, aLocal_ = -1, aBBox_ = -1, aBody_ = -1, aBoxMin_ = -1, aBoxMax_ = -1;
+    int aOrigin_ = -1, aAxisX_ = -1, aAxisY_ = -1, aAxisZ_ = -1;
+    int aExtCoord_ = -1, aLen_ = -1, aSection_ = -1, aCubCoord_ = -1, aDim_ = -1;
+    int aLoops_ = -1, aCoedges_ = -1, aStart_ = -1, aEnd_ = -1;
+    int aCenter_ = -1, aRadius_ = -1, aRange_ = -1, aClock_ = -1;
+};
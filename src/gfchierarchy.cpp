@@ -0,0 +1,161 @@
+#include "gfchierarchy.h"
+#include "gfcindex.h"
+#include "gfcparallel.h"
+#include "gfctyped.h"
+#include "perftrace.h"
+#include "schemacache.h"
+
+#include <QElapsedTimer>
+#include <utility>
+#include <vector>
+
+void GfcHierarchy::clear()
+{
+    ix_ = nullptr;
+    schema_ = nullptr;
+    start_.clear();
+    children_.clear();
+    descendants_.clear();
+    roots_.clear();
+    unassigned_.clear();
+}
+
+bool GfcHierarchy::build(const GfcIndex& index, const CompiledSchema& schema, Stats* stats)
+{
+    GFC_PERF_SCOPE("空间结构层次");
+    QElapsedTimer timer;
+    timer.start();
+    clear();
+    const int eAgg = schema.find(QStringLiteral("GfcRelAggregates"));
+    if (eAgg < 0) return false;
+    const int aRelating = schema.attributeIndex(eAgg, QStringLiteral("RelatingObject"));
+    const int aRelated = schema.attributeIndex(eAgg, QStringLiteral("RelatedObjects"));
+    const int eElement = schema.find(QStringLiteral("GfcElement"));
+    ix_ = &index;
+    schema_ = &schema;
+    eObject_ = schema.find(QStringLiteral("GfcObject"));
+    aName_ = eObject_ >= 0 ? schema.attributeIndex(eObject_, QStringLiteral("Name")) : -1;
+
+    // 类表只有几百项：先按类判定，逐行只查表
+    QVector<quint8> kind(index.classCount(), 0);   // 1 聚合关系，2 构件
+    for (int c = 0; c < index.classCount(); ++c) {
+        const int e = index.schemaEntity(c);
+        if (e < 0) continue;
+        if (schema.isSubtypeOf(e, eAgg)) kind[c] = 1;
+        else if (eElement >= 0 && schema.isSubtypeOf(e, eElement)) kind[c] = 2;
+    }
+    const int n = index.size();
+    QVector<int> rels;
+    for (int r = 0; r < n; ++r) {
+        if (kind[index.at(r).cls] == 1) rels << r;
+    }
+
+    // 分段并行：读出 (整体行, 部分行)，各段按文件顺序
+    using Link = std::pair<int, int>;
+    const int parts = gfc::partsFor(rels.size(), 1024);
+    std::vector<std::vector<Link>> linksOf(static_cast<size_t>(parts));
+    std::vector<int> unresolvedOf(static_cast<size_t>(parts), 0);
+    gfc::parallelParts(rels.size(), parts, [&](int b, int e, int p) {
+        std::vector<Link>& links = linksOf[size_t(p)];
+        gfc::Ref ref;
+        for (int i = b; i < e; ++i) {
+            gfc::ArgReader r(index.args(rels[i]));
+            if (aRelating < 0 || !r.skipValues(aRelating) || r.readNull() || !r.readRef(ref)) continue;
+            const int whole = index.rowOf(ref.id);
+            if (whole < 0) {
+                ++unresolvedOf[size_t(p)];
+                continue;
+            }
+            gfc::ArgReader list(index.args(rels[i]));
+            if (aRelated < 0 || !list.skipValues(aRelated) || list.readNull() || !list.beginList()) continue;
+            while (!list.atListEnd() && list.readRef(ref)) {
+                const int part = index.rowOf(ref.id);
+                if (part >= 0) links.emplace_back(whole, part);
+                else ++unresolvedOf[size_t(p)];
+            }
+        }
+    });
+
+    // 顺序合并为 CSR
+    start_.fill(0, n + 1);
+    QVector<quint8> isPart(n, 0);
+    int linkCount = 0;
+    for (const std::vector<Link>& links : linksOf) {
+        for (const Link& l : links) {
+            ++start_[l.first + 1];
+            isPart[l.second] = 1;
+        }
+        linkCount += int(links.size());
+    }
+    for (int r = 0; r < n; ++r) start_[r + 1] += start_[r];
+    children_.resize(linkCount);
+    QVector<int> fill(start_.cbegin(), start_.cend() - 1);
+    for (const std::vector<Link>& links : linksOf) {
+        for (const Link& l : links) children_[fill[l.first]++] = l.second;
+    }
+    for (int r = 0; r < n; ++r) {
+        if (start_[r + 1] > start_[r] && !isPart[r]) roots_ << r;
+        else if (kind[index.at(r).cls] == 2 && !isPart[r]) unassigned_ << r;
+    }
+    countDescendants();
+
+    if (stats) {
+        Stats s;
+        s.relations = rels.size();
+        s.links = linkCount;
+        s.roots = roots_.size();
+        s.unassigned = unassigned_.size();
+        for (int u : unresolvedOf) s.unresolved += u;
+        s.elapsedMs = timer.elapsed();
+        *stats = s;
+    }
+    PerfTrace::instance().setCounter(QStringLiteral("聚合边"), linkCount);
+    return true;
+}
+
+void GfcHierarchy::countDescendants()
+{
+    const int n = start_.size() - 1;
+    descendants_.fill(0, n);
+    QVector<quint8> state(n, 0);   // 0 未访问，1 在栈上，2 已完成
+    struct Frame {
+        int row;
+        int next;
+    };
+    QVector<Frame> stack;
+    for (int root : roots_) {
+        if (state[root]) continue;
+        state[root] = 1;
+        stack << Frame { root, 0 };
+        while (!stack.isEmpty()) {
+            Frame& top = stack.last();
+            if (top.next < childCount(top.row)) {
+                const int c = child(top.row, top.next++);
+                if (state[c] == 0) {
+                    state[c] = 1;
+                    stack << Frame { c, 0 };   // top 此后可能失效，下一轮重新取
+                }
+                continue;
+            }
+            int sum = 0;
+            for (int k = 0; k < childCount(top.row); ++k) {
+                const int c = child(top.row, k);
+                if (state[c] == 2) sum += 1 + descendants_[c];   // 在栈上的是环，不计
+            }
+            descendants_[top.row] = sum;
+            state[top.row] = 2;
+            stack.removeLast();
+        }
+    }
+}
+
+QString GfcHierarchy::name(int row) const
+{
+    if (!ix_ || aName_ < 0) return QString();
+    const int e = ix_->schemaEntity(ix_->at(row).cls);
+    if (e < 0 || !schema_->isSubtypeOf(e, eObject_)) return QString();
+    gfc::ArgReader r(ix_->args(row));
+    std::string v;
+    if (!r.skipValues(aName_) || r.readNull() || !r.readString(v)) return QString();
+    return QString::fromStdString(v);
+}
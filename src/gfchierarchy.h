@@ -0,0 +1,50 @@
+#pragma once
+#include <QString>
+#include <QVector>
+
+class CompiledSchema;
+class GfcIndex;
+
+/**
+ * 空间结构层次（项目 → 建筑 → 楼层 → 构件），由 GfcRelAggregates(RelatingObject, RelatedObjects) 得出：
+ * - 一遍线性扫描关系实例：分段并行读引用并换成行号，再顺序合并为 CSR 子结点表（保持文件顺序）
+ * - 根：作为整体出现、自身不是任何聚合的部分；未被任何聚合收纳的 GfcElement 单列为“未归属”
+ * - 子孙数：从根迭代后序累加；同一实例被多处收纳时各处分别计数，遇到环只走一次
+ * 结点以行号表示；名称（GfcObject.Name）按需读取，供展示层懒加载时只处理可见结点。
+ */
+
+class GfcHierarchy {
+public:
+    struct Stats {
+        int relations = 0;        // GfcRelAggregates 实例数
+        int links = 0;            // 整体 → 部分 边数
+        int roots = 0;
+        int unassigned = 0;
+        int unresolved = 0;       // 目标不存在的引用
+        qint64 elapsedMs = 0;
+    };
+
+    // index 与 schema 需在使用期间有效；Schema 中没有 GfcRelAggregates 时返回 false
+    bool build(const GfcIndex& index, const CompiledSchema& schema, Stats* stats = nullptr);
+    void clear();
+
+    const QVector<int>& roots() const { return roots_; }
+    const QVector<int>& unassigned() const { return unassigned_; }
+    int childCount(int row) const { return start_.isEmpty() ? 0 : start_[row + 1] - start_[row]; }
+    int child(int row, int k) const { return children_[start_[row] + k]; }
+    int descendantCount(int row) const { return descendants_.isEmpty() ? 0 : descendants_[row]; }
+    // GfcObject.Name（已解码）；没有或不是 GfcObject 时为空
+    QString name(int row) const;
+
+private:
+    void countDescendants();
+
+    const GfcIndex* ix_ = nullptr;
+    const CompiledSchema* schema_ = nullptr;
+    int eObject_ = -1, aName_ = -1;
+    QVector<int> start_;          // 行 r 的子结点为 children_[start_[r], start_[r + 1])
+    QVector<int> children_;
+    QVector<int> descendants_;
+    QVector<int> roots_;
+    QVector<int> unassigned_;
+};
@@ -0,0 +1,238 @@
+#include "gfcindex.h"
+#include "gfcparallel.h"
+#include "perftrace.h"
+#include "schemacache.h"
+
+namespace {
+
+inline bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+inline bool isNameChar(char c)
+{
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+// 跳过空白与 /* */ 注释
+const char* skipBlank(const char* p, const char* e)
+{
+    for (;;) {
+        while (p < e && isSpace(*p)) ++p;
+        if (p + 1 < e && p[0] == '/' && p[1] == '*') {
+            p += 2;
+            while (p + 1 < e && !(p[0] == '*' && p[1] == '/')) ++p;
+            p = (p + 1 < e) ? p + 2 : e;
+            continue;
+        }
+        return p;
+    }
+}
+
+// p 指向 '('：返回匹配的 ')'，未闭合返回 nullptr；字符串内括号不计
+const char* matchParen(const char* p, const char* e)
+{
+    int depth = 0;
+    while (p < e) {
+        const char c = *p;
+        if (c == '\'') {
+            ++p;
+            while (p < e) {
+                if (*p == '\'') {
+                    if (p + 1 < e && p[1] == '\'') { p += 2; continue; }
+                    break;
+                }
+                ++p;
+            }
+            if (p >= e) return nullptr;
+        }
+        else if (c == '(') ++depth;
+        else if (c == ')' && --depth == 0) return p;
+        ++p;
+    }
+    return nullptr;
+}
+
+// 在顶层（字符串/注释之外）查找关键字行 "DATA;"
+const char* findData(const char* p, const char* e)
+{
+    const char* start = p;
+    while (p < e) {
+        p = skipBlank(p, e);
+        if (p >= e) break;
+        if (*p == '\'') {
+            ++p;
+            while (p < e) {
+                if (*p == '\'') {
+                    if (p + 1 < e && p[1] == '\'') { p += 2; continue; }
+                    ++p;
+                    break;
+                }
+                ++p;
+            }
+            continue;
+        }
+        if (e - p >= 4 && std::string_view(p, 4) == "DATA" && (p == start || !isNameChar(p[-1]))) {
+            const char* q = skipBlank(p + 4, e);
+            if (q < e && *q == ';') return q + 1;
+        }
+        ++p;
+    }
+    return nullptr;
+}
+
+} // namespace
+
+void GfcIndex::clear()
+{
+    data_.clear();
+    entries_.clear();
+    rowById_.clear();
+    classNames_.clear();
+    classEntity_.clear();
+    headerEnd_ = trailerBegin_ = 0;
+    refOffsets_.clear();
+    refTargets_.clear();
+    dangling_ = 0;
+}
+
+bool GfcIndex::build(const QByteArray& data, const CompiledSchema* schema, QString* err)
+{
+    GFC_PERF_SCOPE("构建实例索引");
+    clear();
+    data_ = data;
+
+    const char* base = data_.constData();
+    const char* e = base + data_.size();
+    const char* p = findData(base, e);
+    if (!p) {
+        if (err) *err = QStringLiteral("未找到 DATA; 段");
+        return false;
+    }
+    headerEnd_ = trailerBegin_ = p - base;
+
+    QHash<QByteArray, int> clsByName;
+    entries_.reserve(int(data_.size() / 48));
+    auto fail = [&](const char* at, const QString& what) {
+        if (err) *err = QStringLiteral("第 %1 字节：%2").arg(at - base).arg(what);
+        return false;
+    };
+
+    bool first = true;
+    for (;;) {
+        p = skipBlank(p, e);
+        if (p >= e || *p != '#') break;   // ENDSEC; 或文件结束
+
+        GfcIndexEntry en;
+        en.begin = p - base;
+        ++p;
+        qint64 id = 0;
+        const char* digits = p;
+        while (p < e && *p >= '0' && *p <= '9') id = id * 10 + (*p++ - '0');
+        if (p == digits) return fail(p, QStringLiteral("实例编号缺失"));
+        p = skipBlank(p, e);
+        if (p >= e || *p != '=') return fail(p, QStringLiteral("缺少 '='"));
+        p = skipBlank(p + 1, e);
+        const char* name = p;
+        while (p < e && isNameChar(*p)) ++p;
+        if (p == name) return fail(p, QStringLiteral("缺少类名"));
+        const QByteArray cls = QByteArray::fromRawData(name, int(p - name));
+        p = skipBlank(p, e);
+        if (p >= e || *p != '(') return fail(p, QStringLiteral("缺少 '('"));
+        const char* close = matchParen(p, e);
+        if (!close) return fail(p, QStringLiteral("括号未闭合"));
+        en.argsBegin = (p + 1) - base;
+        en.argsEnd = close - base;
+        p = skipBlank(close + 1, e);
+        if (p >= e || *p != ';') return fail(p, QStringLiteral("缺少 ';'"));
+        ++p;
+        en.end = p - base;
+        en.id = id;
+
+        auto it = clsByName.constFind(cls);
+        if (it == clsByName.constEnd()) {
+            const QByteArray owned(cls.constData(), cls.size());
+            it = clsByName.insert(owned, classNames_.size());
+            classNames_.push_back(owned);
+            classEntity_.push_back(schema ? schema->find(owned.constData(), owned.size()) : -1);
+        }
+        en.cls = it.value();
+
+        if (first) { headerEnd_ = en.begin; first = false; }
+        trailerBegin_ = en.end;
+        rowById_.insert(id, entries_.size());
+        entries_.push_back(en);
+    }
+    entries_.squeeze();
+    PerfTrace::instance().setCounter(QStringLiteral("索引实例数"), entries_.size());
+    return true;
+}
+
+std::string_view GfcIndex::args(int row) const
+{
+    const GfcIndexEntry& en = entries_[row];
+    return std::string_view(data_.constData() + en.argsBegin, std::size_t(en.argsEnd - en.argsBegin));
+}
+
+std::string_view GfcIndex::text(int row) const
+{
+    const GfcIndexEntry& en = entries_[row];
+    return std::string_view(data_.constData() + en.begin, std::size_t(en.end - en.begin));
+}
+
+void GfcIndex::buildRefs()
+{
+    GFC_PERF_SCOPE("构建引用图");
+    const int n = entries_.size();
+    refOffsets_.fill(0, n + 1);
+
+    // 按行分段并行：先计数，前缀和后再填充
+    const int parts = gfc::maxParts();
+    QVector<int> danglingPerPart(parts, 0);
+
+    gfc::parallelParts(n, parts, [&](int b, int e, int part) {
+        for (int row = b; row < e; ++row) {
+            int c = 0;
+            forEachRef(row, [&](qint64 id) {
+                if (rowById_.contains(id)) ++c;
+                else ++danglingPerPart[part];
+            });
+            refOffsets_[row + 1] = c;
+        }
+    });
+    for (int row = 0; row < n; ++row) refOffsets_[row + 1] += refOffsets_[row];
+    refTargets_.resize(refOffsets_[n]);
+
+    gfc::parallelParts(n, parts, [&](int b, int e, int) {
+        for (int row = b; row < e; ++row) {
+            int k = refOffsets_[row];
+            forEachRef(row, [&](qint64 id) {
+                const int t = rowById_.value(id, -1);
+                if (t >= 0) refTargets_[k++] = t;
+            });
+        }
+    });
+    dangling_ = 0;
+    for (int d : danglingPerPart) dangling_ += d;
+    PerfTrace::instance().setCounter(QStringLiteral("引用数"), refTargets_.size());
+}
+
+void GfcIndex::buildReferrers(QVector<int>* offsets, QVector<int>* rows) const
+{
+    const int n = entries_.size();
+    QVector<int>& off = *offsets;
+    off.fill(0, n + 1);
+    for (int t : refTargets_) ++off[t + 1];
+    for (int r = 0; r < n; ++r) off[r + 1] += off[r];
+    rows->resize(off[n]);
+    QVector<int> fill = off;
+    for (int r = 0; r < n; ++r) {
+        for (int k = refOffsets_[r]; k < refOffsets_[r + 1]; ++k) (*rows)[fill[refTargets_[k]]++] = r;
+    }
+}
+
+qint64 GfcIndex::memoryBytes() const
+{
+    qint64 bytes = qint64(entries_.capacity()) * qint64(sizeof(GfcIndexEntry));
+    bytes += qint64(refOffsets_.capacity() + refTargets_.capacity()) * qint64(sizeof(int));
+    bytes += qint64(rowById_.size()) * 32;
+    for (const QByteArray& n : classNames_) bytes += n.size() + 32;
+    return bytes;
+}
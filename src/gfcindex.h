@@ -0,0 +1,103 @@
+#pragma once
+#include <QByteArray>
+#include <QHash>
+#include <QString>
+#include <QVector>
+#include <string_view>
+
+class CompiledSchema;
+
+/**
+ * GFC 文件的字节级实例索引（直接在 UTF-8 缓冲上扫描，不解码为 QString）：
+ * - 每个实例记录 #id、类、以及实例/参数区在缓冲中的字节偏移
+ * - id -> 行号哈希；文件内出现的类名表（大写原文），并映射到 Schema 实体下标
+ * - HEADER 段（首个实例之前）与结尾段（末个实例之后）的范围，便于原样保留
+ * 参数区的值由 gfctyped.h 的 ArgReader 或 GfcIndex::forEachRef 按需读取。
+ */
+
+struct GfcIndexEntry {
+    qint64 id = -1;
+    int cls = -1;             // 文件内类表下标（className/schemaEntity）
+    qint64 begin = 0;         // '#'
+    qint64 argsBegin = 0;     // '(' 之后
+    qint64 argsEnd = 0;       // 匹配的 ')'
+    qint64 end = 0;           // ';' 之后
+};
+
+class GfcIndex {
+public:
+    // data 必须在索引生命周期内保持不变（隐式共享，拷贝无开销）
+    bool build(const QByteArray& data, const CompiledSchema* schema = nullptr, QString* err = nullptr);
+    void clear();
+
+    const QByteArray& data() const { return data_; }
+    int size() const { return entries_.size(); }
+    const GfcIndexEntry& at(int row) const { return entries_[row]; }
+    int rowOf(qint64 id) const { return rowById_.value(id, -1); }
+
+    std::string_view args(int row) const;
+    std::string_view text(int row) const;     // 整个实例 "#1=GFCX(...);"
+
+    // 类表：文件内首次出现顺序
+    int classCount() const { return classNames_.size(); }
+    const QByteArray& className(int cls) const { return classNames_[cls]; }
+    int schemaEntity(int cls) const { return classEntity_[cls]; }   // -1 表示 Schema 中没有
+
+    qint64 headerEnd() const { return headerEnd_; }        // 首个实例起点（无实例时为 DATA; 之后）
+    qint64 trailerBegin() const { return trailerBegin_; }  // 末个实例 ';' 之后
+    // 实例 row 连同其后间隔的终点：下一个实例的 '#'（含换行/注释），末个实例为结尾段起点
+    qint64 spanEnd(int row) const { return row + 1 < entries_.size() ? entries_[row + 1].begin : trailerBegin_; }
+
+    // 参数区中的每个实例引用 #n（跳过字符串内容）
+    template <class F> void forEachRef(int row, F&& f) const;
+
+    // 引用图（CSR，目标为行号，按出现顺序、含重复；悬空引用不计入）：buildRefs() 并行构建
+    void buildRefs();
+    bool hasRefs() const { return !refOffsets_.isEmpty(); }
+    int refCount(int row) const { return refOffsets_[row + 1] - refOffsets_[row]; }
+    int ref(int row, int k) const { return refTargets_[refOffsets_[row] + k]; }
+    int danglingRefCount() const { return dangling_; }
+    // 反向引用（CSR：offsets 为 size()+1 项，rows 为引用该行的行号，升序、含重复）；需先 buildRefs()
+    void buildReferrers(QVector<int>* offsets, QVector<int>* rows) const;
+
+    qint64 memoryBytes() const;
+
+private:
+    QByteArray data_;
+    QVector<GfcIndexEntry> entries_;
+    QHash<qint64, int> rowById_;
+    QVector<QByteArray> classNames_;
+    QVector<int> classEntity_;
+    qint64 headerEnd_ = 0;
+    qint64 trailerBegin_ = 0;
+    QVector<int> refOffsets_;   // size()+1 项
+    QVector<int> refTargets_;
+    int dangling_ = 0;
+};
+
+template <class F>
+void GfcIndex::forEachRef(int row, F&& f) const
+{
+    const std::string_view a = args(row);
+    const char* p = a.data();
+    const char* e = p + a.size();
+    while (p < e) {
+        const char c = *p++;
+        if (c == '\'') {
+            while (p < e) {
+                if (*p == '\'') {
+                    if (p + 1 < e && p[1] == '\'') { p += 2; continue; }
+                    ++p;
+                    break;
+                }
+                ++p;
+            }
+        }
+        else if (c == '#') {
+            qint64 id = 0;
+            bool any = false;
+            while (p < e && *p >= '0' && *p <= '9') { id = id * 10 + (*p - '0'); ++p; any = true; }
+            if (any) f(id);
+        }
+    }
+}
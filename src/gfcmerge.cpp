@@ -0,0 +1,432 @@
+#include "gfcmerge.h"
+#include "gfcbinary.h"
+#include "gfcfileio.h"
+#include "perftrace.h"
+#include "schemacache.h"
+
+#include <QBitArray>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QHash>
+#include <QPair>
+#include <QSet>
+#include <cstring>
+
+namespace {
+
+inline bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+inline bool isNameChar(char c)
+{
+    return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+// 把任意切分的输入流切成语句（到字符串/注释之外的 ';' 为止），去掉注释、'\r' 与首尾空白
+class StatementSplitter {
+public:
+    template <class F>
+    bool feed(const char* p, qint64 n, F&& onStatement)
+    {
+        const char* e = p + n;
+        while (p < e) {
+            const char c = *p++;
+            if (c == '\r') continue;
+            switch (state_) {
+            case Normal:
+                if (c == '/') { state_ = Slash; continue; }
+                stmt_ += c;
+                if (c == '\'') state_ = Str;
+                else if (c == ';') {
+                    if (!deliver(onStatement)) return false;
+                }
+                break;
+            case Slash:
+                if (c == '*') { state_ = Comment; continue; }
+                stmt_ += '/';
+                state_ = Normal;
+                --p;   // 重新按 Normal 处理 c
+                break;
+            case Str:
+                stmt_ += c;
+                if (c == '\'') state_ = Normal;   // '' 转义：回到 Normal 后立刻再次进入 Str
+                break;
+            case Comment:
+                if (c == '*') state_ = CommentStar;
+                break;
+            case CommentStar:
+                if (c == '/') state_ = Normal;
+                else if (c != '*') state_ = Comment;
+                break;
+            }
+        }
+        return true;
+    }
+
+    // 输入结束时不应残留未结束的语句
+    bool finish() const
+    {
+        for (char c : stmt_) {
+            if (!isSpace(c)) return false;
+        }
+        return state_ == Normal || state_ == Slash;
+    }
+
+private:
+    template <class F>
+    bool deliver(F&& onStatement)
+    {
+        int b = 0, e = stmt_.size();
+        while (b < e && isSpace(stmt_[b])) ++b;
+        while (e > b && isSpace(stmt_[e - 1])) --e;
+        const bool ok = onStatement(std::string_view(stmt_.constData() + b, size_t(e - b)));
+        stmt_.clear();
+        return ok;
+    }
+
+    enum State { Normal, Slash, Str, Comment, CommentStar };
+    State state_ = Normal;
+    QByteArray stmt_;
+};
+
+// 归并键：两路独立的 64 位哈希
+using Key128 = QPair<quint64, quint64>;
+
+Key128 contentKey(const QByteArray& bytes)
+{
+    quint64 h1 = 14695981039346656037ull;
+    quint64 h2 = 0x243f6a8885a308d3ull;
+    for (char ch : bytes) {
+        const quint64 c = static_cast<unsigned char>(ch);
+        h1 = (h1 ^ c) * 1099511628211ull;
+        h2 = (h2 ^ c) * 0x9e3779b97f4a7c15ull;
+        h2 ^= h2 >> 29;
+    }
+    return qMakePair(h1, h2 ^ quint64(bytes.size()));
+}
+
+bool startsWithWord(std::string_view s, const char* word)
+{
+    const size_t n = std::strlen(word);
+    if (s.size() < n) return false;
+    for (size_t i = 0; i < n; ++i) {
+        if ((s[i] & ~0x20) != (word[i] & ~0x20) && s[i] != word[i]) return false;
+    }
+    return s.size() == n || !isNameChar(s[n]);
+}
+
+class Merger {
+public:
+    Merger(const CompiledSchema& schema, const GfcMerge::Options& opt, GfcStreamWriter* out)
+        : schema_(schema), opt_(opt), out_(out)
+    {
+        const QStringList roots = opt.unifyRoots.isEmpty() ? GfcMerge::defaultUnifyRoots() : opt.unifyRoots;
+        for (const QString& r : roots) {
+            const int e = schema.find(r);
+            if (e >= 0) roots_ << e;
+        }
+    }
+
+    bool mergeFile(const QString& path, int fileNo, qint64 doneBefore, qint64 total, QString* err);
+    bool finish(QString* err);
+
+    GfcMerge::Stats stats;
+
+private:
+    bool onStatement(std::string_view s);
+    bool onInstance(std::string_view s);
+    bool isCandidate(const QByteArray& clsUpper);
+    qint64 mapRef(qint64 id) const { return unifiedMap_.value(id, id + offset_); }
+    void markDefined(qint64 id);
+    bool isDefined(qint64 id) const { return id < defined_.size() && defined_.testBit(int(id)); }
+
+    const CompiledSchema& schema_;
+    const GfcMerge::Options& opt_;
+    GfcStreamWriter* out_;
+    QVector<int> roots_;
+    QHash<QByteArray, bool> candidateCache_;
+
+    enum Phase { Header, Data, Trailer };
+    Phase phase_ = Header;
+    int fileNo_ = 0;
+    qint64 offset_ = 0;
+    qint64 maxOut_ = 0;
+    QByteArray trailer_;          // 第一个文件 ENDSEC; 之后的语句
+    QString error_;
+
+    // 合并共享实体
+    QHash<Key128, qint64> shared_;                  // 之前文件中候选实体：内容键 -> 输出编号
+    QVector<QPair<Key128, qint64>> pendingShared_;  // 本文件的候选实体，文件结束后并入 shared_
+    QHash<qint64, qint64> unifiedMap_;              // 本文件：被合并的编号 -> 输出编号
+    QSet<qint64> forwardRefs_;                      // 本文件：定义前就被引用过的编号
+    QBitArray defined_;
+    QByteArray line_;
+};
+
+bool Merger::isCandidate(const QByteArray& clsUpper)
+{
+    auto it = candidateCache_.constFind(clsUpper);
+    if (it != candidateCache_.constEnd()) return it.value();
+    const int e = schema_.find(clsUpper.constData(), clsUpper.size());
+    bool yes = false;
+    for (int r : roots_) {
+        if (e >= 0 && schema_.isSubtypeOf(e, r)) { yes = true; break; }
+    }
+    candidateCache_.insert(clsUpper, yes);
+    return yes;
+}
+
+void Merger::markDefined(qint64 id)
+{
+    if (id >= defined_.size()) {
+        if (id >= (qint64(1) << 31) - 1) return;   // 超出位图范围：按未定义处理（只会少合并）
+        defined_.resize(int(qMin<qint64>(qMax<qint64>(id + 1, qint64(defined_.size()) * 2), (qint64(1) << 31) - 1)));
+    }
+    defined_.setBit(int(id));
+}
+
+bool Merger::onStatement(std::string_view s)
+{
+    switch (phase_) {
+    case Header:
+        if (startsWithWord(s, "DATA")) {
+            phase_ = Data;
+            if (fileNo_ == 0) return out_->write("DATA;\n", 6);
+            return true;
+        }
+        if (fileNo_ == 0) {
+            if (!out_->write(s.data(), qint64(s.size())) || !out_->write("\n", 1)) return false;
+        }
+        return true;
+    case Data:
+        if (!s.empty() && s[0] == '#') return onInstance(s);
+        if (startsWithWord(s, "ENDSEC")) phase_ = Trailer;
+        return true;   // DATA 段中的其它语句忽略
+    case Trailer:
+        if (fileNo_ == 0) {
+            trailer_.append(s.data(), int(s.size()));
+            trailer_ += '\n';
+        }
+        return true;
+    }
+    return true;
+}
+
+bool Merger::onInstance(std::string_view s)
+{
+    const char* p = s.data() + 1;
+    const char* e = s.data() + s.size();
+    qint64 id = 0;
+    if (p == e || !isDigit(*p)) {
+        error_ = QStringLiteral("无法识别的实例：%1").arg(QString::fromUtf8(s.data(), int(qMin<size_t>(s.size(), 80))));
+        return false;
+    }
+    while (p < e && isDigit(*p)) id = id * 10 + (*p++ - '0');
+    while (p < e && isSpace(*p)) ++p;
+    if (p == e || *p != '=') {
+        error_ = QStringLiteral("#%1 缺少 '='").arg(id);
+        return false;
+    }
+    ++p;
+    while (p < e && isSpace(*p)) ++p;
+    const char* nameBegin = p;
+    while (p < e && isNameChar(*p)) ++p;
+    QByteArray cls(nameBegin, int(p - nameBegin));
+    for (char& c : cls) {
+        if (c >= 'a' && c <= 'z') c -= 32;
+    }
+
+    // 改写引用：参数区内字符串之外的 #n
+    const bool unify = opt_.unify;
+    line_ = cls;
+    bool inStr = false;
+    while (p < e) {
+        const char c = *p++;
+        if (inStr) {
+            line_ += c;
+            if (c == '\'') inStr = false;
+            continue;
+        }
+        if (c == '\'') {
+            inStr = true;
+            line_ += c;
+        }
+        else if (c == '#' && p < e && isDigit(*p)) {
+            qint64 ref = 0;
+            while (p < e && isDigit(*p)) ref = ref * 10 + (*p++ - '0');
+            if (unify && !isDefined(ref)) forwardRefs_.insert(ref);
+            const qint64 mapped = mapRef(ref);
+            maxOut_ = qMax(maxOut_, mapped);
+            line_ += '#';
+            line_ += QByteArray::number(mapped);
+        }
+        else {
+            line_ += c;
+        }
+    }
+
+    if (unify) {
+        markDefined(id);
+        if (isCandidate(cls) && !forwardRefs_.contains(id)) {
+            const Key128 key = contentKey(line_);
+            auto it = shared_.constFind(key);
+            if (it != shared_.constEnd()) {
+                unifiedMap_.insert(id, it.value());
+                ++stats.unified;
+                return true;
+            }
+            pendingShared_ << qMakePair(key, id + offset_);
+        }
+    }
+
+    const qint64 outId = id + offset_;
+    maxOut_ = qMax(maxOut_, outId);
+    ++stats.instances;
+    const QByteArray head = '#' + QByteArray::number(outId) + '=';
+    return out_->write(head) && out_->write(line_) && out_->write("\n", 1);
+}
+
+bool Merger::mergeFile(const QString& path, int fileNo, qint64 doneBefore, qint64 total, QString* err)
+{
+    GFC_PERF_SCOPE("合并文件");
+    fileNo_ = fileNo;
+    offset_ = fileNo == 0 ? 0 : maxOut_;
+    stats.offsets << offset_;
+    phase_ = Header;
+    unifiedMap_.clear();
+    forwardRefs_.clear();
+    defined_.clear();
+    pendingShared_.clear();
+
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) {
+        if (err) *err = QStringLiteral("无法打开文件：%1").arg(path);
+        return false;
+    }
+
+    StatementSplitter splitter;
+    bool first = true;
+    auto feed = [&](const char* d, qint64 n) {
+        if (first) {
+            first = false;
+            if (n >= 3 && std::memcmp(d, "\xEF\xBB\xBF", 3) == 0) { d += 3; n -= 3; }
+        }
+        if (opt_.write.cancelled()) {
+            error_ = QStringLiteral("已取消");
+            return false;
+        }
+        if (!splitter.feed(d, n, [this](std::string_view s) { return onStatement(s); })) {
+            if (error_.isEmpty()) error_ = out_->errorString();
+            return false;
+        }
+        if (opt_.write.progress) opt_.write.progress(doneBefore + (f.isOpen() ? f.pos() : f.size()), total);
+        return true;
+    };
+
+    const QByteArray head = f.peek(4);
+    const GfcCompress::Codec codec = GfcCompress::detect(head);
+    bool ok = true;
+    QString e;
+    if (GfcFileIO::isBinaryPath(path) || GfcBinary::isBinary(head)) {
+        // 二进制容器只能整体还原
+        f.close();
+        QByteArray text;
+        ok = GfcFileIO::readText(path, &text, &e) && feed(text.constData(), text.size());
+    }
+    else if (codec != GfcCompress::None) {
+        ok = GfcCompress::decompress(&f, codec, feed, &e);
+    }
+    else {
+        QByteArray buf(1 << 20, Qt::Uninitialized);
+        for (;;) {
+            const qint64 n = f.read(buf.data(), buf.size());
+            if (n < 0) { e = f.errorString(); ok = false; break; }
+            if (n == 0) break;
+            if (!feed(buf.constData(), n)) { ok = false; break; }
+        }
+    }
+    if (ok && !splitter.finish()) {
+        ok = false;
+        e = QStringLiteral("文件结尾不完整");
+    }
+    if (ok && phase_ == Header) {
+        ok = false;
+        e = QStringLiteral("未找到 DATA 段");
+    }
+    if (!ok) {
+        if (err) *err = QStringLiteral("%1：%2").arg(QFileInfo(path).fileName(), !error_.isEmpty() ? error_ : e);
+        return false;
+    }
+
+    for (const auto& kv : pendingShared_) shared_.insert(kv.first, kv.second);
+    ++stats.files;
+    return true;
+}
+
+bool Merger::finish(QString* err)
+{
+    if (!out_->write("ENDSEC;\n", 8) || !out_->write(trailer_)) {
+        if (err) *err = out_->errorString();
+        return false;
+    }
+    stats.maxId = maxOut_;
+    return true;
+}
+
+} // namespace
+
+QStringList GfcMerge::defaultUnifyRoots()
+{
+    return { QStringLiteral("GfcProject"), QStringLiteral("GfcSpatialStructureElement"),
+             QStringLiteral("GfcGeometry"), QStringLiteral("GfcRelDecomposes") };
+}
+
+bool GfcMerge::merge(const QStringList& inputs, const QString& output, const CompiledSchema& schema,
+                     const Options& opt, Stats* stats, QString* err)
+{
+    QElapsedTimer timer;
+    timer.start();
+    if (inputs.isEmpty()) {
+        if (err) *err = QStringLiteral("没有输入文件");
+        return false;
+    }
+    if (GfcFileIO::isBinaryPath(output)) {
+        if (err) *err = QStringLiteral("合并只能流式写出文本 .gfc（可加 .gz/.zst）");
+        return false;
+    }
+    for (const QString& in : inputs) {
+        if (QFileInfo(in).absoluteFilePath() == QFileInfo(output).absoluteFilePath()) {
+            if (err) *err = QStringLiteral("输出文件不能是输入文件之一：%1").arg(output);
+            return false;
+        }
+    }
+
+    GfcWriter::Options wopt = opt.write;
+    wopt.compression = GfcCompress::codecForPath(output);
+    if (!GfcCompress::available(wopt.compression)) {
+        if (err) *err = QStringLiteral("本版本未启用 %1 支持").arg(GfcCompress::codecName(wopt.compression));
+        return false;
+    }
+    GfcStreamWriter out;
+    if (!out.open(output, wopt, err)) return false;
+
+    qint64 total = 0;
+    for (const QString& in : inputs) total += QFileInfo(in).size();
+
+    Merger merger(schema, opt, &out);
+    qint64 done = 0;
+    for (int i = 0; i < inputs.size(); ++i) {
+        if (!merger.mergeFile(inputs[i], i, done, total, err)) return false;   // out 析构时丢弃临时文件
+        done += QFileInfo(inputs[i]).size();
+    }
+    if (!merger.finish(err) || !out.commit(err)) return false;
+
+    if (stats) {
+        *stats = merger.stats;
+        stats->bytesOut = out.bytesWritten();
+        stats->elapsedMs = timer.elapsed();
+    }
+    PerfTrace::instance().setCounter(QStringLiteral("合并实例"), merger.stats.instances);
+    PerfTrace::instance().setCounter(QStringLiteral("归并实例"), merger.stats.unified);
+    return true;
+}
@@ -0,0 +1,46 @@
+#pragma once
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+#include "gfcwriter.h"
+
+class CompiledSchema;
+
+/**
+ * 多文件合并（流式）：依次读入 N 个文件，逐条语句改写后直接写出，不在内存中保留模型文本
+ * - 编号：第 i 个文件的 #n 改为 #(n + offset_i)，offset_i 为之前已写出（含引用）的最大编号，区间互不重叠；
+ *   第一个文件编号不变。实例与引用在同一遍中改写
+ * - HEADER 与结尾取第一个文件的；注释去掉
+ * - 可选合并共享实体（unify）：指定根类（默认项目/空间结构/几何/分解关系）的实例，
+ *   把引用换成输出编号后内容相同即视为同一实体（哈希归并，引用已归并的实体随之相同），
+ *   只与之前文件中的实体合并，同一文件内不去重；被前向引用过的实例不参与
+ * 内存：不合并时与输入大小无关；合并时每个文件额外占用“每编号 1 位”的已定义位图与归并映射。
+ * .gfcb 输入无法流式解码，整体还原后再按同样方式处理。输出为文本 .gfc（可加 .gz/.zst）。
+ */
+
+struct GfcMergeOptions {
+    bool unify = false;
+    QStringList unifyRoots;        // 空则用 GfcMerge::defaultUnifyRoots()
+    GfcWriter::Options write;      // progress(已读字节, 总字节)、cancel；压缩由输出扩展名决定
+};
+
+class GfcMerge {
+public:
+    using Options = GfcMergeOptions;
+
+    struct Stats {
+        int files = 0;
+        qint64 instances = 0;          // 写出的实例
+        qint64 unified = 0;            // 合并掉的实例
+        qint64 maxId = 0;
+        QVector<qint64> offsets;       // 各文件的编号偏移
+        qint64 bytesOut = 0;
+        qint64 elapsedMs = 0;
+    };
+
+    static QStringList defaultUnifyRoots();
+
+    static bool merge(const QStringList& inputs, const QString& output, const CompiledSchema& schema,
+                      const Options& opt = Options(), Stats* stats = nullptr, QString* err = nullptr);
+};
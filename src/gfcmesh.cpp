@@ -0,0 +1,545 @@
+#include "gfcmesh.h"
+#include "gfcindex.h"
+#include "gfcnumber.h"
+#include "gfcparallel.h"
+#include "perftrace.h"
+#include "schemacache.h"
+
+#include <QElapsedTimer>
+#include <QSaveFile>
+#include <QThread>
+#include <QtEndian>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+struct Pt {
+    double x, y;
+};
+
+// 三角形 abc 的两倍有向面积（逆时针为正）
+inline double orient(const Pt& a, const Pt& b, const Pt& c)
+{
+    return (b.x - a.x) * (c.y - a.y) - (b.y - a.y) * (c.x - a.x);
+}
+
+// p 在三角形 abc 内或边上（abc 任意方向）
+inline bool inTriangle(const Pt& p, const Pt& a, const Pt& b, const Pt& c)
+{
+    const double d1 = orient(a, b, p), d2 = orient(b, c, p), d3 = orient(c, a, p);
+    const bool neg = d1 < 0 || d2 < 0 || d3 < 0;
+    const bool pos = d1 > 0 || d2 > 0 || d3 > 0;
+    return !(neg && pos);
+}
+
+double ringArea(const QVector<Pt>& ring)
+{
+    double s = 0;
+    for (int i = 0, n = ring.size(); i < n; ++i) {
+        const Pt& a = ring[i];
+        const Pt& b = ring[(i + 1) % n];
+        s += a.x * b.y - b.x * a.y;
+    }
+    return 0.5 * s;
+}
+
+// 把洞（顺时针）并入外环（逆时针）：从洞上 x 最大的点 M 向 +x 作射线，
+// 连到可见的外环顶点（射线碰到的边上 x 较大的端点；被反射顶点挡住时取与射线夹角最小者）
+void bridgeHole(const QVector<Pt>& pts, QVector<int>& outer, const QVector<int>& hole)
+{
+    int hm = 0;
+    for (int k = 1; k < hole.size(); ++k) {
+        if (pts[hole[k]].x > pts[hole[hm]].x) hm = k;
+    }
+    const Pt M = pts[hole[hm]];
+    const int n = outer.size();
+    double bestX = std::numeric_limits<double>::infinity();
+    int edge = -1;
+    for (int i = 0; i < n; ++i) {
+        const Pt& a = pts[outer[i]];
+        const Pt& b = pts[outer[(i + 1) % n]];
+        if ((a.y > M.y) == (b.y > M.y)) continue;
+        const double x = a.x + (M.y - a.y) * (b.x - a.x) / (b.y - a.y);
+        if (x >= M.x && x < bestX) {
+            bestX = x;
+            edge = i;
+        }
+    }
+    int target = 0;
+    if (edge < 0) {
+        // 退化（洞不在外环内）：连到最近的外环顶点
+        double best = std::numeric_limits<double>::infinity();
+        for (int i = 0; i < n; ++i) {
+            const Pt& q = pts[outer[i]];
+            const double d = (q.x - M.x) * (q.x - M.x) + (q.y - M.y) * (q.y - M.y);
+            if (d < best) { best = d; target = i; }
+        }
+    }
+    else {
+        const int i1 = (edge + 1) % n;
+        target = pts[outer[edge]].x > pts[outer[i1]].x ? edge : i1;
+        const Pt I{ bestX, M.y };
+        const Pt P = pts[outer[target]];
+        double bestTan = std::numeric_limits<double>::infinity();
+        double bestDist = bestTan;
+        for (int j = 0; j < n; ++j) {
+            const Pt& q = pts[outer[j]];
+            if (j == target || q.x < M.x || !inTriangle(q, M, I, P)) continue;
+            if (orient(pts[outer[(j + n - 1) % n]], q, pts[outer[(j + 1) % n]]) > 0) continue;   // 只看反射顶点
+            const double t = std::fabs(q.y - M.y) / std::max(q.x - M.x, 1e-300);
+            const double d = (q.x - M.x) * (q.x - M.x) + (q.y - M.y) * (q.y - M.y);
+            if (t < bestTan || (t == bestTan && d < bestDist)) {
+                bestTan = t;
+                bestDist = d;
+                target = j;
+            }
+        }
+    }
+    // 外环 .. P, M, 洞一圈, M, P, 外环其余
+    QVector<int> merged;
+    merged.reserve(n + hole.size() + 2);
+    for (int i = 0; i <= target; ++i) merged << outer[i];
+    for (int k = 0; k < hole.size(); ++k) merged << hole[(hm + k) % hole.size()];
+    merged << hole[hm] << outer[target];
+    for (int i = target + 1; i < n; ++i) merged << outer[i];
+    outer.swap(merged);
+}
+
+// 耳切三角化（poly 为逆时针、可含桥接产生的重复顶点）；数值退化时强制剪耳，保证终止
+void earClip(const QVector<Pt>& pts, const QVector<int>& poly, QVector<quint32>* tris)
+{
+    const int n = poly.size();
+    if (n < 3) return;
+    QVector<int> prev(n), next(n);
+    for (int i = 0; i < n; ++i) {
+        prev[i] = (i + n - 1) % n;
+        next[i] = (i + 1) % n;
+    }
+    int remaining = n;
+    int cur = 0;
+    int stall = 0;
+    while (remaining > 3) {
+        const int a = prev[cur], c = next[cur];
+        const int va = poly[a], vb = poly[cur], vc = poly[c];
+        const double o = orient(pts[va], pts[vb], pts[vc]);
+        bool ear = o > 0;
+        for (int k = next[c]; ear && k != a; k = next[k]) {
+            const int v = poly[k];
+            if (v != va && v != vb && v != vc && inTriangle(pts[v], pts[va], pts[vb], pts[vc])) ear = false;
+        }
+        if (!ear && ++stall <= remaining) {
+            cur = next[cur];
+            continue;
+        }
+        if (o != 0) *tris << quint32(va) << quint32(vb) << quint32(vc);
+        next[a] = c;
+        prev[c] = a;
+        --remaining;
+        cur = c;
+        stall = 0;
+    }
+    const int a = prev[cur], c = next[cur];
+    if (orient(pts[poly[a]], pts[poly[cur]], pts[poly[c]]) != 0) {
+        *tris << quint32(poly[a]) << quint32(poly[cur]) << quint32(poly[c]);
+    }
+}
+
+bool isConvex(const QVector<Pt>& pts, const QVector<int>& poly)
+{
+    const int n = poly.size();
+    for (int i = 0; i < n; ++i) {
+        if (orient(pts[poly[(i + n - 1) % n]], pts[poly[i]], pts[poly[(i + 1) % n]]) < 0) return false;
+    }
+    return true;
+}
+
+double determinant(const double m[3][4])
+{
+    return m[0][0] * (m[1][1] * m[2][2] - m[1][2] * m[2][1])
+         - m[0][1] * (m[1][0] * m[2][2] - m[1][2] * m[2][0])
+         + m[0][2] * (m[1][0] * m[2][1] - m[1][1] * m[2][0]);
+}
+
+// 一批截面点 (u, v, w) 变换到世界后追加到顶点数组：逐坐标轴的紧凑循环
+void appendTransformed(const double m[3][4], const double* u, const double* v, double w, int n, QVector<double>* out)
+{
+    const int base = out->size();
+    out->resize(base + 3 * n);
+    double* o = out->data() + base;
+    for (int k = 0; k < 3; ++k) {
+        const double a = m[k][0], b = m[k][1], t = m[k][2] * w + m[k][3];
+        for (int i = 0; i < n; ++i) o[3 * i + k] = t + a * u[i] + b * v[i];
+    }
+}
+
+// OBJ 坐标：10 位有效数字，不受进程 locale 影响
+inline int formatCoord(double v, char* buf)
+{
+#if defined(__cpp_lib_to_chars)
+    return int(std::to_chars(buf, buf + gfc::kRealBufSize, v, std::chars_format::general, 10).ptr - buf);
+#else
+    return gfc::formatReal(v, buf);
+#endif
+}
+
+QByteArray encodeObj(const GfcIndex& ix, int row, const GfcMesh& mesh, qint64 vertexBase)
+{
+    QByteArray out;
+    if (mesh.triangles.isEmpty()) return out;
+    out.reserve(mesh.vertexCount() * 40 + mesh.triangleCount() * 24 + 32);
+    const GfcIndexEntry& en = ix.at(row);
+    out += "o ";
+    out += ix.className(en.cls);
+    out += '_';
+    gfc::appendNumber(out, en.id);
+    out += '\n';
+    char buf[gfc::kRealBufSize];
+    const double* v = mesh.vertices.constData();
+    for (int i = 0, n = mesh.vertexCount(); i < n; ++i) {
+        out += 'v';
+        for (int k = 0; k < 3; ++k) {
+            out += ' ';
+            out.append(buf, formatCoord(v[3 * i + k], buf));
+        }
+        out += '\n';
+    }
+    const quint32* t = mesh.triangles.constData();
+    for (int i = 0, n = mesh.triangleCount(); i < n; ++i) {
+        out += 'f';
+        for (int k = 0; k < 3; ++k) {
+            out += ' ';
+            gfc::appendNumber(out, vertexBase + t[3 * i + k]);
+        }
+        out += '\n';
+    }
+    return out;
+}
+
+inline void putFloat(char*& p, float f)
+{
+    quint32 bits;
+    std::memcpy(&bits, &f, 4);
+    qToLittleEndian(bits, p);
+    p += 4;
+}
+
+// 二进制 STL：每个三角形 50 字节（法向、三个顶点、属性字）
+QByteArray encodeStl(const GfcMesh& mesh)
+{
+    const int n = mesh.triangleCount();
+    QByteArray out(n * 50, '\0');
+    char* p = out.data();
+    const double* v = mesh.vertices.constData();
+    const quint32* t = mesh.triangles.constData();
+    for (int i = 0; i < n; ++i) {
+        const double* a = v + 3 * t[3 * i];
+        const double* b = v + 3 * t[3 * i + 1];
+        const double* c = v + 3 * t[3 * i + 2];
+        const double e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        const double e2[3] = { c[0] - a[0], c[1] - a[1], c[2] - a[2] };
+        double nx = e1[1] * e2[2] - e1[2] * e2[1];
+        double ny = e1[2] * e2[0] - e1[0] * e2[2];
+        double nz = e1[0] * e2[1] - e1[1] * e2[0];
+        const double len = std::sqrt(nx * nx + ny * ny + nz * nz);
+        if (len > 0) { nx /= len; ny /= len; nz /= len; }
+        putFloat(p, float(nx));
+        putFloat(p, float(ny));
+        putFloat(p, float(nz));
+        for (const double* q : { a, b, c }) {
+            for (int k = 0; k < 3; ++k) putFloat(p, float(q[k]));
+        }
+        p += 2;
+    }
+    return out;
+}
+
+} // namespace
+
+// 截面网格：各环轮廓点依次存放（已定向：外环逆时针、洞顺时针），cap 为截面三角形（逆时针）
+struct GfcTessellator::Section {
+    QVector<double> u, v;
+    QVector<int> ringStart;       // 各环起点，末尾为总点数
+    QVector<quint32> cap;
+};
+
+GfcTessellator::GfcTessellator(const GfcIndex& index, const CompiledSchema& schema, const Options& opt)
+    : eval_(index, schema), opt_(opt)
+{
+}
+
+int GfcTessellator::cachedSections() const
+{
+    QReadLocker locker(&lock_);
+    return cache_.size();
+}
+
+int GfcTessellator::arcSegments(double radius, double sweep) const
+{
+    const double tol = opt_.chordTolerance;
+    const double step = tol > 0 && tol < radius ? 2 * std::acos(1 - tol / radius) : gfc::kPi;
+    const double turns = sweep / (2 * gfc::kPi);
+    const int lo = qMax(1, int(std::ceil(turns * qMax(1, opt_.minSegmentsPerCircle))));
+    const int hi = qMax(lo, int(std::ceil(turns * qMax(1, opt_.maxSegmentsPerCircle))));
+    return qBound(lo, int(std::ceil(sweep / step)), hi);
+}
+
+QSharedPointer<const GfcTessellator::Section> GfcTessellator::section(int row, QByteArray* why) const
+{
+    {
+        QReadLocker locker(&lock_);
+        const auto it = cache_.constFind(row);
+        if (it != cache_.constEnd()) return it.value();
+    }
+    std::vector<GfcSectionLoop> loops;
+    QSharedPointer<const Section> s;
+    if (eval_.section(row, &loops, why)) s = buildSection(loops);
+    // 并发时可能被算了两次，结果相同，保留先写入的
+    QWriteLocker locker(&lock_);
+    return cache_.insert(row, cache_.value(row, s)).value();
+}
+
+QSharedPointer<const GfcTessellator::Section> GfcTessellator::buildSection(const std::vector<GfcSectionLoop>& loops) const
+{
+    // ① 离散各环，去掉相邻重合点
+    QVector<QVector<Pt>> rings;
+    for (const GfcSectionLoop& loop : loops) {
+        QVector<Pt> ring;
+        auto add = [&ring](double x, double y) {
+            if (!ring.isEmpty() && ring.last().x == x && ring.last().y == y) return;
+            ring << Pt{ x, y };
+        };
+        // 每段只放起点与圆弧内部点，终点即下一段的起点；最后一段的终点若与首点重合随后去掉
+        for (const GfcSectionSegment& s : loop) {
+            add(s.x0, s.y0);
+            if (s.arc) {
+                const double sweep = s.phi1 - s.phi0;
+                const int n = arcSegments(s.r, std::fabs(sweep));
+                for (int i = 1; i < n; ++i) {
+                    const double phi = s.phi0 + sweep * i / n;
+                    add(s.cx + s.r * std::cos(phi), s.cy + s.r * std::sin(phi));
+                }
+            }
+        }
+        add(loop.back().x1, loop.back().y1);
+        while (ring.size() > 1) {
+            const Pt& a = ring.first();
+            const Pt& b = ring.last();
+            const double scale = qMax(1.0, qMax(std::fabs(a.x), std::fabs(a.y)));
+            if (std::fabs(a.x - b.x) > 1e-9 * scale || std::fabs(a.y - b.y) > 1e-9 * scale) break;
+            ring.removeLast();
+        }
+        if (ring.size() >= 3 && ringArea(ring) != 0) rings << ring;
+    }
+    if (rings.isEmpty()) return {};
+
+    // ② 面积最大的为外环（逆时针），其余为洞（顺时针）
+    int outerRing = 0;
+    for (int i = 1; i < rings.size(); ++i) {
+        if (std::fabs(ringArea(rings[i])) > std::fabs(ringArea(rings[outerRing]))) outerRing = i;
+    }
+    std::swap(rings[0], rings[outerRing]);
+    auto section = QSharedPointer<Section>::create();
+    QVector<Pt> pts;
+    QVector<int> outer;
+    QVector<QVector<int>> holes;
+    for (int i = 0; i < rings.size(); ++i) {
+        QVector<Pt>& ring = rings[i];
+        if ((ringArea(ring) > 0) != (i == 0)) std::reverse(ring.begin(), ring.end());
+        section->ringStart << pts.size();
+        QVector<int> ids;
+        for (const Pt& p : ring) {
+            ids << pts.size();
+            pts << p;
+            section->u << p.x;
+            section->v << p.y;
+        }
+        if (i == 0) outer = ids;
+        else holes << ids;
+    }
+    section->ringStart << pts.size();
+
+    // ③ 三角化：单环凸多边形扇形；否则按 x 从大到小桥接各洞后耳切
+    if (holes.isEmpty() && isConvex(pts, outer)) {
+        for (int i = 1; i + 1 < outer.size(); ++i) {
+            section->cap << quint32(outer[0]) << quint32(outer[i]) << quint32(outer[i + 1]);
+        }
+        return section;
+    }
+    auto maxX = [&pts](const QVector<int>& ring) {
+        double x = -std::numeric_limits<double>::infinity();
+        for (int id : ring) x = qMax(x, pts[id].x);
+        return x;
+    };
+    std::sort(holes.begin(), holes.end(), [&](const QVector<int>& a, const QVector<int>& b) { return maxX(a) > maxX(b); });
+    for (const QVector<int>& hole : holes) bridgeHole(pts, outer, hole);
+    earClip(pts, outer, &section->cap);
+    return section;
+}
+
+int GfcTessellator::tessellate(int row, GfcMesh* mesh, QByteArray* skippedClass) const
+{
+    mesh->clear();
+    std::vector<GfcSolid> solids;
+    int skipped = eval_.solids(row, &solids, skippedClass);
+    for (const GfcSolid& s : solids) {
+        const double (&m)[3][4] = s.world;
+        const quint32 base = quint32(mesh->vertexCount());
+        bool flip = false;
+        auto tri = [&](quint32 a, quint32 b, quint32 c) {
+            if (flip) std::swap(b, c);
+            mesh->triangles << base + a << base + b << base + c;
+        };
+
+        if (s.kind == GfcSolid::Cuboid) {
+            // 角点编号：bit0 = X，bit1 = Y，bit2 = Z
+            static const int kFaces[12][3] = { { 0, 2, 3 }, { 0, 3, 1 }, { 4, 5, 7 }, { 4, 7, 6 },
+                                               { 0, 1, 5 }, { 0, 5, 4 }, { 2, 6, 7 }, { 2, 7, 3 },
+                                               { 0, 4, 6 }, { 0, 6, 2 }, { 1, 3, 7 }, { 1, 7, 5 } };
+            const double us[4] = { 0, s.dim[0], 0, s.dim[0] };
+            const double vs[4] = { 0, 0, s.dim[1], s.dim[1] };
+            appendTransformed(m, us, vs, 0, 4, &mesh->vertices);
+            appendTransformed(m, us, vs, s.dim[2], 4, &mesh->vertices);
+            flip = determinant(m) * s.dim[0] * s.dim[1] * s.dim[2] < 0;
+            for (const auto& f : kFaces) tri(quint32(f[0]), quint32(f[1]), quint32(f[2]));
+            continue;
+        }
+
+        QByteArray why;
+        const QSharedPointer<const Section> sec = section(s.section, &why);
+        if (!sec) {
+            ++skipped;
+            if (skippedClass && skippedClass->isEmpty()) *skippedClass = why.isEmpty() ? QByteArray("GFCCOMMONPOLYGON") : why;
+            continue;
+        }
+        const int n = sec->u.size();
+        mesh->vertices.reserve(mesh->vertices.size() + 6 * n);
+        mesh->triangles.reserve(mesh->triangles.size() + 2 * sec->cap.size() + 6 * n);
+        appendTransformed(m, sec->u.constData(), sec->v.constData(), 0, n, &mesh->vertices);
+        appendTransformed(m, sec->u.constData(), sec->v.constData(), s.len, n, &mesh->vertices);
+        flip = determinant(m) * s.len < 0;
+        const quint32 top = quint32(n);
+        const quint32* cap = sec->cap.constData();
+        for (int i = 0; i + 2 < sec->cap.size(); i += 3) {
+            tri(cap[i], cap[i + 2], cap[i + 1]);                       // 底面朝 -Z
+            tri(top + cap[i], top + cap[i + 1], top + cap[i + 2]);
+        }
+        for (int r = 0; r + 1 < sec->ringStart.size(); ++r) {
+            const int b = sec->ringStart[r], e = sec->ringStart[r + 1];
+            for (int i = b; i < e; ++i) {
+                const quint32 p = quint32(i), q = quint32(i + 1 < e ? i + 1 : b);
+                tri(p, q, top + q);
+                tri(p, top + q, top + p);
+            }
+        }
+    }
+    return skipped;
+}
+
+GfcMeshExport::Format GfcMeshExport::formatFor(const QString& path)
+{
+    return path.endsWith(QLatin1String(".stl"), Qt::CaseInsensitive) ? Stl : Obj;
+}
+
+bool GfcMeshExport::write(const GfcIndex& ix, const CompiledSchema& schema, const QString& path,
+                          const GfcMeshOptions& opt, Stats* stats, QString* err)
+{
+    GFC_PERF_SCOPE("导出网格");
+    QElapsedTimer timer;
+    timer.start();
+    const Format format = formatFor(path);
+    const GfcTessellator tess(ix, schema, opt);
+    const QVector<int> rows = tess.evaluator().elementRows();
+    Stats st;
+    st.elements = rows.size();
+
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly)) {
+        if (err) *err = QStringLiteral("无法写入文件：%1（%2）").arg(path, f.errorString());
+        return false;
+    }
+    auto fail = [&](const QString& msg) {
+        f.cancelWriting();
+        if (err) *err = msg;
+        return false;
+    };
+    QByteArray head;
+    if (format == Stl) {
+        head = QByteArray(84, '\0');
+        const char title[] = "GFC Editor binary STL";
+        std::memcpy(head.data(), title, sizeof(title) - 1);
+    }
+    else {
+        head = "# GFC Editor OBJ export\n";
+    }
+    if (f.write(head) != head.size()) return fail(QStringLiteral("写入失败：%1").arg(f.errorString()));
+    st.bytes = head.size();
+
+    // 一批构件：并行网格化 -> 定顶点编号 -> 并行编码 -> 顺序写出，之后释放
+    struct Item {
+        GfcMesh mesh;
+        QByteArray skippedClass;
+        int skipped = 0;
+        QByteArray bytes;
+    };
+    const int batch = qMax(256, QThread::idealThreadCount() * 64);
+    QVector<Item> items;
+    QVector<qint64> bases;
+    qint64 vertexBase = 1;                    // OBJ 顶点从 1 开始编号
+    for (int first = 0; first < rows.size(); first += batch) {
+        if (opt.cancel && opt.cancel->load(std::memory_order_relaxed)) return fail(QStringLiteral("已取消导出"));
+        const int m = qMin(batch, rows.size() - first);
+        items.clear();
+        items.resize(m);
+        const int parts = gfc::partsFor(m, 8);
+        gfc::parallelParts(m, parts, [&](int b, int e, int) {
+            for (int i = b; i < e; ++i) {
+                Item& it = items[i];
+                it.skipped = tess.tessellate(rows[first + i], &it.mesh, &it.skippedClass);
+            }
+        });
+        bases.resize(m);
+        for (int i = 0; i < m; ++i) {
+            const Item& it = items[i];
+            bases[i] = vertexBase;
+            vertexBase += it.mesh.vertexCount();
+            st.vertices += it.mesh.vertexCount();
+            st.triangles += it.mesh.triangleCount();
+            if (it.mesh.triangleCount()) ++st.meshed;
+            st.skipped += it.skipped;
+            if (it.skipped) ++st.skippedClasses[it.skippedClass];
+        }
+        gfc::parallelParts(m, parts, [&](int b, int e, int) {
+            for (int i = b; i < e; ++i) {
+                Item& it = items[i];
+                it.bytes = format == Stl ? encodeStl(it.mesh) : encodeObj(ix, rows[first + i], it.mesh, bases[i]);
+                it.mesh.clear();
+            }
+        });
+        for (const Item& it : items) {
+            if (f.write(it.bytes) != it.bytes.size()) return fail(QStringLiteral("写入失败：%1").arg(f.errorString()));
+            st.bytes += it.bytes.size();
+        }
+        if (opt.progress) opt.progress(first + m, rows.size());
+    }
+
+    if (format == Stl) {
+        if (st.triangles > qint64(std::numeric_limits<quint32>::max())) {
+            return fail(QStringLiteral("三角形数超出 STL 上限：%1").arg(st.triangles));
+        }
+        char count[4];
+        qToLittleEndian(quint32(st.triangles), count);
+        if (!f.seek(80) || f.write(count, 4) != 4) return fail(QStringLiteral("写入失败：%1").arg(f.errorString()));
+    }
+    if (!f.commit()) {
+        if (err) *err = QStringLiteral("无法替换目标文件：%1（%2）").arg(path, f.errorString());
+        return false;
+    }
+    st.sections = tess.cachedSections();
+    st.elapsedMs = timer.elapsed();
+    PerfTrace::instance().setCounter(QStringLiteral("三角形"), st.triangles);
+    if (stats) *stats = st;
+    return true;
+}
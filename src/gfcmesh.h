@@ -0,0 +1,90 @@
+#pragma once
+#include <QByteArray>
+#include <QHash>
+#include <QReadWriteLock>
+#include <QSharedPointer>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <functional>
+
+#include "gfcgeometry.h"
+
+class CompiledSchema;
+class GfcIndex;
+
+/**
+ * 构件网格化与 OBJ / STL 导出：
+ * - 形体链与 GfcGeometryEvaluator 相同（GfcExtrudedBody、GfcCuboidBody），坐标系合成后变换到世界
+ * - 截面：圆弧按弦高容差离散（每整圆段数有上下限），各环去掉重合点后定向（外环逆时针、洞顺时针），
+ *   洞用桥接边并入外环后耳切三角化；单环凸多边形直接扇形三角化。
+ *   截面网格按截面行缓存，多个构件共用同一截面时只离散一次（读写锁，线程安全）
+ * - 拉伸体：底面、顶面与侧面四边形，共用顶点的索引网格；三角形朝外（det 为负时翻转）
+ * - 导出：构件分批在线程池上并行网格化与编码，按批顺序写出后即释放，内存与批大小成正比；
+ *   写入临时文件，完成后原子替换目标（STL 三角形数在结尾回填）
+ * 容差以截面坐标单位计。
+ */
+
+struct GfcMeshOptions {
+    double chordTolerance = 1.0;             // 圆弧弦高容差
+    int minSegmentsPerCircle = 8;
+    int maxSegmentsPerCircle = 256;
+    std::function<void(qint64 done, qint64 total)> progress;   // 可空，在调用线程触发
+    const std::atomic<bool>* cancel = nullptr;
+};
+
+// 索引三角网格（世界坐标）
+struct GfcMesh {
+    QVector<double> vertices;     // x, y, z 依次排列
+    QVector<quint32> triangles;   // 每 3 个为一个三角形
+
+    int vertexCount() const { return vertices.size() / 3; }
+    int triangleCount() const { return triangles.size() / 3; }
+    void clear() { vertices.clear(); triangles.clear(); }
+};
+
+class GfcTessellator {
+public:
+    using Options = GfcMeshOptions;
+
+    // index 与 schema 需在使用期间有效；tessellate 可在多个线程同时调用
+    GfcTessellator(const GfcIndex& index, const CompiledSchema& schema, const Options& opt = Options());
+
+    const GfcGeometryEvaluator& evaluator() const { return eval_; }
+    // 构件的全部实体合为一个网格；返回跳过的形体数
+    int tessellate(int row, GfcMesh* mesh, QByteArray* skippedClass = nullptr) const;
+    int cachedSections() const;
+
+private:
+    struct Section;
+    QSharedPointer<const Section> section(int row, QByteArray* why) const;
+    QSharedPointer<const Section> buildSection(const std::vector<GfcSectionLoop>& loops) const;
+    int arcSegments(double radius, double sweep) const;
+
+    GfcGeometryEvaluator eval_;
+    Options opt_;
+    mutable QReadWriteLock lock_;
+    mutable QHash<int, QSharedPointer<const Section>> cache_;   // 截面行 -> 网格（空指针表示无法网格化）
+};
+
+class GfcMeshExport {
+public:
+    enum Format { Obj, Stl };
+    struct Stats {
+        int elements = 0;
+        int meshed = 0;               // 至少有一个实体的构件
+        int skipped = 0;              // 跳过的形体
+        qint64 vertices = 0;
+        qint64 triangles = 0;
+        int sections = 0;             // 缓存的截面
+        qint64 bytes = 0;
+        qint64 elapsedMs = 0;
+        QHash<QByteArray, int> skippedClasses;
+    };
+
+    // 按扩展名：.stl 为二进制 STL，其余为 OBJ
+    static Format formatFor(const QString& path);
+    // OBJ 每个构件一个对象（o 类名_#id）；STL 为二进制，全部三角形
+    static bool write(const GfcIndex& index, const CompiledSchema& schema, const QString& path,
+                      const GfcMeshOptions& opt = GfcMeshOptions(), Stats* stats = nullptr, QString* err = nullptr);
+};
@@ -0,0 +1,107 @@
+#pragma once
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <system_error>
+
+#if !defined(__cpp_lib_to_chars)
+#include <locale>
+#include <sstream>
+#include <string>
+#endif
+
+/**
+ * STEP 数值的解码与写出（只依赖标准库）：
+ * - parseReal / parseInteger：直接在字节缓冲上解析（std::from_chars），不构造子串、不受进程 locale 影响
+ *   接受 STEP 写法：可选前导 '+'、"3."、"1.E-05"、".5"
+ * - formatReal：最短可往返表示（std::to_chars），并规整为 STEP 形式：必有小数点、指数大写，如 3. / 1.E-05
+ *   parseReal(formatReal(x)) == x 对所有有限值成立，加载/保存不会改变数值
+ * 标准库不支持浮点 from_chars/to_chars 时回退到 classic locale 的流（较慢但结果一致）。
+ */
+
+namespace gfc {
+
+// 解析成功返回数值之后的位置，失败返回 nullptr
+inline const char* parseReal(const char* p, const char* end, double& v)
+{
+    if (p < end && *p == '+') ++p;
+#if defined(__cpp_lib_to_chars)
+    const auto r = std::from_chars(p, end, v);
+    return r.ec == std::errc() ? r.ptr : nullptr;
+#else
+    const char* q = p;
+    if (q < end && *q == '-') ++q;
+    while (q < end && ((*q >= '0' && *q <= '9') || *q == '.' || *q == 'e' || *q == 'E'
+                       || ((*q == '+' || *q == '-') && (q[-1] == 'e' || q[-1] == 'E')))) ++q;
+    std::istringstream in(std::string(p, std::size_t(q - p)));
+    in.imbue(std::locale::classic());
+    in >> v;
+    return (in && q > p) ? q : nullptr;
+#endif
+}
+
+inline const char* parseInteger(const char* p, const char* end, std::int64_t& v)
+{
+    if (p < end && *p == '+') ++p;
+    const auto r = std::from_chars(p, end, v);
+    return r.ec == std::errc() ? r.ptr : nullptr;
+}
+
+// 整段恰好是一个实数（两端不含空白）
+inline bool parseRealExact(const char* p, const char* end, double& v)
+{
+    return p < end && parseReal(p, end, v) == end;
+}
+
+// buf 至少 kRealBufSize 字节；返回写入长度（不含结尾 0）
+constexpr int kRealBufSize = 40;
+
+inline int formatReal(double v, char* buf)
+{
+    char tmp[kRealBufSize];
+#if defined(__cpp_lib_to_chars)
+    const auto r = std::to_chars(tmp, tmp + sizeof(tmp), v);
+    const int n = int(r.ptr - tmp);
+#else
+    int n = 0;
+    for (int prec = 15; prec <= 17; ++prec) {
+        std::ostringstream os;
+        os.imbue(std::locale::classic());
+        os.precision(prec);
+        os << v;
+        const std::string s = os.str();
+        double back = 0;
+        n = int(s.size());
+        std::memcpy(tmp, s.data(), s.size());
+        if (parseReal(tmp, tmp + n, back) && back == v) break;
+    }
+#endif
+    // 规整为 STEP 形式：尾数必须带小数点，指数用大写 E
+    int mant = 0;
+    while (mant < n && tmp[mant] != 'e' && tmp[mant] != 'E') ++mant;
+    bool hasDot = false;
+    bool isNumber = false;
+    for (int i = 0; i < mant; ++i) {
+        if (tmp[i] == '.') hasDot = true;
+        if (tmp[i] >= '0' && tmp[i] <= '9') isNumber = true;
+    }
+    std::memcpy(buf, tmp, std::size_t(mant));
+    int o = mant;
+    if (isNumber && !hasDot) buf[o++] = '.';   // inf/nan 原样保留
+    if (mant < n) {
+        buf[o++] = 'E';
+        std::memcpy(buf + o, tmp + mant + 1, std::size_t(n - mant - 1));
+        o += n - mant - 1;
+    }
+    buf[o] = '\0';
+    return o;
+}
+
+inline int formatInteger(std::int64_t v, char* buf)
+{
+    const auto r = std::to_chars(buf, buf + 24, v);
+    *r.ptr = '\0';
+    return int(r.ptr - buf);
+}
+
+} // namespace gfc
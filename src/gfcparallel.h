@@ -0,0 +1,46 @@
+#pragma once
+#include <QByteArray>
+#include <QThread>
+#include <QVector>
+#include <QtConcurrent/QtConcurrentMap>
+
+/**
+ * 分段并行的共用小工具（各批处理模块共用）：
+ * - parallelParts：把 [0, n) 均分为 parts 段，每段一个任务 f(begin, end, part)；只有一段时在调用线程执行
+ * - partsFor：每段约 grain 个元素，至多 maxParts() 段；按段号存放的中间结果可按 maxParts() 预留
+ */
+
+namespace gfc {
+
+inline int maxParts()
+{
+    return qMax(1, QThread::idealThreadCount() * 4);
+}
+
+inline int partsFor(int n, int grain = 4096)
+{
+    return qMax(1, qMin(n / grain + 1, maxParts()));
+}
+
+template <class F>
+void parallelParts(int n, int parts, F&& f)
+{
+    QVector<int> ids;
+    for (int i = 0; i < parts; ++i) ids << i;
+    auto run = [&](int part) {
+        f(int(qint64(n) * part / parts), int(qint64(n) * (part + 1) / parts), part);
+    };
+    if (parts == 1) run(0);
+    else QtConcurrent::blockingMap(ids, run);
+}
+
+// 非负整数（实例 id、行号）追加为十进制文本；热循环里比 QByteArray::number 少一次分配
+inline void appendNumber(QByteArray& out, qint64 v)
+{
+    char buf[24];
+    int n = 0;
+    do { buf[n++] = char('0' + v % 10); v /= 10; } while (v);
+    while (n) out += buf[--n];
+}
+
+} // namespace gfc
@@ -1,4 +1,5 @@
 #include "gfcparser.h"
+#include "gfcnumber.h"
 #include <QRegularExpression>
 
 // === 放在 gfcparser.cpp 末尾（或合适位置） ===
@@ -138,3 +139,55 @@ int GfcParser::parseInstanceIndex(const QString &token)
     if (!m.hasMatch()) return -1;
     return m.captured(1).toInt();
 }
+
+// ---- 数值解码：把 ASCII 片段拷到栈上缓冲后直接 from_chars ----
+
+static bool toAsciiBuffer(QStringView t, char* buf, int cap, int* len)
+{
+    t = t.trimmed();
+    if (t.isEmpty() || t.size() >= cap) return false;
+    for (int i = 0; i < t.size(); ++i) {
+        const ushort u = t[i].unicode();
+        if (u >= 0x80) return false;
+        buf[i] = char(u);
+    }
+    *len = int(t.size());
+    return true;
+}
+
+bool GfcParser::decodeReal(QStringView token, double* out)
+{
+    char buf[64];
+    int n = 0;
+    double v = 0;
+    if (!toAsciiBuffer(token, buf, int(sizeof(buf)), &n) || !gfc::parseRealExact(buf, buf + n, v)) return false;
+    if (out) *out = v;
+    return true;
+}
+
+bool GfcParser::decodeReals(QStringView list, QVector<double>* out)
+{
+    list = list.trimmed();
+    if (list.size() < 2 || list.front() != QLatin1Char('(') || list.back() != QLatin1Char(')')) return false;
+    list = list.mid(1, list.size() - 2);
+    if (out) out->clear();
+    if (list.trimmed().isEmpty()) return true;
+
+    qsizetype from = 0;
+    while (from <= list.size()) {
+        qsizetype comma = list.indexOf(QLatin1Char(','), from);
+        if (comma < 0) comma = list.size();
+        double v = 0;
+        if (!decodeReal(list.mid(from, comma - from), &v)) return false;
+        if (out) out->push_back(v);
+        from = comma + 1;
+    }
+    return true;
+}
+
+QString GfcParser::formatReal(double v)
+{
+    char buf[gfc::kRealBufSize];
+    const int n = gfc::formatReal(v, buf);
+    return QString::fromLatin1(buf, n);
+}
@@ -3,6 +3,8 @@
 #include <QHash>
 #include <QVector>
 #include <QPair>
+#include <QStringList>
+#include <QStringView>
 
 /**
  * 极简 GFC 文本解析辅助：
@@ -36,6 +38,13 @@ public:
 
     static bool parseInstanceAt(const QString& text, int startPos, ParsedInstance* out);
 
+    // 数值参数解码（from_chars，不经 QString::toDouble）：token 两端空白忽略，须整段是一个数
+    static bool decodeReal(QStringView token, double* out);
+    // 数值列表，如 "(0.95447997803503,0.,-0.298274993135947)"；遇到非数值元素返回 false
+    static bool decodeReals(QStringView list, QVector<double>* out);
+    // 最短可往返的 STEP 实数写法，如 3. / 0.1 / 1.E-05
+    static QString formatReal(double v);
+
 private:
     // ★ 新增：切分顶层参数（忽略嵌套括号/字符串内部逗号）
     static QStringList splitTopLevelCsv(const QString& s);
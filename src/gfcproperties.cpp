@@ -0,0 +1,429 @@
+#include "gfcproperties.h"
+#include "gfcindex.h"
+#include "gfcnumber.h"
+#include "gfcparallel.h"
+#include "gfctyped.h"
+#include "perftrace.h"
+#include "schemacache.h"
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QSaveFile>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace {
+
+// 一个待解码的属性：叶属性行 + 所在复合属性行（-1 为直接挂在属性集下）
+struct Slot {
+    int leaf;
+    int parent;
+};
+
+struct Decoded {
+    QString key, name, value;
+    double number = std::nan("");
+};
+
+// 一个参数值的文本：字符串解码，列表逐项以逗号连接，其余保留原文
+QString argText(const std::string& raw)
+{
+    if (raw.empty() || raw == "$" || raw == "*") return QString();
+    if (raw[0] == '\'') {
+        gfc::ArgReader r(raw);
+        std::string s;
+        return r.readString(s) ? QString::fromStdString(s) : QString::fromStdString(raw);
+    }
+    if (raw[0] == '(') {
+        gfc::ArgReader r(raw);
+        QStringList items;
+        std::string item;
+        if (!r.beginList()) return QString::fromStdString(raw);
+        while (!r.atListEnd() && r.readRaw(item)) items << argText(item);
+        return items.join(QStringLiteral(", "));
+    }
+    return QString::fromStdString(raw);
+}
+
+QString csvField(QString s)
+{
+    if (s.contains(QLatin1Char(',')) || s.contains(QLatin1Char('"')) || s.contains(QLatin1Char('\n'))) {
+        s.replace(QLatin1Char('"'), QStringLiteral("\"\""));
+        s = QLatin1Char('"') + s + QLatin1Char('"');
+    }
+    return s;
+}
+
+bool writeFile(const QString& path, const QByteArray& bytes, QString* err)
+{
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly) || f.write(bytes) != bytes.size() || !f.commit()) {
+        if (err) *err = QStringLiteral("无法写入 %1：%2").arg(path, f.errorString());
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+bool GfcPropertyIndex::build(const GfcIndex& index, const CompiledSchema& schema, Stats* stats)
+{
+    GFC_PERF_SCOPE("属性透视索引");
+    QElapsedTimer timer;
+    timer.start();
+    *this = GfcPropertyIndex();
+    const int eRel = schema.find(QStringLiteral("GfcRelDefinesByProperties"));
+    const int eSet = schema.find(QStringLiteral("GfcPropertySet"));
+    const int eProp = schema.find(QStringLiteral("GfcProperty"));
+    const int eComplex = schema.find(QStringLiteral("GfcComplexProperty"));
+    if (eRel < 0 || eSet < 0 || eProp < 0) return false;
+    ix_ = &index;
+    schema_ = &schema;
+    const int aRelSet = schema.attributeIndex(eRel, QStringLiteral("RelatingPropertySet"));
+    const int aRelObjects = schema.attributeIndex(eRel, QStringLiteral("RelatedObjects"));
+    const int aSetProps = schema.attributeIndex(eSet, QStringLiteral("HasProperties"));
+    const int aComplexProps = eComplex >= 0 ? schema.attributeIndex(eComplex, QStringLiteral("HasProperties")) : -1;
+    const int aName = schema.attributeIndex(eProp, QStringLiteral("Name"));
+    const int aCode = schema.attributeIndex(eProp, QStringLiteral("Code"));
+    const int aValue = schema.attributeCount(eProp);   // 各具体属性类的取值紧跟在 GfcProperty 的属性之后
+
+    QVector<quint8> kind(index.classCount(), 0);       // 1 关系，2 属性集，3 复合属性，4 其它属性
+    for (int c = 0; c < index.classCount(); ++c) {
+        const int e = index.schemaEntity(c);
+        if (e < 0) continue;
+        if (schema.isSubtypeOf(e, eRel)) kind[c] = 1;
+        else if (schema.isSubtypeOf(e, eSet)) kind[c] = 2;
+        else if (eComplex >= 0 && schema.isSubtypeOf(e, eComplex)) kind[c] = 3;
+        else if (schema.isSubtypeOf(e, eProp)) kind[c] = 4;
+    }
+    const int n = index.size();
+    auto kindOf = [&](int row) { return row >= 0 ? kind[index.at(row).cls] : 0; };
+    auto readRefs = [&](int row, int attr, std::vector<int>* rows) {
+        rows->clear();
+        gfc::ArgReader r(index.args(row));
+        gfc::Ref ref;
+        if (attr < 0 || !r.skipValues(attr) || r.readNull() || !r.beginList()) return;
+        while (!r.atListEnd() && r.readRef(ref)) rows->push_back(index.rowOf(ref.id));
+    };
+
+    QVector<int> rels;
+    for (int r = 0; r < n; ++r) {
+        if (kind[index.at(r).cls] == 1) rels << r;
+    }
+
+    // 1) 并行：每个关系展开为 (对象行, 槽) 对，槽为属性集中的叶属性（复合属性展开一层）
+    struct Pair {
+        int object;
+        Slot slot;
+    };
+    std::vector<std::vector<Pair>> pairsOf(static_cast<size_t>(gfc::maxParts()));
+    gfc::parallelParts(rels.size(), gfc::partsFor(rels.size(), 256), [&](int b, int e, int part) {
+        std::vector<Pair>& out = pairsOf[size_t(part)];
+        std::vector<int> objects, props, children;
+        std::vector<Slot> leaves;
+        gfc::Ref ref;
+        for (int i = b; i < e; ++i) {
+            gfc::ArgReader r(index.args(rels[i]));
+            if (aRelSet < 0 || !r.skipValues(aRelSet) || r.readNull() || !r.readRef(ref)) continue;
+            const int set = index.rowOf(ref.id);
+            if (kindOf(set) != 2) continue;
+            leaves.clear();
+            readRefs(set, aSetProps, &props);
+            for (int p : props) {
+                if (kindOf(p) == 4) leaves.push_back({ p, -1 });
+                if (kindOf(p) != 3) continue;
+                readRefs(p, aComplexProps, &children);
+                for (int c : children) {
+                    if (kindOf(c) == 4) leaves.push_back({ c, p });
+                }
+            }
+            readRefs(rels[i], aRelObjects, &objects);
+            for (int o : objects) {
+                if (o < 0) continue;
+                for (const Slot& s : leaves) out.push_back({ o, s });
+            }
+        }
+    });
+
+    // 2) 槽编号：直接挂在属性集下的按行号查表，复合属性下的（少见）用哈希
+    QVector<int> directSlot(n, -1);
+    QHash<qint64, int> nestedSlot;
+    std::vector<Slot> unique;
+    std::vector<int> slotOfPair;
+    size_t pairCount = 0;
+    for (const auto& pairs : pairsOf) pairCount += pairs.size();
+    slotOfPair.reserve(pairCount);
+    for (const auto& pairs : pairsOf) {
+        for (const Pair& p : pairs) {
+            int* id = nullptr;
+            if (p.slot.parent < 0) {
+                id = &directSlot[p.slot.leaf];
+            }
+            else {
+                const qint64 k = (qint64(p.slot.parent) << 32) | quint32(p.slot.leaf);
+                auto it = nestedSlot.find(k);
+                if (it == nestedSlot.end()) it = nestedSlot.insert(k, -1);
+                id = &it.value();
+            }
+            if (*id < 0) {
+                *id = int(unique.size());
+                unique.push_back(p.slot);
+            }
+            slotOfPair.push_back(*id);
+        }
+    }
+
+    // 3) 并行解码各槽
+    auto readText = [&](int row, int attr) {
+        gfc::ArgReader r(index.args(row));
+        std::string raw;
+        if (attr < 0 || !r.skipValues(attr) || !r.readRaw(raw)) return QString();
+        return argText(raw);
+    };
+    std::vector<Decoded> decoded(unique.size());
+    gfc::parallelParts(int(unique.size()), gfc::partsFor(int(unique.size()), 1024), [&](int b, int e, int) {
+        for (int i = b; i < e; ++i) {
+            const Slot& s = unique[size_t(i)];
+            Decoded& d = decoded[size_t(i)];
+            d.name = readText(s.leaf, aName);
+            const QString code = readText(s.leaf, aCode);
+            d.key = code.isEmpty() ? d.name : code;
+            if (s.parent >= 0) {
+                const QString parentCode = readText(s.parent, aCode);
+                const QString parentName = readText(s.parent, aName);
+                d.key = (parentCode.isEmpty() ? parentName : parentCode) + QLatin1Char('.') + d.key;
+                d.name = parentName + QLatin1Char('.') + d.name;
+            }
+            d.value = readText(s.leaf, aValue);
+            const QByteArray utf8 = d.value.trimmed().toUtf8();
+            double v = 0;
+            if (gfc::parseRealExact(utf8.constData(), utf8.constData() + utf8.size(), v) && std::isfinite(v)) d.number = v;
+        }
+    });
+
+    // 4) 键与取值驻留
+    QHash<QString, int> keyIds, valueIds;
+    std::vector<int> slotKey(unique.size()), slotValue(unique.size());
+    for (size_t i = 0; i < unique.size(); ++i) {
+        const Decoded& d = decoded[i];
+        auto k = keyIds.constFind(d.key);
+        if (k == keyIds.constEnd()) {
+            k = keyIds.insert(d.key, keyCode_.size());
+            keyCode_ << d.key;
+            keyName_ << d.name;
+        }
+        slotKey[i] = k.value();
+        auto v = valueIds.constFind(d.value);
+        if (v == valueIds.constEnd()) {
+            v = valueIds.insert(d.value, valueText_.size());
+            valueText_ << d.value;
+            valueNumber_ << d.number;
+        }
+        slotValue[i] = v.value();
+    }
+
+    // 5) 按对象行计数排序（稳定，保持出现顺序）
+    QVector<int> start(n + 1, 0);
+    for (const auto& pairs : pairsOf) {
+        for (const Pair& p : pairs) ++start[p.object + 1];
+    }
+    for (int r = 0; r < n; ++r) start[r + 1] += start[r];
+    const int rows = int(pairCount);
+    obj_.resize(rows);
+    prop_.resize(rows);
+    key_.resize(rows);
+    value_.resize(rows);
+    size_t k = 0;
+    for (const auto& pairs : pairsOf) {
+        for (const Pair& p : pairs) {
+            const int at = start[p.object]++;
+            const int slot = slotOfPair[k++];
+            obj_[at] = p.object;
+            prop_[at] = p.slot.leaf;
+            key_[at] = slotKey[size_t(slot)];
+            value_[at] = slotValue[size_t(slot)];
+        }
+    }
+    buildRanks();
+
+    if (stats) {
+        Stats s;
+        s.relations = rels.size();
+        for (int i = 0; i < rows; ++i) {
+            if (i == 0 || obj_[i] != obj_[i - 1]) ++s.objects;
+        }
+        s.properties = int(unique.size());
+        s.rows = rows;
+        s.keys = keyCode_.size();
+        s.values = valueText_.size();
+        s.elapsedMs = timer.elapsed();
+        *stats = s;
+    }
+    PerfTrace::instance().setCounter(QStringLiteral("属性行"), rows);
+    return true;
+}
+
+void GfcPropertyIndex::buildRanks()
+{
+    auto rank = [](int count, auto less) {
+        QVector<int> order(count), ranks(count);
+        for (int i = 0; i < count; ++i) order[i] = i;
+        std::sort(order.begin(), order.end(), less);
+        for (int i = 0; i < count; ++i) ranks[order[i]] = i;
+        return ranks;
+    };
+    keyRank_ = rank(keyCount(), [this](int a, int b) { return keyCode_[a] < keyCode_[b]; });
+    // 数在前按数值，其余按文本
+    valueRank_ = rank(valueCount(), [this](int a, int b) {
+        const double x = valueNumber_[a], y = valueNumber_[b];
+        const bool nx = !std::isnan(x), ny = !std::isnan(y);
+        if (nx != ny) return nx;
+        if (nx && x != y) return x < y;
+        return valueText_[a] < valueText_[b];
+    });
+}
+
+std::pair<int, int> GfcPropertyIndex::rowsOf(int objectRow) const
+{
+    const auto range = std::equal_range(obj_.cbegin(), obj_.cend(), objectRow);
+    return { int(range.first - obj_.cbegin()), int(range.second - obj_.cbegin()) };
+}
+
+QString GfcPropertyIndex::valueOf(int objectRow, const QString& key) const
+{
+    const std::pair<int, int> range = rowsOf(objectRow);
+    for (int r = range.first; r < range.second; ++r) {
+        if (keyCode_[key_[r]].compare(key, Qt::CaseInsensitive) == 0) return valueText_[value_[r]];
+    }
+    return QString();
+}
+
+QString GfcPropertyIndex::cell(int r, Column c) const
+{
+    switch (c) {
+    case Object: return QStringLiteral("#%1").arg(ix_->at(obj_[r]).id);
+    case Class: {
+        const int e = ix_->schemaEntity(ix_->at(obj_[r]).cls);
+        return e >= 0 ? schema_->name(e) : QString::fromLatin1(ix_->className(ix_->at(obj_[r]).cls));
+    }
+    case Key: return keyCode_[key_[r]];
+    case Name: return keyName_[key_[r]];
+    case Value: return valueText_[value_[r]];
+    case ColumnCount: break;
+    }
+    return QString();
+}
+
+QVector<int> GfcPropertyIndex::select(const GfcPropertyFilter& f) const
+{
+    GFC_PERF_SCOPE("属性筛选");
+    const QString key = f.key.trimmed();
+    QVector<quint8> keyOk(keyCount(), key.isEmpty());
+    if (!key.isEmpty()) {
+        for (int k = 0; k < keyCount(); ++k) {
+            keyOk[k] = keyCode_[k].compare(key, Qt::CaseInsensitive) == 0 || keyName_[k].compare(key, Qt::CaseInsensitive) == 0;
+        }
+    }
+    QVector<quint8> valueOk(valueCount(), 1);
+    for (int v = 0; v < valueCount(); ++v) {
+        switch (f.op) {
+        case GfcPropertyFilter::Any: break;
+        case GfcPropertyFilter::Equals: valueOk[v] = valueText_[v] == f.text; break;
+        case GfcPropertyFilter::Contains: valueOk[v] = valueText_[v].contains(f.text, Qt::CaseInsensitive); break;
+        case GfcPropertyFilter::Range: valueOk[v] = valueNumber_[v] >= f.lo && valueNumber_[v] <= f.hi; break;   // NaN 不满足
+        }
+    }
+
+    const int n = rowCount();
+    std::vector<QVector<int>> partsOut(static_cast<size_t>(gfc::maxParts()));
+    gfc::parallelParts(n, gfc::partsFor(n, 65536), [&](int b, int e, int part) {
+        QVector<int>& out = partsOut[size_t(part)];
+        for (int r = b; r < e; ++r) {
+            if (keyOk[key_[r]] && valueOk[value_[r]]) out << r;
+        }
+    });
+    QVector<int> rows;
+    for (const QVector<int>& out : partsOut) rows += out;
+    return rows;
+}
+
+void GfcPropertyIndex::sort(QVector<int>* rows, Column c, bool descending) const
+{
+    GFC_PERF_SCOPE("属性排序");
+    // 各列换成可比较的整数，必要时以行号保证稳定
+    QVector<int> classRank;
+    if (c == Class) {
+        classRank.resize(ix_->classCount());
+        QVector<int> order(ix_->classCount());
+        for (int i = 0; i < order.size(); ++i) order[i] = i;
+        std::sort(order.begin(), order.end(), [this](int a, int b) { return ix_->className(a) < ix_->className(b); });
+        for (int i = 0; i < order.size(); ++i) classRank[order[i]] = i;
+    }
+    auto keyOf = [&](int r) -> qint64 {
+        switch (c) {
+        case Object: return ix_->at(obj_[r]).id;
+        case Class: return classRank[ix_->at(obj_[r]).cls];
+        case Key: case Name: return keyRank_[key_[r]];
+        case Value: return valueRank_[value_[r]];
+        case ColumnCount: break;
+        }
+        return 0;
+    };
+    std::stable_sort(rows->begin(), rows->end(), [&](int a, int b) {
+        const qint64 x = keyOf(a), y = keyOf(b);
+        return descending ? y < x : x < y;
+    });
+}
+
+bool GfcPropertyIndex::writeCsv(const QVector<int>& rows, const QString& path, QString* err) const
+{
+    QByteArray out("\xEF\xBB\xBF");   // BOM，便于表格软件识别 UTF-8
+    out += "id,class,code,name,value\n";
+    for (int r : rows) {
+        QStringList line;
+        for (int c = 0; c < ColumnCount; ++c) line << csvField(cell(r, Column(c)));
+        out += line.join(QLatin1Char(',')).toUtf8() + '\n';
+    }
+    return writeFile(path, out, err);
+}
+
+bool GfcPropertyIndex::writePivotCsv(const QVector<int>& rows, const QString& path, QString* err) const
+{
+    // 列：所选行中出现的键（按键名排序）；行：对象（按首次出现顺序）
+    QVector<int> column(keyCount(), -1);
+    QVector<int> keys;
+    for (int r : rows) {
+        if (column[key_[r]] < 0) {
+            column[key_[r]] = 0;
+            keys << key_[r];
+        }
+    }
+    std::sort(keys.begin(), keys.end(), [this](int a, int b) { return keyRank_[a] < keyRank_[b]; });
+    for (int i = 0; i < keys.size(); ++i) column[keys[i]] = i;
+
+    QHash<int, int> lineOf;
+    QVector<int> objects;
+    QVector<QStringList> cells;
+    for (int r : rows) {
+        auto it = lineOf.constFind(obj_[r]);
+        if (it == lineOf.constEnd()) {
+            it = lineOf.insert(obj_[r], objects.size());
+            objects << r;
+            cells << QStringList();
+            for (int i = 0; i < keys.size(); ++i) cells.last() << QString();
+        }
+        cells[it.value()][column[key_[r]]] = valueText_[value_[r]];
+    }
+
+    QByteArray out("\xEF\xBB\xBF");
+    QStringList header { QStringLiteral("id"), QStringLiteral("class") };
+    for (int k : keys) header << csvField(keyCode_[k]);
+    out += header.join(QLatin1Char(',')).toUtf8() + '\n';
+    for (int i = 0; i < objects.size(); ++i) {
+        QStringList line { cell(objects[i], Object), cell(objects[i], Class) };
+        for (const QString& v : cells[i]) line << csvField(v);
+        out += line.join(QLatin1Char(',')).toUtf8() + '\n';
+    }
+    return writeFile(path, out, err);
+}
@@ -0,0 +1,80 @@
+#pragma once
+#include <QString>
+#include <QVector>
+#include <limits>
+#include <utility>
+
+class CompiledSchema;
+class GfcIndex;
+
+/**
+ * 构件 × 属性透视索引：GfcRelDefinesByProperties(RelatingPropertySet, RelatedObjects)
+ *   → GfcPropertySet.HasProperties → GfcProperty(Name, Code, Extension, 值)。
+ * - 一遍扫描关系实例（分段并行）得到 (对象行, 属性行)；每个属性实例只解码一次（并行），
+ *   键（Code，缺省时用 Name）与取值各自驻留为编号，每行只存四个 int
+ * - 取值：字符串按转义解码（\X2\ 等）；数值、布尔、引用保留原文；列表以逗号连接；能解析为数的另存数值供范围筛选
+ * - GfcComplexProperty 展开为子属性，键为“父键.子键”
+ * - 行按 (对象行, 出现顺序) 排列，rowsOf(对象) 为连续区间，即“对象 → (键 → 值)”
+ * 筛选先在键表、取值表上判定（远小于行数），再并行扫描行的编号列；排序按预先算好的名次比较整数。
+ */
+
+struct GfcPropertyFilter {
+    enum Op { Any, Equals, Contains, Range };
+    QString key;                  // 空为任意；否则与键或属性名相等（不区分大小写）
+    Op op = Any;
+    QString text;                 // Equals：取值全等；Contains：包含（不区分大小写）
+    double lo = -std::numeric_limits<double>::infinity();   // Range：数值在 [lo, hi] 内
+    double hi = std::numeric_limits<double>::infinity();
+};
+
+class GfcPropertyIndex {
+public:
+    enum Column { Object, Class, Key, Name, Value, ColumnCount };
+    struct Stats {
+        int relations = 0;
+        int objects = 0;          // 至少有一个属性的对象
+        int properties = 0;       // 解码的属性实例
+        int rows = 0;
+        int keys = 0;
+        int values = 0;           // 不同取值
+        qint64 elapsedMs = 0;
+    };
+
+    // index 与 schema 需在使用期间有效；Schema 中没有 GfcRelDefinesByProperties 时返回 false
+    bool build(const GfcIndex& index, const CompiledSchema& schema, Stats* stats = nullptr);
+
+    int rowCount() const { return obj_.size(); }
+    int objectRow(int r) const { return obj_[r]; }
+    int propertyRow(int r) const { return prop_[r]; }
+    int key(int r) const { return key_[r]; }
+    int value(int r) const { return value_[r]; }
+
+    int keyCount() const { return keyCode_.size(); }
+    const QString& keyCode(int k) const { return keyCode_[k]; }
+    const QString& keyName(int k) const { return keyName_[k]; }
+    int valueCount() const { return valueText_.size(); }
+    const QString& valueText(int v) const { return valueText_[v]; }
+    double valueNumber(int v) const { return valueNumber_[v]; }   // 不是数时为 NaN
+
+    // 对象的属性行 [first, second)；没有时为空区间
+    std::pair<int, int> rowsOf(int objectRow) const;
+    QString valueOf(int objectRow, const QString& key) const;
+
+    QString cell(int r, Column c) const;
+    QVector<int> select(const GfcPropertyFilter& f) const;          // 行号升序
+    void sort(QVector<int>* rows, Column c, bool descending) const;
+
+    // 长表：每行一条属性；透视表：每个对象一行，所含键各占一列
+    bool writeCsv(const QVector<int>& rows, const QString& path, QString* err = nullptr) const;
+    bool writePivotCsv(const QVector<int>& rows, const QString& path, QString* err = nullptr) const;
+
+private:
+    void buildRanks();
+
+    const GfcIndex* ix_ = nullptr;
+    const CompiledSchema* schema_ = nullptr;
+    QVector<int> obj_, prop_, key_, value_;
+    QVector<QString> keyCode_, keyName_, valueText_;
+    QVector<double> valueNumber_;
+    QVector<int> keyRank_, valueRank_;    // 排序名次
+};
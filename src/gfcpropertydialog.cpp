@@ -0,0 +1,223 @@
+#include "gfcpropertydialog.h"
+
+#include <QAbstractTableModel>
+#include <QApplication>
+#include <QComboBox>
+#include <QDialogButtonBox>
+#include <QElapsedTimer>
+#include <QFileDialog>
+#include <QHBoxLayout>
+#include <QHeaderView>
+#include <QLabel>
+#include <QLineEdit>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QTableView>
+#include <QVBoxLayout>
+#include <algorithm>
+#include <cmath>
+
+// 属性行虚表：只保存筛选后的行号，按需取文本
+class PropertyRowModel : public QAbstractTableModel
+{
+public:
+    explicit PropertyRowModel(const GfcPropertyIndex* props, QObject* parent) : QAbstractTableModel(parent), props_(props) {}
+
+    void setRows(QVector<int> rows)
+    {
+        beginResetModel();
+        rows_ = std::move(rows);
+        endResetModel();
+    }
+    QVector<int>* rows() { return &rows_; }
+    int rowAt(int row) const { return rows_.value(row, -1); }
+
+    // 排序只重排下标，不换模型
+    void sortRows(int column, bool descending)
+    {
+        emit layoutAboutToBeChanged();
+        props_->sort(&rows_, GfcPropertyIndex::Column(column), descending);
+        emit layoutChanged();
+    }
+
+    int rowCount(const QModelIndex& parent = QModelIndex()) const override { return parent.isValid() ? 0 : rows_.size(); }
+    int columnCount(const QModelIndex& parent = QModelIndex()) const override
+    {
+        return parent.isValid() ? 0 : GfcPropertyIndex::ColumnCount;
+    }
+
+    QVariant headerData(int section, Qt::Orientation o, int role) const override
+    {
+        if (o != Qt::Horizontal || role != Qt::DisplayRole) return QVariant();
+        static const char* const kHeaders[] = { "对象", "类", "键", "属性名", "值" };
+        return QString::fromUtf8(kHeaders[section]);
+    }
+
+    QVariant data(const QModelIndex& idx, int role) const override
+    {
+        const int r = rows_[idx.row()];
+        if (role == Qt::TextAlignmentRole && idx.column() == GfcPropertyIndex::Value
+            && !std::isnan(props_->valueNumber(props_->value(r)))) {
+            return int(Qt::AlignRight | Qt::AlignVCenter);
+        }
+        if (role != Qt::DisplayRole) return QVariant();
+        return props_->cell(r, GfcPropertyIndex::Column(idx.column()));
+    }
+
+private:
+    const GfcPropertyIndex* props_;
+    QVector<int> rows_;
+};
+
+GfcPropertyDialog::GfcPropertyDialog(QSharedPointer<GfcIndex> index, QSharedPointer<CompiledSchema> schema,
+                                     QSharedPointer<GfcPropertyIndex> props, const QString& summary, QWidget* parent)
+    : QDialog(parent), index_(std::move(index)), schema_(std::move(schema)), props_(std::move(props))
+{
+    setWindowTitle(QStringLiteral("属性透视表"));
+    setAttribute(Qt::WA_DeleteOnClose);
+    resize(1000, 680);
+
+    auto* summaryLabel = new QLabel(summary, this);
+    summaryLabel->setWordWrap(true);
+
+    // 键：空为全部；下拉为键表（按 Code 排序），也可直接输入 Code 或属性名
+    keyBox_ = new QComboBox(this);
+    keyBox_->setEditable(true);
+    keyBox_->setInsertPolicy(QComboBox::NoInsert);
+    keyBox_->setMinimumContentsLength(20);
+    QVector<int> keys(props_->keyCount());
+    for (int k = 0; k < keys.size(); ++k) keys[k] = k;
+    std::sort(keys.begin(), keys.end(), [this](int a, int b) { return props_->keyCode(a) < props_->keyCode(b); });
+    keyBox_->addItem(QString());
+    for (int k : keys) {
+        const QString& code = props_->keyCode(k);
+        const QString& name = props_->keyName(k);
+        keyBox_->addItem(code == name ? code : QStringLiteral("%1（%2）").arg(code, name), code);
+    }
+
+    opBox_ = new QComboBox(this);
+    opBox_->addItem(QStringLiteral("任意"), int(GfcPropertyFilter::Any));
+    opBox_->addItem(QStringLiteral("等于"), int(GfcPropertyFilter::Equals));
+    opBox_->addItem(QStringLiteral("包含"), int(GfcPropertyFilter::Contains));
+    opBox_->addItem(QStringLiteral("范围"), int(GfcPropertyFilter::Range));
+    textEdit_ = new QLineEdit(this);
+    textEdit_->setPlaceholderText(QStringLiteral("值"));
+    loEdit_ = new QLineEdit(this);
+    loEdit_->setPlaceholderText(QStringLiteral("下限"));
+    hiEdit_ = new QLineEdit(this);
+    hiEdit_->setPlaceholderText(QStringLiteral("上限"));
+    auto* applyBtn = new QPushButton(QStringLiteral("筛选"), this);
+    applyBtn->setDefault(true);
+    countLabel_ = new QLabel(this);
+
+    auto* filterRow = new QHBoxLayout;
+    filterRow->addWidget(new QLabel(QStringLiteral("键"), this));
+    filterRow->addWidget(keyBox_, 1);
+    filterRow->addWidget(opBox_);
+    filterRow->addWidget(textEdit_, 1);
+    filterRow->addWidget(loEdit_);
+    filterRow->addWidget(hiEdit_);
+    filterRow->addWidget(applyBtn);
+
+    model_ = new PropertyRowModel(props_.data(), this);
+    view_ = new QTableView(this);
+    view_->setModel(model_);
+    view_->setSelectionBehavior(QAbstractItemView::SelectRows);
+    view_->setSelectionMode(QAbstractItemView::SingleSelection);
+    view_->verticalHeader()->setVisible(false);
+    view_->verticalHeader()->setDefaultSectionSize(fontMetrics().height() + 4);
+    view_->horizontalHeader()->setStretchLastSection(true);
+    view_->horizontalHeader()->setSortIndicatorShown(true);
+    view_->horizontalHeader()->setSectionsClickable(true);
+    view_->horizontalHeader()->setSortIndicator(-1, Qt::AscendingOrder);
+
+    auto* buttons = new QDialogButtonBox(this);
+    auto* csvBtn = buttons->addButton(QStringLiteral("导出 CSV ..."), QDialogButtonBox::ActionRole);
+    auto* pivotBtn = buttons->addButton(QStringLiteral("导出透视表 CSV ..."), QDialogButtonBox::ActionRole);
+    buttons->addButton(QDialogButtonBox::Close);
+
+    auto* bottomRow = new QHBoxLayout;
+    bottomRow->addWidget(countLabel_, 1);
+    bottomRow->addWidget(buttons);
+    auto* lay = new QVBoxLayout(this);
+    lay->addWidget(summaryLabel);
+    lay->addLayout(filterRow);
+    lay->addWidget(view_, 1);
+    lay->addLayout(bottomRow);
+
+    auto updateInputs = [this]() {
+        const int op = opBox_->currentData().toInt();
+        textEdit_->setEnabled(op == GfcPropertyFilter::Equals || op == GfcPropertyFilter::Contains);
+        loEdit_->setEnabled(op == GfcPropertyFilter::Range);
+        hiEdit_->setEnabled(op == GfcPropertyFilter::Range);
+    };
+    connect(opBox_, QOverload<int>::of(&QComboBox::currentIndexChanged), this, updateInputs);
+    connect(applyBtn, &QPushButton::clicked, this, &GfcPropertyDialog::applyFilter);
+    connect(textEdit_, &QLineEdit::returnPressed, this, &GfcPropertyDialog::applyFilter);
+    connect(view_->horizontalHeader(), &QHeaderView::sortIndicatorChanged, this, &GfcPropertyDialog::sortBy);
+    connect(csvBtn, &QPushButton::clicked, this, [this]() { exportCsv(false); });
+    connect(pivotBtn, &QPushButton::clicked, this, [this]() { exportCsv(true); });
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+    connect(view_, &QTableView::doubleClicked, this, [this](const QModelIndex& idx) {
+        const int r = model_->rowAt(idx.row());
+        if (r >= 0) emit instanceActivated(index_->at(props_->objectRow(r)).id);
+    });
+
+    updateInputs();
+    applyFilter();
+}
+
+void GfcPropertyDialog::applyFilter()
+{
+    GfcPropertyFilter f;
+    const int i = keyBox_->currentIndex();
+    // 选中下拉项时取其 Code；手工输入的文本与下拉项显示不符时按输入匹配
+    f.key = i > 0 && keyBox_->itemText(i) == keyBox_->currentText() ? keyBox_->itemData(i).toString()
+                                                                      : keyBox_->currentText().trimmed();
+    f.op = GfcPropertyFilter::Op(opBox_->currentData().toInt());
+    f.text = textEdit_->text();
+    if (f.op == GfcPropertyFilter::Range) {
+        bool ok = true;
+        if (!loEdit_->text().trimmed().isEmpty()) f.lo = loEdit_->text().trimmed().toDouble(&ok);
+        if (ok && !hiEdit_->text().trimmed().isEmpty()) f.hi = hiEdit_->text().trimmed().toDouble(&ok);
+        if (!ok) {
+            QMessageBox::warning(this, QStringLiteral("属性透视表"), QStringLiteral("范围的上下限须为数值"));
+            return;
+        }
+    }
+
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    QElapsedTimer timer;
+    timer.start();
+    QVector<int> rows = props_->select(f);
+    const QHeaderView* header = view_->horizontalHeader();
+    if (header->sortIndicatorSection() >= 0) {
+        props_->sort(&rows, GfcPropertyIndex::Column(header->sortIndicatorSection()),
+                     header->sortIndicatorOrder() == Qt::DescendingOrder);
+    }
+    model_->setRows(std::move(rows));
+    QApplication::restoreOverrideCursor();
+    countLabel_->setText(QStringLiteral("%1 / %2 行，用时 %3 ms")
+        .arg(model_->rowCount()).arg(props_->rowCount()).arg(timer.elapsed()));
+}
+
+void GfcPropertyDialog::sortBy(int column, Qt::SortOrder order)
+{
+    if (column < 0) return;
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    model_->sortRows(column, order == Qt::DescendingOrder);
+    QApplication::restoreOverrideCursor();
+}
+
+void GfcPropertyDialog::exportCsv(bool pivot)
+{
+    const QString title = pivot ? QStringLiteral("导出透视表 CSV") : QStringLiteral("导出 CSV");
+    const QString path = QFileDialog::getSaveFileName(this, title, QString(), QStringLiteral("CSV 文件 (*.csv)"));
+    if (path.isEmpty()) return;
+    QString err;
+    QApplication::setOverrideCursor(Qt::WaitCursor);
+    const bool ok = pivot ? props_->writePivotCsv(*model_->rows(), path, &err)
+                          : props_->writeCsv(*model_->rows(), path, &err);
+    QApplication::restoreOverrideCursor();
+    if (!ok) QMessageBox::warning(this, title, err);
+}
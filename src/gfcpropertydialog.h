@@ -0,0 +1,50 @@
+#pragma once
+#include <QDialog>
+#include <QSharedPointer>
+
+#include "gfcindex.h"
+#include "gfcproperties.h"
+#include "schemacache.h"
+
+class QComboBox;
+class QLabel;
+class QLineEdit;
+class QTableView;
+class PropertyRowModel;
+
+/**
+ * 属性透视表窗口（非模态）：
+ * - 上方：键（Code 或属性名，可下拉选择或输入）+ 条件（任意/等于/包含/范围）→ 筛选
+ * - 中间：对象/类/键/属性名/值 虚表，点击表头按该列排序（百万行也只排下标）
+ * - 下方：导出长表 CSV 或透视表 CSV（每对象一行、每键一列），均只导出当前筛选结果
+ * 双击行时发出 instanceActivated（对象 #id）。
+ */
+
+class GfcPropertyDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    // 三者共同持有：主窗口重新解析或换 Schema 后窗口仍可用
+    GfcPropertyDialog(QSharedPointer<GfcIndex> index, QSharedPointer<CompiledSchema> schema,
+                      QSharedPointer<GfcPropertyIndex> props, const QString& summary, QWidget* parent = nullptr);
+
+signals:
+    void instanceActivated(qint64 id);
+
+private:
+    void applyFilter();
+    void sortBy(int column, Qt::SortOrder order);
+    void exportCsv(bool pivot);
+
+    QSharedPointer<GfcIndex> index_;
+    QSharedPointer<CompiledSchema> schema_;
+    QSharedPointer<GfcPropertyIndex> props_;
+    QComboBox* keyBox_ = nullptr;
+    QComboBox* opBox_ = nullptr;
+    QLineEdit* textEdit_ = nullptr;
+    QLineEdit* loEdit_ = nullptr;
+    QLineEdit* hiEdit_ = nullptr;
+    QLabel* countLabel_ = nullptr;
+    QTableView* view_ = nullptr;
+    PropertyRowModel* model_ = nullptr;
+};
@@ -0,0 +1,115 @@
+#include "gfcpurge.h"
+#include "gfcindex.h"
+#include "gfcparallel.h"
+#include "perftrace.h"
+#include "schemacache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <vector>
+
+QStringList GfcPurge::defaultRoots()
+{
+    return { QStringLiteral("GfcProject"), QStringLiteral("GfcRelationShip") };
+}
+
+void GfcPurge::mark(GfcIndex& ix, const CompiledSchema& schema, const QStringList& rootClasses,
+                    Plan* plan, QStringList* unknownRoots)
+{
+    GFC_PERF_SCOPE("可达性标记");
+    if (!ix.hasRefs()) ix.buildRefs();
+    const int n = ix.size();
+
+    QVector<int> rootEntities;
+    for (const QString& name : rootClasses) {
+        const int e = schema.find(name.trimmed());
+        if (e >= 0) rootEntities << e;
+        else if (unknownRoots) *unknownRoots << name.trimmed();
+    }
+    QVector<quint8> rootClass(ix.classCount(), 0);
+    for (int c = 0; c < ix.classCount(); ++c) {
+        const int e = ix.schemaEntity(c);
+        if (e < 0) { rootClass[c] = 1; continue; }
+        for (int r : rootEntities) {
+            if (schema.isSubtypeOf(e, r)) { rootClass[c] = 1; break; }
+        }
+    }
+
+    std::vector<std::atomic<quint8>> marked(static_cast<size_t>(n));
+    QVector<int> frontier;
+    for (int r = 0; r < n; ++r) {
+        if (rootClass[ix.at(r).cls]) {
+            marked[size_t(r)].store(1, std::memory_order_relaxed);
+            frontier << r;
+        }
+    }
+    plan->roots = frontier.size();
+
+    // 逐层扩展：本层各段并行，认领到的下一层实例各段分别收集
+    while (!frontier.isEmpty()) {
+        const int m = frontier.size();
+        const int used = m < 4096 ? 1 : gfc::maxParts();
+        QVector<QVector<int>> next(used);
+        gfc::parallelParts(m, used, [&](int b, int e, int part) {
+            QVector<int>& out = next[part];
+            for (int i = b; i < e; ++i) {
+                const int r = frontier[i];
+                for (int k = 0, kn = ix.refCount(r); k < kn; ++k) {
+                    const int t = ix.ref(r, k);
+                    if (marked[size_t(t)].load(std::memory_order_relaxed)) continue;
+                    if (marked[size_t(t)].exchange(1, std::memory_order_relaxed) == 0) out << t;
+                }
+            }
+        });
+
+        frontier.clear();
+        for (const QVector<int>& v : next) frontier += v;
+    }
+
+    // 汇总
+    plan->keep.resize(n);
+    plan->removed = 0;
+    plan->bytes = 0;
+    QVector<ClassStat> stats(ix.classCount());
+    for (int c = 0; c < ix.classCount(); ++c) stats[c].name = ix.className(c);
+    for (int r = 0; r < n; ++r) {
+        const bool keep = marked[size_t(r)].load(std::memory_order_relaxed) != 0;
+        plan->keep[r] = keep ? 1 : 0;
+        ClassStat& cs = stats[ix.at(r).cls];
+        ++cs.total;
+        if (keep) continue;
+        const qint64 bytes = ix.spanEnd(r) - ix.at(r).begin;
+        ++cs.removed;
+        cs.bytes += bytes;
+        ++plan->removed;
+        plan->bytes += bytes;
+    }
+    plan->classes.clear();
+    for (const ClassStat& cs : stats) {
+        if (cs.removed) plan->classes << cs;
+    }
+    std::sort(plan->classes.begin(), plan->classes.end(),
+              [](const ClassStat& a, const ClassStat& b) { return a.removed > b.removed; });
+    PerfTrace::instance().setCounter(QStringLiteral("不可达实例"), plan->removed);
+}
+
+QByteArray GfcPurge::apply(const GfcIndex& ix, const QVector<quint8>& keep)
+{
+    GFC_PERF_SCOPE("删除实例");
+    const QByteArray& data = ix.data();
+    const char* base = data.constData();
+    QByteArray out;
+    out.reserve(data.size());
+    out.append(base, int(ix.headerEnd()));
+    int last = ix.size() - 1;
+    while (last >= 0 && !keep[last]) --last;
+    for (int r = 0; r <= last; ++r) {
+        if (!keep[r]) continue;
+        const qint64 b = ix.at(r).begin;
+        // 保留的最后一个实例到 ';' 为止，其后直接接原结尾段
+        const qint64 e = r == last ? ix.at(r).end : ix.spanEnd(r);
+        out.append(base + b, int(e - b));
+    }
+    out.append(base + ix.trailerBegin(), int(data.size() - ix.trailerBegin()));
+    return out;
+}
@@ -0,0 +1,43 @@
+#pragma once
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+
+class CompiledSchema;
+class GfcIndex;
+
+/**
+ * 清除不可达实例（按可达性回收）：
+ * - 根：指定根类（含子类）的全部实例；默认 GfcProject 与所有关系实体（GfcRelationShip）。
+ *   Schema 中没有的类一律视为根（不认识就不删）
+ * - 标记：沿引用图逐层并行扩展，原子置位认领，每层各线程各自收集下一层
+ * - 未标记的实例即可删除；按类统计实例数与字节数，供预览后一次性删除
+ */
+
+class GfcPurge {
+public:
+    struct ClassStat {
+        QByteArray name;       // 大写类名
+        int total = 0;
+        int removed = 0;
+        qint64 bytes = 0;      // 删除的字节（含实例后的换行）
+    };
+
+    struct Plan {
+        QVector<quint8> keep;            // 按行：1 保留
+        QVector<ClassStat> classes;      // 仅含有删除的类，按删除数降序
+        int roots = 0;
+        int removed = 0;
+        qint64 bytes = 0;
+    };
+
+    static QStringList defaultRoots();
+
+    // 根类名不区分大小写；找不到的根类名放入 unknownRoots（可空）
+    static void mark(GfcIndex& index, const CompiledSchema& schema, const QStringList& rootClasses,
+                     Plan* plan, QStringList* unknownRoots = nullptr);
+
+    // 删除 keep=0 的实例（连同其后的换行/注释）后的完整文本；HEADER 与结尾原样保留
+    static QByteArray apply(const GfcIndex& index, const QVector<quint8>& keep);
+};
@@ -0,0 +1,439 @@
+#include "gfcquantity.h"
+#include "gfcexportcommon.h"
+#include "gfcindex.h"
+#include "gfcnumber.h"
+#include "gfcparallel.h"
+#include "gfctyped.h"
+#include "perftrace.h"
+#include "schemacache.h"
+
+#include <QElapsedTimer>
+#include <QHash>
+#include <QPair>
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace {
+
+// 顶层参数值逐个放入 out，超出 out 长度的不取；返回放入的个数
+int splitValues(std::string_view s, std::vector<std::string_view>& out)
+{
+    int n = 0;
+    gfc::forEachValue(s, [&](std::string_view v) {
+        if (n < int(out.size())) out[size_t(n++)] = v;
+    });
+    return n;
+}
+
+// 类型值 GFCDOUBLE(3.) 取内值
+std::string_view unwrap(std::string_view v)
+{
+    std::string_view inner;
+    return gfc::typedInner(v, &inner) ? gfc::trim(inner) : v;
+}
+
+bool textOf(std::string_view v, std::string& out)
+{
+    v = unwrap(v);
+    out.clear();
+    if (v.empty() || v[0] != '\'') return false;
+    gfc::ArgReader r(v);
+    return r.readString(out);
+}
+
+// 数值：实数、整数或内容为数值的字符串（Quantity 为 GfcString）
+bool numberOf(std::string_view v, double& d, std::string& tmp)
+{
+    v = unwrap(v);
+    if (!v.empty() && v[0] == '\'') {
+        if (!textOf(v, tmp)) return false;
+        v = gfc::trim(tmp);
+    }
+    return gfc::parseRealExact(v.data(), v.data() + v.size(), d) && std::isfinite(d);
+}
+
+bool integerOf(std::string_view v, qint64& n, std::string& tmp)
+{
+    double d = 0;
+    if (!numberOf(v, d, tmp)) return false;
+    n = qint64(std::llround(d));
+    return true;
+}
+
+QString qstr(const std::string& s)
+{
+    return QString::fromUtf8(s.data(), int(s.size()));
+}
+
+enum Role : quint8 { None, QuotaDetail, QuotaTotal, BillDetail, BillTotal, SteelDetail, SteelTotal };
+
+// 文件类 → 角色与所需属性的参数位置
+struct ClassInfo {
+    Role role = None;
+    int slot[8] = { -1, -1, -1, -1, -1, -1, -1, -1 };
+};
+
+// 汇总的单位换算为 kg
+double weightScale(const QString& unit)
+{
+    const QString u = unit.trimmed();
+    if (u.compare(QLatin1String("t"), Qt::CaseInsensitive) == 0 || u == QStringLiteral("吨")) return 1000.0;
+    return 1.0;
+}
+
+} // namespace
+
+bool GfcQuantityGroup::matches(double tolerance) const
+{
+    return hasTotal && std::fabs(quantity - total) <= tolerance * qMax(1.0, std::fabs(total));
+}
+
+bool GfcQuantityReport::compute(const GfcIndex& ix, const CompiledSchema& schema, Result* result,
+                                const Options& opt, QString* err)
+{
+    GFC_PERF_SCOPE("工程量汇总");
+    QElapsedTimer timer;
+    timer.start();
+
+    struct Spec {
+        Role role;
+        const char* entity;
+        QVector<const char*> attrs;
+    };
+    const Spec specs[] = {
+        { QuotaDetail, "GfcQuotaDetail", { "FloorNum", "Quantity" } },
+        { QuotaTotal, "GfcQuotaTotal", { "Code", "SubCode", "Name", "Content", "Unit", "Quantity" } },
+        { BillDetail, "GfcBillDetail", { "FloorNum", "Quantity" } },
+        { BillTotal, "GfcBillTotal", { "Code", "Name", "Attr", "Unit", "Quantity" } },
+        { SteelDetail, "GfcSteelDetail", { "Level", "Dia", "Num", "BarLength", "SingleWeight", "TotalWeight" } },
+        { SteelTotal, "GfcSteelTotal", { "Level", "Dia", "Weight", "Unit" } },
+    };
+    QVector<ClassInfo> info(ix.classCount());
+    bool any = false;
+    for (const Spec& s : specs) {
+        const int base = schema.find(QString::fromLatin1(s.entity));
+        if (base < 0) continue;
+        any = true;
+        for (int c = 0; c < ix.classCount(); ++c) {
+            const int e = ix.schemaEntity(c);
+            if (e < 0 || !schema.isSubtypeOf(e, base)) continue;
+            info[c].role = s.role;
+            for (int k = 0; k < s.attrs.size(); ++k) info[c].slot[k] = schema.attributeIndex(e, QString::fromLatin1(s.attrs[k]));
+        }
+    }
+    if (!any) {
+        if (err) *err = QStringLiteral("Schema 中没有工程量实体（GfcQuotaDetail / GfcBillDetail / GfcSteelDetail）");
+        return false;
+    }
+    // 参数值缓冲：按涉及实体的最多属性数（含继承属性）
+    size_t width = 1;
+    for (int c = 0; c < ix.classCount(); ++c) {
+        if (info[c].role != None) width = qMax(width, size_t(schema.attributeCount(ix.schemaEntity(c))));
+    }
+
+    // 一遍按文件顺序：汇总建组，明细归属最近的同类汇总（之前没有汇总的归入该类的“无汇总”组）
+    Result res;
+    QVector<int> detailRows, detailGroup, steelRows, steelTotalRows;
+    int current[2] = { -1, -1 }, orphan[2] = { -1, -1 };
+    for (int r = 0; r < ix.size(); ++r) {
+        const Role role = info[ix.at(r).cls].role;
+        if (role == None) continue;
+        if (role == QuotaTotal || role == BillTotal) {
+            const int k = role == QuotaTotal ? 0 : 1;
+            GfcQuantityGroup g;
+            g.kind = k == 0 ? GfcQuantityGroup::Quota : GfcQuantityGroup::Bill;
+            g.totalRow = r;
+            current[k] = res.groups.size();
+            res.groups << g;
+            ++res.totals;
+        }
+        else if (role == QuotaDetail || role == BillDetail) {
+            const int k = role == QuotaDetail ? 0 : 1;
+            if (current[k] < 0) {
+                if (orphan[k] < 0) {
+                    GfcQuantityGroup g;
+                    g.kind = k == 0 ? GfcQuantityGroup::Quota : GfcQuantityGroup::Bill;
+                    orphan[k] = res.groups.size();
+                    res.groups << g;
+                }
+                current[k] = orphan[k];
+            }
+            detailRows << r;
+            detailGroup << current[k];
+        }
+        else if (role == SteelDetail) {
+            steelRows << r;
+        }
+        else {
+            steelTotalRows << r;
+            ++res.totals;
+        }
+    }
+    res.details = detailRows.size() + steelRows.size();
+
+    // 汇总：编码、名称、单位与量
+    std::string tmp;
+    std::vector<std::string_view> v(width);
+    for (GfcQuantityGroup& g : res.groups) {
+        if (g.totalRow < 0) continue;
+        const ClassInfo& ci = info[ix.at(g.totalRow).cls];
+        const int n = splitValues(ix.args(g.totalRow), v);
+        auto text = [&](int k) {
+            const int s = ci.slot[k];
+            return s >= 0 && s < n && textOf(v[s], tmp) ? qstr(tmp) : QString();
+        };
+        auto number = [&](int k, double& d) {
+            const int s = ci.slot[k];
+            return s >= 0 && s < n && numberOf(v[s], d, tmp);
+        };
+        if (ci.role == QuotaTotal) {
+            g.code = text(0);
+            g.subCode = text(1);
+            g.name = text(2);
+            g.description = text(3);
+            g.unit = text(4);
+            g.hasTotal = number(5, g.total);
+        }
+        else {
+            g.code = text(0);
+            g.name = text(1);
+            g.description = text(2);
+            g.unit = text(3);
+            g.hasTotal = number(4, g.total);
+        }
+    }
+
+    // 定额/清单明细：并行解码为列（楼层、数量、是否数值）
+    const int nd = detailRows.size();
+    QVector<qint64> floorOf(nd, 0);
+    QVector<double> qtyOf(nd, 0);
+    QVector<quint8> validOf(nd, 0);
+    gfc::parallelParts(nd, gfc::partsFor(nd), [&](int b, int e, int) {
+        std::string t;
+        std::vector<std::string_view> v(width);
+        for (int i = b; i < e; ++i) {
+            const int r = detailRows[i];
+            const ClassInfo& ci = info[ix.at(r).cls];
+            const int n = splitValues(ix.args(r), v);
+            if (ci.slot[0] >= 0 && ci.slot[0] < n) integerOf(v[ci.slot[0]], floorOf[i], t);
+            validOf[i] = ci.slot[1] >= 0 && ci.slot[1] < n && numberOf(v[ci.slot[1]], qtyOf[i], t);
+        }
+    });
+
+    // 分段累加：每段各自的组数组与（组, 楼层）表，最后合并
+    struct FloorAcc {
+        int details = 0;
+        double quantity = 0;
+    };
+    using FloorKey = QPair<int, qint64>;
+    const int groups = res.groups.size();
+    const int dparts = gfc::partsFor(nd);
+    QVector<QVector<double>> sumOf(dparts, QVector<double>(groups, 0));
+    QVector<QVector<int>> countOf(dparts, QVector<int>(groups, 0)), badOf(dparts, QVector<int>(groups, 0));
+    QVector<QHash<FloorKey, FloorAcc>> floorsOf(dparts);
+    gfc::parallelParts(nd, dparts, [&](int b, int e, int part) {
+        double* sum = sumOf[part].data();
+        int* count = countOf[part].data();
+        int* bad = badOf[part].data();
+        QHash<FloorKey, FloorAcc>& floors = floorsOf[part];
+        for (int i = b; i < e; ++i) {
+            const int g = detailGroup[i];
+            const double q = validOf[i] ? qtyOf[i] : 0.0;
+            sum[g] += q;
+            ++count[g];
+            bad[g] += 1 - validOf[i];
+            FloorAcc& f = floors[FloorKey(g, floorOf[i])];
+            ++f.details;
+            f.quantity += q;
+        }
+    });
+    QHash<FloorKey, FloorAcc> floors;
+    for (int p = 0; p < dparts; ++p) {
+        for (int g = 0; g < groups; ++g) {
+            res.groups[g].quantity += sumOf[p][g];
+            res.groups[g].details += countOf[p][g];
+            res.groups[g].unparsed += badOf[p][g];
+        }
+        for (auto it = floorsOf[p].constBegin(); it != floorsOf[p].constEnd(); ++it) {
+            FloorAcc& f = floors[it.key()];
+            f.details += it.value().details;
+            f.quantity += it.value().quantity;
+        }
+    }
+    for (auto it = floors.constBegin(); it != floors.constEnd(); ++it) {
+        GfcQuantityFloor f;
+        f.group = it.key().first;
+        f.floor = it.key().second;
+        f.details = it.value().details;
+        f.quantity = it.value().quantity;
+        res.floors << f;
+    }
+    std::sort(res.floors.begin(), res.floors.end(), [](const GfcQuantityFloor& a, const GfcQuantityFloor& b) {
+        return a.group != b.group ? a.group < b.group : a.floor < b.floor;
+    });
+
+    // 钢筋明细：并行解码为列，再按（级别, 直径）编组
+    const int ns = steelRows.size();
+    QVector<QString> levelOf(ns);
+    QVector<qint64> diaOf(ns, 0), numOf(ns, 0);
+    QVector<double> lengthOf(ns, 0), singleOf(ns, 0), weightOf(ns, 0);
+    QVector<quint8> steelBad(ns, 0);
+    gfc::parallelParts(ns, gfc::partsFor(ns), [&](int b, int e, int) {
+        std::string t;
+        std::vector<std::string_view> v(width);
+        for (int i = b; i < e; ++i) {
+            const int r = steelRows[i];
+            const ClassInfo& ci = info[ix.at(r).cls];
+            const int n = splitValues(ix.args(r), v);
+            auto has = [&](int k) { return ci.slot[k] >= 0 && ci.slot[k] < n; };
+            if (has(0) && textOf(v[ci.slot[0]], t)) levelOf[i] = qstr(t);
+            if (has(1)) integerOf(v[ci.slot[1]], diaOf[i], t);
+            if (has(2)) integerOf(v[ci.slot[2]], numOf[i], t);
+            if (has(3)) numberOf(v[ci.slot[3]], lengthOf[i], t);
+            if (has(4)) numberOf(v[ci.slot[4]], singleOf[i], t);
+            const bool weight = has(5) && numberOf(v[ci.slot[5]], weightOf[i], t);
+            steelBad[i] = !weight;
+            lengthOf[i] *= double(numOf[i]);
+        }
+    });
+
+    using SteelKey = QPair<QString, qint64>;
+    QHash<SteelKey, int> steelGroup;
+    const int steelBase = res.groups.size();
+    auto steelGroupOf = [&](const QString& level, qint64 dia) {
+        auto it = steelGroup.constFind(SteelKey(level, dia));
+        if (it != steelGroup.constEnd()) return it.value();
+        GfcQuantityGroup g;
+        g.kind = GfcQuantityGroup::Steel;
+        g.code = level;
+        g.dia = dia;
+        g.unit = QStringLiteral("kg");
+        const int id = res.groups.size();
+        res.groups << g;
+        steelGroup.insert(SteelKey(level, dia), id);
+        return id;
+    };
+    QVector<int> steelGroupOfRow(ns);
+    for (int i = 0; i < ns; ++i) steelGroupOfRow[i] = steelGroupOf(levelOf[i], diaOf[i]) - steelBase;
+
+    const int sg = res.groups.size() - steelBase;
+    const int sparts = gfc::partsFor(ns);
+    struct SteelAcc {
+        int details = 0, unparsed = 0, inconsistent = 0;
+        qint64 bars = 0;
+        double length = 0, weight = 0;
+    };
+    QVector<QVector<SteelAcc>> steelOf(sparts, QVector<SteelAcc>(sg));
+    gfc::parallelParts(ns, sparts, [&](int b, int e, int part) {
+        SteelAcc* acc = steelOf[part].data();
+        for (int i = b; i < e; ++i) {
+            SteelAcc& a = acc[steelGroupOfRow[i]];
+            ++a.details;
+            a.unparsed += steelBad[i];
+            a.bars += numOf[i];
+            a.length += lengthOf[i];
+            a.weight += weightOf[i];
+            const double expect = singleOf[i] * double(numOf[i]);
+            a.inconsistent += !steelBad[i] && std::fabs(weightOf[i] - expect) > opt.tolerance * qMax(1.0, std::fabs(expect));
+        }
+    });
+    for (int p = 0; p < sparts; ++p) {
+        for (int k = 0; k < sg; ++k) {
+            GfcQuantityGroup& g = res.groups[steelBase + k];
+            const SteelAcc& a = steelOf[p][k];
+            g.details += a.details;
+            g.unparsed += a.unparsed;
+            g.inconsistent += a.inconsistent;
+            g.bars += a.bars;
+            g.barLength += a.length;
+            g.quantity += a.weight;
+        }
+    }
+
+    // 钢筋汇总：同级别同直径的 Weight 合计（没有明细的汇总也单列一组）
+    for (int r : steelTotalRows) {
+        const ClassInfo& ci = info[ix.at(r).cls];
+        const int n = splitValues(ix.args(r), v);
+        auto has = [&](int k) { return ci.slot[k] >= 0 && ci.slot[k] < n; };
+        QString level, unit;
+        qint64 dia = 0;
+        double weight = 0;
+        if (has(0) && textOf(v[ci.slot[0]], tmp)) level = qstr(tmp);
+        if (has(1)) integerOf(v[ci.slot[1]], dia, tmp);
+        if (has(3) && textOf(v[ci.slot[3]], tmp)) unit = qstr(tmp);
+        if (!has(2) || !numberOf(v[ci.slot[2]], weight, tmp)) continue;
+        GfcQuantityGroup& g = res.groups[steelGroupOf(level, dia)];
+        if (g.totalRow < 0) g.totalRow = r;
+        g.hasTotal = true;
+        g.total += weight * weightScale(unit);
+    }
+    std::sort(res.groups.begin() + steelBase, res.groups.end(), [](const GfcQuantityGroup& a, const GfcQuantityGroup& b) {
+        return a.code != b.code ? a.code < b.code : a.dia < b.dia;
+    });
+
+    for (const GfcQuantityGroup& g : res.groups) res.mismatches += !g.matches(opt.tolerance);
+    res.elapsedMs = timer.elapsed();
+    *result = res;
+    PerfTrace::instance().setCounter(QStringLiteral("工程量明细"), res.details);
+    return true;
+}
+
+QStringList GfcQuantityReport::headers()
+{
+    return { QStringLiteral("类别"), QStringLiteral("编码/级别"), QStringLiteral("子目"), QStringLiteral("名称"),
+             QStringLiteral("说明"), QStringLiteral("楼层"), QStringLiteral("直径"), QStringLiteral("单位"),
+             QStringLiteral("明细"), QStringLiteral("根数"), QStringLiteral("总长"), QStringLiteral("明细合计"),
+             QStringLiteral("汇总"), QStringLiteral("差值"), QStringLiteral("核对") };
+}
+
+QVector<QVariantList> GfcQuantityReport::rows(const Result& res, const Options& opt)
+{
+    static const QString kKind[] = { QStringLiteral("定额"), QStringLiteral("清单"), QStringLiteral("钢筋") };
+    QVector<QVariantList> out;
+    int f = 0;
+    for (int i = 0; i < res.groups.size(); ++i) {
+        const GfcQuantityGroup& g = res.groups[i];
+        const bool steel = g.kind == GfcQuantityGroup::Steel;
+        QString check;
+        if (!g.hasTotal) check = QStringLiteral("无汇总");
+        else check = g.matches(opt.tolerance) ? QStringLiteral("一致") : QStringLiteral("不符");
+        if (g.unparsed) check += QStringLiteral("；%1 条数量非数值").arg(g.unparsed);
+        if (g.inconsistent) check += QStringLiteral("；%1 条总重≠根数×单重").arg(g.inconsistent);
+        out << QVariantList{ kKind[g.kind], g.code, g.subCode, g.name, g.description, QStringLiteral("全部"),
+                             steel ? QVariant(g.dia) : QVariant(), g.unit, g.details,
+                             steel ? QVariant(g.bars) : QVariant(), steel ? QVariant(g.barLength) : QVariant(),
+                             g.quantity, g.hasTotal ? QVariant(g.total) : QVariant(),
+                             g.hasTotal ? QVariant(g.quantity - g.total) : QVariant(), check };
+        for (; f < res.floors.size() && res.floors[f].group == i; ++f) {
+            const GfcQuantityFloor& fl = res.floors[f];
+            out << QVariantList{ kKind[g.kind], g.code, g.subCode, g.name, g.description, fl.floor, QVariant(), g.unit,
+                                 fl.details, QVariant(), QVariant(), fl.quantity, QVariant(), QVariant(), QString() };
+        }
+    }
+    return out;
+}
+
+QByteArray GfcQuantityReport::toCsv(const Result& res, const Options& opt)
+{
+    auto cell = [](const QVariant& v) {
+        if (!v.isValid()) return QByteArray();
+        if (v.userType() == QMetaType::Double) return QByteArray::number(v.toDouble(), 'g', 12);
+        const QByteArray s = v.toString().toUtf8();
+        QByteArray out;
+        gfc::appendCsvText(std::string_view(s.constData(), size_t(s.size())), out);
+        return out;
+    };
+    QByteArray csv("\xEF\xBB\xBF");
+    csv += headers().join(QLatin1Char(',')).toUtf8() + '\n';
+    for (const QVariantList& row : rows(res, opt)) {
+        for (int c = 0; c < row.size(); ++c) {
+            if (c) csv += ',';
+            csv += cell(row[c]);
+        }
+        csv += '\n';
+    }
+    return csv;
+}
@@ -0,0 +1,72 @@
+#pragma once
+#include <QString>
+#include <QStringList>
+#include <QVariantList>
+#include <QVector>
+
+class CompiledSchema;
+class GfcIndex;
+
+/**
+ * 工程量汇总与核对（GfcQuotaDetail / GfcBillDetail / GfcSteelDetail）：
+ * - 定额、清单：明细归属于文件中位于其前的最近一个同类汇总（GfcQuotaTotal / GfcBillTotal，GFC 导出时
+ *   汇总行后紧跟其明细）；每个汇总一组，另按楼层（FloorNum）细分；明细合计与汇总的 Quantity 核对
+ * - 钢筋：明细按（级别 Level, 直径 Dia）分组，合计根数、总长与 TotalWeight，与同级别同直径的
+ *   GfcSteelTotal.Weight 合计核对（单位为 t/吨 时换算为 kg）；另核对每条明细 TotalWeight = Num × SingleWeight
+ * 明细按行并行解码为列数组（楼层、数量、归属组……），再分段并行累加后合并。属性位置按 Schema 查得。
+ */
+
+struct GfcQuantityGroup {
+    enum Kind : quint8 { Quota, Bill, Steel };
+    Kind kind = Quota;
+    int totalRow = -1;        // 汇总实例行（钢筋为第一个匹配的 SteelTotal）；-1 为没有
+    QString code;             // 定额/清单编码；钢筋为级别
+    QString subCode;          // 定额子目
+    QString name;
+    QString description;      // 定额 Content / 清单 Attr
+    QString unit;             // 钢筋为 kg
+    qint64 dia = 0;           // 钢筋直径
+    int details = 0;
+    int unparsed = 0;         // 数量不是数值的明细
+    int inconsistent = 0;     // 钢筋：TotalWeight 与 Num × SingleWeight 不符的明细
+    qint64 bars = 0;          // 钢筋根数（Num 合计）
+    double barLength = 0;     // 钢筋总长（Num × BarLength 合计）
+    double quantity = 0;      // 明细合计（钢筋为 TotalWeight 合计）
+    bool hasTotal = false;
+    double total = 0;         // 汇总的量
+
+    bool matches(double tolerance) const;   // |明细合计 - 汇总| <= tolerance × max(1, |汇总|)
+};
+
+struct GfcQuantityFloor {
+    int group = 0;            // GfcQuantityReport::Result::groups 下标
+    qint64 floor = 0;
+    int details = 0;
+    double quantity = 0;
+};
+
+struct GfcQuantityOptions {
+    double tolerance = 1e-3;      // 相对容差（汇总量绝对值小于 1 时按绝对值）
+};
+
+class GfcQuantityReport {
+public:
+    using Options = GfcQuantityOptions;
+
+    struct Result {
+        QVector<GfcQuantityGroup> groups;    // 定额、清单按文件顺序，其后钢筋按级别、直径
+        QVector<GfcQuantityFloor> floors;    // 按组、楼层排序
+        int totals = 0;                      // 汇总实例数
+        int details = 0;                     // 明细实例数
+        int mismatches = 0;                  // 与汇总不符（或无汇总）的组
+        qint64 elapsedMs = 0;
+    };
+
+    static bool compute(const GfcIndex& index, const CompiledSchema& schema, Result* result,
+                        const Options& opt = Options(), QString* err = nullptr);
+
+    // 报表：每组一行（楼层为“全部”），其后为该组各楼层；供报表窗口与 CSV 共用
+    static QStringList headers();
+    static QVector<QVariantList> rows(const Result& result, const Options& opt = Options());
+    static QByteArray toCsv(const Result& result, const Options& opt = Options());
+};
@@ -0,0 +1,697 @@
+#include "gfcquery.h"
+#include "gfcindex.h"
+#include "gfcnumber.h"
+#include "gfcparallel.h"
+#include "gfctyped.h"
+#include "gfcvalueindex.h"
+#include "perftrace.h"
+#include "schemacache.h"
+
+#include <QElapsedTimer>
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+// 递归下降解析：直接在 UTF-8 字节上走，关键字大小写无关
+class GfcQueryParser {
+public:
+    GfcQueryParser(const std::string& text, const CompiledSchema& schema, GfcQuery* q)
+        : s_(text), schema_(schema), q_(q) {}
+
+    bool parse(QString* err)
+    {
+        if (!parseClass(&q_->entity_)) return fail(err);
+        if (keyword("where")) {
+            q_->root_ = parseOr();
+            if (q_->root_ < 0) return fail(err);
+        }
+        skipWs();
+        if (p_ < s_.size()) {
+            error_ = QStringLiteral("多余的内容");
+            return fail(err);
+        }
+        return true;
+    }
+
+private:
+    const std::string& s_;
+    const CompiledSchema& schema_;
+    GfcQuery* q_;
+    size_t p_ = 0;
+    QString error_;
+
+    using Node = GfcQuery::Node;
+
+    bool fail(QString* err)
+    {
+        if (err) *err = QStringLiteral("第 %1 个字符处：%2").arg(int(p_) + 1).arg(error_);
+        return false;
+    }
+    int error(const QString& msg)
+    {
+        if (error_.isEmpty()) error_ = msg;
+        return -1;
+    }
+
+    void skipWs()
+    {
+        while (p_ < s_.size() && (s_[p_] == ' ' || s_[p_] == '\t' || s_[p_] == '\r' || s_[p_] == '\n')) ++p_;
+    }
+    static bool identStart(char c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_'; }
+    static bool identChar(char c) { return identStart(c) || (c >= '0' && c <= '9'); }
+
+    // 只看不吃
+    std::string peekIdent()
+    {
+        skipWs();
+        size_t e = p_;
+        if (e < s_.size() && identStart(s_[e])) {
+            while (e < s_.size() && identChar(s_[e])) ++e;
+        }
+        return s_.substr(p_, e - p_);
+    }
+    bool keyword(const char* kw)
+    {
+        const std::string id = peekIdent();
+        if (id.size() != std::strlen(kw)) return false;
+        for (size_t i = 0; i < id.size(); ++i) {
+            if (std::tolower(uchar(id[i])) != kw[i]) return false;
+        }
+        p_ += id.size();
+        return true;
+    }
+    bool symbol(const char* sym)
+    {
+        skipWs();
+        const size_t n = std::strlen(sym);
+        if (s_.compare(p_, n, sym) != 0) return false;
+        p_ += n;
+        return true;
+    }
+    QString ident()
+    {
+        const std::string id = peekIdent();
+        p_ += id.size();
+        return QString::fromStdString(id);
+    }
+
+    bool parseClass(int* entity)
+    {
+        if (symbol("*")) {
+            *entity = -1;
+            return true;
+        }
+        const QString name = ident();
+        *entity = name.isEmpty() ? -1 : schema_.find(name);
+        if (name.isEmpty()) error(QStringLiteral("缺少类名（或 *）"));
+        else if (*entity < 0) error(QStringLiteral("Schema 中没有类 %1").arg(name));
+        return *entity >= 0;
+    }
+
+    int add(Node n)
+    {
+        q_->nodes_.push_back(std::move(n));
+        return int(q_->nodes_.size()) - 1;
+    }
+
+    int parseOr()
+    {
+        int l = parseAnd();
+        while (l >= 0 && keyword("or")) {
+            const int r = parseAnd();
+            if (r < 0) return -1;
+            Node n;
+            n.kind = Node::Or;
+            n.left = l;
+            n.right = r;
+            l = add(std::move(n));
+        }
+        return l;
+    }
+    int parseAnd()
+    {
+        int l = parseNot();
+        while (l >= 0 && keyword("and")) {
+            const int r = parseNot();
+            if (r < 0) return -1;
+            Node n;
+            n.kind = Node::And;
+            n.left = l;
+            n.right = r;
+            l = add(std::move(n));
+        }
+        return l;
+    }
+    int parseNot()
+    {
+        if (keyword("not")) {
+            const int c = parseNot();
+            if (c < 0) return -1;
+            Node n;
+            n.kind = Node::Not;
+            n.left = c;
+            return add(std::move(n));
+        }
+        return parsePrimary();
+    }
+
+    int parsePrimary()
+    {
+        if (symbol("(")) {
+            const int c = parseOr();
+            if (c < 0) return -1;
+            if (!symbol(")")) return error(QStringLiteral("缺少 )"));
+            return c;
+        }
+        if (keyword("refs")) {
+            Node n;
+            n.kind = Node::Refs;
+            if (!symbol("(")) return error(QStringLiteral("refs 后应为 ("));
+            if (!parseClass(&n.entity)) return -1;
+            if (keyword("where")) {
+                n.left = parseOr();
+                if (n.left < 0) return -1;
+            }
+            if (!symbol(")")) return error(QStringLiteral("缺少 )"));
+            return add(std::move(n));
+        }
+
+        Node n;
+        do {
+            const QString a = ident();
+            if (a.isEmpty()) return error(QStringLiteral("应为属性名"));
+            if (!attributeExists(a)) return error(QStringLiteral("Schema 中没有名为 %1 的属性").arg(a));
+            n.path.push_back(a);
+        } while (symbol("."));
+
+        if (keyword("is")) {
+            n.kind = Node::IsNull;
+            n.negate = keyword("not");
+            if (!keyword("null")) return error(QStringLiteral("is 后应为 null 或 not null"));
+            return add(std::move(n));
+        }
+        n.negate = keyword("not");
+        const bool like = keyword("like");
+        n.caseless = !like && keyword("ilike");
+        if (like || n.caseless) {
+            n.kind = Node::Like;
+            if (!parseLiteral(&n.literal) || n.literal.kind != GfcQuery::Literal::String) {
+                return error(QStringLiteral("like 后应为 '模式'"));
+            }
+            return add(std::move(n));
+        }
+        if (n.negate) return error(QStringLiteral("not 后应为 like / ilike"));
+
+        static const struct { const char* sym; Node::Op op; } kOps[] = {
+            { "!=", Node::Ne }, { "<>", Node::Ne }, { "<=", Node::Le }, { ">=", Node::Ge },
+            { "=", Node::Eq }, { "<", Node::Lt }, { ">", Node::Gt },
+        };
+        bool found = false;
+        for (const auto& o : kOps) {
+            if (symbol(o.sym)) {
+                n.op = o.op;
+                found = true;
+                break;
+            }
+        }
+        if (!found) return error(QStringLiteral("应为比较符、like 或 is"));
+        if (!parseLiteral(&n.literal)) return error(QStringLiteral("应为字面量（数、'字符串'、.枚举.、true/false、#id）"));
+        n.kind = Node::Compare;
+        return add(std::move(n));
+    }
+
+    bool parseLiteral(GfcQuery::Literal* lit)
+    {
+        skipWs();
+        if (p_ >= s_.size()) return false;
+        const char c = s_[p_];
+        if (c == '\'') {
+            lit->kind = GfcQuery::Literal::String;
+            lit->text.clear();
+            for (++p_; p_ < s_.size(); ++p_) {
+                if (s_[p_] == '\'') {
+                    if (p_ + 1 < s_.size() && s_[p_ + 1] == '\'') {
+                        lit->text += '\'';
+                        ++p_;
+                        continue;
+                    }
+                    ++p_;
+                    return true;
+                }
+                lit->text += s_[p_];
+            }
+            return false;
+        }
+        if (c == '.') {
+            const size_t e = s_.find('.', p_ + 1);
+            if (e == std::string::npos) return false;
+            lit->kind = GfcQuery::Literal::Enum;
+            lit->text = s_.substr(p_ + 1, e - p_ - 1);
+            for (char& ch : lit->text) ch = char(std::toupper(uchar(ch)));
+            p_ = e + 1;
+            return !lit->text.empty();
+        }
+        if (c == '#') {
+            size_t e = p_ + 1;
+            while (e < s_.size() && s_[e] >= '0' && s_[e] <= '9') ++e;
+            if (e == p_ + 1) return false;
+            lit->kind = GfcQuery::Literal::Ref;
+            lit->id = std::stoll(s_.substr(p_ + 1, e - p_ - 1));
+            p_ = e;
+            return true;
+        }
+        if (keyword("true") || keyword("false")) {
+            lit->kind = GfcQuery::Literal::Enum;
+            lit->text = std::tolower(uchar(s_[p_ - 2])) == 'u' ? "T" : "F";
+            return true;
+        }
+        const char* b = s_.data() + p_;
+        const char* e = gfc::parseReal(b, s_.data() + s_.size(), lit->number);
+        if (!e || e == b) return false;
+        lit->kind = GfcQuery::Literal::Number;
+        p_ += size_t(e - b);
+        return true;
+    }
+
+    bool attributeExists(const QString& name) const
+    {
+        for (int e = 0; e < schema_.entityCount(); ++e) {
+            if (schema_.attributeIndex(e, name) >= 0) return true;
+        }
+        return false;
+    }
+};
+
+bool GfcQuery::parse(const QString& text, const CompiledSchema& schema, QString* err)
+{
+    *this = GfcQuery();
+    schema_ = &schema;
+    const std::string utf8 = text.toStdString();
+    GfcQueryParser parser(utf8, schema, this);
+    if (!parser.parse(err)) {
+        *this = GfcQuery();
+        return false;
+    }
+    return true;
+}
+
+bool GfcQuery::usesRefs() const
+{
+    for (const Node& n : nodes_) {
+        if (n.kind == Node::Refs) return true;
+    }
+    return false;
+}
+
+namespace {
+
+// 参数值（已解码）；列表展开为各项，类型值（如 GFCLABEL('x')）取其内值
+struct Value {
+    enum Kind { Null, Number, String, Enum, Ref };
+    Kind kind = Null;
+    double number = 0;
+    std::string text;
+    qint64 id = -1;
+};
+
+void collectValues(std::string_view raw, std::vector<Value>* out)
+{
+    while (!raw.empty() && raw.front() == ' ') raw.remove_prefix(1);
+    while (!raw.empty() && raw.back() == ' ') raw.remove_suffix(1);
+    if (raw.empty()) return;
+    Value v;
+    const char c = raw.front();
+    if (c == '$' || c == '*') {
+        out->push_back(v);
+    }
+    else if (c == '\'') {
+        gfc::ArgReader r(raw);
+        v.kind = Value::String;
+        if (r.readString(v.text)) out->push_back(std::move(v));
+    }
+    else if (c == '.') {
+        v.kind = Value::Enum;
+        v.text.assign(raw.substr(1, raw.size() >= 2 ? raw.size() - 2 : 0));
+        out->push_back(std::move(v));
+    }
+    else if (c == '#') {
+        gfc::ArgReader r(raw);
+        gfc::Ref ref;
+        if (r.readRef(ref)) {
+            v.kind = Value::Ref;
+            v.id = ref.id;
+            out->push_back(v);
+        }
+    }
+    else if (c == '(') {
+        gfc::ArgReader r(raw);
+        std::string item;
+        if (!r.beginList()) return;
+        while (!r.atListEnd() && r.readRaw(item)) collectValues(item, out);
+    }
+    else if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z')) {
+        const size_t open = raw.find('('), close = raw.rfind(')');
+        if (open != std::string_view::npos && close != std::string_view::npos && close > open) {
+            collectValues(raw.substr(open + 1, close - open - 1), out);
+        }
+    }
+    else {
+        const char* e = gfc::parseReal(raw.data(), raw.data() + raw.size(), v.number);
+        v.kind = e ? Value::Number : Value::String;
+        if (!e) v.text.assign(raw);
+        out->push_back(std::move(v));
+    }
+}
+
+template <typename T>
+bool compare(const T& a, const T& b, int op)
+{
+    switch (op) {
+    case 0: return a == b;
+    case 1: return !(a == b);
+    case 2: return a < b;
+    case 3: return a < b || a == b;
+    case 4: return b < a;
+    case 5: return b < a || a == b;
+    }
+    return false;
+}
+
+// SQL like：% 任意串，_ 一个 UTF-8 字符；caseless 只折叠 ASCII
+bool likeMatch(std::string_view s, std::string_view pat, bool caseless)
+{
+    auto same = [caseless](char a, char b) {
+        if (!caseless) return a == b;
+        return std::tolower(uchar(a)) == std::tolower(uchar(b));
+    };
+    auto charLen = [](std::string_view t, size_t i) {
+        const uchar c = uchar(t[i]);
+        return c < 0x80 ? 1 : c >= 0xF0 ? 4 : c >= 0xE0 ? 3 : c >= 0xC0 ? 2 : 1;
+    };
+    size_t si = 0, pi = 0, starP = std::string_view::npos, starS = 0;
+    while (si < s.size()) {
+        if (pi < pat.size() && pat[pi] == '%') {
+            starP = pi++;
+            starS = si;
+        }
+        else if (pi < pat.size() && pat[pi] == '_') {
+            si += size_t(charLen(s, si));
+            ++pi;
+        }
+        else if (pi < pat.size() && same(pat[pi], s[si])) {
+            ++si;
+            ++pi;
+        }
+        else if (starP != std::string_view::npos) {
+            pi = starP + 1;
+            starS += size_t(charLen(s, starS));
+            si = starS;
+        }
+        else {
+            return false;
+        }
+    }
+    while (pi < pat.size() && pat[pi] == '%') ++pi;
+    return pi == pat.size() && si == s.size();
+}
+
+} // namespace
+
+// 一次执行：为每个路径步预先查好“文件类 → 参数位置”，求值时只查表
+class GfcQueryRun {
+public:
+    using Node = GfcQuery::Node;
+
+    GfcQueryRun(const GfcQuery& q, const GfcIndex& index) : q_(q), ix_(index)
+    {
+        const int classes = index.classCount();
+        slots_.resize(q.nodes_.size());
+        reach_.resize(q.nodes_.size());
+        for (size_t k = 0; k < q.nodes_.size(); ++k) {
+            for (const QString& attr : q.nodes_[k].path) {
+                QVector<int> byClass(classes, -1);
+                for (int c = 0; c < classes; ++c) {
+                    const int e = index.schemaEntity(c);
+                    if (e >= 0) byClass[c] = q.schema_->attributeIndex(e, attr);
+                }
+                slots_[k].push_back(byClass);
+            }
+        }
+    }
+
+    // 类过滤：类表只有几百项，先判定
+    QVector<quint8> classFilter(int entity) const
+    {
+        QVector<quint8> ok(ix_.classCount(), entity < 0);
+        if (entity < 0) return ok;
+        for (int c = 0; c < ix_.classCount(); ++c) {
+            const int e = ix_.schemaEntity(c);
+            ok[c] = e >= 0 && q_.schema_->isSubtypeOf(e, entity);
+        }
+        return ok;
+    }
+
+    // refs(...)：目标集并行求出后沿反向引用图广度优先；子结点先于父结点，按下标顺序准备即可
+    void prepareRefs()
+    {
+        std::vector<int> revStart, revSource;
+        for (size_t k = 0; k < q_.nodes_.size(); ++k) {
+            const Node& n = q_.nodes_[k];
+            if (n.kind != Node::Refs) continue;
+            if (revStart.empty()) buildReverse(&revStart, &revSource);
+            const QVector<quint8> classOk = classFilter(n.entity);
+            QVector<int> all;
+            for (int r = 0; r < ix_.size(); ++r) {
+                if (classOk[ix_.at(r).cls]) all << r;
+            }
+            const QVector<int> targets = n.left >= 0 ? filter(all, n.left) : all;
+            QVector<quint8>& reach = reach_[k];
+            reach.fill(0, ix_.size());
+            std::vector<int> queue(targets.cbegin(), targets.cend());
+            for (size_t head = 0; head < queue.size(); ++head) {
+                const int u = queue[head];
+                for (int i = revStart[size_t(u)]; i < revStart[size_t(u) + 1]; ++i) {
+                    const int from = revSource[size_t(i)];
+                    if (!reach[from]) {
+                        reach[from] = 1;
+                        queue.push_back(from);
+                    }
+                }
+            }
+            targetCounts_ << targets.size();
+        }
+    }
+    const QVector<int>& targetCounts() const { return targetCounts_; }
+
+    // 并行求值，保持行序
+    QVector<int> filter(const QVector<int>& rows, int node) const
+    {
+        const int n = rows.size();
+        const int parts = gfc::partsFor(n, 2048);
+        std::vector<QVector<int>> outOf(static_cast<size_t>(parts));
+        gfc::parallelParts(n, parts, [&](int b, int e, int p) {
+            std::vector<Value> buf;
+            for (int i = b; i < e; ++i) {
+                if (node < 0 || eval(node, rows[i], &buf)) outOf[size_t(p)] << rows[i];
+            }
+        });
+        QVector<int> out;
+        for (const QVector<int>& o : outOf) out += o;
+        return out;
+    }
+
+    bool eval(int k, int row, std::vector<Value>* buf) const
+    {
+        const Node& n = q_.nodes_[size_t(k)];
+        switch (n.kind) {
+        case Node::And: return eval(n.left, row, buf) && eval(n.right, row, buf);
+        case Node::Or: return eval(n.left, row, buf) || eval(n.right, row, buf);
+        case Node::Not: return !eval(n.left, row, buf);
+        case Node::Refs: return reach_[size_t(k)][row] != 0;
+        default: break;
+        }
+        buf->clear();
+        values(k, 0, row, buf);
+        if (n.kind == Node::IsNull) {
+            bool null = true;
+            for (const Value& v : *buf) null = null && v.kind == Value::Null;
+            return null != n.negate;
+        }
+        for (const Value& v : *buf) {
+            if (n.kind == Node::Like) {
+                if ((v.kind == Value::String || v.kind == Value::Enum)
+                    && likeMatch(v.text, n.literal.text, n.caseless) != n.negate) {
+                    return true;
+                }
+                continue;
+            }
+            if (test(n, v)) return true;
+        }
+        return false;
+    }
+
+private:
+    const GfcQuery& q_;
+    const GfcIndex& ix_;
+    std::vector<std::vector<QVector<int>>> slots_;   // [结点][路径步][文件类] → 参数位置
+    std::vector<QVector<quint8>> reach_;              // refs 结点：可（传递）到达目标集的行
+    QVector<int> targetCounts_;
+
+    void buildReverse(std::vector<int>* start, std::vector<int>* source) const
+    {
+        const int n = ix_.size();
+        start->assign(size_t(n) + 1, 0);
+        for (int r = 0; r < n; ++r) {
+            for (int k = 0; k < ix_.refCount(r); ++k) ++(*start)[size_t(ix_.ref(r, k)) + 1];
+        }
+        for (int r = 0; r < n; ++r) (*start)[size_t(r) + 1] += (*start)[size_t(r)];
+        source->assign(size_t(start->back()), 0);
+        std::vector<int> fill(start->cbegin(), start->cend() - 1);
+        for (int r = 0; r < n; ++r) {
+            for (int k = 0; k < ix_.refCount(r); ++k) (*source)[size_t(fill[size_t(ix_.ref(r, k))]++)] = r;
+        }
+    }
+
+    // 沿路径收集末级取值；中间步只跟进引用
+    void values(int k, size_t step, int row, std::vector<Value>* out) const
+    {
+        const std::vector<QVector<int>>& steps = slots_[size_t(k)];
+        const int slot = steps[step][ix_.at(row).cls];
+        if (slot < 0) return;
+        gfc::ArgReader r(ix_.args(row));
+        std::string raw;
+        if (!r.skipValues(slot) || !r.readRaw(raw)) return;
+        if (step + 1 == steps.size()) {
+            collectValues(raw, out);
+            return;
+        }
+        std::vector<Value> refs;
+        collectValues(raw, &refs);
+        for (const Value& v : refs) {
+            if (v.kind != Value::Ref) continue;
+            const int target = ix_.rowOf(v.id);
+            if (target >= 0) values(k, step + 1, target, out);
+        }
+    }
+
+    static bool test(const Node& n, const Value& v)
+    {
+        const GfcQuery::Literal& lit = n.literal;
+        switch (lit.kind) {
+        case GfcQuery::Literal::Number:
+            return v.kind == Value::Number && compare(v.number, lit.number, n.op);
+        case GfcQuery::Literal::String:
+            return v.kind == Value::String && compare(v.text, lit.text, n.op);
+        case GfcQuery::Literal::Enum: {
+            if (v.kind != Value::Enum) return false;
+            std::string up = v.text;
+            for (char& c : up) c = char(std::toupper(uchar(c)));
+            return compare(up, lit.text, n.op);
+        }
+        case GfcQuery::Literal::Ref:
+            return v.kind == Value::Ref && compare(v.id, lit.id, n.op);
+        }
+        return false;
+    }
+};
+
+bool GfcQuery::run(const GfcIndex& index, const GfcValueIndex* values, const ChunkFn& onChunk, Stats* stats,
+                   QString* err) const
+{
+    GFC_PERF_SCOPE("查询");
+    QElapsedTimer timer;
+    timer.start();
+    if (!schema_) {
+        if (err) *err = QStringLiteral("查询尚未解析");
+        return false;
+    }
+    if (usesRefs() && !index.hasRefs()) {
+        if (err) *err = QStringLiteral("refs(...) 需要引用图（先 buildRefs）");
+        return false;
+    }
+    GfcQueryRun run(*this, index);
+    const QVector<quint8> classOk = run.classFilter(entity_);
+    QStringList plan;
+    plan << (entity_ < 0 ? QStringLiteral("全部类") : QStringLiteral("类 %1（含子类）").arg(schema_->name(entity_)));
+
+    // 候选：顶层 and 链里可走取值索引的条件中出现最少的一项；否则按类扫描
+    QVector<int> candidates;
+    bool seeded = false;
+    if (values && root_ >= 0) {
+        std::vector<int> conj, stack { root_ };
+        while (!stack.empty()) {
+            const int k = stack.back();
+            stack.pop_back();
+            if (nodes_[size_t(k)].kind == Node::And) {
+                stack.push_back(nodes_[size_t(k)].left);
+                stack.push_back(nodes_[size_t(k)].right);
+            }
+            else {
+                conj.push_back(k);
+            }
+        }
+        QVector<GfcValueIndex::Posting> best;
+        int bestNode = -1;
+        for (int k : conj) {
+            const Node& n = nodes_[size_t(k)];
+            const std::string& t = n.literal.text;
+            // 只取等值：超长串不进整值词典，前缀查找会漏掉它们；空串也不进索引，只能全表扫描
+            if (n.kind != Node::Compare || n.op != Node::Eq || n.path.size() != 1
+                || n.literal.kind != Literal::String || t.empty() || int(t.size()) > GfcValueIndex::kMaxValueBytes) {
+                continue;
+            }
+            QVector<GfcValueIndex::Posting> hits =
+                values->lookup(GfcValueIndex::Value, QByteArray(t.data(), int(t.size())), false);
+            if (bestNode < 0 || hits.size() < best.size()) {
+                best.swap(hits);
+                bestNode = k;
+            }
+        }
+        if (bestNode >= 0) {
+            // 出现须落在该类此属性的参数位置上
+            const QString& attr = nodes_[size_t(bestNode)].path[0];
+            QVector<int> slotOf(index.classCount(), -1);
+            for (int c = 0; c < index.classCount(); ++c) {
+                const int e = index.schemaEntity(c);
+                if (classOk[c] && e >= 0) slotOf[c] = schema_->attributeIndex(e, attr);
+            }
+            for (const GfcValueIndex::Posting& h : best) {
+                if (h.slot != slotOf[index.at(h.row).cls]) continue;
+                if (candidates.isEmpty() || candidates.last() != h.row) candidates << h.row;
+            }
+            plan << QStringLiteral("取值索引 %1 = … → %2 个候选").arg(attr).arg(candidates.size());
+            seeded = true;
+        }
+    }
+    if (!seeded) {
+        for (int r = 0; r < index.size(); ++r) {
+            if (classOk[index.at(r).cls]) candidates << r;
+        }
+        plan << QStringLiteral("按类扫描 %1 行").arg(candidates.size());
+    }
+
+    run.prepareRefs();
+    for (int c : run.targetCounts()) plan << QStringLiteral("引用闭包（目标 %1 个）").arg(c);
+
+    // 分块并行求值，块间按行序回调
+    constexpr int kChunk = 65536;
+    int matches = 0;
+    for (int b = 0; b < candidates.size(); b += kChunk) {
+        const QVector<int> chunk = candidates.mid(b, kChunk);
+        const QVector<int> hit = run.filter(chunk, root_);
+        matches += hit.size();
+        if (!hit.isEmpty() && !onChunk(hit)) {
+            plan << QStringLiteral("提前结束");
+            break;
+        }
+    }
+
+    if (stats) {
+        stats->candidates = candidates.size();
+        stats->matches = matches;
+        stats->elapsedMs = timer.elapsed();
+        stats->plan = plan.join(QStringLiteral("；"));
+    }
+    PerfTrace::instance().setCounter(QStringLiteral("查询命中"), matches);
+    return true;
+}
@@ -0,0 +1,76 @@
+#pragma once
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <functional>
+#include <string>
+#include <vector>
+
+class CompiledSchema;
+class GfcIndex;
+class GfcValueIndex;
+
+/**
+ * 实例查询语言：
+ *   查询    := 类名 | *  [where 条件]                   类名含子类，大小写无关
+ *   条件    := 条件 or 条件 | 条件 and 条件 | not 条件 | ( 条件 )
+ *            | 路径 比较符 字面量 | 路径 [not] like|ilike '模式' | 路径 is [not] null
+ *            | refs(类名 [where 条件])                   （传递地）引用了满足条件的实例
+ *   路径    := 属性名 { . 属性名 }                      按 Schema 属性名，经引用逐级跟进；列表逐项
+ *   比较符  := = != <> < <= > >=      字面量 := 数 | '字符串' | .枚举. | true | false | #id
+ * 路径有多个取值（列表、多处引用）时任一满足即可；'字符串' 只比字符串值，.枚举. 只比枚举值；like 中 % 匹配任意串、_ 匹配一个字符，ilike 忽略 ASCII 大小写。
+ * 例：GfcFloor where Height > 3 and Name like 'F%'
+ *     GfcElement where refs(GfcExtrudedBody where Len > 150)
+ * 执行计划：
+ * - 类过滤按 Schema 继承区间判定，逐行只查类表
+ * - 顶层 and 链中有“单级属性 = '字符串'”且有取值索引时，取出现最少的一项作为候选种子（出现须落在该属性位置上）
+ * - refs(...) 先并行求出目标集，再沿反向引用图一次广度优先得到所有（传递）引用者
+ * - 候选分块并行求值，按行序分块回调（流式输出）
+ */
+
+class GfcQuery {
+public:
+    struct Stats {
+        int candidates = 0;
+        int matches = 0;
+        qint64 elapsedMs = 0;
+        QString plan;             // 执行计划说明
+    };
+    // 每块匹配行（行号升序）；返回 false 提前结束
+    using ChunkFn = std::function<bool(const QVector<int>& rows)>;
+
+    bool parse(const QString& text, const CompiledSchema& schema, QString* err);
+    bool usesRefs() const;        // 用到 refs(...) 时，执行前须先 index.buildRefs()
+
+    // values 可为空（或与 index 内容不符时应传空）；index 与 schema 须与 parse 时相同的 Schema 对应
+    bool run(const GfcIndex& index, const GfcValueIndex* values, const ChunkFn& onChunk,
+             Stats* stats = nullptr, QString* err = nullptr) const;
+
+private:
+    struct Literal {
+        enum Kind { Number, String, Enum, Ref };
+        Kind kind = Number;
+        double number = 0;
+        std::string text;         // 字符串（UTF-8）或枚举名（大写）
+        qint64 id = -1;
+    };
+    struct Node {
+        enum Kind { And, Or, Not, Compare, Like, IsNull, Refs };
+        enum Op { Eq, Ne, Lt, Le, Gt, Ge };
+        Kind kind = Compare;
+        int left = -1, right = -1;          // And/Or/Not 的子结点；Refs 的条件（-1 为无）
+        std::vector<QString> path;          // Compare/Like/IsNull
+        Op op = Eq;
+        Literal literal;
+        bool negate = false;                // not like / is not null
+        bool caseless = false;              // ilike
+        int entity = -1;                    // Refs 的类（-1 为任意类）
+    };
+    friend class GfcQueryRun;
+    friend class GfcQueryParser;
+
+    const CompiledSchema* schema_ = nullptr;
+    int entity_ = -1;                       // -1：*
+    std::vector<Node> nodes_;               // 子结点总在父结点之前
+    int root_ = -1;                         // 条件根；-1 为无条件
+};
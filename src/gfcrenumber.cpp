@@ -0,0 +1,175 @@
+#include "gfcrenumber.h"
+#include "gfcindex.h"
+#include "gfcparallel.h"
+#include "perftrace.h"
+
+#include <QHash>
+#include <climits>
+
+namespace {
+
+inline bool isDigit(char c) { return c >= '0' && c <= '9'; }
+
+} // namespace
+
+QVector<int> GfcRenumber::topologicalOrder(const GfcIndex& ix, int* cycleEdges)
+{
+    GFC_PERF_SCOPE("拓扑排序");
+    const int n = ix.size();
+    QVector<int> order;
+    order.reserve(n);
+    QVector<quint8> state(n, 0);   // 0 未访问，1 在栈上，2 完成
+    struct Frame { int row; int k; };
+    QVector<Frame> stack;
+    int back = 0;
+
+    for (int root = 0; root < n; ++root) {
+        if (state[root]) continue;
+        state[root] = 1;
+        stack.push_back({ root, 0 });
+        while (!stack.isEmpty()) {
+            Frame& f = stack.last();
+            if (f.k < ix.refCount(f.row)) {
+                const int t = ix.ref(f.row, f.k++);
+                if (state[t] == 0) {
+                    state[t] = 1;
+                    stack.push_back({ t, 0 });
+                }
+                else if (state[t] == 1) {
+                    ++back;
+                }
+            }
+            else {
+                state[f.row] = 2;
+                order << f.row;
+                stack.removeLast();
+            }
+        }
+    }
+    if (cycleEdges) *cycleEdges = back;
+    return order;
+}
+
+bool GfcRenumber::renumber(GfcIndex& ix, Order order, QByteArray* out, Stats* stats, QString* err)
+{
+    GFC_PERF_SCOPE("重新编号");
+    if (ix.size() == 0) {
+        if (err) *err = QStringLiteral("没有实例");
+        return false;
+    }
+    if (!ix.hasRefs()) ix.buildRefs();
+    const int n = ix.size();
+    Stats st;
+    st.instances = n;
+
+    QVector<int> seq;
+    if (order == Topological) {
+        seq = topologicalOrder(ix, &st.cycleEdges);
+    }
+    else {
+        seq.resize(n);
+        for (int i = 0; i < n; ++i) seq[i] = i;
+    }
+    QVector<qint64> newId(n);
+    for (int pos = 0; pos < n; ++pos) {
+        newId[seq[pos]] = pos + 1;
+        if (seq[pos] != pos) ++st.moved;
+        if (ix.at(seq[pos]).id != pos + 1) ++st.idsChanged;
+    }
+
+    // 悬空引用：按首次出现顺序分配 n 之后的编号
+    QHash<qint64, qint64> danglingMap;
+    if (ix.danglingRefCount() > 0) {
+        for (int r = 0; r < n; ++r) {
+            ix.forEachRef(r, [&](qint64 id) {
+                if (ix.rowOf(id) < 0 && !danglingMap.contains(id)) danglingMap.insert(id, n + 1 + danglingMap.size());
+            });
+        }
+        st.dangling = danglingMap.size();
+    }
+
+    // 按新顺序分段并行改写
+    const QByteArray& data = ix.data();
+    const char* base = data.constData();
+    const int parts = gfc::partsFor(n, 2048);
+    QVector<QByteArray> pieces(parts);
+    QVector<qint64> refCounts(parts, 0);
+
+    gfc::parallelParts(n, parts, [&](int b, int e, int part) {
+        QByteArray& buf = pieces[part];
+        qint64 approx = 0;
+        for (int pos = b; pos < e; ++pos) approx += ix.at(seq[pos]).end - ix.at(seq[pos]).begin + 2;
+        buf.reserve(int(qMin<qint64>(approx + approx / 16, INT_MAX / 2)));
+        qint64 refs = 0;
+
+        for (int pos = b; pos < e; ++pos) {
+            const int r = seq[pos];
+            const GfcIndexEntry& en = ix.at(r);
+            // 实例前的空白/注释：文件顺序保留原样，拓扑顺序统一为换行
+            if (pos > 0) {
+                if (order == FileOrder) {
+                    const qint64 gap = ix.at(r - 1).end;
+                    buf.append(base + gap, int(en.begin - gap));
+                }
+                else {
+                    buf += '\n';
+                }
+            }
+            buf += '#';
+            gfc::appendNumber(buf, newId[r]);
+            // '=' 与类名原样，从 id 之后到参数区开始
+            const char* p = base + en.begin + 1;
+            while (isDigit(*p)) ++p;
+            buf.append(p, int(base + en.argsBegin - p));
+
+            const char* a = base + en.argsBegin;
+            const char* ae = base + en.argsEnd;
+            const char* run = a;
+            const int kn = ix.refCount(r);
+            int k = 0;
+            bool inStr = false;
+            while (a < ae) {
+                const char c = *a;
+                if (inStr) {
+                    if (c == '\'') inStr = false;
+                    ++a;
+                    continue;
+                }
+                if (c == '\'') { inStr = true; ++a; continue; }
+                if (c != '#' || a + 1 >= ae || !isDigit(a[1])) { ++a; continue; }
+
+                buf.append(run, int(a - run));
+                const char* d = a + 1;
+                qint64 id = 0;
+                while (d < ae && isDigit(*d)) id = id * 10 + (*d++ - '0');
+                qint64 mapped;
+                if (k < kn && ix.at(ix.ref(r, k)).id == id) mapped = newId[ix.ref(r, k++)];
+                else mapped = danglingMap.value(id, id);
+                buf += '#';
+                gfc::appendNumber(buf, mapped);
+                ++refs;
+                a = run = d;
+            }
+            buf.append(run, int(ae - run));
+            buf.append(ae, int(base + en.end - ae));   // ")...;"
+        }
+        refCounts[part] = refs;
+    });
+
+    QByteArray result;
+    qint64 total = ix.headerEnd() + (data.size() - ix.trailerBegin());
+    for (const QByteArray& p : pieces) total += p.size();
+    result.reserve(int(qMin<qint64>(total, INT_MAX)));
+    result.append(base, int(ix.headerEnd()));
+    for (QByteArray& p : pieces) {
+        result += p;
+        p.clear();
+    }
+    result.append(base + ix.trailerBegin(), int(data.size() - ix.trailerBegin()));
+
+    for (qint64 c : refCounts) st.refs += c;
+    PerfTrace::instance().setCounter(QStringLiteral("改写引用"), st.refs);
+    if (stats) *stats = st;
+    *out = result;
+    return true;
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+class GfcIndex;
+
+/**
+ * 实例重新编号（紧凑化）：
+ * - FileOrder：实例位置不变，按文件顺序编号为 #1..#n，实例之间的注释/空行原样保留
+ * - Topological：按引用图深度优先后序重排，被引用的实例总在引用者之前（定义先于使用），
+ *   其余尽量保持原顺序；引用环上的回边忽略
+ * 所有 #n（字符串之外）在一遍线性扫描中改写，按行分段并行生成后拼接；
+ * 悬空引用改为 n 之后的新编号（仍然悬空，但不会撞上新编号）。
+ */
+
+class GfcRenumber {
+public:
+    enum Order { FileOrder, Topological };
+
+    struct Stats {
+        int instances = 0;
+        qint64 refs = 0;            // 改写的引用数（含悬空）
+        int idsChanged = 0;         // 编号变化的实例
+        int moved = 0;              // 位置变化的实例（Topological）
+        int dangling = 0;           // 不同的悬空编号个数
+        int cycleEdges = 0;         // 排序时忽略的回边（Topological）
+    };
+
+    // index 需已 build（引用图按需构建）；out 为完整的新文本
+    static bool renumber(GfcIndex& index, Order order, QByteArray* out, Stats* stats = nullptr,
+                         QString* err = nullptr);
+
+    // 新顺序（行号序列），供其它需要“定义在前”顺序的功能复用
+    static QVector<int> topologicalOrder(const GfcIndex& index, int* cycleEdges = nullptr);
+};
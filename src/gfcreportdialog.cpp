@@ -0,0 +1,123 @@
+#include "gfcreportdialog.h"
+
+#include <QDialogButtonBox>
+#include <QFile>
+#include <QFileDialog>
+#include <QHeaderView>
+#include <QLabel>
+#include <QMessageBox>
+#include <QPushButton>
+#include <QTableWidget>
+#include <QVBoxLayout>
+
+namespace {
+
+bool isNumeric(const QVariant& v)
+{
+    switch (v.userType()) {
+    case QMetaType::Int: case QMetaType::UInt: case QMetaType::LongLong: case QMetaType::ULongLong: case QMetaType::Double:
+        return true;
+    default:
+        return false;
+    }
+}
+
+QString csvField(QString s)
+{
+    if (s.contains(QLatin1Char(',')) || s.contains(QLatin1Char('"')) || s.contains(QLatin1Char('\n'))) {
+        s.replace(QLatin1Char('"'), QStringLiteral("\"\""));
+        s = QLatin1Char('"') + s + QLatin1Char('"');
+    }
+    return s;
+}
+
+} // namespace
+
+GfcReportDialog::GfcReportDialog(const QString& title, const QString& summary, const QStringList& headers,
+                                 QWidget* parent)
+    : QDialog(parent)
+{
+    setWindowTitle(title);
+    resize(720, 480);
+
+    summary_ = new QLabel(summary, this);
+    summary_->setWordWrap(true);
+    summary_->setTextInteractionFlags(Qt::TextSelectableByMouse);
+
+    table_ = new QTableWidget(0, headers.size(), this);
+    table_->setHorizontalHeaderLabels(headers);
+    table_->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table_->setSelectionBehavior(QAbstractItemView::SelectRows);
+    table_->verticalHeader()->setVisible(false);
+    table_->horizontalHeader()->setStretchLastSection(true);
+
+    auto* buttons = new QDialogButtonBox(this);
+    auto* csvBtn = buttons->addButton(QStringLiteral("导出 CSV ..."), QDialogButtonBox::ActionRole);
+    acceptBtn_ = buttons->addButton(QString(), QDialogButtonBox::AcceptRole);
+    acceptBtn_->setVisible(false);
+    buttons->addButton(QDialogButtonBox::Close);
+    connect(csvBtn, &QPushButton::clicked, this, &GfcReportDialog::exportCsv);
+    connect(buttons, &QDialogButtonBox::accepted, this, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, this, &QDialog::reject);
+
+    auto* lay = new QVBoxLayout(this);
+    lay->addWidget(summary_);
+    lay->addWidget(table_, 1);
+    lay->addWidget(buttons);
+}
+
+void GfcReportDialog::addRow(const QVariantList& cells)
+{
+    table_->setSortingEnabled(false);
+    const int row = table_->rowCount();
+    table_->insertRow(row);
+    for (int c = 0; c < cells.size() && c < table_->columnCount(); ++c) {
+        auto* item = new QTableWidgetItem;
+        item->setData(Qt::DisplayRole, cells[c]);
+        if (isNumeric(cells[c])) item->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
+        table_->setItem(row, c, item);
+    }
+    table_->setSortingEnabled(true);
+}
+
+void GfcReportDialog::showEvent(QShowEvent* e)
+{
+    table_->resizeColumnsToContents();
+    QDialog::showEvent(e);
+}
+
+void GfcReportDialog::setAcceptText(const QString& text)
+{
+    acceptBtn_->setText(text);
+    acceptBtn_->setVisible(!text.isEmpty());
+    if (!text.isEmpty()) acceptBtn_->setDefault(true);
+}
+
+void GfcReportDialog::setSummary(const QString& summary)
+{
+    summary_->setText(summary);
+}
+
+void GfcReportDialog::exportCsv()
+{
+    const QString path = QFileDialog::getSaveFileName(this, QStringLiteral("导出 CSV"), QString(),
+                                                      QStringLiteral("CSV 文件 (*.csv)"));
+    if (path.isEmpty()) return;
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        QMessageBox::warning(this, QStringLiteral("导出 CSV"), f.errorString());
+        return;
+    }
+    QStringList line;
+    for (int c = 0; c < table_->columnCount(); ++c) line << csvField(table_->horizontalHeaderItem(c)->text());
+    f.write("\xEF\xBB\xBF");   // BOM，便于表格软件识别 UTF-8
+    f.write(line.join(QLatin1Char(',')).toUtf8() + "\n");
+    for (int r = 0; r < table_->rowCount(); ++r) {
+        line.clear();
+        for (int c = 0; c < table_->columnCount(); ++c) {
+            const QTableWidgetItem* it = table_->item(r, c);
+            line << csvField(it ? it->data(Qt::DisplayRole).toString() : QString());
+        }
+        f.write(line.join(QLatin1Char(',')).toUtf8() + "\n");
+    }
+}
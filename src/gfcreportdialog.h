@@ -0,0 +1,37 @@
+#pragma once
+#include <QDialog>
+#include <QStringList>
+#include <QVariantList>
+
+class QLabel;
+class QPushButton;
+class QTableWidget;
+
+/**
+ * 通用报表/预览窗口：一段说明 + 一张可排序的表 + “导出 CSV”。
+ * 数值单元格（整数/浮点）按数值排序、右对齐；设置了确认按钮文字时作为“先预览再执行”的确认框使用，
+ * 否则只有“关闭”。
+ */
+
+class GfcReportDialog : public QDialog
+{
+    Q_OBJECT
+public:
+    GfcReportDialog(const QString& title, const QString& summary, const QStringList& headers,
+                    QWidget* parent = nullptr);
+
+    void addRow(const QVariantList& cells);
+    void setAcceptText(const QString& text);     // 空则不显示确认按钮
+    void setSummary(const QString& summary);
+    QTableWidget* table() const { return table_; }
+
+protected:
+    void showEvent(QShowEvent* e) override;
+
+private:
+    void exportCsv();
+
+    QLabel* summary_ = nullptr;
+    QTableWidget* table_ = nullptr;
+    QPushButton* acceptBtn_ = nullptr;
+};
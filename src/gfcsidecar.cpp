@@ -0,0 +1,106 @@
+#include "gfcsidecar.h"
+
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QFile>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QSaveFile>
+
+QString GfcSidecar::pathFor(const QString& documentPath)
+{
+    return documentPath + QStringLiteral(".gfcx");
+}
+
+QByteArray GfcSidecar::contentKey(const QByteArray& utf8)
+{
+    return QCryptographicHash::hash(utf8, QCryptographicHash::Sha1);
+}
+
+bool GfcSidecar::load(const QString& path, const QByteArray& key, QString* err)
+{
+    key_ = key;
+    sections_.clear();
+    QFile f(path);
+    if (!f.open(QIODevice::ReadOnly)) {
+        if (err) *err = QStringLiteral("没有旁路索引：%1").arg(path);
+        return false;
+    }
+    const QByteArray data = f.readAll();
+    QDataStream ds(data);
+    ds.setByteOrder(QDataStream::LittleEndian);
+
+    quint32 magic = 0, version = 0, keyLen = 0, count = 0;
+    ds >> magic >> version >> keyLen;
+    const quint32 limit = quint32(data.size());
+    if (ds.status() != QDataStream::Ok || magic != kMagic || version != kVersion || keyLen > limit) {
+        if (err) *err = QStringLiteral("旁路索引版本不符或已损坏：%1").arg(path);
+        return false;
+    }
+    QByteArray fileKey(int(keyLen), Qt::Uninitialized);
+    ds.readRawData(fileKey.data(), int(keyLen));
+    if (fileKey != key) {
+        if (err) *err = QStringLiteral("旁路索引与当前内容不符：%1").arg(path);
+        return false;
+    }
+    ds >> count;
+    QMap<QByteArray, QByteArray> sections;
+    auto readBytes = [&](QByteArray* out) {
+        quint32 len = 0;
+        ds >> len;
+        if (ds.status() != QDataStream::Ok || len > limit) return false;
+        out->resize(int(len));
+        return ds.readRawData(out->data(), int(len)) == int(len);
+    };
+    for (quint32 i = 0; i < count && ds.status() == QDataStream::Ok; ++i) {
+        QByteArray tag, bytes;
+        if (!readBytes(&tag) || !readBytes(&bytes)) {
+            ds.setStatus(QDataStream::ReadCorruptData);
+            break;
+        }
+        sections.insert(tag, bytes);
+    }
+    if (ds.status() != QDataStream::Ok) {
+        if (err) *err = QStringLiteral("旁路索引数据不完整：%1").arg(path);
+        return false;
+    }
+    sections_.swap(sections);
+    return true;
+}
+
+bool GfcSidecar::save(const QString& path, QString* err) const
+{
+    QByteArray out;
+    QDataStream ds(&out, QIODevice::WriteOnly);
+    ds.setByteOrder(QDataStream::LittleEndian);
+    auto writeBytes = [&ds](const QByteArray& b) {
+        ds << quint32(b.size());
+        ds.writeRawData(b.constData(), b.size());
+    };
+    ds << kMagic << kVersion;
+    writeBytes(key_);
+    ds << quint32(sections_.size());
+    for (auto it = sections_.constBegin(); it != sections_.constEnd(); ++it) {
+        writeBytes(it.key());
+        writeBytes(it.value());
+    }
+
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly) || f.write(out) != out.size() || !f.commit()) {
+        if (err) *err = QStringLiteral("无法写入旁路索引：%1（%2）").arg(path, f.errorString());
+        return false;
+    }
+    return true;
+}
+
+bool GfcSidecar::update(const QString& path, const QByteArray& key, const QByteArray& tag, const QByteArray& data,
+                        QString* err)
+{
+    // 读-改-写整体加锁，多处同时写回时不互相覆盖对方的段
+    static QMutex mutex;
+    QMutexLocker lock(&mutex);
+    GfcSidecar sidecar;
+    sidecar.load(path, key);   // 失败时为以 key 为键的空文件
+    sidecar.setSection(tag, data);
+    return sidecar.save(path, err);
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <QByteArray>
+#include <QMap>
+#include <QString>
+
+/**
+ * 旁路索引文件（model.gfc → model.gfc.gfcx）：按标签保存可重建的派生索引（空间索引、取值索引等），
+ * 下次打开同一内容时直接读入，不必重算。
+ * - 内容键：文档 UTF-8 文本的 SHA-1；键不符（文件已改动）时整个文件视为无效
+ * - 布局（小端）：magic, version, 键, 段数，各段（标签 u32 长度 + 字节，数据 u32 长度 + 字节）
+ * - 各段格式由使用者自行定义并带版本；写出经临时文件原子替换
+ * - 多个索引共用一个文件：各自只经 update() 写入自己的段，其余段保留（同进程内串行）
+ * 写旁路文件失败不影响主流程。
+ */
+
+class GfcSidecar {
+public:
+    static constexpr quint32 kMagic = 0x58434647;   // "GFCX"
+    static constexpr quint32 kVersion = 1;
+
+    static QString pathFor(const QString& documentPath);
+    static QByteArray contentKey(const QByteArray& utf8);
+
+    // 读入 path；文件不存在、已损坏或键不符时返回 false，并清空为以 key 为键的空文件
+    bool load(const QString& path, const QByteArray& key, QString* err = nullptr);
+    bool save(const QString& path, QString* err = nullptr) const;
+
+    // 读入 path（键不符则从空文件开始）、替换 tag 段后写回；可在多个线程同时调用
+    static bool update(const QString& path, const QByteArray& key, const QByteArray& tag, const QByteArray& data,
+                       QString* err = nullptr);
+
+    const QByteArray& key() const { return key_; }
+    bool hasSection(const QByteArray& tag) const { return sections_.contains(tag); }
+    QByteArray section(const QByteArray& tag) const { return sections_.value(tag); }
+    void setSection(const QByteArray& tag, const QByteArray& data) { sections_.insert(tag, data); }
+
+private:
+    QByteArray key_;
+    QMap<QByteArray, QByteArray> sections_;
+};
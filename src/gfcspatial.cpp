@@ -0,0 +1,326 @@
+#include "gfcspatial.h"
+#include "gfcindex.h"
+#include "gfcparallel.h"
+#include "perftrace.h"
+#include "schemacache.h"
+
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <QRegularExpression>
+#include <algorithm>
+#include <cmath>
+#include <queue>
+
+namespace {
+
+inline double center2(const GfcAabb& b, int axis)
+{
+    return b.min[axis] + b.max[axis];
+}
+
+inline bool overlaps(const GfcAabb& a, const GfcAabb& b)
+{
+    for (int k = 0; k < 3; ++k) {
+        if (a.max[k] < b.min[k] || b.max[k] < a.min[k]) return false;
+    }
+    return true;
+}
+
+// 点到包围盒距离的平方（点在盒内为 0）
+inline double distance2(const GfcAabb& b, const double* p)
+{
+    double s = 0;
+    for (int k = 0; k < 3; ++k) {
+        const double d = p[k] < b.min[k] ? b.min[k] - p[k] : p[k] > b.max[k] ? p[k] - b.max[k] : 0;
+        s += d * d;
+    }
+    return s;
+}
+
+int ceilDiv(int a, int b)
+{
+    return (a + b - 1) / b;
+}
+
+// STR 排列：返回 boxes 的下标顺序，按此顺序每 capacity 个为一组
+template <typename BoxOf>
+QVector<int> strOrder(int n, int capacity, BoxOf boxOf)
+{
+    QVector<int> order(n);
+    for (int i = 0; i < n; ++i) order[i] = i;
+    auto byAxis = [&boxOf](int axis) {
+        return [&boxOf, axis](int a, int b) { return center2(boxOf(a), axis) < center2(boxOf(b), axis); };
+    };
+    const int leaves = ceilDiv(n, capacity);
+    const int slabs = qMax(1, int(std::ceil(std::cbrt(double(leaves)))));
+    const int slabSize = ceilDiv(leaves, slabs) * capacity;
+    std::sort(order.begin(), order.end(), byAxis(0));
+
+    auto sortSlab = [&](int b) {
+        const int e = qMin(n, b + slabSize);
+        std::sort(order.begin() + b, order.begin() + e, byAxis(1));
+        const int slabLeaves = ceilDiv(e - b, capacity);
+        const int strips = qMax(1, int(std::ceil(std::sqrt(double(slabLeaves)))));
+        const int stripSize = ceilDiv(slabLeaves, strips) * capacity;
+        for (int s = b; s < e; s += stripSize) {
+            std::sort(order.begin() + s, order.begin() + qMin(e, s + stripSize), byAxis(2));
+        }
+    };
+    const int slabCount = ceilDiv(n, slabSize);
+    gfc::parallelParts(slabCount, slabCount, [&](int b, int e, int) {
+        for (int k = b; k < e; ++k) sortSlab(k * slabSize);
+    });
+    return order;
+}
+
+QString normalizedQueryText(const QString& text)
+{
+    QString t = text.trimmed().toLower();
+    t.replace(QChar(u'，'), QLatin1Char(' '));
+    t.replace(QLatin1Char(','), QLatin1Char(' '));
+    t.replace(QLatin1Char('('), QLatin1Char(' '));
+    t.replace(QLatin1Char(')'), QLatin1Char(' '));
+    return t;
+}
+
+} // namespace
+
+GfcSpatialIndex GfcSpatialIndex::build(const GfcIndex& index, const CompiledSchema& schema, BuildStats* stats)
+{
+    GFC_PERF_SCOPE("空间索引构建");
+    QElapsedTimer timer;
+    timer.start();
+    const GfcGeometryEvaluator eval(index, schema);
+    const QVector<int> rows = eval.elementRows();
+    const int n = rows.size();
+    QVector<Item> items(n);
+    QVector<quint8> declared(n, 0);
+    gfc::parallelParts(n, gfc::partsFor(n, 256), [&](int b, int e, int) {
+        for (int i = b; i < e; ++i) {
+            items[i].id = index.at(rows[i]).id;
+            items[i].box = eval.evaluate(rows[i]).box;
+            if (items[i].box.isEmpty()) {
+                items[i].box = eval.declaredBox(rows[i]);
+                declared[i] = !items[i].box.isEmpty();
+            }
+        }
+    });
+
+    GfcSpatialIndex sx;
+    sx.load(std::move(items));
+    if (stats) {
+        BuildStats s;
+        s.elements = n;
+        s.indexed = sx.size();
+        s.declared = int(std::count(declared.cbegin(), declared.cend(), quint8(1)));
+        s.nodes = sx.nodes_.size();
+        s.elapsedMs = timer.elapsed();
+        *stats = s;
+    }
+    PerfTrace::instance().setCounter(QStringLiteral("空间索引条目"), sx.size());
+    return sx;
+}
+
+void GfcSpatialIndex::load(QVector<Item> items)
+{
+    items.erase(std::remove_if(items.begin(), items.end(), [](const Item& it) { return it.box.isEmpty(); }),
+                items.end());
+    items_.clear();
+    nodes_.clear();
+    const int n = items.size();
+    if (n == 0) return;
+
+    // 叶层：条目按 STR 顺序重排后每 kNodeCapacity 个一组
+    const QVector<int> order = strOrder(n, kNodeCapacity, [&items](int i) -> const GfcAabb& { return items[i].box; });
+    items_.reserve(n);
+    for (int i : order) items_ << items[i];
+    for (int b = 0; b < n; b += kNodeCapacity) {
+        Node leaf;
+        leaf.first = b;
+        leaf.count = qMin(kNodeCapacity, n - b);
+        for (int i = b; i < b + leaf.count; ++i) leaf.box.unite(items_[i].box);
+        nodes_ << leaf;
+    }
+
+    // 上层：本层结点按 STR 重排后成组挂到新的父结点下，直到只剩一个
+    int levelBegin = 0;
+    while (nodes_.size() - levelBegin > 1) {
+        const int levelEnd = nodes_.size();
+        const int m = levelEnd - levelBegin;
+        const QVector<Node> level(nodes_.cbegin() + levelBegin, nodes_.cend());
+        const QVector<int> o = strOrder(m, kNodeCapacity, [&level](int i) -> const GfcAabb& { return level[i].box; });
+        for (int i = 0; i < m; ++i) nodes_[levelBegin + i] = level[o[i]];
+        for (int b = 0; b < m; b += kNodeCapacity) {
+            Node parent;
+            parent.leaf = false;
+            parent.first = levelBegin + b;
+            parent.count = qMin(kNodeCapacity, m - b);
+            for (int i = parent.first; i < parent.first + parent.count; ++i) parent.box.unite(nodes_[i].box);
+            nodes_ << parent;
+        }
+        levelBegin = levelEnd;
+    }
+}
+
+QVector<GfcSpatialIndex::Hit> GfcSpatialIndex::intersects(const GfcAabb& box) const
+{
+    QVector<Hit> hits;
+    if (nodes_.isEmpty() || box.isEmpty()) return hits;
+    QVector<int> stack { nodes_.size() - 1 };
+    while (!stack.isEmpty()) {
+        const Node& node = nodes_[stack.takeLast()];
+        if (!overlaps(node.box, box)) continue;
+        for (int i = node.first; i < node.first + node.count; ++i) {
+            if (!node.leaf) stack << i;
+            else if (overlaps(items_[i].box, box)) hits << Hit { items_[i].id, 0 };
+        }
+    }
+    std::sort(hits.begin(), hits.end(), [](const Hit& a, const Hit& b) { return a.id < b.id; });
+    return hits;
+}
+
+QVector<GfcSpatialIndex::Hit> GfcSpatialIndex::containing(double x, double y, double z) const
+{
+    GfcAabb p;
+    p.add(x, y, z);
+    return intersects(p);
+}
+
+QVector<GfcSpatialIndex::Hit> GfcSpatialIndex::nearest(double x, double y, double z, int k) const
+{
+    QVector<Hit> hits;
+    if (nodes_.isEmpty() || k <= 0) return hits;
+    const double p[3] = { x, y, z };
+    // 候选：(距离平方, 下标)；下标 >= 0 为结点，< 0 为条目 ~i
+    using Entry = std::pair<double, int>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+    queue.push({ distance2(nodes_.last().box, p), nodes_.size() - 1 });
+    while (!queue.empty() && hits.size() < k) {
+        const Entry top = queue.top();
+        queue.pop();
+        if (top.second < 0) {
+            hits << Hit { items_[~top.second].id, std::sqrt(top.first) };
+            continue;
+        }
+        const Node& node = nodes_[top.second];
+        for (int i = node.first; i < node.first + node.count; ++i) {
+            if (node.leaf) queue.push({ distance2(items_[i].box, p), ~i });
+            else queue.push({ distance2(nodes_[i].box, p), i });
+        }
+    }
+    return hits;
+}
+
+QVector<GfcSpatialIndex::Hit> GfcSpatialIndex::run(const Query& q) const
+{
+    switch (q.kind) {
+    case Query::Box: return intersects(q.box);
+    case Query::Point: return containing(q.point[0], q.point[1], q.point[2]);
+    case Query::Nearest: return nearest(q.point[0], q.point[1], q.point[2], q.k);
+    }
+    return {};
+}
+
+bool GfcSpatialIndex::parseQuery(const QString& text, Query* q, QString* err)
+{
+    const QStringList words = normalizedQueryText(text).split(QRegularExpression(QStringLiteral("\\s+")),
+                                                              Qt::SkipEmptyParts);
+    auto fail = [err](const QString& msg) {
+        if (err) *err = msg;
+        return false;
+    };
+    if (words.isEmpty()) return fail(QStringLiteral("查询为空"));
+    QVector<double> nums;
+    for (int i = 1; i < words.size(); ++i) {
+        bool ok = false;
+        const double v = words[i].toDouble(&ok);
+        if (!ok || !std::isfinite(v)) return fail(QStringLiteral("不是数字：%1").arg(words[i]));
+        nums << v;
+    }
+    Query r;
+    const QString& kind = words.first();
+    if (kind == QLatin1String("box")) {
+        if (nums.size() != 6) return fail(QStringLiteral("box 需要 6 个数：x0 y0 z0 x1 y1 z1"));
+        r.kind = Query::Box;
+        r.box.add(nums[0], nums[1], nums[2]);
+        r.box.add(nums[3], nums[4], nums[5]);
+    }
+    else if (kind == QLatin1String("point")) {
+        if (nums.size() != 3) return fail(QStringLiteral("point 需要 3 个数：x y z"));
+        r.kind = Query::Point;
+    }
+    else if (kind == QLatin1String("knn")) {
+        if (nums.size() != 3 && nums.size() != 4) return fail(QStringLiteral("knn 需要 3 或 4 个数：x y z [k]"));
+        r.kind = Query::Nearest;
+        if (nums.size() == 4) {
+            if (nums[3] < 1 || nums[3] != std::floor(nums[3])) return fail(QStringLiteral("k 须为正整数"));
+            r.k = int(qMin(nums[3], 1e6));
+        }
+    }
+    else {
+        return fail(QStringLiteral("未知查询：%1（可用 box / point / knn）").arg(kind));
+    }
+    if (r.kind != Query::Box) std::copy(nums.cbegin(), nums.cbegin() + 3, r.point);
+    *q = r;
+    return true;
+}
+
+QByteArray GfcSpatialIndex::serialize() const
+{
+    QByteArray out;
+    QDataStream ds(&out, QIODevice::WriteOnly);
+    ds.setByteOrder(QDataStream::LittleEndian);
+    auto writeBox = [&ds](const GfcAabb& b) {
+        for (int k = 0; k < 3; ++k) ds << b.min[k];
+        for (int k = 0; k < 3; ++k) ds << b.max[k];
+    };
+    ds << kFormat << quint32(items_.size()) << quint32(nodes_.size());
+    for (const Item& it : items_) {
+        ds << it.id;
+        writeBox(it.box);
+    }
+    for (const Node& node : nodes_) {
+        writeBox(node.box);
+        ds << qint32(node.first) << qint32(node.count) << quint8(node.leaf);
+    }
+    return out;
+}
+
+bool GfcSpatialIndex::deserialize(const QByteArray& data)
+{
+    QDataStream ds(data);
+    ds.setByteOrder(QDataStream::LittleEndian);
+    auto readBox = [&ds](GfcAabb* b) {
+        for (int k = 0; k < 3; ++k) ds >> b->min[k];
+        for (int k = 0; k < 3; ++k) ds >> b->max[k];
+    };
+    quint32 format = 0, itemCount = 0, nodeCount = 0;
+    ds >> format >> itemCount >> nodeCount;
+    // 条目 56 字节、结点 57 字节，先按数据长度核对数量，避免按损坏的计数分配
+    if (ds.status() != QDataStream::Ok || format != kFormat
+        || qint64(itemCount) * 56 + qint64(nodeCount) * 57 + 12 != data.size()) {
+        return false;
+    }
+    QVector<Item> items(static_cast<int>(itemCount));
+    QVector<Node> nodes(static_cast<int>(nodeCount));
+    for (Item& it : items) {
+        ds >> it.id;
+        readBox(&it.box);
+    }
+    for (int i = 0; i < nodes.size(); ++i) {
+        Node& node = nodes[i];
+        qint32 first = 0, count = 0;
+        quint8 leaf = 0;
+        readBox(&node.box);
+        ds >> first >> count >> leaf;
+        node.first = first;
+        node.count = count;
+        node.leaf = leaf != 0;
+        const int limit = node.leaf ? items.size() : i;   // 父结点总在子结点之后
+        if (first < 0 || count <= 0 || count > limit - first) return false;
+    }
+    if (ds.status() != QDataStream::Ok || (items.isEmpty() != nodes.isEmpty())) return false;
+    items_.swap(items);
+    nodes_.swap(nodes);
+    return true;
+}
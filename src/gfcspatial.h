@@ -0,0 +1,82 @@
+#pragma once
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+#include "gfcgeometry.h"
+
+class CompiledSchema;
+class GfcIndex;
+
+/**
+ * 构件包围盒空间索引（STR 批量装载的 R 树）：
+ * - 包围盒：GfcGeometryEvaluator 计算的世界包围盒；无法计算时退回形体声明的 GfcShape.BoundingBox；
+ *   两者都没有的构件不入索引。逐构件并行计算
+ * - 装载：按中心 x 排序切成 S 片，片内按 y 切条、条内按 z 排序，每 16 个为一个叶结点；
+ *   上层结点重复同样过程，直到只剩根。各片的排序在线程池上并行
+ * - 布局：结点数组按层连续存放，子结点（或叶中的构件）为连续区间，根为最后一个结点
+ * - 查询：框选（相交）、点选（包含点的包围盒）、k 近邻（按点到包围盒的距离，最佳优先）
+ * - 序列化为旁路索引中的 "spatial" 段（小端，带格式版本）
+ */
+
+class GfcSpatialIndex {
+public:
+    static constexpr int kNodeCapacity = 16;
+    static constexpr quint32 kFormat = 1;
+    static const char* sidecarTag() { return "spatial"; }
+
+    struct Item {
+        qint64 id = -1;
+        GfcAabb box;
+    };
+    struct Hit {
+        qint64 id = -1;
+        double distance = 0;      // k 近邻：点到包围盒的距离；其余为 0
+    };
+    struct Query {
+        enum Kind { Box, Point, Nearest };
+        Kind kind = Box;
+        GfcAabb box;              // Box：查询框
+        double point[3] = {};     // Point / Nearest：查询点
+        int k = 10;               // Nearest：个数
+    };
+    struct BuildStats {
+        int elements = 0;
+        int indexed = 0;          // 入索引的构件
+        int declared = 0;         // 其中使用声明包围盒的
+        int nodes = 0;
+        qint64 elapsedMs = 0;
+    };
+
+    // 计算全部构件的包围盒并装载
+    static GfcSpatialIndex build(const GfcIndex& index, const CompiledSchema& schema, BuildStats* stats = nullptr);
+    // 用给定条目装载（空包围盒的条目被丢弃）
+    void load(QVector<Item> items);
+
+    int size() const { return items_.size(); }
+    bool isEmpty() const { return items_.isEmpty(); }
+    GfcAabb bounds() const { return nodes_.isEmpty() ? GfcAabb() : nodes_.last().box; }
+
+    // 结果按 id 升序（k 近邻按距离升序）
+    QVector<Hit> intersects(const GfcAabb& box) const;
+    QVector<Hit> containing(double x, double y, double z) const;
+    QVector<Hit> nearest(double x, double y, double z, int k) const;
+    QVector<Hit> run(const Query& q) const;
+
+    // "box x0 y0 z0 x1 y1 z1" / "point x y z" / "knn x y z [k]"，数字以空格或逗号分隔
+    static bool parseQuery(const QString& text, Query* q, QString* err = nullptr);
+
+    QByteArray serialize() const;
+    bool deserialize(const QByteArray& data);
+
+private:
+    struct Node {
+        GfcAabb box;
+        int first = 0;            // 叶：items_ 下标；否则 nodes_ 下标
+        int count = 0;
+        bool leaf = true;
+    };
+
+    QVector<Item> items_;
+    QVector<Node> nodes_;
+};
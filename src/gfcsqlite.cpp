@@ -0,0 +1,551 @@
+#include "gfcsqlite.h"
+#include "gfcexportcommon.h"
+#include "gfcindex.h"
+#include "gfcnumber.h"
+#include "gfcparallel.h"
+#include "gfctyped.h"
+#include "perftrace.h"
+#include "schemacache.h"
+
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QSet>
+#include <QThread>
+#include <cmath>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifdef GFC_HAVE_SQLITE
+#include <sqlite3.h>
+#endif
+
+#ifdef GFC_HAVE_SQLITE
+namespace {
+
+// 一个单元格：文本为所在块 text 中的区间
+struct Cell {
+    enum Kind : quint8 { Null, Int, Real, Text };
+    Kind kind = Null;
+    qint64 i = 0;
+    double d = 0;
+    int off = 0;
+    int len = 0;
+};
+
+struct Link {
+    qint64 src;
+    int column;
+    int pos;
+    qint64 dst;
+};
+
+// 一块解码结果：rows × (1 + 列数) 个单元格（首列为 id）
+struct Decoded {
+    std::vector<Cell> cells;
+    QByteArray text;
+    std::vector<Link> links;
+};
+
+void textCell(std::string_view s, Cell& c, QByteArray& text)
+{
+    c.kind = Cell::Text;
+    c.off = text.size();
+    c.len = int(s.size());
+    text.append(s.data(), int(s.size()));
+}
+
+// 标量值 → 单元格；列表（及多值类型值）写为 JSON 文本
+void decodeCell(std::string_view v, Cell& c, QByteArray& text, std::string& tmp, QByteArray& json)
+{
+    c = Cell();
+    if (v.empty() || v[0] == '$' || v[0] == '*') return;
+    switch (v[0]) {
+    case '\'': {
+        gfc::ArgReader r(v);
+        if (!r.readString(tmp)) tmp.assign(v);
+        textCell(tmp, c, text);
+        return;
+    }
+    case '.': {
+        const std::string_view name = v.size() >= 2 ? v.substr(1, v.size() - 2) : std::string_view();
+        if (name == "T" || name == "TRUE") { c.kind = Cell::Int; c.i = 1; }
+        else if (name == "F" || name == "FALSE") { c.kind = Cell::Int; c.i = 0; }
+        else if (name != "U" && name != "UNKNOWN") textCell(name, c, text);
+        return;
+    }
+    case '#': {
+        std::int64_t id = 0;
+        const char* p = v.data() + 1;
+        while (p < v.data() + v.size() && gfc::isSpace(*p)) ++p;
+        if (gfc::parseInteger(p, v.data() + v.size(), id)) {
+            c.kind = Cell::Int;
+            c.i = id;
+        }
+        return;
+    }
+    case '(':
+        json.clear();
+        gfc::appendJson(v, json, tmp);
+        textCell(std::string_view(json.constData(), size_t(json.size())), c, text);
+        return;
+    default:
+        break;
+    }
+    std::string_view inner;
+    if (gfc::typedInner(v, &inner)) {
+        int count = 0;
+        gfc::forEachValue(inner, [&](std::string_view) { ++count; });
+        if (count == 1) {
+            decodeCell(gfc::trim(inner), c, text, tmp, json);
+        }
+        else {
+            json.clear();
+            gfc::appendJson(v, json, tmp);
+            textCell(std::string_view(json.constData(), size_t(json.size())), c, text);
+        }
+        return;
+    }
+    const char* end = v.data() + v.size();
+    std::int64_t n = 0;
+    double d = 0;
+    if (gfc::parseInteger(v.data(), end, n) == end) {
+        c.kind = Cell::Int;
+        c.i = n;
+    }
+    else if (gfc::parseRealExact(v.data(), end, d)) {
+        if (std::isfinite(d)) {
+            c.kind = Cell::Real;
+            c.d = d;
+        }
+    }
+    else {
+        textCell(v, c, text);
+    }
+}
+
+// 聚合值里的引用逐项记为链接（嵌套列表展平计位）
+void collectLinks(std::string_view v, qint64 src, int column, int& pos, std::vector<Link>& out)
+{
+    gfc::forEachValue(v, [&](std::string_view item) {
+        if (!item.empty() && item[0] == '(') {
+            collectLinks(item.substr(1, item.size() >= 2 ? item.size() - 2 : 0), src, column, pos, out);
+            return;
+        }
+        if (!item.empty() && item[0] == '#') {
+            std::int64_t id = 0;
+            if (gfc::parseInteger(item.data() + 1, item.data() + item.size(), id)) out.push_back({ src, column, pos, id });
+        }
+        ++pos;
+    });
+}
+
+// 按文件类预备的表结构
+struct Table {
+    QByteArray name;                 // CamelCase（Schema 中没有时为原文大写类名）
+    int entity = -1;
+    QVector<QByteArray> columns;     // 列名（已避开 id 与重名）
+    QVector<QByteArray> attrs;       // 对应属性名（未知类为 _n）
+    QVector<QByteArray> sqlTypes;    // 列类型（未知为空：无类型亲和）
+    QVector<quint8> isRef;           // 单值引用列：建索引
+};
+
+QByteArray quoted(const QByteArray& id)
+{
+    QByteArray out("\"");
+    for (char c : id) {
+        if (c == '"') out += '"';
+        out += c;
+    }
+    return out + '"';
+}
+
+QByteArray sqlType(const CompiledAttr& a)
+{
+    if (a.aggregate > 0) return "TEXT";
+    switch (a.base) {
+    case GfcBaseType::Real: return "REAL";
+    case GfcBaseType::Integer:
+    case GfcBaseType::Boolean:
+    case GfcBaseType::Logical:
+    case GfcBaseType::Entity: return "INTEGER";
+    case GfcBaseType::String:
+    case GfcBaseType::Binary:
+    case GfcBaseType::Enum: return "TEXT";
+    default: return QByteArray();
+    }
+}
+
+const char* baseName(const CompiledAttr& a)
+{
+    switch (a.base) {
+    case GfcBaseType::Real: return "REAL";
+    case GfcBaseType::Integer: return "INTEGER";
+    case GfcBaseType::Boolean: return "BOOLEAN";
+    case GfcBaseType::Logical: return "LOGICAL";
+    case GfcBaseType::String: return "STRING";
+    case GfcBaseType::Binary: return "BINARY";
+    case GfcBaseType::Enum: return "ENUMERATION";
+    case GfcBaseType::Entity: return "ENTITY";
+    default: return "";
+    }
+}
+
+Table makeTable(const GfcIndex& ix, const CompiledSchema& schema, int cls, int extraColumns)
+{
+    Table t;
+    t.entity = ix.schemaEntity(cls);
+    t.name = t.entity >= 0 ? schema.name(t.entity).toUtf8() : ix.className(cls);
+    QSet<QByteArray> used;
+    used.insert("id");
+    const int known = t.entity >= 0 ? schema.attributeCount(t.entity) : 0;
+    for (int k = 0; k < known + extraColumns; ++k) {
+        const CompiledAttr* a = k < known ? &schema.attribute(t.entity, k) : nullptr;
+        const QByteArray attr = a ? a->name.toUtf8() : "_" + QByteArray::number(k + 1);
+        QByteArray col = attr;
+        while (used.contains(col.toLower())) col += '_';
+        used.insert(col.toLower());
+        t.columns << col;
+        t.attrs << attr;
+        t.sqlTypes << (a ? sqlType(*a) : QByteArray());
+        t.isRef << quint8(a && a->aggregate == 0 && a->base == GfcBaseType::Entity);
+    }
+    return t;
+}
+
+// 连接与语句的收尾；失败时删除临时文件
+class Database {
+public:
+    explicit Database(const QString& path) : path_(path) {}
+    ~Database()
+    {
+        for (sqlite3_stmt* s : stmts_) sqlite3_finalize(s);
+        if (db_) sqlite3_close(db_);
+        if (!kept_) QFile::remove(path_);
+    }
+
+    bool open(QString* err)
+    {
+        QFile::remove(path_);
+        if (sqlite3_open_v2(path_.toUtf8().constData(), &db_, SQLITE_OPEN_READWRITE | SQLITE_OPEN_CREATE, nullptr)
+            != SQLITE_OK) {
+            return fail(err);
+        }
+        return true;
+    }
+
+    bool exec(const QByteArray& sql, QString* err)
+    {
+        return sqlite3_exec(db_, sql.constData(), nullptr, nullptr, nullptr) == SQLITE_OK || fail(err);
+    }
+
+    sqlite3_stmt* prepare(const QByteArray& sql, QString* err)
+    {
+        sqlite3_stmt* s = nullptr;
+        if (sqlite3_prepare_v3(db_, sql.constData(), sql.size() + 1, SQLITE_PREPARE_PERSISTENT, &s, nullptr) != SQLITE_OK) {
+            fail(err);
+            return nullptr;
+        }
+        stmts_ << s;
+        return s;
+    }
+
+    void release(sqlite3_stmt* s)
+    {
+        stmts_.removeOne(s);
+        sqlite3_finalize(s);
+    }
+
+    bool step(sqlite3_stmt* s, QString* err)
+    {
+        const int rc = sqlite3_step(s);
+        sqlite3_reset(s);
+        return rc == SQLITE_DONE || fail(err);
+    }
+
+    bool close(QString* err)
+    {
+        for (sqlite3_stmt* s : stmts_) sqlite3_finalize(s);
+        stmts_.clear();
+        const int rc = sqlite3_close(db_);
+        db_ = nullptr;
+        if (rc != SQLITE_OK) {
+            if (err) *err = QStringLiteral("SQLite：关闭数据库失败");
+            return false;
+        }
+        kept_ = true;
+        return true;
+    }
+
+    bool fail(QString* err)
+    {
+        if (err) *err = QStringLiteral("SQLite：%1").arg(QString::fromUtf8(db_ ? sqlite3_errmsg(db_) : "无法打开数据库"));
+        return false;
+    }
+
+private:
+    QString path_;
+    sqlite3* db_ = nullptr;
+    QVector<sqlite3_stmt*> stmts_;
+    bool kept_ = false;
+};
+
+bool bindCell(sqlite3_stmt* s, int k, const Cell& c, const QByteArray& text)
+{
+    switch (c.kind) {
+    case Cell::Int: return sqlite3_bind_int64(s, k, c.i) == SQLITE_OK;
+    case Cell::Real: return sqlite3_bind_double(s, k, c.d) == SQLITE_OK;
+    case Cell::Text: return sqlite3_bind_text(s, k, text.constData() + c.off, c.len, SQLITE_STATIC) == SQLITE_OK;
+    default: return sqlite3_bind_null(s, k) == SQLITE_OK;
+    }
+}
+
+// 临时库替换目标：先直接改名覆盖（POSIX 下原子）；不支持覆盖时把旧库改名为备份，
+// 新库改名失败则还原备份，任何时刻目标要么是旧库要么是新库
+bool replaceFile(const QString& tmpPath, const QString& path, QString* err)
+{
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    fs::rename(fs::u8path(tmpPath.toStdString()), fs::u8path(path.toStdString()), ec);
+    if (!ec) return true;
+
+    const QString backup = path + QStringLiteral(".bak");
+    const bool hadOld = QFile::exists(path);
+    if (hadOld) {
+        QFile::remove(backup);
+        if (!QFile::rename(path, backup)) {
+            QFile::remove(tmpPath);
+            if (err) *err = QStringLiteral("无法替换目标文件：%1").arg(path);
+            return false;
+        }
+    }
+    if (!QFile::rename(tmpPath, path)) {
+        if (hadOld) QFile::rename(backup, path);
+        QFile::remove(tmpPath);
+        if (err) *err = QStringLiteral("无法替换目标文件：%1").arg(path);
+        return false;
+    }
+    if (hadOld) QFile::remove(backup);
+    return true;
+}
+
+} // namespace
+
+bool GfcSqliteExport::available()
+{
+    return true;
+}
+
+bool GfcSqliteExport::write(const GfcIndex& ix, const CompiledSchema& schema, const QString& path,
+                            const Options& opt, Stats* stats, QString* err)
+{
+    GFC_PERF_SCOPE("导出 SQLite");
+    QElapsedTimer timer;
+    timer.start();
+    QVector<quint8> classOk;
+    if (!gfc::selectClasses(ix, schema, opt.classes, &classOk, err)) return false;
+
+    // 按类计数排序（类内保持文件顺序）
+    const int classes = ix.classCount();
+    QVector<int> start(classes + 1, 0);
+    for (int r = 0; r < ix.size(); ++r) {
+        if (classOk[ix.at(r).cls]) ++start[ix.at(r).cls + 1];
+    }
+    for (int c = 0; c < classes; ++c) start[c + 1] += start[c];
+    QVector<int> rows(start[classes]);
+    QVector<int> fill = start;
+    for (int r = 0; r < ix.size(); ++r) {
+        if (classOk[ix.at(r).cls]) rows[fill[ix.at(r).cls]++] = r;
+    }
+
+    // Schema 中没有的类取其实例的最多参数个数
+    QVector<int> extra(classes, 0);
+    for (int r : rows) {
+        const int c = ix.at(r).cls;
+        if (ix.schemaEntity(c) >= 0) continue;
+        int k = 0;
+        gfc::forEachValue(ix.args(r), [&k](std::string_view) { ++k; });
+        extra[c] = qMax(extra[c], k);
+    }
+    QVector<Table> tables(classes);
+    for (int c = 0; c < classes; ++c) {
+        if (start[c] < start[c + 1]) tables[c] = makeTable(ix, schema, c, extra[c]);
+    }
+
+    struct Chunk { int cls; int begin; int end; };
+    QVector<Chunk> chunks;
+    for (int c = 0; c < classes; ++c) {
+        for (int b = start[c]; b < start[c + 1]; b += kChunkRows) chunks.push_back({ c, b, qMin(start[c + 1], b + kChunkRows) });
+    }
+
+    const QString tmpPath = path + QStringLiteral(".part");
+    Database db(tmpPath);
+    if (!db.open(err)) return false;
+    if (!db.exec("PRAGMA page_size=65536; PRAGMA journal_mode=OFF; PRAGMA synchronous=OFF; "
+                 "PRAGMA locking_mode=EXCLUSIVE; PRAGMA temp_store=MEMORY; PRAGMA cache_size=-262144;", err)
+        || !db.exec("CREATE TABLE gfc_instances(id INTEGER PRIMARY KEY, class TEXT NOT NULL);"
+                    "CREATE TABLE gfc_links(src INTEGER NOT NULL, attr TEXT NOT NULL, pos INTEGER NOT NULL, dst INTEGER NOT NULL);"
+                    "CREATE TABLE gfc_columns(tbl TEXT NOT NULL, col TEXT NOT NULL, attr TEXT NOT NULL, type TEXT, base TEXT, optional INTEGER);",
+                    err)) {
+        return false;
+    }
+    int tableCount = 0;
+    for (const Table& t : tables) {
+        if (t.name.isEmpty()) continue;
+        QByteArray sql = "CREATE TABLE " + quoted(t.name) + "(id INTEGER PRIMARY KEY";
+        for (int k = 0; k < t.columns.size(); ++k) {
+            sql += ", " + quoted(t.columns[k]);
+            if (!t.sqlTypes[k].isEmpty()) sql += ' ' + t.sqlTypes[k];
+        }
+        if (!db.exec(sql + ");", err)) return false;
+        ++tableCount;
+    }
+
+    sqlite3_stmt* insInstance = db.prepare("INSERT OR IGNORE INTO gfc_instances(id, class) VALUES(?, ?)", err);
+    sqlite3_stmt* insLink = db.prepare("INSERT INTO gfc_links(src, attr, pos, dst) VALUES(?, ?, ?, ?)", err);
+    if (!insInstance || !insLink || !db.exec("BEGIN", err)) return false;
+
+    // 分块并行解码，每轮取线程数两倍的块，按序插入
+    auto decode = [&](const Chunk& ch, Decoded& out) {
+        const int width = tables[ch.cls].columns.size() + 1;
+        const bool known = ix.schemaEntity(ch.cls) >= 0;
+        out.cells.resize(size_t(ch.end - ch.begin) * size_t(width));
+        std::string tmp;
+        QByteArray json;
+        for (int i = ch.begin; i < ch.end; ++i) {
+            const int r = rows[i];
+            Cell* cells = &out.cells[size_t(i - ch.begin) * size_t(width)];
+            cells[0].kind = Cell::Int;
+            cells[0].i = ix.at(r).id;
+            int k = 0;
+            gfc::forEachValue(ix.args(r), [&](std::string_view v) {
+                if (k >= width - 1) return;   // 多出的参数不写（列按 Schema 固定）
+                decodeCell(v, cells[k + 1], out.text, tmp, json);
+                if (known && !v.empty() && v[0] == '(') {
+                    int pos = 0;
+                    collectLinks(v.substr(1, v.size() >= 2 ? v.size() - 2 : 0), cells[0].i, k, pos, out.links);
+                }
+                ++k;
+            });
+        }
+    };
+
+    const int wave = qMax(1, QThread::idealThreadCount() * 2);
+    int current = -1;
+    sqlite3_stmt* insRow = nullptr;
+    qint64 done = 0, sinceCommit = 0, links = 0;
+    for (int w = 0; w < chunks.size(); w += wave) {
+        const int m = qMin(wave, chunks.size() - w);
+        QVector<Decoded> decoded(m);
+        gfc::parallelParts(m, m, [&](int b, int e, int) {
+            for (int i = b; i < e; ++i) decode(chunks[w + i], decoded[i]);
+        });
+
+        for (int i = 0; i < m; ++i) {
+            if (opt.write.cancelled()) {
+                if (err) *err = QStringLiteral("已取消");
+                return false;
+            }
+            const Chunk& ch = chunks[w + i];
+            const Table& t = tables[ch.cls];
+            if (ch.cls != current) {
+                if (insRow) db.release(insRow);
+                QByteArray sql = "INSERT OR IGNORE INTO " + quoted(t.name) + " VALUES(?";
+                for (int k = 0; k < t.columns.size(); ++k) sql += ",?";
+                insRow = db.prepare(sql + ')', err);
+                if (!insRow) return false;
+                current = ch.cls;
+            }
+            const Decoded& d = decoded[i];
+            const int width = t.columns.size() + 1;
+            for (int row = 0; row < ch.end - ch.begin; ++row) {
+                const Cell* cells = &d.cells[size_t(row) * size_t(width)];
+                bool ok = true;
+                for (int k = 0; k < width; ++k) ok = ok && bindCell(insRow, k + 1, cells[k], d.text);
+                ok = ok && sqlite3_bind_int64(insInstance, 1, cells[0].i) == SQLITE_OK
+                    && sqlite3_bind_text(insInstance, 2, t.name.constData(), t.name.size(), SQLITE_STATIC) == SQLITE_OK;
+                if (!ok) return db.fail(err);
+                if (!db.step(insRow, err) || !db.step(insInstance, err)) return false;
+            }
+            for (const Link& l : d.links) {
+                const QByteArray& attr = t.attrs[l.column];
+                if (sqlite3_bind_int64(insLink, 1, l.src) != SQLITE_OK
+                    || sqlite3_bind_text(insLink, 2, attr.constData(), attr.size(), SQLITE_STATIC) != SQLITE_OK
+                    || sqlite3_bind_int(insLink, 3, l.pos) != SQLITE_OK
+                    || sqlite3_bind_int64(insLink, 4, l.dst) != SQLITE_OK) {
+                    return db.fail(err);
+                }
+                if (!db.step(insLink, err)) return false;
+            }
+            links += qint64(d.links.size());
+            done += ch.end - ch.begin;
+            sinceCommit += ch.end - ch.begin;
+            if (sinceCommit >= kTxRows) {
+                if (!db.exec("COMMIT; BEGIN", err)) return false;
+                sinceCommit = 0;
+            }
+            if (opt.write.progress) opt.write.progress(done, rows.size());
+        }
+    }
+
+    // 列说明与索引：数据写完后再建，插入时不维护二级索引
+    sqlite3_stmt* insColumn = db.prepare("INSERT INTO gfc_columns VALUES(?, ?, ?, ?, ?, ?)", err);
+    if (!insColumn) return false;
+    QByteArray indexSql = "CREATE INDEX gfc_instances_class ON gfc_instances(class);"
+                          "CREATE INDEX gfc_links_src ON gfc_links(src);"
+                          "CREATE INDEX gfc_links_dst ON gfc_links(dst);";
+    int indexes = 3;
+    for (const Table& t : tables) {
+        if (t.name.isEmpty()) continue;
+        const int known = t.entity >= 0 ? schema.attributeCount(t.entity) : 0;
+        for (int k = 0; k < t.columns.size(); ++k) {
+            const CompiledAttr* a = k < known ? &schema.attribute(t.entity, k) : nullptr;
+            const QByteArray type = a ? a->type.toUtf8() : QByteArray();
+            const char* base = a ? baseName(*a) : "";
+            bool ok = sqlite3_bind_text(insColumn, 1, t.name.constData(), t.name.size(), SQLITE_STATIC) == SQLITE_OK
+                && sqlite3_bind_text(insColumn, 2, t.columns[k].constData(), t.columns[k].size(), SQLITE_STATIC) == SQLITE_OK
+                && sqlite3_bind_text(insColumn, 3, t.attrs[k].constData(), t.attrs[k].size(), SQLITE_STATIC) == SQLITE_OK
+                && sqlite3_bind_text(insColumn, 4, type.constData(), type.size(), SQLITE_STATIC) == SQLITE_OK
+                && sqlite3_bind_text(insColumn, 5, base, -1, SQLITE_STATIC) == SQLITE_OK
+                && sqlite3_bind_int(insColumn, 6, a && a->optional ? 1 : 0) == SQLITE_OK;
+            if (!ok) return db.fail(err);
+            if (!db.step(insColumn, err)) return false;
+            if (t.isRef[k]) {
+                indexSql += "CREATE INDEX " + quoted(t.name + '_' + t.columns[k]) + " ON " + quoted(t.name) + '('
+                    + quoted(t.columns[k]) + ");";
+                ++indexes;
+            }
+        }
+    }
+    if (!db.exec("COMMIT", err) || !db.exec(indexSql, err) || !db.close(err)) return false;
+
+    if (!replaceFile(tmpPath, path, err)) return false;
+
+    if (stats) {
+        stats->instances = rows.size();
+        stats->tables = tableCount;
+        stats->links = links;
+        stats->indexes = indexes;
+        stats->bytesOut = QFileInfo(path).size();
+        stats->elapsedMs = timer.elapsed();
+    }
+    PerfTrace::instance().setCounter(QStringLiteral("导出实例"), rows.size());
+    return true;
+}
+
+#else
+
+bool GfcSqliteExport::available()
+{
+    return false;
+}
+
+bool GfcSqliteExport::write(const GfcIndex&, const CompiledSchema&, const QString&, const Options&, Stats*, QString* err)
+{
+    if (err) *err = QStringLiteral("本版本未启用 SQLite 支持");
+    return false;
+}
+
+#endif // GFC_HAVE_SQLITE
@@ -0,0 +1,46 @@
+#pragma once
+#include <QString>
+#include <QStringList>
+
+#include "gfcwriter.h"
+
+class CompiledSchema;
+class GfcIndex;
+
+/**
+ * 导出为 SQLite 数据库，供即席 SQL 分析：
+ * - 每个类一张表（表名为 CamelCase 类名），id INTEGER PRIMARY KEY，其后每个 Schema 属性一列，
+ *   列类型按解析后的基本类型：REAL / INTEGER（整数、布尔、单值引用存目标 id）/ TEXT（字符串、枚举）；
+ *   聚合值存为 JSON 文本；与 id 同名（大小写无关）的属性列名后加 _
+ * - gfc_instances(id, class)：全部导出实例；gfc_links(src, attr, pos, dst)：聚合值里的引用逐项一行
+ * - gfc_columns(tbl, col, attr, type, base, optional)：各列对应的 Schema 属性与类型
+ * 实例按类分块并行解码为单元格，单线程用预编译语句批量插入，每约 kTxRows 行提交一次事务；
+ * 数据写完后再建引用列与 gfc_links 的索引。先写同目录临时文件，成功后改名覆盖目标，失败时原库保持不变。
+ * 需构建时找到 SQLite3（GFC_HAVE_SQLITE），否则 available() 为 false。
+ */
+
+struct GfcSqliteOptions {
+    QStringList classes;          // 只导出这些类（含子类）；空为全部
+    GfcWriter::Options write;     // progress(已插入实例, 总实例)、cancel
+};
+
+class GfcSqliteExport {
+public:
+    using Options = GfcSqliteOptions;
+    static constexpr int kChunkRows = 8192;
+    static constexpr int kTxRows = 1 << 20;
+
+    struct Stats {
+        qint64 instances = 0;
+        int tables = 0;
+        qint64 links = 0;
+        int indexes = 0;
+        qint64 bytesOut = 0;
+        qint64 elapsedMs = 0;
+    };
+
+    static bool available();
+
+    static bool write(const GfcIndex& index, const CompiledSchema& schema, const QString& path,
+                      const Options& opt = Options(), Stats* stats = nullptr, QString* err = nullptr);
+};
@@ -0,0 +1,292 @@
+#include "gfctableexport.h"
+#include "gfccompress.h"
+#include "gfcexportcommon.h"
+#include "gfcindex.h"
+#include "gfcnumber.h"
+#include "gfcparallel.h"
+#include "gfctyped.h"
+#include "perftrace.h"
+#include "schemacache.h"
+
+#include <QDir>
+#include <QElapsedTimer>
+#include <QThread>
+#include <cmath>
+#include <string>
+#include <string_view>
+
+namespace {
+
+// 一个参数值写为 CSV 单元格：标量直接写，列表与类型值写 JSON 文本
+void appendCell(std::string_view v, QByteArray& out, std::string& tmp, QByteArray& json)
+{
+    if (v.empty() || v[0] == '$' || v[0] == '*') return;
+    if (v[0] == '\'') {
+        gfc::ArgReader r(v);
+        if (!r.readString(tmp)) tmp.assign(v);
+        gfc::appendCsvText(tmp, out);
+        return;
+    }
+    json.clear();
+    gfc::appendJson(v, json, tmp);
+    if (json == "null") return;
+    gfc::appendCsvText(std::string_view(json.constData(), size_t(json.size())), out);
+}
+
+// 按文件类预备的字段名
+struct ClassLayout {
+    QByteArray name;                  // CamelCase（Schema 中没有时为原文大写类名）
+    QVector<QByteArray> jsonKeys;     // ,"Name":
+    int entity = -1;
+};
+
+QVector<ClassLayout> layouts(const GfcIndex& ix, const CompiledSchema& schema)
+{
+    QVector<ClassLayout> out(ix.classCount());
+    for (int c = 0; c < ix.classCount(); ++c) {
+        ClassLayout& l = out[c];
+        l.entity = ix.schemaEntity(c);
+        l.name = l.entity >= 0 ? schema.name(l.entity).toUtf8() : ix.className(c);
+        const int n = l.entity >= 0 ? schema.attributeCount(l.entity) : 0;
+        for (int i = 0; i < n; ++i) {
+            l.jsonKeys << ",\"" + schema.attribute(l.entity, i).name.toUtf8() + "\":";
+        }
+    }
+    return out;
+}
+
+QByteArray extraKey(int i)
+{
+    return ",\"_" + QByteArray::number(i + 1) + "\":";
+}
+
+// 分块并行转换：chunks 个块每轮取线程数两倍，转换后按序交给 sink
+template <class Convert, class Sink>
+bool runChunks(int chunks, Convert&& convert, Sink&& sink)
+{
+    const int wave = qMax(1, QThread::idealThreadCount() * 2);
+    for (int w = 0; w < chunks; w += wave) {
+        const int m = qMin(wave, chunks - w);
+        QVector<QByteArray> pieces(m);
+        gfc::parallelParts(m, m, [&](int b, int e, int) {
+            for (int i = b; i < e; ++i) convert(w + i, pieces[i]);
+        });
+        for (int i = 0; i < m; ++i) {
+            if (!sink(w + i, pieces[i])) return false;
+            pieces[i].clear();
+        }
+    }
+    return true;
+}
+
+bool openWriter(GfcStreamWriter& out, const QString& path, const GfcWriter::Options& base, QString* err)
+{
+    GfcWriter::Options wopt = base;
+    wopt.compression = GfcCompress::codecForPath(path);
+    if (!GfcCompress::available(wopt.compression)) {
+        if (err) *err = QStringLiteral("本版本未启用 %1 支持").arg(GfcCompress::codecName(wopt.compression));
+        return false;
+    }
+    return out.open(path, wopt, err);
+}
+
+} // namespace
+
+bool GfcTableExport::writeNdjson(const GfcIndex& ix, const CompiledSchema& schema, const QString& path,
+                                 const Options& opt, Stats* stats, QString* err)
+{
+    GFC_PERF_SCOPE("导出 NDJSON");
+    QElapsedTimer timer;
+    timer.start();
+    QVector<quint8> classOk;
+    if (!gfc::selectClasses(ix, schema, opt.classes, &classOk, err)) return false;
+    const QVector<ClassLayout> layout = layouts(ix, schema);
+    QVector<int> rows;
+    for (int r = 0; r < ix.size(); ++r) {
+        if (classOk[ix.at(r).cls]) rows << r;
+    }
+
+    GfcStreamWriter out;
+    if (!openWriter(out, path, opt.write, err)) return false;
+    const int chunks = (rows.size() + kChunkRows - 1) / kChunkRows;
+    auto convert = [&](int chunk, QByteArray& buf) {
+        std::string tmp;
+        const int b = chunk * kChunkRows, e = qMin(rows.size(), b + kChunkRows);
+        for (int i = b; i < e; ++i) {
+            const int r = rows[i];
+            const GfcIndexEntry& en = ix.at(r);
+            const ClassLayout& l = layout[en.cls];
+            buf += "{\"id\":";
+            buf += QByteArray::number(en.id);
+            buf += ",\"class\":";
+            gfc::appendJsonString(std::string_view(l.name.constData(), size_t(l.name.size())), buf);
+            int k = 0;
+            gfc::forEachValue(ix.args(r), [&](std::string_view v) {
+                buf += k < l.jsonKeys.size() ? l.jsonKeys[k] : extraKey(k);
+                gfc::appendJson(v, buf, tmp);
+                ++k;
+            });
+            buf += "}\n";
+        }
+    };
+    qint64 done = 0;
+    const bool ok = runChunks(chunks, convert, [&](int chunk, const QByteArray& piece) {
+        if (opt.write.cancelled() || !out.write(piece)) return false;
+        done = qMin<qint64>(rows.size(), qint64(chunk + 1) * kChunkRows);
+        if (opt.write.progress) opt.write.progress(done, rows.size());
+        return true;
+    });
+    if (!ok) {
+        if (err) *err = opt.write.cancelled() ? QStringLiteral("已取消") : out.errorString();
+        return false;
+    }
+    if (!out.commit(err)) return false;
+
+    if (stats) {
+        stats->instances = rows.size();
+        stats->classes = 0;
+        for (int c = 0; c < ix.classCount(); ++c) stats->classes += classOk[c];
+        stats->files = 1;
+        stats->bytesOut = out.bytesWritten();
+        stats->elapsedMs = timer.elapsed();
+    }
+    PerfTrace::instance().setCounter(QStringLiteral("导出实例"), rows.size());
+    return true;
+}
+
+bool GfcTableExport::writeCsvTables(const GfcIndex& ix, const CompiledSchema& schema, const QString& dir,
+                                    const QString& suffix, const Options& opt, Stats* stats, QString* err)
+{
+    GFC_PERF_SCOPE("导出 CSV 表");
+    QElapsedTimer timer;
+    timer.start();
+    QVector<quint8> classOk;
+    if (!gfc::selectClasses(ix, schema, opt.classes, &classOk, err)) return false;
+    if (!QDir().mkpath(dir)) {
+        if (err) *err = QStringLiteral("无法创建目录：%1").arg(dir);
+        return false;
+    }
+    const QVector<ClassLayout> layout = layouts(ix, schema);
+
+    // 按类计数排序（类内保持文件顺序）
+    const int classes = ix.classCount();
+    QVector<int> start(classes + 1, 0);
+    for (int r = 0; r < ix.size(); ++r) {
+        if (classOk[ix.at(r).cls]) ++start[ix.at(r).cls + 1];
+    }
+    for (int c = 0; c < classes; ++c) start[c + 1] += start[c];
+    QVector<int> rows(start[classes]);
+    QVector<int> fill = start;
+    for (int r = 0; r < ix.size(); ++r) {
+        if (classOk[ix.at(r).cls]) rows[fill[ix.at(r).cls]++] = r;
+    }
+
+    // 列数：已知类为 Schema 属性数；Schema 中没有的类取其实例的最多参数个数
+    QVector<int> columns(classes, 0);
+    for (int c = 0; c < classes; ++c) columns[c] = layout[c].jsonKeys.size();
+    for (int r : rows) {
+        const int c = ix.at(r).cls;
+        if (layout[c].entity >= 0) continue;
+        int k = 0;
+        gfc::forEachValue(ix.args(r), [&k](std::string_view) { ++k; });
+        columns[c] = qMax(columns[c], k);
+    }
+
+    struct Chunk { int cls; int begin; int end; };
+    QVector<Chunk> chunks;
+    for (int c = 0; c < classes; ++c) {
+        for (int b = start[c]; b < start[c + 1]; b += kChunkRows) chunks.push_back({ c, b, qMin(start[c + 1], b + kChunkRows) });
+    }
+
+    auto convert = [&](int chunk, QByteArray& buf) {
+        std::string tmp;
+        QByteArray json;
+        const Chunk& ch = chunks[chunk];
+        for (int i = ch.begin; i < ch.end; ++i) {
+            const int r = rows[i];
+            buf += QByteArray::number(ix.at(r).id);
+            int k = 0;
+            gfc::forEachValue(ix.args(r), [&](std::string_view v) {
+                if (k++ >= columns[ch.cls]) return;   // 多出的参数不写（列已固定）
+                buf += ',';
+                appendCell(v, buf, tmp, json);
+            });
+            for (; k < columns[ch.cls]; ++k) buf += ',';
+            buf += '\n';
+        }
+    };
+
+    GfcStreamWriter out;
+    int current = -1, files = 0;
+    qint64 bytes = 0;
+    auto header = [&](int c) {
+        QByteArray h("\xEF\xBB\xBF" "id");
+        for (int k = 0; k < columns[c]; ++k) {
+            h += ',';
+            h += k < layout[c].jsonKeys.size() ? schema.attribute(layout[c].entity, k).name.toUtf8()
+                                               : "_" + QByteArray::number(k + 1);
+        }
+        return h + '\n';
+    };
+    auto closeCurrent = [&]() {
+        if (current < 0) return true;
+        if (!out.commit(err)) return false;
+        bytes += out.bytesWritten();
+        ++files;
+        return true;
+    };
+    const bool ok = runChunks(chunks.size(), convert, [&](int chunk, const QByteArray& piece) {
+        if (opt.write.cancelled()) {
+            if (err) *err = QStringLiteral("已取消");
+            return false;
+        }
+        const int c = chunks[chunk].cls;
+        if (c != current) {
+            if (!closeCurrent()) return false;
+            current = c;
+            const QString path = QDir(dir).filePath(QString::fromUtf8(layout[c].name) + suffix);
+            if (!openWriter(out, path, opt.write, err) || !out.write(header(c))) return false;
+        }
+        if (!out.write(piece)) {
+            if (err) *err = out.errorString();
+            return false;
+        }
+        if (opt.write.progress) opt.write.progress(chunks[chunk].end, rows.size());
+        return true;
+    });
+    if (!ok || !closeCurrent()) return false;
+
+    // 列说明：类,列,Schema 类型,可选
+    QByteArray cols("\xEF\xBB\xBF" "class,column,type,optional\n");
+    int classCount = 0;
+    for (int c = 0; c < classes; ++c) {
+        if (start[c] == start[c + 1]) continue;
+        ++classCount;
+        cols += layout[c].name + ",id,,false\n";
+        for (int k = 0; k < columns[c]; ++k) {
+            const bool known = k < layout[c].jsonKeys.size();
+            const CompiledAttr* a = known ? &schema.attribute(layout[c].entity, k) : nullptr;
+            cols += layout[c].name + ',';
+            cols += a ? a->name.toUtf8() : "_" + QByteArray::number(k + 1);
+            cols += ',';
+            if (a) gfc::appendCsvText(a->type.toStdString(), cols);
+            cols += a && a->optional ? ",true\n" : ",false\n";
+        }
+    }
+    GfcStreamWriter colsOut;
+    if (!openWriter(colsOut, QDir(dir).filePath(QStringLiteral("columns") + suffix), opt.write, err)
+        || !colsOut.write(cols) || !colsOut.commit(err)) {
+        if (err && err->isEmpty()) *err = colsOut.errorString();
+        return false;
+    }
+
+    if (stats) {
+        stats->instances = rows.size();
+        stats->classes = classCount;
+        stats->files = files + 1;
+        stats->bytesOut = bytes + colsOut.bytesWritten();
+        stats->elapsedMs = timer.elapsed();
+    }
+    PerfTrace::instance().setCounter(QStringLiteral("导出实例"), rows.size());
+    return true;
+}
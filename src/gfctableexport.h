@@ -0,0 +1,47 @@
+#pragma once
+#include <QString>
+#include <QStringList>
+
+#include "gfcwriter.h"
+
+class CompiledSchema;
+class GfcIndex;
+
+/**
+ * 面向分析工具的表格导出（按 Schema 展平属性表命名字段）：
+ * - NDJSON：每个实例一行 {"id":12,"class":"GfcFloor","Name":"F1","Height":3.6,"Body":5,...}；
+ *   引用写为目标 id，列表为数组，类型值取其内值，$ 为 null，.T./.F. 为 true/false，其它枚举为名称字符串
+ * - CSV：每个类一个 <类名>.csv（列为 id 与该类全部属性），另写 columns.csv 列出各列的 Schema 类型与是否可选；
+ *   列表与类型值在单元格内写为 JSON 文本
+ * 数值规整为 JSON 合法写法（3. -> 3.0）。Schema 中没有的类按参数位置命名为 _1、_2……；
+ * 已知类的实例参数多于 Schema 属性时，多出的在 NDJSON 中同样写为 _n，CSV 中不写（列按 Schema 固定）
+ * 实例按块（每块至多 kChunkRows 行）并行转换，每轮只持有线程数两倍的块，按序经 GfcStreamWriter 写出，
+ * 内存与文件大小无关；CSV 按类分块，各类文件依次打开、写完即提交。压缩由扩展名决定（.gz / .zst）。
+ */
+
+struct GfcTableExportOptions {
+    QStringList classes;          // 只导出这些类（含子类）；空为全部
+    GfcWriter::Options write;     // progress(已处理实例, 总实例)、cancel；compression 由扩展名决定
+};
+
+class GfcTableExport {
+public:
+    using Options = GfcTableExportOptions;
+    static constexpr int kChunkRows = 16384;
+
+    struct Stats {
+        qint64 instances = 0;
+        int classes = 0;
+        int files = 0;
+        qint64 bytesOut = 0;
+        qint64 elapsedMs = 0;
+    };
+
+    static bool writeNdjson(const GfcIndex& index, const CompiledSchema& schema, const QString& path,
+                            const Options& opt = Options(), Stats* stats = nullptr, QString* err = nullptr);
+
+    // dir 不存在时创建；suffix 为每个文件的扩展名（如 ".csv"、".csv.gz"）
+    static bool writeCsvTables(const GfcIndex& index, const CompiledSchema& schema, const QString& dir,
+                               const QString& suffix = QStringLiteral(".csv"), const Options& opt = Options(),
+                               Stats* stats = nullptr, QString* err = nullptr);
+};
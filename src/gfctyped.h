@@ -0,0 +1,436 @@
+#pragma once
+#include <charconv>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "gfcnumber.h"
+
+/**
+ * 生成代码（gfccodegen 产出的 gfc_entities.h）的运行时支持：
+ * - ArgReader：在实例参数区（#n=CLASS( ... ); 括号内的文本）上顺序读取，不切分子串、不查哈希
+ * - ArgWriter：按 STEP 语法写回参数区
+ * - Codec<T>：按字段的 C++ 类型在编译期选定解码/编码实现；EntityTraits<E> 由生成代码特化
+ * 只依赖标准库，插件与批处理工具可直接包含。
+ * 约定：非 OPTIONAL 字段读到 $ 时取默认值（现有导出文件里常见），编码时空引用写 $。
+ */
+
+namespace gfc {
+
+struct Ref {
+    std::int64_t id = -1;   // #id；-1 表示空（$）
+    bool isNull() const { return id < 0; }
+    bool operator==(const Ref& o) const { return id == o.id; }
+    bool operator!=(const Ref& o) const { return id != o.id; }
+};
+
+// 无法映射为具体 C++ 类型的值：保留原始参数文本
+struct Raw {
+    std::string text;
+};
+
+class ArgReader {
+public:
+    explicit ArgReader(std::string_view args)
+        : begin_(args.data()), p_(args.data()), end_(args.data() + args.size()) {}
+
+    bool ok() const { return ok_; }
+    bool fail() { ok_ = false; return false; }
+    // 已读到的位置（相对参数区起点）
+    std::size_t offset() const { return std::size_t(p_ - begin_); }
+
+    // 读到 $（空）或 *（派生）时消费并返回 true
+    bool readNull() {
+        if (!sep()) return false;
+        if (p_ < end_ && (*p_ == '$' || *p_ == '*')) { ++p_; needComma_ = true; return true; }
+        return false;
+    }
+
+    bool readDouble(double& v) {
+        if (!sep()) return false;
+        const char* e = parseReal(p_, end_, v);
+        if (!e) return fail();
+        p_ = e;
+        needComma_ = true;
+        return true;
+    }
+
+    bool readInt(std::int64_t& v) {
+        if (!sep()) return false;
+        const char* e = parseInteger(p_, end_, v);
+        if (!e) return fail();
+        if (e < end_ && (*e == '.' || *e == 'e' || *e == 'E')) {
+            // 整数字段写成了实数形式（如 3. 或 3.0）：按实数读后取整
+            double d = 0;
+            e = parseReal(p_, end_, d);
+            if (!e) return fail();
+            v = static_cast<std::int64_t>(d);
+        }
+        p_ = e;
+        needComma_ = true;
+        return true;
+    }
+
+    bool readBool(bool& v) {
+        std::string_view t;
+        if (!readEnum(t)) return false;
+        if (t == "T" || t == "TRUE") { v = true; return true; }
+        if (t == "F" || t == "FALSE" || t == "U" || t == "UNKNOWN") { v = false; return true; }
+        return fail();
+    }
+
+    bool readRef(Ref& v) {
+        if (!sep()) return false;
+        if (p_ >= end_ || *p_ != '#') return fail();
+        const char* s = p_ + 1;
+        while (s < end_ && *s == ' ') ++s;
+        const auto r = std::from_chars(s, end_, v.id);
+        if (r.ec != std::errc()) return fail();
+        p_ = r.ptr;
+        needComma_ = true;
+        return true;
+    }
+
+    // .NAME. -> NAME
+    bool readEnum(std::string_view& v) {
+        if (!sep()) return false;
+        if (p_ >= end_ || *p_ != '.') return fail();
+        const char* s = ++p_;
+        while (p_ < end_ && *p_ != '.') ++p_;
+        if (p_ >= end_) return fail();
+        v = std::string_view(s, std::size_t(p_ - s));
+        ++p_;
+        needComma_ = true;
+        return true;
+    }
+
+    // 'text'：'' 还原为 '，\X2\...\X0\（UTF-16 十六进制）与 \X\hh 解码为 UTF-8
+    bool readString(std::string& v) {
+        if (!sep()) return false;
+        if (p_ >= end_ || *p_ != '\'') return fail();
+        ++p_;
+        v.clear();
+        while (p_ < end_) {
+            const char c = *p_;
+            if (c == '\'') {
+                if (p_ + 1 < end_ && p_[1] == '\'') { v += '\''; p_ += 2; continue; }
+                ++p_;
+                needComma_ = true;
+                return true;
+            }
+            if (c == '\\' && decodeEscape(v)) continue;
+            v += c;
+            ++p_;
+        }
+        return fail();   // 字符串未闭合
+    }
+
+    bool beginList() {
+        if (!sep()) return false;
+        if (p_ >= end_ || *p_ != '(') return fail();
+        ++p_;
+        needComma_ = false;
+        return true;
+    }
+    bool atListEnd() {
+        skipWs();
+        return p_ >= end_ || *p_ == ')';
+    }
+    bool endList() {
+        skipWs();
+        if (p_ >= end_ || *p_ != ')') return fail();
+        ++p_;
+        needComma_ = true;
+        return true;
+    }
+
+    // 原样截取一个值（括号、字符串平衡）
+    bool readRaw(std::string& v) {
+        if (!sep()) return false;
+        const char* s = p_;
+        if (!skipOne()) return fail();
+        v.assign(s, std::size_t(p_ - s));
+        needComma_ = true;
+        return true;
+    }
+
+    bool skipValues(int n) {
+        for (int i = 0; i < n; ++i) {
+            if (!sep() || !skipOne()) return fail();
+            needComma_ = true;
+        }
+        return true;
+    }
+
+    // 全部参数读完：只允许剩余空白
+    bool finish() {
+        skipWs();
+        return ok_ && p_ == end_;
+    }
+
+private:
+    const char* begin_;
+    const char* p_;
+    const char* end_;
+    bool needComma_ = false;
+    bool ok_ = true;
+
+    void skipWs() {
+        while (p_ < end_ && (*p_ == ' ' || *p_ == '\t' || *p_ == '\r' || *p_ == '\n')) ++p_;
+    }
+
+    // 值之间的逗号
+    bool sep() {
+        if (!ok_) return false;
+        skipWs();
+        if (needComma_) {
+            if (p_ >= end_ || *p_ != ',') return fail();
+            ++p_;
+            skipWs();
+            needComma_ = false;
+        }
+        return true;
+    }
+
+    bool skipOne() {
+        if (p_ >= end_) return false;
+        int depth = 0;
+        bool inStr = false;
+        for (; p_ < end_; ++p_) {
+            const char c = *p_;
+            if (inStr) {
+                if (c == '\'') {
+                    if (p_ + 1 < end_ && p_[1] == '\'') { ++p_; continue; }
+                    inStr = false;
+                }
+                continue;
+            }
+            if (c == '\'') { inStr = true; continue; }
+            if (c == '(') { ++depth; continue; }
+            if (c == ')') {
+                if (depth == 0) break;
+                if (--depth == 0) { ++p_; break; }
+                continue;
+            }
+            if (c == ',' && depth == 0) break;
+        }
+        return depth == 0 && !inStr;
+    }
+
+    static int hexVal(char c) {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    }
+
+    static void appendUtf8(std::string& out, std::uint32_t cp) {
+        if (cp < 0x80) { out += char(cp); }
+        else if (cp < 0x800) { out += char(0xC0 | (cp >> 6)); out += char(0x80 | (cp & 0x3F)); }
+        else if (cp < 0x10000) {
+            out += char(0xE0 | (cp >> 12)); out += char(0x80 | ((cp >> 6) & 0x3F)); out += char(0x80 | (cp & 0x3F));
+        }
+        else {
+            out += char(0xF0 | (cp >> 18)); out += char(0x80 | ((cp >> 12) & 0x3F));
+            out += char(0x80 | ((cp >> 6) & 0x3F)); out += char(0x80 | (cp & 0x3F));
+        }
+    }
+
+    // 识别成功则消费转义序列并返回 true；否则把 '\' 当普通字符
+    bool decodeEscape(std::string& out) {
+        const std::size_t left = std::size_t(end_ - p_);
+        if (left >= 4 && p_[1] == 'X' && p_[2] == '\\' && hexVal(p_[3]) >= 0 && left >= 5 && hexVal(p_[4]) >= 0) {
+            appendUtf8(out, std::uint32_t(hexVal(p_[3]) * 16 + hexVal(p_[4])));
+            p_ += 5;
+            return true;
+        }
+        if (left >= 4 && p_[1] == 'X' && p_[2] == '2' && p_[3] == '\\') {
+            const char* q = p_ + 4;
+            std::string tmp;
+            std::uint32_t high = 0;
+            while (q + 4 <= end_ && *q != '\\') {
+                std::uint32_t u = 0;
+                for (int i = 0; i < 4; ++i) {
+                    const int h = hexVal(q[i]);
+                    if (h < 0) return false;
+                    u = (u << 4) | std::uint32_t(h);
+                }
+                q += 4;
+                if (u >= 0xD800 && u < 0xDC00) { high = u; continue; }
+                if (u >= 0xDC00 && u < 0xE000 && high) { u = 0x10000 + ((high - 0xD800) << 10) + (u - 0xDC00); high = 0; }
+                appendUtf8(tmp, u);
+            }
+            if (q + 4 > end_ || q[0] != '\\' || q[1] != 'X' || q[2] != '0' || q[3] != '\\') return false;
+            out += tmp;
+            p_ = q + 4;
+            return true;
+        }
+        return false;
+    }
+};
+
+class ArgWriter {
+public:
+    void writeNull() { sep(); out_ += '$'; }
+    void writeDouble(double v) {
+        sep();
+        char buf[kRealBufSize];
+        out_.append(buf, std::size_t(formatReal(v, buf)));   // 最短可往返表示
+    }
+    void writeInt(std::int64_t v) {
+        sep();
+        char buf[24];
+        out_.append(buf, std::size_t(formatInteger(v, buf)));
+    }
+    void writeBool(bool v) { sep(); out_ += v ? ".T." : ".F."; }
+    void writeEnum(std::string_view name) { sep(); out_ += '.'; out_ += name; out_ += '.'; }
+    void writeRef(const Ref& r) {
+        if (r.isNull()) { writeNull(); return; }
+        sep();
+        out_ += '#';
+        char buf[24];
+        const auto res = std::to_chars(buf, buf + sizeof(buf), r.id);
+        out_.append(buf, std::size_t(res.ptr - buf));
+    }
+    // GFC 文件按 UTF-8（代码页 65001）直接写出中文，只需转义单引号
+    void writeString(std::string_view s) {
+        sep();
+        out_ += '\'';
+        for (char c : s) {
+            if (c == '\'') out_ += '\'';
+            out_ += c;
+        }
+        out_ += '\'';
+    }
+    void writeRaw(std::string_view text) { sep(); out_ += text; }
+    void beginList() { sep(); out_ += '('; needComma_ = false; }
+    void endList() { out_ += ')'; needComma_ = true; }
+
+    const std::string& str() const { return out_; }
+    std::string take() { needComma_ = false; return std::move(out_); }
+
+private:
+    std::string out_;
+    bool needComma_ = false;
+    void sep() {
+        if (needComma_) out_ += ',';
+        needComma_ = true;
+    }
+};
+
+// ================== 字段编解码（编译期按类型选择） ==================
+template<class T> struct Codec;
+
+template<> struct Codec<double> {
+    static bool decode(ArgReader& r, double& v) { return r.readDouble(v); }
+    static void encode(ArgWriter& w, double v) { w.writeDouble(v); }
+};
+template<> struct Codec<std::int64_t> {
+    static bool decode(ArgReader& r, std::int64_t& v) { return r.readInt(v); }
+    static void encode(ArgWriter& w, std::int64_t v) { w.writeInt(v); }
+};
+template<> struct Codec<bool> {
+    static bool decode(ArgReader& r, bool& v) { return r.readBool(v); }
+    static void encode(ArgWriter& w, bool v) { w.writeBool(v); }
+};
+template<> struct Codec<std::string> {
+    static bool decode(ArgReader& r, std::string& v) { return r.readString(v); }
+    static void encode(ArgWriter& w, const std::string& v) { w.writeString(v); }
+};
+template<> struct Codec<Ref> {
+    static bool decode(ArgReader& r, Ref& v) { return r.readRef(v); }
+    static void encode(ArgWriter& w, const Ref& v) { w.writeRef(v); }
+};
+template<> struct Codec<Raw> {
+    static bool decode(ArgReader& r, Raw& v) { return r.readRaw(v.text); }
+    static void encode(ArgWriter& w, const Raw& v) { w.writeRaw(v.text); }
+};
+
+template<class T> bool field(ArgReader& r, T& v);
+template<class T> void put(ArgWriter& w, const T& v);
+
+template<class T> struct Codec<std::vector<T>> {
+    static bool decode(ArgReader& r, std::vector<T>& v) {
+        v.clear();
+        if (!r.beginList()) return false;
+        while (!r.atListEnd()) {
+            T x{};   // 先解到临时量：std::vector<bool> 的元素不能取引用
+            if (!field(r, x)) return false;
+            v.push_back(std::move(x));
+        }
+        return r.endList();
+    }
+    static void encode(ArgWriter& w, const std::vector<T>& v) {
+        w.beginList();
+        for (const T& x : v) put(w, x);
+        w.endList();
+    }
+};
+
+template<class T> struct Codec<std::optional<T>> {
+    static bool decode(ArgReader& r, std::optional<T>& v) {
+        v.reset();
+        if (r.readNull()) return true;
+        T x{};
+        if (!Codec<T>::decode(r, x)) return false;
+        v = std::move(x);
+        return true;
+    }
+    static void encode(ArgWriter& w, const std::optional<T>& v) {
+        if (v) Codec<T>::encode(w, *v);
+        else w.writeNull();
+    }
+};
+
+// 非 OPTIONAL 字段同样接受 $（取默认值）
+template<class T> bool field(ArgReader& r, T& v)
+{
+    if (r.readNull()) { v = T{}; return true; }
+    return r.ok() && Codec<T>::decode(r, v);
+}
+template<class T> bool field(ArgReader& r, std::optional<T>& v)
+{
+    return r.ok() && Codec<std::optional<T>>::decode(r, v);
+}
+template<class T> void put(ArgWriter& w, const T& v) { Codec<T>::encode(w, v); }
+
+// ================== 实体 ==================
+// 生成代码为每个 ENTITY 特化：name / stepName / attributeCount / decodeFields / encodeFields
+template<class E> struct EntityTraits;
+
+// args：#n=CLASS( 与 ) 之间的文本
+template<class E> bool decode(std::string_view args, E& out)
+{
+    ArgReader r(args);
+    return EntityTraits<E>::decodeFields(r, out) && r.finish();
+}
+
+template<class E> std::string encode(const E& v)
+{
+    ArgWriter w;
+    EntityTraits<E>::encodeFields(w, v);
+    return w.take();
+}
+
+// 完整实例行：#id=STEPNAME(args);
+template<class E> std::string encodeInstance(std::int64_t id, const E& v)
+{
+    std::string s = "#" + std::to_string(id) + "=";
+    s += EntityTraits<E>::stepName;
+    s += '(';
+    s += encode(v);
+    s += ");";
+    return s;
+}
+
+// 只解码第 index 个参数（跳过前面的值，不解析整条实例）
+template<class T> bool decodeAt(std::string_view args, int index, T& out)
+{
+    ArgReader r(args);
+    return r.skipValues(index) && field(r, out);
+}
+
+} // namespace gfc
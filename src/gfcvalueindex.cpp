@@ -0,0 +1,439 @@
+#include "gfcvalueindex.h"
+#include "gfcindex.h"
+#include "gfcparallel.h"
+#include "gfcsidecar.h"
+#include "gfctyped.h"
+#include "perftrace.h"
+
+#include <QDataStream>
+#include <QElapsedTimer>
+#include <algorithm>
+#include <deque>
+#include <queue>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+bool isWordByte(unsigned char c)
+{
+    return c >= 0x80 || c == '_' || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+// 词：字母数字下划线的连续段，或非 ASCII 字节（完整的 UTF-8 字符）的连续段
+template <typename F>
+void forEachToken(std::string_view s, F&& f)
+{
+    size_t i = 0;
+    const size_t n = s.size();
+    while (i < n) {
+        while (i < n && !isWordByte(uchar(s[i]))) ++i;
+        const size_t b = i;
+        const bool wide = i < n && uchar(s[i]) >= 0x80;
+        while (i < n && isWordByte(uchar(s[i])) && (uchar(s[i]) >= 0x80) == wide) ++i;
+        if (i > b) f(s.substr(b, i - b));
+    }
+}
+
+void foldAscii(std::string* s)
+{
+    for (char& c : *s) {
+        if (c >= 'A' && c <= 'Z') c = char(c - 'A' + 'a');
+    }
+}
+
+// 参数中的每个字符串：(顶层位置, 解码后的文本)；无转义时直接给原文片段
+template <typename F>
+void forEachString(std::string_view args, std::string* buf, F&& f)
+{
+    int depth = 0, slot = 0;
+    const size_t n = args.size();
+    for (size_t i = 0; i < n; ++i) {
+        const char c = args[i];
+        if (c == '\'') {
+            size_t j = i + 1;
+            bool plain = true;
+            for (; j < n; ++j) {
+                if (args[j] == '\'') {
+                    if (j + 1 < n && args[j + 1] == '\'') {
+                        plain = false;
+                        ++j;
+                        continue;
+                    }
+                    break;
+                }
+                if (args[j] == '\\') plain = false;
+            }
+            if (j >= n) return;   // 未闭合
+            if (plain) {
+                f(slot, args.substr(i + 1, j - i - 1));
+            }
+            else {
+                gfc::ArgReader r(args.substr(i, j - i + 1));
+                if (r.readString(*buf)) f(slot, std::string_view(*buf));
+            }
+            i = j;
+        }
+        else if (c == '(') {
+            ++depth;
+        }
+        else if (c == ')') {
+            --depth;
+        }
+        else if (c == ',' && depth == 0) {
+            ++slot;
+        }
+    }
+}
+
+// 一段内驻留的词条及其出现（行序）
+struct LocalTerms {
+    std::deque<std::string> terms;                     // deque：元素地址稳定，可作哈希键的视图
+    std::unordered_map<std::string_view, quint32> ids;
+    struct Emit {
+        quint32 term;
+        quint32 row;
+        quint16 slot;
+    };
+    std::vector<Emit> emits;
+    std::vector<quint32> order;                        // 排序后的局部词条下标
+    std::vector<quint32> global;                       // 局部 → 全局词条下标
+
+    void add(std::string_view term, int row, int slot)
+    {
+        auto it = ids.find(term);
+        if (it == ids.end()) {
+            terms.emplace_back(term);
+            it = ids.emplace(std::string_view(terms.back()), quint32(terms.size() - 1)).first;
+        }
+        emits.push_back({ it->second, quint32(row), quint16(qMin(slot, 0xFFFF)) });
+    }
+};
+
+template <typename T>
+void writeArray(QDataStream& ds, const QVector<T>& v)
+{
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    ds.writeRawData(reinterpret_cast<const char*>(v.constData()), int(v.size() * int(sizeof(T))));
+#else
+    for (T x : v) ds << x;
+#endif
+}
+
+template <typename T>
+bool readArray(QDataStream& ds, QVector<T>* v, int n)
+{
+    v->resize(n);
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    const int bytes = n * int(sizeof(T));
+    return ds.readRawData(reinterpret_cast<char*>(v->data()), bytes) == bytes;
+#else
+    for (T& x : *v) ds >> x;
+    return ds.status() == QDataStream::Ok;
+#endif
+}
+
+} // namespace
+
+GfcValueIndex GfcValueIndex::build(const GfcIndex& index, Stats* stats)
+{
+    GFC_PERF_SCOPE("取值倒排索引");
+    QElapsedTimer timer;
+    timer.start();
+    const int n = index.size();
+    const int parts = gfc::partsFor(n);
+    std::vector<LocalTerms> local(static_cast<size_t>(parts * FieldCount));
+    std::vector<int> stringsOf(static_cast<size_t>(parts), 0);
+
+    // 1) 分段并行扫描，段内驻留
+    gfc::parallelParts(n, parts, [&](int b, int e, int p) {
+        LocalTerms& values = local[size_t(p * FieldCount + Value)];
+        LocalTerms& tokens = local[size_t(p * FieldCount + Token)];
+        std::string buf, low;
+        for (int row = b; row < e; ++row) {
+            forEachString(index.args(row), &buf, [&](int slot, std::string_view s) {
+                if (s.empty()) return;
+                ++stringsOf[size_t(p)];
+                if (int(s.size()) <= kMaxValueBytes) values.add(s, row, slot);
+                forEachToken(s, [&](std::string_view t) {
+                    if (int(t.size()) > kMaxTokenBytes) return;
+                    low.assign(t);
+                    foldAscii(&low);
+                    tokens.add(low, row, slot);
+                });
+            });
+        }
+    });
+
+    // 2) 各段词表并行排序
+    const int jobs = parts * FieldCount;
+    gfc::parallelParts(jobs, jobs, [&](int b, int e, int) {
+        for (int j = b; j < e; ++j) {
+            LocalTerms& l = local[size_t(j)];
+            l.order.resize(l.terms.size());
+            for (size_t i = 0; i < l.order.size(); ++i) l.order[i] = quint32(i);
+            std::sort(l.order.begin(), l.order.end(), [&l](quint32 a, quint32 b) { return l.terms[a] < l.terms[b]; });
+            l.global.assign(l.terms.size(), 0);
+        }
+    });
+
+    GfcValueIndex vx;
+    for (int f = 0; f < FieldCount; ++f) {
+        Terms& t = vx.terms_[f];
+        // 3) 多路归并为全局有序词表
+        struct Head {
+            const std::string* term;
+            int part;
+            size_t pos;
+        };
+        auto later = [](const Head& a, const Head& b) { return *b.term < *a.term; };
+        std::priority_queue<Head, std::vector<Head>, decltype(later)> heap(later);
+        for (int p = 0; p < parts; ++p) {
+            const LocalTerms& l = local[size_t(p * FieldCount + f)];
+            if (!l.order.empty()) heap.push({ &l.terms[l.order[0]], p, 0 });
+        }
+        t.offset << 0;
+        const std::string* last = nullptr;
+        while (!heap.empty()) {
+            Head h = heap.top();
+            heap.pop();
+            if (!last || *last != *h.term) {
+                if (last) t.offset << quint32(t.blob.size());
+                t.blob.append(h.term->data(), int(h.term->size()));
+                last = h.term;
+            }
+            LocalTerms& l = local[size_t(h.part * FieldCount + f)];
+            l.global[l.order[h.pos]] = quint32(t.offset.size() - 1);
+            if (++h.pos < l.order.size()) {
+                h.term = &l.terms[l.order[h.pos]];
+                heap.push(h);
+            }
+        }
+        if (last) t.offset << quint32(t.blob.size());
+        else t.offset.clear();
+        const int termCount = qMax(0, t.offset.size() - 1);
+
+        // 4) 按段（即行）序计数排序为 CSR；同一词条在同一 (行, 位置) 只记一次
+        QVector<quint32> fill(termCount + 1, 0);
+        for (int p = 0; p < parts; ++p) {
+            const LocalTerms& l = local[size_t(p * FieldCount + f)];
+            for (const LocalTerms::Emit& e : l.emits) ++fill[int(l.global[e.term]) + 1];
+        }
+        for (int i = 0; i < termCount; ++i) fill[i + 1] += fill[i];
+        QVector<quint32> begin = fill;
+        QVector<quint64> postings(int(fill.isEmpty() ? 0 : fill.last()));
+        for (int p = 0; p < parts; ++p) {
+            LocalTerms& l = local[size_t(p * FieldCount + f)];
+            for (const LocalTerms::Emit& e : l.emits) {
+                const int g = int(l.global[e.term]);
+                const quint64 v = (quint64(e.row) << 16) | e.slot;
+                if (fill[g] > begin[g] && postings[int(fill[g]) - 1] == v) continue;
+                postings[int(fill[g]++)] = v;
+            }
+            std::vector<LocalTerms::Emit>().swap(l.emits);
+        }
+        // 去重留下的空隙：压紧
+        t.start.resize(termCount + 1);
+        quint32 w = 0;
+        for (int g = 0; g < termCount; ++g) {
+            t.start[g] = w;
+            for (quint32 k = begin[g]; k < fill[g]; ++k) postings[int(w++)] = postings[int(k)];
+        }
+        if (termCount > 0) t.start[termCount] = w;
+        else t.start.clear();
+        postings.resize(int(w));
+        t.postings = std::move(postings);
+    }
+
+    if (stats) {
+        Stats s;
+        s.instances = n;
+        for (int c : stringsOf) s.strings += c;
+        s.values = vx.termCount(Value);
+        s.tokens = vx.termCount(Token);
+        s.postings = vx.postingCount();
+        s.elapsedMs = timer.elapsed();
+        *stats = s;
+    }
+    PerfTrace::instance().setCounter(QStringLiteral("取值词条"), vx.termCount(Value) + vx.termCount(Token));
+    return vx;
+}
+
+GfcValueIndex GfcValueIndex::loadOrBuild(const GfcIndex& index, const QString& sidecarPath, bool* fromSidecar,
+                                         Stats* stats)
+{
+    return loadOrBuild(index, sidecarPath.isEmpty() ? QByteArray() : GfcSidecar::contentKey(index.data()), sidecarPath,
+                       fromSidecar, stats);
+}
+
+GfcValueIndex GfcValueIndex::loadOrBuild(const GfcIndex& index, const QByteArray& key, const QString& sidecarPath,
+                                         bool* fromSidecar, Stats* stats)
+{
+    GfcSidecar sidecar;
+    GfcValueIndex vx;
+    const bool loaded = !sidecarPath.isEmpty() && sidecar.load(sidecarPath, key)
+        && vx.deserialize(sidecar.section(sidecarTag()));
+    if (fromSidecar) *fromSidecar = loaded;
+    if (loaded) return vx;
+    vx = build(index, stats);
+    // 只替换本段，空间索引等其它段保留；写不了（只读目录等）不影响查找
+    if (!sidecarPath.isEmpty()) GfcSidecar::update(sidecarPath, key, sidecarTag(), vx.serialize());
+    return vx;
+}
+
+bool GfcValueIndex::isEmpty() const
+{
+    return termCount(Value) == 0 && termCount(Token) == 0;
+}
+
+std::pair<int, int> GfcValueIndex::range(const Terms& t, const QByteArray& key, bool prefix) const
+{
+    const int count = t.offset.isEmpty() ? 0 : t.offset.size() - 1;
+    auto termAt = [&t](int i) {
+        return std::string_view(t.blob.constData() + t.offset[i], size_t(t.offset[i + 1] - t.offset[i]));
+    };
+    const std::string_view k(key.constData(), size_t(key.size()));
+    int lo = 0, hi = count;
+    while (lo < hi) {
+        const int mid = (lo + hi) / 2;
+        if (termAt(mid) < k) lo = mid + 1;
+        else hi = mid;
+    }
+    int end = lo;
+    if (prefix) {
+        // 以 k 开头的词条在有序表中连续
+        int l = lo, h = count;
+        while (l < h) {
+            const int mid = (l + h) / 2;
+            if (termAt(mid).substr(0, k.size()) == k) l = mid + 1;
+            else h = mid;
+        }
+        end = l;
+    }
+    else if (end < count && termAt(end) == k) {
+        ++end;
+    }
+    return { lo, end };
+}
+
+namespace {
+
+bool postingLess(const GfcValueIndex::Posting& a, const GfcValueIndex::Posting& b)
+{
+    return a.row != b.row ? a.row < b.row : a.slot < b.slot;
+}
+
+bool postingEqual(const GfcValueIndex::Posting& a, const GfcValueIndex::Posting& b)
+{
+    return a.row == b.row && a.slot == b.slot;
+}
+
+} // namespace
+
+QVector<GfcValueIndex::Posting> GfcValueIndex::lookup(Field f, const QByteArray& utf8, bool prefix) const
+{
+    const Terms& t = terms_[f];
+    const std::pair<int, int> r = range(t, utf8, prefix);
+    QVector<Posting> out;
+    for (int g = r.first; g < r.second; ++g) {
+        for (quint32 k = t.start[g]; k < t.start[g + 1]; ++k) {
+            const quint64 v = t.postings[int(k)];
+            out.push_back({ int(v >> 16), int(v & 0xFFFF) });
+        }
+    }
+    // 单个词条的出现本身有序且不重复；前缀跨多个词条时才需排序
+    if (r.second - r.first > 1) {
+        std::sort(out.begin(), out.end(), postingLess);
+        out.erase(std::unique(out.begin(), out.end(), postingEqual), out.end());
+    }
+    return out;
+}
+
+QVector<GfcValueIndex::Posting> GfcValueIndex::lookup(const QString& term, bool prefix, int limit, int* total) const
+{
+    GFC_PERF_SCOPE("取值查找");
+    const QByteArray utf8 = term.toUtf8();
+    QVector<Posting> out = lookup(Value, utf8, prefix);
+    const QVector<QByteArray> parts = tokens(utf8);
+    if (parts.size() == 1 && (parts[0] == utf8 || !prefix)) {
+        std::string low = parts[0].toStdString();
+        foldAscii(&low);
+        const QVector<Posting> byToken = lookup(Token, QByteArray(low.data(), int(low.size())), prefix);
+        QVector<Posting> merged(out.size() + byToken.size());
+        merged.erase(std::set_union(out.cbegin(), out.cend(), byToken.cbegin(), byToken.cend(), merged.begin(), postingLess),
+                     merged.end());
+        out.swap(merged);
+    }
+    if (total) *total = out.size();
+    if (limit >= 0 && out.size() > limit) out.resize(limit);
+    return out;
+}
+
+QVector<QByteArray> GfcValueIndex::tokens(const QByteArray& utf8)
+{
+    QVector<QByteArray> out;
+    forEachToken(std::string_view(utf8.constData(), size_t(utf8.size())), [&out](std::string_view t) {
+        out << QByteArray(t.data(), int(t.size()));
+    });
+    return out;
+}
+
+QByteArray GfcValueIndex::serialize() const
+{
+    QByteArray out;
+    QDataStream ds(&out, QIODevice::WriteOnly);
+    ds.setByteOrder(QDataStream::LittleEndian);
+    ds << kFormat;
+    for (const Terms& t : terms_) {
+        const int count = t.offset.isEmpty() ? 0 : t.offset.size() - 1;
+        ds << quint32(count) << quint32(t.blob.size()) << quint32(t.postings.size());
+        if (count == 0) continue;
+        ds.writeRawData(t.blob.constData(), t.blob.size());
+        writeArray(ds, t.offset);
+        writeArray(ds, t.start);
+        writeArray(ds, t.postings);
+    }
+    return out;
+}
+
+bool GfcValueIndex::deserialize(const QByteArray& data)
+{
+    QDataStream ds(data);
+    ds.setByteOrder(QDataStream::LittleEndian);
+    quint32 format = 0;
+    ds >> format;
+    if (ds.status() != QDataStream::Ok || format != kFormat) return false;
+    Terms terms[FieldCount];
+    qint64 remaining = data.size() - 4;
+    for (Terms& t : terms) {
+        quint32 count = 0, blobSize = 0, postingCount = 0;
+        ds >> count >> blobSize >> postingCount;
+        remaining -= 12;
+        if (ds.status() != QDataStream::Ok) return false;
+        if (count == 0) {
+            if (blobSize || postingCount) return false;
+            continue;
+        }
+        // 先按剩余长度核对数量，避免按损坏的计数分配
+        const qint64 need = qint64(blobSize) + 8 * (qint64(count) + 1) + 8 * qint64(postingCount);
+        if (need > remaining) return false;
+        remaining -= need;
+        t.blob.resize(int(blobSize));
+        if (ds.readRawData(t.blob.data(), int(blobSize)) != int(blobSize)) return false;
+        if (!readArray(ds, &t.offset, int(count) + 1) || !readArray(ds, &t.start, int(count) + 1)
+            || !readArray(ds, &t.postings, int(postingCount))) {
+            return false;
+        }
+        if (t.offset.first() != 0 || t.offset.last() != blobSize || t.start.first() != 0 || t.start.last() != postingCount) {
+            return false;
+        }
+        for (int i = 0; i < int(count); ++i) {
+            if (t.offset[i] > t.offset[i + 1] || t.start[i] > t.start[i + 1]) return false;
+        }
+    }
+    if (remaining != 0) return false;
+    for (int f = 0; f < FieldCount; ++f) terms_[f] = std::move(terms[f]);
+    return true;
+}
@@ -0,0 +1,73 @@
+#pragma once
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <utility>
+
+class GfcIndex;
+
+/**
+ * 字符串取值倒排索引：所有实例参数中的字符串（含列表、类型值内的，按 '' / \X2\…\X0\ / \X\hh 解码为 UTF-8）
+ * 映射到 (实例行, 参数位置)。两张词典：
+ * - 整值：解码后的完整字符串，区分大小写（GUID、编码、名称的精确/前缀查找）；超过 kMaxValueBytes 的长串只按词索引
+ * - 词：ASCII 字母数字下划线的连续段，或非 ASCII 字符（中文等）的连续段；ASCII 部分折叠为小写
+ * 构建：分段并行扫描并在段内驻留词条，各段词表并行排序后多路归并为全局有序词表，再按行序计数排序为 CSR 出现表。
+ * 查找：有序词表上二分（前缀为一段连续区间），毫秒级；序列化为旁路索引中的 "values" 段（小端，带格式版本）。
+ */
+
+class GfcValueIndex {
+public:
+    static constexpr quint32 kFormat = 1;
+    static constexpr int kMaxValueBytes = 256;
+    static constexpr int kMaxTokenBytes = 64;
+    static const char* sidecarTag() { return "values"; }
+
+    enum Field { Value, Token, FieldCount };
+    struct Posting {
+        int row = -1;
+        int slot = -1;            // 所在的顶层参数位置（与 Schema 展平属性下标一致）
+    };
+    struct Stats {
+        int instances = 0;
+        int strings = 0;          // 扫描到的字符串个数
+        int values = 0;           // 不同整值
+        int tokens = 0;           // 不同词
+        qint64 postings = 0;
+        qint64 elapsedMs = 0;
+    };
+
+    static GfcValueIndex build(const GfcIndex& index, Stats* stats = nullptr);
+    // 旁路索引中有内容键相符的段时读入，否则新建并写回；sidecarPath 为空时只新建
+    static GfcValueIndex loadOrBuild(const GfcIndex& index, const QString& sidecarPath,
+                                     bool* fromSidecar = nullptr, Stats* stats = nullptr);
+    // 同上，内容键已由调用方算好（避免对整个文档再做一次 SHA-1）
+    static GfcValueIndex loadOrBuild(const GfcIndex& index, const QByteArray& key, const QString& sidecarPath,
+                                     bool* fromSidecar = nullptr, Stats* stats = nullptr);
+
+    bool isEmpty() const;
+    int termCount(Field f) const { return terms_[f].offset.isEmpty() ? 0 : terms_[f].offset.size() - 1; }
+    qint64 postingCount() const { return qint64(terms_[Value].postings.size()) + terms_[Token].postings.size(); }
+
+    // 整值精确（或前缀）匹配，与词匹配（单个词时）合并；按 (行, 位置) 升序去重。
+    // limit >= 0 时最多返回 limit 条，total 为截断前的条数
+    QVector<Posting> lookup(const QString& term, bool prefix, int limit = -1, int* total = nullptr) const;
+    QVector<Posting> lookup(Field f, const QByteArray& utf8, bool prefix) const;
+
+    QByteArray serialize() const;
+    bool deserialize(const QByteArray& data);
+
+    // 供构建与查找共用：按上述规则切词（返回原文中的片段，未折叠大小写）
+    static QVector<QByteArray> tokens(const QByteArray& utf8);
+
+private:
+    struct Terms {
+        QByteArray blob;          // 词条按字节序拼接
+        QVector<quint32> offset;  // 词条 t 为 blob[offset[t], offset[t + 1])
+        QVector<quint32> start;   // 词条 t 的出现为 postings[start[t], start[t + 1])
+        QVector<quint64> postings;   // (行 << 16) | 位置
+    };
+    // 词条区间 [first, second)
+    std::pair<int, int> range(const Terms& t, const QByteArray& key, bool prefix) const;
+
+    Terms terms_[FieldCount];
+};
@@ -0,0 +1,261 @@
+#include "gfcweld.h"
+#include "gfcindex.h"
+#include "gfcparallel.h"
+#include "gfctyped.h"
+#include "perftrace.h"
+#include "schemacache.h"
+
+#include <QThread>
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr int kCandidates = 4;                 // 每个点保留的更早候选数
+constexpr double kMaxCell = 4.0e18;            // 单元号超出 int64 安全范围的点不参与
+
+inline quint64 mix(quint64 h, qint64 v)
+{
+    h ^= quint64(v) + 0x9E3779B97F4A7C15ull + (h << 6) + (h >> 2);
+    h ^= h >> 31;
+    h *= 0xBF58476D1CE4E5B9ull;
+    return h ^ (h >> 29);
+}
+
+// 分段并行排序后逐轮两两归并
+template <class Less>
+void parallelSort(QVector<int>& v, Less less)
+{
+    const int n = v.size();
+    const int parts = n < 65536 ? 1 : QThread::idealThreadCount();
+    QVector<int> bounds;
+    for (int i = 0; i <= parts; ++i) bounds << int(qint64(n) * i / parts);
+    gfc::parallelParts(parts, parts, [&](int b, int e, int) {
+        for (int p = b; p < e; ++p) std::sort(v.begin() + bounds[p], v.begin() + bounds[p + 1], less);
+    });
+    // 第 j 对：段 [2jw, 2jw+w) 与其后 w 段归并
+    for (int w = 1; w < parts; w *= 2) {
+        const int pairs = (parts - w + 2 * w - 1) / (2 * w);
+        gfc::parallelParts(pairs, pairs, [&](int b, int e, int) {
+            for (int j = b; j < e; ++j) {
+                const int i = j * 2 * w;
+                std::inplace_merge(v.begin() + bounds[i], v.begin() + bounds[i + w],
+                                   v.begin() + bounds[qMin(i + 2 * w, parts)], less);
+            }
+        });
+    }
+}
+
+// 一组同维的点：rows 为行号（升序），canon 按行写回
+template <int D>
+void weldGroup(const GfcIndex& ix, const QVector<int>& rows, double eps, QVector<int>& canon,
+               GfcWeld::Stats& st)
+{
+    const int m = rows.size();
+    if (m == 0) return;
+    const int parts = gfc::partsFor(m);
+
+    // ① 解析坐标（按列存放）
+    QVector<double> xs[D];
+    for (int d = 0; d < D; ++d) xs[d].resize(m);
+    QVector<quint8> valid(m, 0);
+    gfc::parallelParts(m, parts, [&](int b, int e, int) {
+        for (int i = b; i < e; ++i) {
+            gfc::ArgReader r(ix.args(rows[i]));
+            double v[D];
+            bool ok = true;
+            for (int d = 0; d < D && ok; ++d) ok = r.readDouble(v[d]) && std::isfinite(v[d]);
+            if (!ok) continue;
+            for (int d = 0; d < D; ++d) xs[d][i] = v[d];
+            valid[i] = 1;
+        }
+    });
+
+    // ② 单元号与单元哈希：单元边长 2ε，逐列的紧凑循环。
+    //    点在单元内偏下半还是上半决定该轴只需再查下侧还是上侧的相邻单元（side 位）
+    const double inv = 1.0 / (2 * eps);
+    QVector<qint64> cells[D];
+    for (int d = 0; d < D; ++d) cells[d].resize(m);
+    QVector<quint8> side(m, 0);
+    QVector<quint64> keys(m);
+    gfc::parallelParts(m, parts, [&](int b, int e, int) {
+        for (int d = 0; d < D; ++d) {
+            const double* x = xs[d].constData();
+            qint64* c = cells[d].data();
+            quint8* s = side.data();
+            for (int i = b; i < e; ++i) {
+                const double t = x[i] * inv;
+                const double f = std::floor(t);
+                if (!(std::fabs(f) < kMaxCell)) { valid[i] = 0; continue; }
+                c[i] = qint64(f);
+                s[i] |= quint8((t - f >= 0.5) << d);
+            }
+        }
+        for (int i = b; i < e; ++i) {
+            quint64 h = 0;
+            for (int d = 0; d < D; ++d) h = mix(h, cells[d][i]);
+            keys[i] = h;
+        }
+    });
+
+    // ③ 按 (单元哈希, 下标) 排序
+    QVector<int> order;
+    order.reserve(m);
+    for (int i = 0; i < m; ++i) {
+        if (valid[i]) order << i;
+        else ++st.skipped;
+    }
+    parallelSort(order, [&keys](int a, int b) { return keys[a] != keys[b] ? keys[a] < keys[b] : a < b; });
+
+    // 单元表（开放寻址）：单元哈希 -> order 中的一段
+    struct Cell { quint64 key; int begin; int end; };
+    int capacity = 16;
+    while (capacity < order.size() * 2) capacity *= 2;
+    const quint64 mask = quint64(capacity - 1);
+    QVector<Cell> table(capacity, Cell{ 0, 0, 0 });
+    for (int i = 0; i < order.size();) {
+        const quint64 h = keys[order[i]];
+        int j = i + 1;
+        while (j < order.size() && keys[order[j]] == h) ++j;
+        quint64 slot = h & mask;
+        while (table[int(slot)].end > table[int(slot)].begin) slot = (slot + 1) & mask;
+        table[int(slot)] = { h, i, j };
+        i = j;
+    }
+    auto findCell = [&](quint64 h) -> const Cell* {
+        for (quint64 slot = h & mask;; slot = (slot + 1) & mask) {
+            const Cell& c = table[int(slot)];
+            if (c.end == c.begin) return nullptr;
+            if (c.key == h) return &c;
+        }
+    };
+
+    // 遍历所在单元及各轴 side 一侧的相邻单元（共 2^D 个）中下标小于 i 且距离在容差内的点；
+    // 段内按下标升序，f 返回 false 时结束该单元
+    const double eps2 = eps * eps;
+    auto forEachNear = [&](int i, auto&& f) {
+        for (int combo = 0; combo < (1 << D); ++combo) {
+            quint64 h = 0;
+            for (int d = 0; d < D; ++d) {
+                const qint64 off = (combo >> d & 1) ? ((side[i] >> d & 1) ? 1 : -1) : 0;
+                h = mix(h, cells[d][i] + off);
+            }
+            const Cell* c = findCell(h);
+            if (!c) continue;
+            for (int k = c->begin; k < c->end; ++k) {
+                const int j = order[k];
+                if (j >= i) break;
+                double d2 = 0;
+                for (int d = 0; d < D; ++d) {
+                    const double t = xs[d][i] - xs[d][j];
+                    d2 += t * t;
+                }
+                if (d2 <= eps2 && !f(j)) break;
+            }
+        }
+    };
+
+    // ④ 并行：每个点下标最小的 kCandidates 个近邻（升序）
+    QVector<int> cand(m * kCandidates, -1);
+    gfc::parallelParts(m, parts, [&](int b, int e, int) {
+        for (int i = b; i < e; ++i) {
+            if (!valid[i]) continue;
+            int* out = cand.data() + qint64(i) * kCandidates;
+            int found = 0;
+            forEachNear(i, [&](int j) {
+                int pos = found;
+                if (found == kCandidates) {
+                    if (j >= out[kCandidates - 1]) return false;
+                    pos = kCandidates - 1;
+                }
+                else {
+                    ++found;
+                }
+                while (pos > 0 && out[pos - 1] > j) { out[pos] = out[pos - 1]; --pos; }
+                out[pos] = j;
+                return true;
+            });
+        }
+    });
+
+    // ⑤ 按文件顺序贪心：归到下标最小的、仍是代表的近邻。
+    //    候选已满且都不是代表时，回退为完整扫描（只在点很密时发生），结果与逐点贪心一致
+    QVector<int> rep(m);
+    int welded = 0;
+    double maxShift2 = 0;
+    for (int i = 0; i < m; ++i) {
+        rep[i] = i;
+        const int* c = cand.constData() + qint64(i) * kCandidates;
+        int target = -1;
+        for (int k = 0; k < kCandidates && c[k] >= 0 && target < 0; ++k) {
+            if (rep[c[k]] == c[k]) target = c[k];
+        }
+        if (target < 0 && c[kCandidates - 1] >= 0) {
+            forEachNear(i, [&](int j) {
+                if (rep[j] != j) return true;
+                if (target < 0 || j < target) target = j;
+                return false;
+            });
+        }
+        if (target >= 0) {
+            rep[i] = target;
+            double d2 = 0;
+            for (int d = 0; d < D; ++d) {
+                const double t = xs[d][i] - xs[d][target];
+                d2 += t * t;
+            }
+            maxShift2 = qMax(maxShift2, d2);
+            ++welded;
+        }
+        canon[rows[i]] = rows[rep[i]];
+    }
+    st.points[D - 2] = order.size();
+    st.welded[D - 2] = welded;
+    st.maxShift = qMax(st.maxShift, std::sqrt(maxShift2));
+}
+
+} // namespace
+
+bool GfcWeld::analyze(GfcIndex& ix, const CompiledSchema& schema, double eps, QVector<int>* canon,
+                      Stats* stats, QString* err)
+{
+    GFC_PERF_SCOPE("点焊接分析");
+    if (!(eps > 0) || !std::isfinite(eps)) {
+        if (err) *err = QStringLiteral("容差必须为正数");
+        return false;
+    }
+    if (!ix.hasRefs()) ix.buildRefs();
+    const int n = ix.size();
+    const int v2 = schema.find(QStringLiteral("GfcVector2d"));
+    const int v3 = schema.find(QStringLiteral("GfcVector3d"));
+    QVector<quint8> dim(ix.classCount(), 0);
+    for (int c = 0; c < ix.classCount(); ++c) {
+        const int e = ix.schemaEntity(c);
+        if (e < 0) continue;
+        if (v3 >= 0 && schema.isSubtypeOf(e, v3)) dim[c] = 3;
+        else if (v2 >= 0 && schema.isSubtypeOf(e, v2)) dim[c] = 2;
+    }
+    QVector<int> rows2, rows3;
+    for (int r = 0; r < n; ++r) {
+        const int d = dim[ix.at(r).cls];
+        if (d == 2) rows2 << r;
+        else if (d == 3) rows3 << r;
+    }
+    if (rows2.isEmpty() && rows3.isEmpty()) {
+        if (err) *err = QStringLiteral("没有 GfcVector2d / GfcVector3d 实例");
+        return false;
+    }
+
+    Stats st;
+    canon->resize(n);
+    for (int r = 0; r < n; ++r) (*canon)[r] = r;
+    weldGroup<2>(ix, rows2, eps, *canon, st);
+    weldGroup<3>(ix, rows3, eps, *canon, st);
+
+    for (int r = 0; r < n; ++r) {
+        if ((*canon)[r] != r) st.bytes += ix.spanEnd(r) - ix.at(r).begin;
+    }
+    PerfTrace::instance().setCounter(QStringLiteral("焊接点"), st.welded[0] + st.welded[1]);
+    if (stats) *stats = st;
+    return true;
+}
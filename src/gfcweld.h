@@ -0,0 +1,32 @@
+#pragma once
+#include <QString>
+#include <QVector>
+
+class CompiledSchema;
+class GfcIndex;
+
+/**
+ * 点焊接（容差合并）：GfcVector2d / GfcVector3d 中距离不超过 epsilon 的点合并为一个，引用随之改写。
+ * - 坐标按列（SoA）并行解析，网格单元号在紧凑循环中批量计算（便于编译器向量化）
+ * - 空间哈希网格：单元边长 = 2·epsilon，按 (单元哈希, 行号) 并行排序后成段、建开放寻址表；
+ *   按点在单元内的位置每轴只查一侧相邻单元，共 2^d 个
+ * - 每个点并行找出编号更小、距离在容差内的前若干个候选；再按文件顺序贪心确定代表点：
+ *   归到编号最小的、仍是代表的近邻，没有则自己成为代表（候选不够时回退为完整扫描）。
+ *   因此每个点与其代表的距离不超过 epsilon，且代表点之间两两距离大于 epsilon
+ * 2D 与 3D 分别处理；坐标不是纯数值（如 $）的点不参与。结果为行号映射，交给 GfcDedupe::apply 删除并改写。
+ */
+
+class GfcWeld {
+public:
+    struct Stats {
+        int points[2] = { 0, 0 };      // [0] 2D，[1] 3D 参与的点
+        int welded[2] = { 0, 0 };      // 被合并掉的点
+        int skipped = 0;               // 坐标无法解析的点
+        qint64 bytes = 0;              // 删除的字节
+        double maxShift = 0;           // 点与其代表的最大距离
+    };
+
+    // canon 与 GfcDedupe::Plan::canon 同义：canon[row] 为代表点的行号
+    static bool analyze(GfcIndex& index, const CompiledSchema& schema, double epsilon,
+                        QVector<int>* canon, Stats* stats, QString* err = nullptr);
+};
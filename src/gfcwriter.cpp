@@ -0,0 +1,212 @@
+#include "gfcwriter.h"
+#include "perftrace.h"
+
+#include <QFuture>
+#include <QSaveFile>
+#include <QThread>
+#include <QtConcurrent/QtConcurrentMap>
+#include <QtConcurrent/QtConcurrentRun>
+
+bool GfcWriter::writeChunksAtomic(int count, const std::function<QByteArray(int)>& producer,
+                                  const QString& path, const Options& opt, QString* err)
+{
+    GFC_PERF_SCOPE("写出文件");
+    QSaveFile f(path);
+    if (!f.open(QIODevice::WriteOnly)) {
+        if (err) *err = QStringLiteral("无法写入文件：%1（%2）").arg(path, f.errorString());
+        return false;
+    }
+
+    // 一批 = 线程数个块：本批并行编码的同时写出上一批
+    const int batch = qMax(1, QThread::idealThreadCount());
+    const GfcCompress::Codec codec = opt.compression;
+    const std::function<Encoded(int)> fn = [&producer, codec](int i) {
+        return codec == GfcCompress::None ? Encoded{ producer(i), QString() } : compress(producer(i), codec);
+    };
+    auto encodeBatch = [&](int first) {
+        QVector<int> ids;
+        for (int i = first; i < qMin(count, first + batch); ++i) ids << i;
+        return QtConcurrent::mapped(std::move(ids), fn);
+    };
+
+    QFuture<Encoded> pending = encodeBatch(0);
+    for (int first = 0; first < count; first += batch) {
+        pending.waitForFinished();
+        const QList<Encoded> ready = pending.results();
+        if (first + batch < count) pending = encodeBatch(first + batch);
+
+        for (int k = 0; k < ready.size(); ++k) {
+            if (opt.cancelled()) {
+                pending.waitForFinished();
+                f.cancelWriting();
+                if (err) *err = QStringLiteral("已取消保存");
+                return false;
+            }
+            if (!ready[k].err.isEmpty()) {
+                pending.waitForFinished();
+                f.cancelWriting();
+                if (err) *err = ready[k].err;
+                return false;
+            }
+            if (f.write(ready[k].bytes) != ready[k].bytes.size()) {
+                pending.waitForFinished();
+                if (err) *err = QStringLiteral("写入失败：%1").arg(f.errorString());
+                f.cancelWriting();
+                return false;
+            }
+            if (opt.progress) opt.progress(first + k + 1, count);
+        }
+    }
+
+    // commit：刷盘后把临时文件原子改名为目标文件
+    if (!f.commit()) {
+        if (err) *err = QStringLiteral("无法替换目标文件：%1（%2）").arg(path, f.errorString());
+        return false;
+    }
+    return true;
+}
+
+GfcWriter::Encoded GfcWriter::compress(const QByteArray& block, GfcCompress::Codec codec)
+{
+    Encoded e;
+    e.bytes = GfcCompress::compressBlock(block, codec, &e.err);
+    if (e.err.isEmpty() && e.bytes.isEmpty() && !block.isEmpty()) e.err = QStringLiteral("压缩失败");
+    return e;
+}
+
+bool GfcWriter::writeTextAtomic(const QString& text, const QString& path,
+                                const Options& opt, QString* err)
+{
+    // 块边界：不拆 UTF-16 代理对
+    QVector<int> bounds{ 0 };
+    const int step = qMax(1024, opt.chunkChars);
+    for (int pos = step; pos < text.size(); pos += step) {
+        int cut = pos;
+        if (text.at(cut - 1).isHighSurrogate()) ++cut;
+        bounds << cut;
+        pos = cut;
+    }
+    bounds << int(text.size());
+
+#ifdef Q_OS_WIN
+    const bool crlf = opt.nativeLineEndings;
+#else
+    const bool crlf = false;
+#endif
+
+    const QStringView all(text);
+    auto encode = [&](int i) {
+        QByteArray bytes = all.mid(bounds[i], bounds[i + 1] - bounds[i]).toUtf8();
+        if (crlf) bytes.replace("\n", "\r\n");
+        return bytes;
+    };
+    return writeChunksAtomic(int(bounds.size()) - 1, encode, path, opt, err);
+}
+
+GfcStreamWriter::GfcStreamWriter() = default;
+
+GfcStreamWriter::~GfcStreamWriter()
+{
+    cancel();
+}
+
+bool GfcStreamWriter::open(const QString& path, const GfcWriter::Options& opt, QString* err)
+{
+    opt_ = opt;
+    error_.clear();
+    written_ = 0;
+    file_.reset(new QSaveFile(path));
+    if (!file_->open(QIODevice::WriteOnly)) {
+        error_ = QStringLiteral("无法写入文件：%1（%2）").arg(path, file_->errorString());
+        file_.reset();
+        if (err) *err = error_;
+        return false;
+    }
+    block_.reserve(qMax(1024, opt_.chunkChars));
+    return true;
+}
+
+bool GfcStreamWriter::write(const char* data, qint64 size)
+{
+    if (!file_ || !error_.isEmpty()) return false;
+    const int step = qMax(1024, opt_.chunkChars);
+    while (size > 0) {
+        const int n = int(qMin<qint64>(size, step - block_.size()));
+        block_.append(data, n);
+        data += n;
+        size -= n;
+        if (block_.size() >= step && !flushBlock(false)) return false;
+    }
+    return true;
+}
+
+// 写出上一块（等待其压缩完成），当前块交给后台压缩；last 时当前块也直接写完
+bool GfcStreamWriter::flushBlock(bool last)
+{
+    if (opt_.cancelled()) {
+        error_ = QStringLiteral("已取消");
+        return false;
+    }
+#ifdef Q_OS_WIN
+    if (opt_.nativeLineEndings) block_.replace("\n", "\r\n");
+#endif
+    // 压缩失败时不能把空块/残块当作成功写出：放弃临时文件，目标保持原样
+    auto writeOut = [this](const GfcWriter::Encoded& e) {
+        if (!e.err.isEmpty()) {
+            error_ = e.err;
+            file_->cancelWriting();
+            return false;
+        }
+        if (file_->write(e.bytes) != e.bytes.size()) {
+            error_ = QStringLiteral("写入失败：%1").arg(file_->errorString());
+            return false;
+        }
+        written_ += e.bytes.size();
+        return true;
+    };
+
+    if (opt_.compression == GfcCompress::None) {
+        const bool ok = writeOut({ block_, QString() });
+        block_.clear();
+        return ok;
+    }
+    if (hasPending_) {
+        hasPending_ = false;
+        pending_.waitForFinished();
+        if (!writeOut(pending_.result())) return false;
+    }
+    const QByteArray block = block_;
+    const GfcCompress::Codec codec = opt_.compression;
+    block_.clear();
+    if (last) return block.isEmpty() || writeOut(GfcWriter::compress(block, codec));
+    pending_ = QtConcurrent::run([block, codec] { return GfcWriter::compress(block, codec); });
+    hasPending_ = true;
+    return true;
+}
+
+bool GfcStreamWriter::commit(QString* err)
+{
+    if (!file_) {
+        if (err) *err = error_;
+        return false;
+    }
+    if (error_.isEmpty() && flushBlock(true) && !file_->commit()) {
+        error_ = QStringLiteral("无法替换目标文件：%1（%2）").arg(file_->fileName(), file_->errorString());
+    }
+    const bool ok = error_.isEmpty();
+    if (!ok) cancel();
+    file_.reset();
+    if (err) *err = error_;
+    return ok;
+}
+
+void GfcStreamWriter::cancel()
+{
+    if (hasPending_) pending_.waitForFinished();
+    hasPending_ = false;
+    if (file_) {
+        file_->cancelWriting();
+        file_.reset();
+    }
+    block_.clear();
+}
@@ -0,0 +1,82 @@
+#pragma once
+#include <QByteArray>
+#include <QFuture>
+#include <QString>
+#include <QVector>
+#include <atomic>
+#include <functional>
+#include <memory>
+
+#include "gfccompress.h"
+
+class QSaveFile;
+
+/**
+ * 保存/导出写出管线：
+ * - 文本按块（约 4M 字符，不拆代理对）并行编码为 UTF-8，同时写出上一批，内存占用与线程数成正比
+ * - 写入同目录下的临时文件（QSaveFile），全部写完并刷盘后原子改名覆盖目标；
+ *   中途失败、取消或崩溃都不会破坏原文件
+ * - 可选压缩：每块独立压缩，压缩与编码一起在工作线程并行完成
+ * - 可在后台线程调用：进度回调在工作线程触发，取消标志随时可置位
+ */
+
+// 放在类外：嵌套类型带成员默认值时不能在外围类内用作默认实参
+struct GfcWriterOptions {
+    std::function<void(qint64 done, qint64 total)> progress;   // 可空
+    const std::atomic<bool>* cancel = nullptr;
+    bool nativeLineEndings = true;           // Windows 下 \n 写为 \r\n（与原 QIODevice::Text 行为一致）
+    int chunkChars = 4 << 20;
+    GfcCompress::Codec compression = GfcCompress::None;   // 每块独立压缩（gzip 成员 / zstd 帧）
+
+    bool cancelled() const { return cancel && cancel->load(std::memory_order_relaxed); }
+};
+
+class GfcWriter {
+public:
+    using Progress = std::function<void(qint64 done, qint64 total)>;
+    using Options = GfcWriterOptions;
+
+    // 写出整份文本（UTF-8，无 BOM）；失败时 err 给出原因，目标文件保持原样
+    static bool writeTextAtomic(const QString& text, const QString& path,
+                                const Options& opt = Options(), QString* err = nullptr);
+
+    // 通用版本：producer(i) 依次产生第 i 块字节（可在工作线程并行调用），共 count 块
+    static bool writeChunksAtomic(int count, const std::function<QByteArray(int)>& producer,
+                                  const QString& path, const Options& opt = Options(),
+                                  QString* err = nullptr);
+
+    // 一块编码/压缩结果；err 非空时该块失败，整个写出放弃
+    struct Encoded {
+        QByteArray bytes;
+        QString err;
+    };
+    static Encoded compress(const QByteArray& block, GfcCompress::Codec codec);
+};
+
+// 流式写出：总长度事先未知时逐段追加（如多文件合并），攒满一块后写出；
+// 压缩时上一块在后台压缩、同时继续接收下一块。同样经临时文件原子替换，progress 不使用
+class GfcStreamWriter {
+public:
+    GfcStreamWriter();
+    ~GfcStreamWriter();   // 未 commit 时放弃临时文件
+
+    bool open(const QString& path, const GfcWriter::Options& opt = GfcWriter::Options(), QString* err = nullptr);
+    bool write(const char* data, qint64 size);
+    bool write(const QByteArray& bytes) { return write(bytes.constData(), bytes.size()); }
+    bool commit(QString* err = nullptr);
+    void cancel();
+
+    qint64 bytesWritten() const { return written_; }
+    const QString& errorString() const { return error_; }
+
+private:
+    bool flushBlock(bool last);
+
+    std::unique_ptr<QSaveFile> file_;
+    GfcWriter::Options opt_;
+    QByteArray block_;
+    QFuture<GfcWriter::Encoded> pending_;   // 上一块的后台压缩
+    bool hasPending_ = false;
+    qint64 written_ = 0;
+    QString error_;
+};
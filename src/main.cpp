@@ -1,8 +1,17 @@
 #include "mainwindow.h"
+#include "gfccli.h"
 #include <QApplication>
 
 int main(int argc, char *argv[])
 {
+    // 子命令（如 convert）走命令行模式，不创建窗口
+    if (GfcCli::isCliInvocation(argc, argv)) {
+        QCoreApplication app(argc, argv);
+        QCoreApplication::setApplicationName("GFC Editor");
+        QCoreApplication::setOrganizationName("ExampleOrg");
+        return GfcCli::run(app.arguments());
+    }
+
     QApplication a(argc, argv);
     QApplication::setApplicationName("GFC Editor");
     QApplication::setOrganizationName("ExampleOrg");
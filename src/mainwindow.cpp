@@ -13,10 +13,10 @@
 #include <QLabel>
 #include <QFileDialog>
 #include <QFile>
-#include <QTextStream>
 #include <QMessageBox>
 #include <QActionGroup>
 #include <QInputDialog>
+#include <QMap>
 #include <QRegularExpression>
 #include <QTextBlock>
 #include <QTextCursor>
@@ -34,17 +34,33 @@
 #include <QTextEdit>
 #include <QColor>
 #include<QApplication>
-
+#include <QProgressBar>
+#include <QToolButton>
+#include <QCloseEvent>
+#include <QtConcurrent/QtConcurrentRun>
+#include <algorithm>
+
+#include "gfcbulkedit.h"
+#include "gfcdedupe.h"
+#include "gfcdiffdialog.h"
+#include "gfcextract.h"
+#include "gfcfileio.h"
+#include "gfcindex.h"
+#include "gfcmerge.h"
+#include "gfcmesh.h"
+#include "gfcpurge.h"
+#include "gfcquantity.h"
+#include "gfcquery.h"
+#include "gfcrenumber.h"
+#include "gfcreportdialog.h"
+#include "gfcsidecar.h"
+#include "gfcspatial.h"
+#include "gfcsqlite.h"
+#include "gfctableexport.h"
 #include "gfcparser.h"
-
-// ---------- 工具：根据平台设置UTF-8 ----------
-static void setUtf8(QTextStream& ts) {
-#if QT_VERSION >= QT_VERSION_CHECK(6,0,0)
-    ts.setEncoding(QStringConverter::Utf8);
-#else
-    ts.setCodec("utf-8");
-#endif
-}
+#include "gfcpropertydialog.h"
+#include "gfcweld.h"
+#include "gfcwriter.h"
 
 MainWindow::MainWindow(QWidget* parent)
     : QMainWindow(parent),
@@ -84,16 +100,30 @@ MainWindow::MainWindow(QWidget* parent)
 
 void MainWindow::onEditorTextChanged()
 {
+    invalidateDocumentCache();
     if (suppressReparse_) return;        // 打开文件时 setPlainText 不触发重算
-    if (schema_.classes().isEmpty()) return;  // 未加载 .exp 时可直接返回（或也允许重算为全0）
+    if (schema_.isEmpty()) return;  // 未加载 .exp 时可直接返回（或也允许重算为全0）
     editRefreshTimer_->start();          // 重启防抖计时
 }
 
 void MainWindow::reparseFromEditor()
 {
-    const QString text = editor_->toPlainText();
-    RecomputeStats st = recomputeFromText(text);
-    rebuildClassTree();                  //rebuild 已含 (0/0) 裁剪的话会生效
+    geometryById_.clear();
+    RecomputeStats st;
+    {
+        PerfOperation op(QStringLiteral("编辑后重算"));
+        QString text;
+        {
+            GFC_PERF_SCOPE("读取编辑器文本");
+            text = editor_->toPlainText();
+        }
+        st = recomputeFromText(text);
+        GFC_PERF_SCOPE("构建类树");
+        rebuildClassTree();                  //rebuild 已含 (0/0) 裁剪的话会生效
+        invalidateStructureTree();
+    }
+    reportMemoryUsage();
+    refreshPerfDock();
 
 #ifdef QT_DEBUG
     qDebug() << "[reparseFromEditor] instances=" << st.instances
@@ -133,6 +163,7 @@ void MainWindow::onPropTableCellClicked(int row, int /*col*/)
 
     const int start = it->data(Qt::UserRole).toInt();
     const int end = it->data(Qt::UserRole + 1).toInt();
+    if (start < 0) return;      // 附加的只读行（如几何量）
 
     if (start >= 0 && end > start) {
         //按需蓝色高亮（带一点透明度）
@@ -152,37 +183,44 @@ MainWindow::RecomputeStats MainWindow::recomputeFromText(const QString& text)
 
     // 1) 扫描 .gfc 实例（只提取 #idx / CLASS(大写) / pos）
     QVector<GfcInstanceRef> refs;
-    GfcParser::countClasses(text, &refs);
+    {
+        GFC_PERF_SCOPE("countClasses");
+        GfcParser::countClasses(text, &refs);
+    }
     stats.instances = refs.size();
+    PerfTrace::instance().setCounter(QStringLiteral("实例数"), refs.size());
 
     // 2) 以 CamelCase 为唯一键；展示仍用驼峰
     directCountCamel_.clear();
     inclusiveCountCamel_.clear();
     instancesByCamel_.clear();
 
-    if (schema_.classes().isEmpty()) return stats;
-    if (lowerToCamel_.isEmpty()) prepareSchemaIndex();
+    if (schema_.isEmpty()) return stats;
 
-    // 3) 直接计数 + 实例清单
+    GFC_PERF_SCOPE("类映射");
+    // 3) 直接计数 + 实例清单（名称哈希查找，按实体下标累计）
+    QVector<int> direct(schema_.entityCount(), 0);
     int unknown = 0;
     for (const auto& r : refs) {
-        const QString camel = lowerToCamel_.value(r.cls.toLower());
-        if (camel.isEmpty()) { ++unknown; continue; }
-        directCountCamel_[camel] += 1;
-        instancesByCamel_[camel].push_back(r);
+        const int e = schema_.find(r.cls);
+        if (e < 0) { ++unknown; continue; }
+        ++direct[e];
+        instancesByCamel_[schema_.name(e)].push_back(r);
     }
     stats.unknown = unknown;
-    stats.mappedCls = directCountCamel_.size();
+    PerfTrace::instance().setCounter(QStringLiteral("未知类实例"), unknown);
 
     // 4) 沿父链累加得到 inclusive
-    inclusiveCountCamel_ = directCountCamel_;
-    for (auto it = directCountCamel_.cbegin(); it != directCountCamel_.cend(); ++it) {
-        QString p = schema_.classes().value(it.key()).parent; // CamelCase
-        while (!p.isEmpty()) {
-            inclusiveCountCamel_[p] += it.value();
-            p = schema_.classes().value(p).parent;
-        }
+    QVector<int> inclusive(schema_.entityCount(), 0);
+    for (int e = 0; e < direct.size(); ++e) {
+        if (direct[e] == 0) continue;
+        directCountCamel_.insert(schema_.name(e), direct[e]);
+        for (int p = e; p >= 0; p = schema_.parent(p)) inclusive[p] += direct[e];
+    }
+    for (int e = 0; e < inclusive.size(); ++e) {
+        if (inclusive[e] > 0) inclusiveCountCamel_.insert(schema_.name(e), inclusive[e]);
     }
+    stats.mappedCls = directCountCamel_.size();
     return stats;
 }
 
@@ -211,6 +249,18 @@ void MainWindow::buildMenusAndToolbar()
 
     auto actSaveAs = mFile->addAction(QStringLiteral("另存为 (&A) ..."));
     connect(actSaveAs, &QAction::triggered, this, &MainWindow::saveGfcAs);
+    auto actMerge = mFile->addAction(QStringLiteral("合并文件 ..."));
+    connect(actMerge, &QAction::triggered, this, &MainWindow::mergeFiles);
+    auto actMesh = mFile->addAction(QStringLiteral("导出网格 (OBJ/STL) ..."));
+    connect(actMesh, &QAction::triggered, this, &MainWindow::exportMesh);
+    auto actTables = mFile->addAction(QStringLiteral("导出表格 (NDJSON/CSV) ..."));
+    connect(actTables, &QAction::triggered, this, &MainWindow::exportTables);
+    auto actSqlite = mFile->addAction(QStringLiteral("导出 SQLite ..."));
+    connect(actSqlite, &QAction::triggered, this, &MainWindow::exportSqlite);
+
+    mFile->addSeparator();
+    auto actOpenExp = mFile->addAction(QStringLiteral("打开 Schema (.exp) ..."));
+    connect(actOpenExp, &QAction::triggered, this, &MainWindow::openSchemaExp);
 
     mFile->addSeparator();
     auto actQuit = mFile->addAction(QStringLiteral("退出"));
@@ -287,6 +337,45 @@ void MainWindow::buildMenusAndToolbar()
     actStatusbar->setChecked(true);
     connect(actStatusbar, &QAction::triggered, this, &MainWindow::toggleStatusbar);
 
+    mView->addSeparator();
+    auto actPerfDock = mView->addAction(QStringLiteral("性能面板"));
+    actPerfDock->setCheckable(true);
+    actPerfDock->setChecked(true);
+    connect(actPerfDock, &QAction::triggered, this, &MainWindow::togglePerfDock);
+
+    actPerfRecord_ = mView->addAction(QStringLiteral("记录性能跟踪 (Chrome Trace)"));
+    actPerfRecord_->setCheckable(true);
+    actPerfRecord_->setChecked(false);
+    connect(actPerfRecord_, &QAction::triggered, this, &MainWindow::togglePerfRecording);
+
+    mView->addSeparator();
+    auto actDiff = mView->addAction(QStringLiteral("语义比较 ..."));
+    connect(actDiff, &QAction::triggered, this, &MainWindow::compareWithFile);
+    auto actRenumber = mView->addAction(QStringLiteral("重新编号 ..."));
+    connect(actRenumber, &QAction::triggered, this, &MainWindow::renumberInstances);
+    auto actPurge = mView->addAction(QStringLiteral("清除不可达实例 ..."));
+    connect(actPurge, &QAction::triggered, this, &MainWindow::purgeUnreachable);
+    auto actDedupe = mView->addAction(QStringLiteral("合并重复实例 ..."));
+    connect(actDedupe, &QAction::triggered, this, &MainWindow::dedupeInstances);
+    auto actWeld = mView->addAction(QStringLiteral("焊接相近点 ..."));
+    connect(actWeld, &QAction::triggered, this, &MainWindow::weldVertices);
+    auto actGeometry = mView->addAction(QStringLiteral("计算构件几何量"));
+    connect(actGeometry, &QAction::triggered, this, &MainWindow::computeGeometry);
+    auto actSpatial = mView->addAction(QStringLiteral("空间查询 ..."));
+    connect(actSpatial, &QAction::triggered, this, &MainWindow::spatialQuery);
+    auto actProps = mView->addAction(QStringLiteral("属性透视表 ..."));
+    connect(actProps, &QAction::triggered, this, &MainWindow::showPropertyTable);
+    auto actValues = mView->addAction(QStringLiteral("取值查找 ..."));
+    connect(actValues, &QAction::triggered, this, &MainWindow::valueLookup);
+    auto actQuery = mView->addAction(QStringLiteral("查询 ..."));
+    connect(actQuery, &QAction::triggered, this, &MainWindow::instanceQuery);
+    auto actBulk = mView->addAction(QStringLiteral("批量改属性 ..."));
+    connect(actBulk, &QAction::triggered, this, &MainWindow::bulkEditAttribute);
+    auto actExtract = mView->addAction(QStringLiteral("提取引用闭包 ..."));
+    connect(actExtract, &QAction::triggered, this, &MainWindow::extractClosure);
+    auto actQuantity = mView->addAction(QStringLiteral("工程量汇总 ..."));
+    connect(actQuantity, &QAction::triggered, this, &MainWindow::quantityReport);
+
     // 帮助
     auto mHelp = menuBar()->addMenu(QStringLiteral("帮助"));
     auto actHelp = mHelp->addAction(QStringLiteral("帮助文档"));
@@ -345,6 +434,25 @@ void MainWindow::buildDocks()
     dockClass->setWidget(classTree_);
     addDockWidget(Qt::LeftDockWidgetArea, dockClass);
 
+    // 视图区（空间结构：项目 → 建筑 → 楼层 → 构件），与类继承树同处左侧
+    structTree_ = new QTreeView(this);
+    structTree_->setHeaderHidden(true);
+    structTree_->setUniformRowHeights(true);
+    structModel_ = new QStandardItemModel(this);
+    structTree_->setModel(structModel_);
+    connect(structTree_, &QTreeView::expanded, this, &MainWindow::onStructureExpanded);
+    connect(structTree_, &QTreeView::clicked, this, &MainWindow::onStructureClicked);
+
+    auto dockStruct = new QDockWidget(QStringLiteral("视图区 - 空间结构"), this);
+    dockStruct->setObjectName("dockStructureView");
+    dockStruct->setWidget(structTree_);
+    addDockWidget(Qt::LeftDockWidgetArea, dockStruct);
+    tabifyDockWidget(dockClass, dockStruct);
+    dockClass->raise();
+    connect(dockStruct, &QDockWidget::visibilityChanged, this, [this](bool visible) {
+        if (visible && structureStale_) rebuildStructureTree();
+    });
+
     // 属性区
     propTable_ = new QTableWidget(this);
     propTable_->setColumnCount(2);
@@ -394,15 +502,46 @@ void MainWindow::buildDocks()
     dockFind->setWidget(resultsTable);
     addDockWidget(Qt::BottomDockWidgetArea, dockFind);
 
+    // 性能区：最近一次加载/重算的阶段耗时、计数器与内存估算
+    perfTable_ = new QTableWidget(this);
+    perfTable_->setColumnCount(3);
+    perfTable_->setHorizontalHeaderLabels({ QStringLiteral("阶段/项"), QStringLiteral("耗时/数值"), QStringLiteral("占比") });
+    perfTable_->horizontalHeader()->setStretchLastSection(true);
+    perfTable_->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    perfTable_->verticalHeader()->setVisible(false);
+
+    auto dockPerf = new QDockWidget(QStringLiteral("性能"), this);
+    dockPerf->setObjectName("dockPerf");
+    dockPerf->setWidget(perfTable_);
+    addDockWidget(Qt::BottomDockWidgetArea, dockPerf);
+    tabifyDockWidget(dockFind, dockPerf);
+    dockFind->raise();
+
     // 允许浮动/停靠
     dockClass->setFeatures(QDockWidget::DockWidgetMovable | QDockWidget::DockWidgetFloatable | QDockWidget::DockWidgetClosable);
+    dockStruct->setFeatures(QDockWidget::DockWidgetMovable | QDockWidget::DockWidgetFloatable | QDockWidget::DockWidgetClosable);
     dockProp->setFeatures(QDockWidget::DockWidgetMovable | QDockWidget::DockWidgetFloatable | QDockWidget::DockWidgetClosable);
     dockFind->setFeatures(QDockWidget::DockWidgetMovable | QDockWidget::DockWidgetFloatable | QDockWidget::DockWidgetClosable);
+    dockPerf->setFeatures(QDockWidget::DockWidgetMovable | QDockWidget::DockWidgetFloatable | QDockWidget::DockWidgetClosable);
 }
 
 
 void MainWindow::buildStatusBar()
 {
+    // 后台任务进度（空闲时隐藏）
+    jobProgress_ = new QProgressBar(this);
+    jobProgress_->setMaximumWidth(160);
+    jobProgress_->setVisible(false);
+    jobCancelBtn_ = new QToolButton(this);
+    jobCancelBtn_->setText(QStringLiteral("取消"));
+    jobCancelBtn_->setVisible(false);
+    connect(jobCancelBtn_, &QToolButton::clicked, this, [this] { jobCancel_ = true; });
+    statusBar()->addPermanentWidget(jobProgress_);
+    statusBar()->addPermanentWidget(jobCancelBtn_);
+
+    jobWatcher_ = new QFutureWatcher<QString>(this);
+    connect(jobWatcher_, &QFutureWatcher<QString>::finished, this, &MainWindow::onJobFinished);
+
     statusBar()->addPermanentWidget(lblPos_);
     statusBar()->addPermanentWidget(lblSize_);
     onCursorPosChanged();
@@ -440,7 +579,7 @@ void MainWindow::newFile()
 }
 
 void MainWindow::openGfc() {
-    QString path = QFileDialog::getOpenFileName(this, QStringLiteral("打开 GFC 文件"), QString(), "GFC (*.gfc)");
+    QString path = QFileDialog::getOpenFileName(this, QStringLiteral("打开 GFC 文件"), QString(), "GFC (*.gfc *.gfcb *.gz *.zst)");
     if (path.isEmpty()) return;
 
     if (loadGfcFromFile(path)) {  // 假设loadGfcFromFile函数已正确实现
@@ -463,20 +602,200 @@ void MainWindow::saveGfc()
         saveGfcAs();
         return;
     }
-    if (saveGfcToFile(currentFilePath_)) {
-        statusBar()->showMessage(QStringLiteral("已保存：%1").arg(currentFilePath_), 2000);
-    }
+    saveGfcToFile(currentFilePath_);
 }
 
 void MainWindow::saveGfcAs()
 {
-    QString path = QFileDialog::getSaveFileName(this, QStringLiteral("另存为 GFC 文件"), currentFilePath_.isEmpty() ? QString() : currentFilePath_, "GFC (*.gfc)");
+    QString path = QFileDialog::getSaveFileName(this, QStringLiteral("另存为 GFC 文件"), currentFilePath_.isEmpty() ? QString() : currentFilePath_,
+                                                QStringLiteral("GFC (*.gfc);;GFC 二进制 (*.gfcb);;GFC gzip (*.gfc.gz);;GFC zstd (*.gfc.zst);;GFC 二进制 zstd (*.gfcb.zst)"));
     if (path.isEmpty()) return;
-    if (saveGfcToFile(path)) {
-        currentFilePath_ = path;
-        updateWindowTitle();
-        statusBar()->showMessage(QStringLiteral("已保存：%1").arg(currentFilePath_), 2000);
+    saveGfcToFile(path, /*becomeCurrent=*/true);
+}
+
+void MainWindow::mergeFiles()
+{
+    if (jobBusy()) return;
+    const QString dir = QFileInfo(currentFilePath_).absolutePath();
+    QStringList inputs = QFileDialog::getOpenFileNames(this, QStringLiteral("选择要合并的 GFC 文件（按文件名顺序编号）"),
+        dir, QStringLiteral("GFC (*.gfc *.gfcb *.gz *.zst);;所有文件 (*.*)"));
+    if (inputs.isEmpty()) return;
+    if (inputs.size() < 2) {
+        statusBar()->showMessage(QStringLiteral("至少选择两个文件。"), 2000);
+        return;
+    }
+    inputs.sort(Qt::CaseInsensitive);
+    const QString output = QFileDialog::getSaveFileName(this, QStringLiteral("合并结果另存为"), dir,
+        QStringLiteral("GFC (*.gfc);;GFC gzip (*.gfc.gz);;GFC zstd (*.gfc.zst)"));
+    if (output.isEmpty()) return;
+    const auto ans = QMessageBox::question(this, QStringLiteral("合并文件"),
+        QStringLiteral("是否合并各文件中内容相同的项目、建筑/楼层与几何实体？\n选“否”则只重排编号、全部保留。"),
+        QMessageBox::Yes | QMessageBox::No | QMessageBox::Cancel, QMessageBox::Yes);
+    if (ans == QMessageBox::Cancel) return;
+
+    GfcMerge::Options opt;
+    opt.unify = ans == QMessageBox::Yes;
+    auto stats = QSharedPointer<GfcMerge::Stats>::create();
+    const CompiledSchema schema = schema_;
+    startJob(QStringLiteral("合并"), QStringLiteral("正在合并 %1 个文件 -> %2").arg(inputs.size()).arg(output),
+        [inputs, output, schema, opt, stats](const std::atomic<bool>* cancel, const JobProgress& progress) {
+            GfcMerge::Options o = opt;
+            o.write.cancel = cancel;
+            o.write.progress = progress;
+            QString err;
+            GfcMerge::merge(inputs, output, schema, o, stats.data(), &err);
+            return err;
+        },
+        [this, stats, output]() {
+            statusBar()->showMessage(QStringLiteral("合并完成：%1 个实例，合并共享实体 %2，用时 %3 ms")
+                .arg(stats->instances).arg(stats->unified).arg(stats->elapsedMs), 4000);
+            if (QMessageBox::question(this, QStringLiteral("合并文件"),
+                    QStringLiteral("已写出 %1（%2 个实例，最大编号 #%3）。是否打开？")
+                        .arg(output).arg(stats->instances).arg(stats->maxId)) == QMessageBox::Yes) {
+                loadGfcFromFile(output);
+            }
+        });
+}
+
+void MainWindow::exportMesh()
+{
+    if (jobBusy()) return;
+    const QFileInfo fi(currentFilePath_);
+    const QString output = QFileDialog::getSaveFileName(this, QStringLiteral("导出网格"),
+        fi.absolutePath() + QLatin1Char('/') + fi.completeBaseName() + QStringLiteral(".obj"),
+        QStringLiteral("Wavefront OBJ (*.obj);;二进制 STL (*.stl)"));
+    if (output.isEmpty()) return;
+    bool ok = false;
+    const double tol = QInputDialog::getDouble(this, QStringLiteral("导出网格"),
+        QStringLiteral("圆弧弦高容差（截面坐标单位）："), 1.0, 1e-6, 1e9, 6, &ok);
+    if (!ok) return;
+
+    QSharedPointer<GfcIndex> index;
+    {
+        PerfOperation op(QStringLiteral("导出网格：建索引"));
+        index = currentIndex();
+        if (!index) return;
+    }
+
+    GfcMeshOptions opt;
+    opt.chordTolerance = tol;
+    auto stats = QSharedPointer<GfcMeshExport::Stats>::create();
+    const CompiledSchema schema = schema_;
+    startJob(QStringLiteral("导出网格"), QStringLiteral("正在导出网格 -> %1").arg(output),
+        [index, output, schema, opt, stats](const std::atomic<bool>* cancel, const JobProgress& progress) {
+            GfcMeshOptions o = opt;
+            o.cancel = cancel;
+            o.progress = progress;
+            QString err;
+            GfcMeshExport::write(*index, schema, output, o, stats.data(), &err);
+            return err;
+        },
+        [this, stats, output]() {
+            QString skipped;
+            if (stats->skipped) {
+                QStringList names;
+                for (auto it = stats->skippedClasses.constBegin(); it != stats->skippedClasses.constEnd(); ++it) {
+                    names << QStringLiteral("%1×%2").arg(QString::fromLatin1(it.key())).arg(it.value());
+                }
+                names.sort();
+                skipped = QStringLiteral("；跳过 %1 个形体（%2）").arg(stats->skipped).arg(names.join(QStringLiteral("，")));
+            }
+            statusBar()->showMessage(QStringLiteral("已导出 %1：构件 %2/%3，三角形 %4，共用截面 %5，用时 %6 ms%7")
+                .arg(output).arg(stats->meshed).arg(stats->elements).arg(stats->triangles)
+                .arg(stats->sections).arg(stats->elapsedMs).arg(skipped), 8000);
+        });
+}
+
+void MainWindow::exportTables()
+{
+    if (jobBusy()) return;
+    const QStringList formats = { QStringLiteral("NDJSON（每行一个实例）"), QStringLiteral("CSV（每类一个文件）") };
+    bool ok = false;
+    const QString format = QInputDialog::getItem(this, QStringLiteral("导出表格"), QStringLiteral("格式："), formats, 0, false, &ok);
+    if (!ok) return;
+    const bool csv = format == formats[1];
+    const QString classes = QInputDialog::getText(this, QStringLiteral("导出表格"),
+        QStringLiteral("只导出这些类（逗号分隔，含子类；留空为全部）："), QLineEdit::Normal, QString(), &ok);
+    if (!ok) return;
+
+    const QFileInfo fi(currentFilePath_);
+    const QString base = currentFilePath_.isEmpty() ? QString() : fi.absolutePath() + QLatin1Char('/') + fi.completeBaseName();
+    const QString output = csv
+        ? QFileDialog::getExistingDirectory(this, QStringLiteral("导出 CSV 到目录"), fi.absolutePath())
+        : QFileDialog::getSaveFileName(this, QStringLiteral("导出 NDJSON"), base.isEmpty() ? QString() : base + QStringLiteral(".ndjson"),
+                                       QStringLiteral("NDJSON (*.ndjson *.ndjson.gz *.ndjson.zst)"));
+    if (output.isEmpty()) return;
+
+    QSharedPointer<GfcIndex> index;
+    {
+        PerfOperation op(QStringLiteral("导出表格：建索引"));
+        index = currentIndex();
+        if (!index) return;
+    }
+
+    GfcTableExport::Options opt;
+    opt.classes = classes.split(QLatin1Char(','), Qt::SkipEmptyParts);
+    auto stats = QSharedPointer<GfcTableExport::Stats>::create();
+    const CompiledSchema schema = schema_;
+    startJob(QStringLiteral("导出表格"), QStringLiteral("正在导出表格 -> %1").arg(output),
+        [index, output, csv, schema, opt, stats](const std::atomic<bool>* cancel, const JobProgress& progress) {
+            GfcTableExport::Options o = opt;
+            o.write.cancel = cancel;
+            o.write.progress = progress;
+            QString err;
+            if (csv) GfcTableExport::writeCsvTables(*index, schema, output, QStringLiteral(".csv"), o, stats.data(), &err);
+            else GfcTableExport::writeNdjson(*index, schema, output, o, stats.data(), &err);
+            return err;
+        },
+        [this, stats, output]() {
+            statusBar()->showMessage(QStringLiteral("已导出 %1：实例 %2，类 %3，文件 %4，%5 字节，用时 %6 ms")
+                .arg(output).arg(stats->instances).arg(stats->classes).arg(stats->files)
+                .arg(stats->bytesOut).arg(stats->elapsedMs), 8000);
+        });
+}
+
+void MainWindow::exportSqlite()
+{
+    if (jobBusy()) return;
+    if (!GfcSqliteExport::available()) {
+        QMessageBox::warning(this, QStringLiteral("导出 SQLite"), QStringLiteral("本版本未启用 SQLite 支持"));
+        return;
+    }
+    bool ok = false;
+    const QString classes = QInputDialog::getText(this, QStringLiteral("导出 SQLite"),
+        QStringLiteral("只导出这些类（逗号分隔，含子类；留空为全部）："), QLineEdit::Normal, QString(), &ok);
+    if (!ok) return;
+    const QFileInfo fi(currentFilePath_);
+    const QString output = QFileDialog::getSaveFileName(this, QStringLiteral("导出 SQLite"),
+        currentFilePath_.isEmpty() ? QString() : fi.absolutePath() + QLatin1Char('/') + fi.completeBaseName() + QStringLiteral(".sqlite"),
+        QStringLiteral("SQLite 数据库 (*.sqlite *.db)"));
+    if (output.isEmpty()) return;
+
+    QSharedPointer<GfcIndex> index;
+    {
+        PerfOperation op(QStringLiteral("导出 SQLite：建索引"));
+        index = currentIndex();
+        if (!index) return;
     }
+
+    GfcSqliteExport::Options opt;
+    opt.classes = classes.split(QLatin1Char(','), Qt::SkipEmptyParts);
+    auto stats = QSharedPointer<GfcSqliteExport::Stats>::create();
+    const CompiledSchema schema = schema_;
+    startJob(QStringLiteral("导出 SQLite"), QStringLiteral("正在导出 SQLite -> %1").arg(output),
+        [index, output, schema, opt, stats](const std::atomic<bool>* cancel, const JobProgress& progress) {
+            GfcSqliteExport::Options o = opt;
+            o.write.cancel = cancel;
+            o.write.progress = progress;
+            QString err;
+            GfcSqliteExport::write(*index, schema, output, o, stats.data(), &err);
+            return err;
+        },
+        [this, stats, output]() {
+            statusBar()->showMessage(QStringLiteral("已导出 %1：实例 %2，表 %3，链接 %4，索引 %5，%6 字节，用时 %7 ms")
+                .arg(output).arg(stats->instances).arg(stats->tables).arg(stats->links).arg(stats->indexes)
+                .arg(stats->bytesOut).arg(stats->elapsedMs), 8000);
+        });
 }
 
 void MainWindow::openSchemaExp()
@@ -484,41 +803,74 @@ void MainWindow::openSchemaExp()
     QString path = QFileDialog::getOpenFileName(this, QStringLiteral("打开 Schema (.exp)"), QString(), "EXP (*.exp)");
     if (path.isEmpty()) return;
 
+    // 首次加载时编译并写入缓存；同一内容再次加载直接读二进制
+    CompiledSchema compiled;
     QString err;
-    if (!schema_.parseFile(path, &err)) {
+    bool fromCache = false;
+    if (!SchemaCache::loadExp(path, &compiled, &err, &fromCache)) {
         QMessageBox::warning(this, QStringLiteral("解析失败"), err);
         return;
     }
-    currentSchemaPath_ = path;
-    children_ = schema_.buildChildrenMap();
-    prepareSchemaIndex();
-    directCountCamel_.clear();
-    inclusiveCountCamel_.clear();
-    instancesByCamel_.clear();
-    statusBar()->showMessage(QStringLiteral("已加载 Schema：%1").arg(path), 3000);
+    schema_ = compiled;
+    invalidateDocumentCache();
+    applyLoadedSchema(path);
+    statusBar()->showMessage(QStringLiteral("已加载 Schema：%1%2")
+        .arg(path, fromCache ? QStringLiteral("（编译缓存）") : QString()), 3000);
+}
+
+void MainWindow::applyLoadedSchema(const QString& displayPath)
+{
+    currentSchemaPath_ = displayPath;
+    recomputeFromText(editor_->toPlainText());
+    rebuildClassTree();
+    invalidateStructureTree();
+    updateWindowTitle();
 }
 
 bool MainWindow::loadGfcFromFile(const QString& path)
 {
-    QFile f(path);
-    if (!f.open(QIODevice::ReadOnly | QIODevice::Text)) {
-        QMessageBox::warning(this, QStringLiteral("打开失败"), QStringLiteral("无法打开文件：%1").arg(path));
-        return false;
-    }
-    QTextStream in(&f);
-    setUtf8(in);
-    const QString text = in.readAll();
-    suppressReparse_ = true;
-    editor_->setPlainText(text);
-    suppressReparse_ = false;
+    RecomputeStats st;
+    {
+        PerfOperation op(QStringLiteral("加载 %1").arg(QFileInfo(path).fileName()));
 
-    enableGfcSyntaxColors();
+        // 读取与解码分开计时（原 QTextStream::readAll 把两者混在一起）
+        QByteArray raw;
+        QString err;
+        if (!GfcFileIO::readText(path, &raw, &err)) {
+            QMessageBox::warning(this, QStringLiteral("打开失败"), err);
+            return false;
+        }
+        QString text;
+        {
+            GFC_PERF_SCOPE("UTF-8 解码");
+            text = QString::fromUtf8(raw);
+            raw.clear();
+        }
 
-    classCounts_ = GfcParser::countClasses(text, nullptr);
-    RecomputeStats st = recomputeFromText(text);
-    currentFilePath_ = path;
-    updateWindowTitle();
-    rebuildClassTree();
+        // 先装高亮器：setPlainText 时同步着色，耗时计入“语法高亮”累计项
+        enableGfcSyntaxColors();
+
+        suppressReparse_ = true;
+        {
+            GFC_PERF_SCOPE("setPlainText");
+            editor_->setPlainText(text);
+        }
+        suppressReparse_ = false;
+
+        {
+            GFC_PERF_SCOPE("countClasses(classCounts_)");
+            classCounts_ = GfcParser::countClasses(text, nullptr);
+        }
+        st = recomputeFromText(text);
+        currentFilePath_ = path;
+        updateWindowTitle();
+        GFC_PERF_SCOPE("构建类树");
+        rebuildClassTree();
+        invalidateStructureTree();
+        prewarmValueIndex(text);
+    }
+    reportMemoryUsage();
+    refreshPerfDock();
 #ifdef QT_DEBUG
     qDebug() << "[loadGfcFromFile] instances=" << st.instances
         << "unknown=" << st.unknown << "mappedCls=" << st.mappedCls;
@@ -531,19 +883,897 @@ bool MainWindow::loadGfcFromFile(const QString& path)
 }
 
 
-bool MainWindow::saveGfcToFile(const QString& path)
+bool MainWindow::saveGfcToFile(const QString& path, bool becomeCurrent)
+{
+    if (jobBusy()) return false;
+
+    // GUI 线程只做一次文本快照；编码、写盘、改名都在后台，保存期间可以继续编辑
+    const QString text = editor_->toPlainText();
+    const CompiledSchema schema = schema_;   // 隐式共享拷贝，供后台编码二进制时映射类下标
+    return startJob(QStringLiteral("保存"), QStringLiteral("正在保存：%1").arg(path),
+        [text, path, schema](const std::atomic<bool>* cancel, const JobProgress& progress) {
+            GfcWriter::Options opt;
+            opt.cancel = cancel;
+            opt.progress = progress;
+            QString err;
+            GfcFileIO::writeText(text, path, schema, opt, &err);
+            return err;
+        },
+        [this, path, becomeCurrent]() {
+            if (becomeCurrent) {
+                currentFilePath_ = path;
+                updateWindowTitle();
+            }
+            statusBar()->showMessage(QStringLiteral("已保存：%1").arg(path), 2000);
+        },
+        /*finishOnClose=*/true);
+}
+
+bool MainWindow::jobBusy()
+{
+    if (!jobActive_) return false;
+    statusBar()->showMessage(QStringLiteral("正在%1，请稍候。").arg(jobName_), 2000);
+    return true;
+}
+
+bool MainWindow::startJob(const QString& name, const QString& message, JobWork work, std::function<void()> done,
+                          bool finishOnClose)
+{
+    if (jobBusy()) return false;
+    jobActive_ = true;
+    jobName_ = name;
+    jobDone_ = std::move(done);
+    jobFinishOnClose_ = finishOnClose;
+    jobCancel_ = false;
+
+    jobProgress_->setFormat(name + QStringLiteral(" %p%"));
+    jobProgress_->setRange(0, 100);
+    jobProgress_->setValue(0);
+    jobProgress_->setVisible(true);
+    jobCancelBtn_->setVisible(true);
+    statusBar()->showMessage(message);
+
+    QPointer<QProgressBar> bar = jobProgress_;
+    const JobProgress progress = [bar](qint64 done, qint64 total) {
+        const int pct = total > 0 ? int(done * 100 / total) : 100;
+        QMetaObject::invokeMethod(bar, [bar, pct] { if (bar) bar->setValue(pct); }, Qt::QueuedConnection);
+    };
+    const std::atomic<bool>* cancel = &jobCancel_;
+    jobWatcher_->setFuture(QtConcurrent::run([work, cancel, progress]() { return work(cancel, progress); }));
+    return true;
+}
+
+void MainWindow::onJobFinished()
+{
+    jobProgress_->setVisible(false);
+    jobCancelBtn_->setVisible(false);
+    jobActive_ = false;
+    const std::function<void()> done = std::move(jobDone_);
+    jobDone_ = nullptr;
+
+    const QString err = jobWatcher_->result();
+    if (!err.isEmpty()) {
+        statusBar()->clearMessage();
+        if (!jobCancel_) QMessageBox::warning(this, QStringLiteral("%1失败").arg(jobName_), err);
+        else statusBar()->showMessage(err, 2000);
+        return;
+    }
+    if (done) done();
+}
+
+void MainWindow::finishJobs()
+{
+    if (!jobWatcher_ || !jobWatcher_->isRunning()) return;
+    // 保存等它写完并改名，避免丢掉用户要保存的内容；合并/导出直接取消（临时文件由写出方清理）
+    if (!jobFinishOnClose_) jobCancel_ = true;
+    statusBar()->showMessage(QStringLiteral("正在结束%1……").arg(jobName_));
+    jobWatcher_->waitForFinished();
+}
+
+MainWindow::~MainWindow()
+{
+    // 正常关闭时 closeEvent 已等过；其它退出路径在成员析构前再等一次
+    finishJobs();
+}
+
+void MainWindow::closeEvent(QCloseEvent* ev)
+{
+    finishJobs();
+    QMainWindow::closeEvent(ev);
+}
+
+void MainWindow::compareWithFile()
+{
+    const QString path = QFileDialog::getOpenFileName(this, QStringLiteral("选择要比较的 GFC 文件"),
+        QFileInfo(currentFilePath_).absolutePath(),
+        QStringLiteral("GFC (*.gfc *.gfcb *.gz *.zst);;所有文件 (*.*)"));
+    if (path.isEmpty()) return;
+
+    // 当前文本快照作为 A；读取 B、建索引、哈希和匹配都在后台完成
+    const QByteArray textA = editor_->toPlainText().toUtf8();
+    const CompiledSchema schema = schema_;
+    auto diff = QSharedPointer<GfcDiff>::create();
+    statusBar()->showMessage(QStringLiteral("正在比较：%1").arg(path));
+
+    auto* watcher = new QFutureWatcher<QString>(this);
+    connect(watcher, &QFutureWatcher<QString>::finished, this, [this, watcher, diff, path]() {
+        watcher->deleteLater();
+        const QString err = watcher->result();
+        if (!err.isEmpty()) {
+            statusBar()->clearMessage();
+            QMessageBox::warning(this, QStringLiteral("语义比较"), err);
+            return;
+        }
+        statusBar()->showMessage(QStringLiteral("比较完成：%1 项差异，用时 %2 ms")
+            .arg(diff->items().size()).arg(diff->elapsedMs()), 3000);
+
+        const QString nameA = currentFilePath_.isEmpty()
+            ? QStringLiteral("当前文档") : QFileInfo(currentFilePath_).fileName();
+        auto* dlg = new GfcDiffDialog(diff, nameA, QFileInfo(path).fileName(), this);
+        connect(dlg, &GfcDiffDialog::instanceActivated, this, [this](qint64 id) {
+            const int pos = findInstancePosition(int(id));
+            if (pos < 0) {
+                statusBar()->showMessage(QStringLiteral("当前文档中已没有 #%1").arg(id), 2000);
+                return;
+            }
+            navigateTo(pos, false);
+            showInstanceByPos(pos, /*moveCaret=*/true);
+        });
+        dlg->show();
+    });
+    watcher->setFuture(QtConcurrent::run([textA, path, schema, diff]() {
+        QByteArray textB;
+        QString err;
+        if (!GfcFileIO::readText(path, &textB, &err)) return err;
+        if (!diff->compare(textA, textB, &schema, &err)) return err;
+        return QString();
+    }));
+}
+
+bool MainWindow::buildCurrentIndex(GfcIndex* index)
 {
-    QFile f(path);
-    if (!f.open(QIODevice::WriteOnly | QIODevice::Text)) {
-        QMessageBox::warning(this, QStringLiteral("保存失败"), QStringLiteral("无法写入文件：%1").arg(path));
+    QString err;
+    if (!index->build(editor_->toPlainText().toUtf8(), &schema_, &err)) {
+        QMessageBox::warning(this, QStringLiteral("无法分析当前文本"), err);
         return false;
     }
-    QTextStream out(&f);
-    setUtf8(out);
-    out << editor_->toPlainText();
     return true;
 }
 
+QSharedPointer<GfcIndex> MainWindow::currentIndex(QByteArray* key)
+{
+    if (!docIndex_) {
+        auto index = QSharedPointer<GfcIndex>::create();
+        if (!buildCurrentIndex(index.data())) return {};
+        docKey_ = GfcSidecar::contentKey(index->data());
+        docIndex_ = index;
+    }
+    if (key) *key = docKey_;
+    return docIndex_;
+}
+
+void MainWindow::invalidateDocumentCache()
+{
+    docIndex_.reset();
+    docKey_.clear();
+    ++docRevision_;
+}
+
+void MainWindow::replaceDocumentText(const QByteArray& utf8)
+{
+    const int caret = editor_->textCursor().position();
+    const QString text = QString::fromUtf8(utf8);
+    suppressReparse_ = true;
+    {
+        GFC_PERF_SCOPE("替换文档");
+        QTextCursor c(editor_->document());
+        c.beginEditBlock();
+        c.select(QTextCursor::Document);
+        c.insertText(text);
+        c.endEditBlock();
+    }
+    suppressReparse_ = false;
+
+    QTextCursor c(editor_->document());
+    c.setPosition(qMin(caret, int(text.size())));
+    editor_->setTextCursor(c);
+    editRefreshTimer_->stop();
+    reparseFromEditor();
+}
+
+void MainWindow::renumberInstances()
+{
+    const QStringList modes = { QStringLiteral("按文件顺序（实例位置不变）"),
+                                QStringLiteral("拓扑顺序（被引用的实例排在前面）") };
+    bool ok = false;
+    const QString mode = QInputDialog::getItem(this, QStringLiteral("重新编号"),
+        QStringLiteral("把实例编号压缩为 #1..#n，并改写全部引用："), modes, 0, false, &ok);
+    if (!ok) return;
+    const auto order = mode == modes[1] ? GfcRenumber::Topological : GfcRenumber::FileOrder;
+
+    QByteArray out;
+    GfcRenumber::Stats st;
+    {
+        PerfOperation op(QStringLiteral("重新编号"));
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        const QSharedPointer<GfcIndex> index = currentIndex();
+        QString err;
+        const bool built = !index.isNull();
+        const bool done = built && GfcRenumber::renumber(*index, order, &out, &st, &err);
+        QApplication::restoreOverrideCursor();
+        if (!done) {
+            if (built) QMessageBox::warning(this, QStringLiteral("重新编号"), err);
+            return;
+        }
+        if (st.idsChanged == 0 && st.moved == 0) {
+            statusBar()->showMessage(QStringLiteral("编号已是紧凑有序的，无需改动。"), 3000);
+            return;
+        }
+    }
+    replaceDocumentText(out);
+    statusBar()->showMessage(
+        QStringLiteral("重新编号：%1 个实例中 %2 个编号变化，%3 个移动位置，改写引用 %4 处%5（可撤销）")
+            .arg(st.instances).arg(st.idsChanged).arg(st.moved).arg(st.refs)
+            .arg(st.dangling ? QStringLiteral("，悬空编号 %1 个").arg(st.dangling) : QString()),
+        5000);
+}
+
+void MainWindow::purgeUnreachable()
+{
+    bool ok = false;
+    const QString roots = QInputDialog::getText(this, QStringLiteral("清除不可达实例"),
+        QStringLiteral("根类（逗号分隔，含子类；从这些实例出发沿引用可达的实例保留）："),
+        QLineEdit::Normal, GfcPurge::defaultRoots().join(QStringLiteral(", ")), &ok);
+    if (!ok) return;
+    const QStringList rootList = roots.split(QLatin1Char(','), Qt::SkipEmptyParts);
+
+    QSharedPointer<GfcIndex> indexPtr;
+    GfcPurge::Plan plan;
+    QStringList unknown;
+    {
+        PerfOperation op(QStringLiteral("可达性分析"));
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        indexPtr = currentIndex();
+        const bool built = !indexPtr.isNull();
+        if (built) GfcPurge::mark(*indexPtr, schema_, rootList, &plan, &unknown);
+        QApplication::restoreOverrideCursor();
+        if (!built) return;
+    }
+    const GfcIndex& index = *indexPtr;
+    const QString unknownNote = unknown.isEmpty() ? QString()
+        : QStringLiteral("\nSchema 中没有的根类已忽略：%1").arg(unknown.join(QStringLiteral(", ")));
+    if (plan.removed == 0) {
+        QMessageBox::information(this, QStringLiteral("清除不可达实例"),
+            QStringLiteral("从 %1 个根实例出发，全部 %2 个实例均可达，无需删除。%3")
+                .arg(plan.roots).arg(index.size()).arg(unknownNote));
+        return;
+    }
+
+    GfcReportDialog dlg(QStringLiteral("清除不可达实例"),
+        QStringLiteral("根实例 %1 个；%2 个实例中有 %3 个不可达，共 %4 字节。%5")
+            .arg(plan.roots).arg(index.size()).arg(plan.removed).arg(plan.bytes).arg(unknownNote),
+        { QStringLiteral("类"), QStringLiteral("实例"), QStringLiteral("删除"), QStringLiteral("字节") }, this);
+    for (const GfcPurge::ClassStat& cs : plan.classes) {
+        dlg.addRow({ QString::fromLatin1(cs.name), cs.total, cs.removed, cs.bytes });
+    }
+    dlg.setAcceptText(QStringLiteral("删除 %1 个实例").arg(plan.removed));
+    if (dlg.exec() != QDialog::Accepted) return;
+
+    replaceDocumentText(GfcPurge::apply(index, plan.keep));
+    statusBar()->showMessage(QStringLiteral("已删除 %1 个不可达实例（%2 字节，可撤销）")
+                                 .arg(plan.removed).arg(plan.bytes), 5000);
+}
+
+void MainWindow::dedupeInstances()
+{
+    bool ok = false;
+    const QString excluded = QInputDialog::getText(this, QStringLiteral("合并重复实例"),
+        QStringLiteral("不参与合并的类（逗号分隔，含子类；这些实例有独立身份，即使内容相同也保留）："),
+        QLineEdit::Normal, GfcDedupe::defaultExcludedRoots().join(QStringLiteral(", ")), &ok);
+    if (!ok) return;
+    const QStringList excludedList = excluded.split(QLatin1Char(','), Qt::SkipEmptyParts);
+
+    QSharedPointer<GfcIndex> indexPtr;
+    GfcDedupe::Plan plan;
+    QStringList unknown;
+    {
+        PerfOperation op(QStringLiteral("内容去重分析"));
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        indexPtr = currentIndex();
+        const bool built = !indexPtr.isNull();
+        if (built) GfcDedupe::analyze(*indexPtr, schema_, excludedList, &plan, &unknown);
+        QApplication::restoreOverrideCursor();
+        if (!built) return;
+    }
+    const GfcIndex& index = *indexPtr;
+    QString notes;
+    if (plan.cyclic) notes += QStringLiteral("\n引用环上的 %1 个实例未参与。").arg(plan.cyclic);
+    if (!unknown.isEmpty()) notes += QStringLiteral("\nSchema 中没有的类已忽略：%1").arg(unknown.join(QStringLiteral(", ")));
+    if (plan.duplicates == 0) {
+        QMessageBox::information(this, QStringLiteral("合并重复实例"),
+            QStringLiteral("%1 个实例中没有内容相同的实例。%2").arg(index.size()).arg(notes));
+        return;
+    }
+
+    GfcReportDialog dlg(QStringLiteral("合并重复实例"),
+        QStringLiteral("%1 个实例中有 %2 个与之前的实例内容相同（含引用的子实例），合并后约节省 %3 字节（%4%）。%5")
+            .arg(index.size()).arg(plan.duplicates).arg(plan.bytes)
+            .arg(100.0 * plan.bytes / qMax(1, index.data().size()), 0, 'f', 1).arg(notes),
+        { QStringLiteral("类"), QStringLiteral("实例"), QStringLiteral("重复"), QStringLiteral("节省字节") }, this);
+    for (const GfcDedupe::ClassStat& cs : plan.classes) {
+        dlg.addRow({ QString::fromLatin1(cs.name), cs.total, cs.duplicates, cs.bytes });
+    }
+    dlg.setAcceptText(QStringLiteral("合并 %1 个实例").arg(plan.duplicates));
+    if (dlg.exec() != QDialog::Accepted) return;
+
+    qint64 refs = 0;
+    QByteArray out;
+    {
+        PerfOperation op(QStringLiteral("合并重复实例"));
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        out = GfcDedupe::apply(index, plan.canon, &refs);
+        QApplication::restoreOverrideCursor();
+    }
+    replaceDocumentText(out);
+    statusBar()->showMessage(QStringLiteral("已合并 %1 个重复实例，改写引用 %2 处（可撤销）")
+                                 .arg(plan.duplicates).arg(refs), 5000);
+}
+
+void MainWindow::weldVertices()
+{
+    bool ok = false;
+    const QString text = QInputDialog::getText(this, QStringLiteral("焊接相近点"),
+        QStringLiteral("容差 ε（GfcVector2d/3d 中距离不超过 ε 的点合并为一个）："),
+        QLineEdit::Normal, QStringLiteral("1e-6"), &ok);
+    if (!ok) return;
+    const double eps = text.trimmed().toDouble(&ok);
+    if (!ok || !(eps > 0)) {
+        QMessageBox::warning(this, QStringLiteral("焊接相近点"), QStringLiteral("容差必须为正数：%1").arg(text));
+        return;
+    }
+
+    QSharedPointer<GfcIndex> index;
+    QVector<int> canon;
+    GfcWeld::Stats st;
+    {
+        PerfOperation op(QStringLiteral("点焊接分析"));
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        QString err;
+        index = currentIndex();
+        const bool built = !index.isNull();
+        const bool done = built && GfcWeld::analyze(*index, schema_, eps, &canon, &st, &err);
+        QApplication::restoreOverrideCursor();
+        if (!done) {
+            if (built) QMessageBox::warning(this, QStringLiteral("焊接相近点"), err);
+            return;
+        }
+    }
+    const int welded = st.welded[0] + st.welded[1];
+    const QString skipped = st.skipped ? QStringLiteral("\n坐标无法解析的 %1 个点未参与。").arg(st.skipped) : QString();
+    if (welded == 0) {
+        QMessageBox::information(this, QStringLiteral("焊接相近点"),
+            QStringLiteral("容差 %1 内没有可合并的点。%2").arg(eps).arg(skipped));
+        return;
+    }
+
+    GfcReportDialog dlg(QStringLiteral("焊接相近点"),
+        QStringLiteral("容差 %1：合并 %2 个点，最大移动 %3，约节省 %4 字节。%5")
+            .arg(eps).arg(welded).arg(st.maxShift, 0, 'g', 6).arg(st.bytes).arg(skipped),
+        { QStringLiteral("类"), QStringLiteral("点"), QStringLiteral("合并") }, this);
+    if (st.points[0]) dlg.addRow({ QStringLiteral("GFCVECTOR2D"), st.points[0], st.welded[0] });
+    if (st.points[1]) dlg.addRow({ QStringLiteral("GFCVECTOR3D"), st.points[1], st.welded[1] });
+    dlg.setAcceptText(QStringLiteral("合并 %1 个点").arg(welded));
+    if (dlg.exec() != QDialog::Accepted) return;
+
+    qint64 refs = 0;
+    QByteArray out;
+    {
+        PerfOperation op(QStringLiteral("焊接相近点"));
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        out = GfcDedupe::apply(*index, canon, &refs);
+        QApplication::restoreOverrideCursor();
+    }
+    replaceDocumentText(out);
+    statusBar()->showMessage(QStringLiteral("已焊接 %1 个点，改写引用 %2 处（可撤销）；引用它们的实例可能因此相同，可再执行“合并重复实例”")
+                                 .arg(welded).arg(refs), 8000);
+}
+
+void MainWindow::computeGeometry()
+{
+    if (jobBusy()) return;
+    QSharedPointer<GfcIndex> index;
+    {
+        PerfOperation op(QStringLiteral("构件几何量：建索引"));
+        index = currentIndex();
+        if (!index) return;
+    }
+
+    auto results = QSharedPointer<QVector<GfcElementGeometry>>::create();
+    auto sum = QSharedPointer<GfcGeometryEvaluator::Summary>::create();
+    const CompiledSchema schema = schema_;
+    const quint64 revision = docRevision_;
+    startJob(QStringLiteral("计算几何量"), QStringLiteral("正在计算构件几何量……"),
+        [index, schema, results, sum](const std::atomic<bool>* cancel, const JobProgress& progress) {
+            *results = GfcGeometryEvaluator(*index, schema).evaluateAll(sum.data(), progress, cancel);
+            return cancel->load() ? QStringLiteral("已取消计算几何量") : QString();
+        },
+        [this, index, results, sum, revision]() {
+            refreshPerfDock();
+            if (revision != docRevision_) {
+                statusBar()->showMessage(QStringLiteral("计算期间文本已改动，几何量结果已丢弃"), 5000);
+                return;
+            }
+            showGeometryReport(*index, *results, *sum);
+        });
+}
+
+void MainWindow::showGeometryReport(const GfcIndex& index, const QVector<GfcElementGeometry>& results,
+                                    const GfcGeometryEvaluator::Summary& sum)
+{
+    if (sum.elements == 0) {
+        QMessageBox::information(this, QStringLiteral("计算构件几何量"), QStringLiteral("没有 GfcElement 实例。"));
+        return;
+    }
+
+    geometryById_.clear();
+    geometryById_.reserve(results.size());
+    struct ClassSum { int count = 0; double volume = 0, area = 0; };
+    QMap<QByteArray, ClassSum> byClass;
+    for (const GfcElementGeometry& g : results) {
+        const GfcIndexEntry& en = index.at(g.row);
+        geometryById_.insert(en.id, g);
+        ClassSum& cs = byClass[index.className(en.cls)];
+        ++cs.count;
+        cs.volume += g.volume;
+        cs.area += g.area;
+    }
+
+    QString summary = QStringLiteral("构件 %1：完整 %2，部分 %3，无可计算形体 %4；用时 %5 ms。\n总体积 %6，总表面积 %7")
+        .arg(sum.elements).arg(sum.complete).arg(sum.partial).arg(sum.empty).arg(sum.elapsedMs)
+        .arg(sum.volume, 0, 'g', 10).arg(sum.area, 0, 'g', 10);
+    if (!sum.box.isEmpty()) {
+        summary += QStringLiteral("\n包围盒 (%1, %2, %3) - (%4, %5, %6)")
+            .arg(sum.box.min[0], 0, 'g', 8).arg(sum.box.min[1], 0, 'g', 8).arg(sum.box.min[2], 0, 'g', 8)
+            .arg(sum.box.max[0], 0, 'g', 8).arg(sum.box.max[1], 0, 'g', 8).arg(sum.box.max[2], 0, 'g', 8);
+    }
+    if (!sum.skippedClasses.isEmpty()) {
+        QStringList names;
+        for (auto it = sum.skippedClasses.constBegin(); it != sum.skippedClasses.constEnd(); ++it) {
+            names << QStringLiteral("%1×%2").arg(QString::fromLatin1(it.key())).arg(it.value());
+        }
+        names.sort();
+        summary += QStringLiteral("\n跳过的形体/曲线类型：%1").arg(names.join(QStringLiteral("，")));
+    }
+    GfcReportDialog dlg(QStringLiteral("构件几何量"), summary,
+        { QStringLiteral("类"), QStringLiteral("构件"), QStringLiteral("体积"), QStringLiteral("表面积") }, this);
+    for (auto it = byClass.constBegin(); it != byClass.constEnd(); ++it) {
+        dlg.addRow({ QString::fromLatin1(it.key()), it.value().count, it.value().volume, it.value().area });
+    }
+    dlg.exec();
+    statusBar()->showMessage(QStringLiteral("已计算 %1 个构件的几何量，选中构件可在属性区查看").arg(sum.elements), 5000);
+    if (currentInstance_.index >= 0) showInstanceByPos(currentInstance_.start, false);
+}
+
+void MainWindow::spatialQuery()
+{
+    bool ok = false;
+    const QString text = QInputDialog::getText(this, QStringLiteral("空间查询"),
+        QStringLiteral("框选：box x0 y0 z0 x1 y1 z1\n点选：point x y z\n近邻：knn x y z [k]"),
+        QLineEdit::Normal, QStringLiteral("knn 0 0 0 10"), &ok);
+    if (!ok || text.trimmed().isEmpty()) return;
+    GfcSpatialIndex::Query query;
+    QString err;
+    if (!GfcSpatialIndex::parseQuery(text, &query, &err)) {
+        QMessageBox::warning(this, QStringLiteral("空间查询"), err);
+        return;
+    }
+
+    QSharedPointer<GfcIndex> indexPtr;
+    QVector<GfcSpatialIndex::Hit> hits;
+    QString source;
+    {
+        PerfOperation op(QStringLiteral("空间查询"));
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        QByteArray key;
+        indexPtr = currentIndex(&key);
+        const bool built = !indexPtr.isNull();
+        if (built) {
+            // 内容未变时复用；否则先读旁路索引，没有（或已过期）再重建并写回
+            if (key != spatialKey_) {
+                GfcSidecar sidecar;
+                const QString sidecarPath = currentFilePath_.isEmpty() ? QString() : GfcSidecar::pathFor(currentFilePath_);
+                const bool loaded = !sidecarPath.isEmpty() && sidecar.load(sidecarPath, key)
+                    && spatial_.deserialize(sidecar.section(GfcSpatialIndex::sidecarTag()));
+                if (loaded) {
+                    source = QStringLiteral("旁路索引");
+                }
+                else {
+                    GfcSpatialIndex::BuildStats bs;
+                    spatial_ = GfcSpatialIndex::build(*indexPtr, schema_, &bs);
+                    source = QStringLiteral("新建索引 %1 ms").arg(bs.elapsedMs);
+                    // 只替换本段，其它段保留；写不了（只读目录等）不影响查询
+                    if (!sidecarPath.isEmpty())
+                        GfcSidecar::update(sidecarPath, key, GfcSpatialIndex::sidecarTag(), spatial_.serialize());
+                }
+                spatialKey_ = key;
+            }
+            GFC_PERF_SCOPE("空间查询");
+            hits = spatial_.run(query);
+        }
+        QApplication::restoreOverrideCursor();
+        if (!built) return;
+    }
+    refreshPerfDock();
+
+    const GfcIndex& index = *indexPtr;
+    QVector<int> rows;
+    QStringList notes;
+    for (const GfcSpatialIndex::Hit& h : hits) {
+        const int row = index.rowOf(h.id);
+        if (row < 0) continue;
+        rows << row;
+        notes << (query.kind == GfcSpatialIndex::Query::Nearest
+                      ? QStringLiteral("[距离 %1] ").arg(h.distance, 0, 'g', 8) : QString());
+    }
+    QString summary = QStringLiteral("空间查询：%1 个构件（索引 %2 个").arg(rows.size()).arg(spatial_.size());
+    if (!source.isEmpty()) summary += QStringLiteral("，%1").arg(source);
+    showRowsInFindResults(index, rows, notes, summary + QStringLiteral("）"));
+}
+
+void MainWindow::showPropertyTable()
+{
+    auto index = QSharedPointer<GfcIndex>::create();
+    auto schema = QSharedPointer<CompiledSchema>::create(schema_);
+    auto props = QSharedPointer<GfcPropertyIndex>::create();
+    GfcPropertyIndex::Stats st;
+    bool parsed = false, built = false;
+    {
+        PerfOperation op(QStringLiteral("属性透视表"));
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        parsed = buildCurrentIndex(index.data());
+        built = parsed && props->build(*index, *schema, &st);
+        QApplication::restoreOverrideCursor();
+    }
+    refreshPerfDock();
+    if (!built) {
+        if (parsed) {
+            QMessageBox::warning(this, QStringLiteral("属性透视表"),
+                QStringLiteral("当前 Schema 中没有 GfcRelDefinesByProperties / GfcPropertySet / GfcProperty"));
+        }
+        return;
+    }
+
+    const QString summary = QStringLiteral("%1 个属性关系，%2 个对象，%3 个属性实例 → %4 行；%5 个键，%6 种取值；用时 %7 ms")
+        .arg(st.relations).arg(st.objects).arg(st.properties).arg(st.rows).arg(st.keys).arg(st.values).arg(st.elapsedMs);
+    auto* dlg = new GfcPropertyDialog(index, schema, props, summary, this);
+    connect(dlg, &GfcPropertyDialog::instanceActivated, this, [this](qint64 id) {
+        const int pos = findInstancePosition(int(id));
+        if (pos < 0) {
+            statusBar()->showMessage(QStringLiteral("当前文档中已没有 #%1").arg(id), 2000);
+            return;
+        }
+        navigateTo(pos, false);
+        showInstanceByPos(pos, /*moveCaret=*/true);
+    });
+    dlg->show();
+}
+
+void MainWindow::prewarmValueIndex(const QString& text)
+{
+    if (schema_.isEmpty() || currentFilePath_.isEmpty()) return;
+    const CompiledSchema schema = schema_;
+    const QString sidecarPath = GfcSidecar::pathFor(currentFilePath_);
+    const quint64 revision = docRevision_;
+    auto index = QSharedPointer<GfcIndex>::create();
+    auto values = QSharedPointer<GfcValueIndex>::create();
+    auto key = QSharedPointer<QByteArray>::create();
+    auto* watcher = new QFutureWatcher<bool>(this);
+    connect(watcher, &QFutureWatcher<bool>::finished, this, [this, watcher, revision, index, values, key]() {
+        watcher->deleteLater();
+        if (!watcher->result()) return;
+        if (*key != valuesKey_) {
+            values_ = values;
+            valuesKey_ = *key;
+        }
+        // 期间文本和 Schema 都没变时，顺带作为当前文本的索引缓存
+        if (revision == docRevision_ && !docIndex_) {
+            docIndex_ = index;
+            docKey_ = *key;
+        }
+    });
+    watcher->setFuture(QtConcurrent::run([text, schema, sidecarPath, index, values, key]() {
+        if (!index->build(text.toUtf8(), &schema)) return false;
+        *key = GfcSidecar::contentKey(index->data());
+        *values = GfcValueIndex::loadOrBuild(*index, *key, sidecarPath);
+        return true;
+    }));
+}
+
+void MainWindow::valueLookup()
+{
+    bool ok = false;
+    const QString text = QInputDialog::getText(this, QStringLiteral("取值查找"),
+        QStringLiteral("要查找的字符串取值（整值或其中的词，词不区分大小写；末尾加 * 为前缀查找）\n"
+                       "如：ConcGradeID、C40、混凝土*、GUID"),
+        QLineEdit::Normal, lastValueQuery_, &ok);
+    QString term = text.trimmed();
+    if (!ok || term.isEmpty()) return;
+    lastValueQuery_ = term;
+    const bool prefix = term.endsWith(QLatin1Char('*'));
+    if (prefix) term.chop(1);
+    if (term.isEmpty()) return;
+
+    constexpr int kMaxShown = 10000;
+    QSharedPointer<GfcIndex> indexPtr;
+    QVector<GfcValueIndex::Posting> hits;
+    int total = 0;
+    QString source;
+    {
+        PerfOperation op(QStringLiteral("取值查找"));
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        // 文本索引与内容键在文本变动前一直复用，查找本身只剩二分
+        QByteArray key;
+        indexPtr = currentIndex(&key);
+        const bool built = !indexPtr.isNull();
+        if (built) {
+            // 内容未变时复用（含打开文件时的后台预建）；否则读旁路索引或重建
+            if (!values_ || key != valuesKey_) {
+                const QString sidecarPath = currentFilePath_.isEmpty() ? QString() : GfcSidecar::pathFor(currentFilePath_);
+                bool loaded = false;
+                GfcValueIndex::Stats vs;
+                values_ = QSharedPointer<GfcValueIndex>::create(
+                    GfcValueIndex::loadOrBuild(*indexPtr, key, sidecarPath, &loaded, &vs));
+                valuesKey_ = key;
+                source = loaded ? QStringLiteral("旁路索引") : QStringLiteral("新建索引 %1 ms").arg(vs.elapsedMs);
+            }
+            hits = values_->lookup(term, prefix, -1, &total);
+        }
+        QApplication::restoreOverrideCursor();
+        if (!built) return;
+    }
+    refreshPerfDock();
+
+    // 同一实例的多处命中合为一行，附注列出所在属性
+    const GfcIndex& index = *indexPtr;
+    QVector<int> rows;
+    QStringList notes;
+    for (int i = 0; i < hits.size() && rows.size() < kMaxShown;) {
+        const int row = hits[i].row;
+        const int e = index.schemaEntity(index.at(row).cls);
+        QStringList attrs;
+        for (; i < hits.size() && hits[i].row == row; ++i) {
+            const int slot = hits[i].slot;
+            attrs << (e >= 0 && slot < schema_.attributeCount(e) ? schema_.attribute(e, slot).name
+                                                                 : QStringLiteral("<extra #%1>").arg(slot));
+        }
+        rows << row;
+        notes << QStringLiteral("[%1] ").arg(attrs.join(QLatin1Char(',')));
+    }
+    QString summary = QStringLiteral("取值查找“%1%2”：%3 处").arg(term, prefix ? QStringLiteral("*") : QString()).arg(total);
+    if (rows.size() >= kMaxShown) summary += QStringLiteral("，只列出前 %1 个实例").arg(kMaxShown);
+    if (!source.isEmpty()) summary += QStringLiteral("（%1）").arg(source);
+    showRowsInFindResults(index, rows, notes, summary);
+}
+
+void MainWindow::instanceQuery()
+{
+    bool ok = false;
+    const QString text = QInputDialog::getMultiLineText(this, QStringLiteral("查询"),
+        QStringLiteral("类名（含子类）或 *，可加 where 条件；属性名按 Schema，可用 . 经引用跟进\n"
+                       "如：GfcFloor where Height > 3 and Name like 'F%'\n"
+                       "    GfcElement where refs(GfcExtrudedBody where Len > 150)"),
+        lastInstanceQuery_, &ok);
+    if (!ok || text.trimmed().isEmpty()) return;
+    lastInstanceQuery_ = text.trimmed();
+
+    GfcQuery query;
+    QString err;
+    if (!query.parse(lastInstanceQuery_, schema_, &err)) {
+        QMessageBox::warning(this, QStringLiteral("查询"), err);
+        return;
+    }
+
+    constexpr int kMaxShown = 10000;
+    QSharedPointer<GfcIndex> indexPtr;
+    QVector<int> rows;
+    GfcQuery::Stats stats;
+    {
+        PerfOperation op(QStringLiteral("查询"));
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        QByteArray key;
+        indexPtr = currentIndex(&key);
+        bool done = !indexPtr.isNull();
+        if (done) {
+            if (query.usesRefs() && !indexPtr->hasRefs()) indexPtr->buildRefs();
+            // 取值索引只在内容未变时使用（打开文件时后台预建），不为查询临时新建
+            const bool valuesOk = values_ && key == valuesKey_;
+            done = query.run(*indexPtr, valuesOk ? values_.data() : nullptr, [&rows](const QVector<int>& chunk) {
+                rows += chunk.mid(0, kMaxShown - rows.size());
+                return true;
+            }, &stats, &err);
+        }
+        QApplication::restoreOverrideCursor();
+        if (!done) {
+            if (!err.isEmpty()) QMessageBox::warning(this, QStringLiteral("查询"), err);
+            return;
+        }
+    }
+    refreshPerfDock();
+
+    QString summary = QStringLiteral("查询：%1 个实例，用时 %2 ms（%3）").arg(stats.matches).arg(stats.elapsedMs).arg(stats.plan);
+    if (stats.matches > rows.size()) summary += QStringLiteral("，只列出前 %1 个").arg(kMaxShown);
+    showRowsInFindResults(*indexPtr, rows, QStringList(), summary);
+}
+
+void MainWindow::bulkEditAttribute()
+{
+    bool ok = false;
+    const QString text = QInputDialog::getMultiLineText(this, QStringLiteral("批量改属性"),
+        QStringLiteral("选择实例的查询（同 工具 → 查询）\n如：GfcStringProperty where Code = 'HJDJ'"),
+        lastInstanceQuery_, &ok);
+    if (!ok || text.trimmed().isEmpty()) return;
+    lastInstanceQuery_ = text.trimmed();
+    GfcQuery query;
+    QString err;
+    if (!query.parse(lastInstanceQuery_, schema_, &err)) {
+        QMessageBox::warning(this, QStringLiteral("批量改属性"), err);
+        return;
+    }
+    const QString assignment = QInputDialog::getText(this, QStringLiteral("批量改属性"),
+        QStringLiteral("属性名 = 值（值按 STEP 写法原样写入）\n如：Val = 'C35'、Height = 3.6、Representations = $"),
+        QLineEdit::Normal, lastBulkAssignment_, &ok);
+    if (!ok || assignment.trimmed().isEmpty()) return;
+    lastBulkAssignment_ = assignment.trimmed();
+    QString attribute;
+    QByteArray value;
+    if (!GfcBulkEdit::parseAssignment(lastBulkAssignment_, &attribute, &value, &err)) {
+        QMessageBox::warning(this, QStringLiteral("批量改属性"), err);
+        return;
+    }
+
+    QByteArray out;
+    GfcBulkEdit::Stats st;
+    {
+        PerfOperation op(QStringLiteral("批量改属性"));
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        QByteArray key;
+        const QSharedPointer<GfcIndex> index = currentIndex(&key);
+        QVector<int> rows;
+        bool done = !index.isNull();
+        if (done && query.usesRefs() && !index->hasRefs()) index->buildRefs();
+        const bool valuesOk = done && values_ && key == valuesKey_;
+        done = done && query.run(*index, valuesOk ? values_.data() : nullptr, [&rows](const QVector<int>& chunk) {
+            rows += chunk;
+            return true;
+        }, nullptr, &err);
+        done = done && GfcBulkEdit::apply(*index, schema_, rows, attribute, value, &out, &st, &err);
+        QApplication::restoreOverrideCursor();
+        if (!done) {
+            if (!err.isEmpty()) QMessageBox::warning(this, QStringLiteral("批量改属性"), err);
+            return;
+        }
+    }
+    refreshPerfDock();
+
+    const QString detail = QStringLiteral("选中 %1 个实例：%2 个将改为 %3，%4 个已是该值，%5 个没有属性 %6。")
+        .arg(st.instances).arg(st.changed).arg(QString::fromUtf8(value)).arg(st.unchanged).arg(st.missing).arg(attribute);
+    if (st.changed == 0) {
+        QMessageBox::information(this, QStringLiteral("批量改属性"), detail + QStringLiteral("\n无需改动。"));
+        return;
+    }
+    if (QMessageBox::question(this, QStringLiteral("批量改属性"), detail + QStringLiteral("\n确定修改？"))
+        != QMessageBox::Yes) {
+        return;
+    }
+    replaceDocumentText(out);
+    statusBar()->showMessage(QStringLiteral("批量改属性：%1 个实例的 %2 已改为 %3（用时 %4 ms，可撤销）")
+                                 .arg(st.changed).arg(attribute, QString::fromUtf8(value)).arg(st.elapsedMs), 5000);
+}
+
+void MainWindow::extractClosure()
+{
+    bool ok = false;
+    const QString text = QInputDialog::getMultiLineText(this, QStringLiteral("提取引用闭包"),
+        QStringLiteral("起点实例：留空为光标所在实例；#id 列表（如 #12 #40）；或查询（同 工具 → 查询）"),
+        QString(), &ok);
+    if (!ok) return;
+    const QString seedText = text.trimmed();
+    GfcQuery query;
+    QString err;
+    const bool byQuery = !seedText.isEmpty() && !seedText.startsWith(QLatin1Char('#'));
+    if (byQuery && !query.parse(seedText, schema_, &err)) {
+        QMessageBox::warning(this, QStringLiteral("提取引用闭包"), err);
+        return;
+    }
+    const bool withRelations = QMessageBox::question(this, QStringLiteral("提取引用闭包"),
+        QStringLiteral("同时带上引用这些实例的关系实例（属性、空间结构等）？")) == QMessageBox::Yes;
+    const QFileInfo fi(currentFilePath_);
+    const QString output = QFileDialog::getSaveFileName(this, QStringLiteral("提取引用闭包"),
+        currentFilePath_.isEmpty() ? QString()
+                                   : fi.absolutePath() + QLatin1Char('/') + fi.completeBaseName() + QStringLiteral("_extract.gfc"),
+        QStringLiteral("GFC 文件 (*.gfc *.gfc.gz *.gfc.zst)"));
+    if (output.isEmpty()) return;
+
+    GfcExtract::Stats st;
+    {
+        PerfOperation op(QStringLiteral("提取引用闭包"));
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        const QSharedPointer<GfcIndex> indexPtr = currentIndex();
+        QVector<int> seeds;
+        bool done = !indexPtr.isNull();
+        if (done) {
+            if (!indexPtr->hasRefs()) indexPtr->buildRefs();
+            const GfcIndex& index = *indexPtr;
+            if (seedText.isEmpty()) {
+                // 光标处的字节偏移落在哪个实例内
+                const qint64 byte = editor_->toPlainText().left(editor_->textCursor().position()).toUtf8().size();
+                int lo = 0, hi = index.size();
+                while (lo < hi) {
+                    const int mid = (lo + hi) / 2;
+                    if (index.at(mid).end <= byte) lo = mid + 1;
+                    else hi = mid;
+                }
+                if (lo < index.size() && index.at(lo).begin <= byte) seeds << lo;
+            }
+            else if (!byQuery) {
+                static const QRegularExpression idRe(QStringLiteral("#(\\d+)"));
+                for (auto it = idRe.globalMatch(seedText); it.hasNext();) {
+                    const int row = index.rowOf(it.next().captured(1).toLongLong());
+                    if (row >= 0) seeds << row;
+                }
+            }
+            else {
+                done = query.run(index, nullptr, [&seeds](const QVector<int>& chunk) {
+                    seeds += chunk;
+                    return true;
+                }, nullptr, &err);
+            }
+            if (done && seeds.isEmpty()) err = QStringLiteral("没有找到起点实例");
+            GfcExtract::Options opt;
+            opt.withRelations = withRelations;
+            done = done && !seeds.isEmpty() && GfcExtract::extract(index, schema_, seeds, output, opt, &st, &err);
+        }
+        QApplication::restoreOverrideCursor();
+        if (!done) {
+            if (!err.isEmpty()) QMessageBox::warning(this, QStringLiteral("提取引用闭包"), err);
+            return;
+        }
+    }
+    refreshPerfDock();
+    statusBar()->showMessage(QStringLiteral("已提取 %1 个起点的闭包：%2 个实例（关系 %3 个，删去引用 %4 处），%5 字节 -> %6，用时 %7 ms")
+                                 .arg(st.seeds).arg(st.instances).arg(st.relations).arg(st.droppedRefs)
+                                 .arg(st.bytesOut).arg(output).arg(st.elapsedMs), 8000);
+}
+
+void MainWindow::quantityReport()
+{
+    GfcQuantityReport::Result res;
+    QString err;
+    {
+        PerfOperation op(QStringLiteral("工程量汇总"));
+        QApplication::setOverrideCursor(Qt::WaitCursor);
+        const QSharedPointer<GfcIndex> index = currentIndex();
+        const bool done = index && GfcQuantityReport::compute(*index, schema_, &res, {}, &err);
+        QApplication::restoreOverrideCursor();
+        if (!done) {
+            if (!err.isEmpty()) QMessageBox::warning(this, QStringLiteral("工程量汇总"), err);
+            return;
+        }
+    }
+    refreshPerfDock();
+    if (res.details == 0 && res.totals == 0) {
+        QMessageBox::information(this, QStringLiteral("工程量汇总"),
+            QStringLiteral("没有 GfcQuotaDetail / GfcBillDetail / GfcSteelDetail 及其汇总实例。"));
+        return;
+    }
+    const QString summary = QStringLiteral("明细 %1 条，汇总 %2 条，分组 %3；与汇总不符或无汇总的分组 %4；用时 %5 ms。\n"
+                                           "每组一行（楼层为“全部”），其后为该组各楼层的小计。")
+        .arg(res.details).arg(res.totals).arg(res.groups.size()).arg(res.mismatches).arg(res.elapsedMs);
+    GfcReportDialog dlg(QStringLiteral("工程量汇总"), summary, GfcQuantityReport::headers(), this);
+    for (const QVariantList& row : GfcQuantityReport::rows(res)) dlg.addRow(row);
+    dlg.exec();
+}
+
 void MainWindow::updateWindowTitle()
 {
     QString title = QStringLiteral("GFC Editor");
@@ -560,29 +1790,19 @@ void MainWindow::updateWindowTitle()
 int MainWindow::computeInclusiveCount(const QString& cls) const
 {
     int sum = classCounts_.value(cls, 0);
-    auto it = children_.find(cls);
-    if (it != children_.end()) {
-        for (const auto& ch : it.value()) {
-            sum += computeInclusiveCount(ch);
-        }
+    const int e = schema_.find(cls);
+    if (e < 0) return sum;
+    for (int ch : schema_.children(e)) {
+        sum += computeInclusiveCount(schema_.name(ch));
     }
     return sum;
 }
 
-void MainWindow::prepareSchemaIndex()
-{
-    lowerToCamel_.clear();
-    for (auto it = schema_.classes().cbegin(); it != schema_.classes().cend(); ++it) {
-        const QString camel = it.key();
-        lowerToCamel_.insert(camel.toLower(), camel);
-    }
-}
-
 void MainWindow::rebuildClassTree()
 {
     classModel_->removeRows(0, classModel_->rowCount());
 
-    if (schema_.classes().isEmpty()) {
+    if (schema_.isEmpty()) {
         auto* tip = new QStandardItem(QStringLiteral("未加载 Schema(.exp)。在“文件”菜单打开 .exp"));
         tip->setEditable(false);
         classModel_->appendRow(tip);
@@ -594,14 +1814,12 @@ void MainWindow::rebuildClassTree()
         if (it.value() > 0) { hasAnyInstance = true; break; }
     }
 
-    QSet<QString> roots;
-    for (auto it = schema_.classes().cbegin(); it != schema_.classes().cend(); ++it) {
-        if (it->parent.isEmpty()) roots.insert(it.key());
-    }
+    const QVector<int> roots = schema_.roots();
 
-    std::function<QStandardItem* (const QString&)> makeNode =
-        [&](const QString& camel) -> QStandardItem*
+    std::function<QStandardItem* (int)> makeNode =
+        [&](int e) -> QStandardItem*
         {
+            const QString& camel = schema_.name(e);
             const int direct = directCountCamel_.value(camel, 0);
             const int incl = inclusiveCountCamel_.value(camel, 0);
 
@@ -613,7 +1831,7 @@ void MainWindow::rebuildClassTree()
             item->setData(camel, RoleClassName);
             item->setData(NodeClass, RoleNodeType);
 
-            for (const auto& ch : children_.value(camel)) {
+            for (int ch : schema_.children(e)) {
                 if (auto* childItem = makeNode(ch)) item->appendRow(childItem);
             }
 
@@ -630,7 +1848,7 @@ void MainWindow::rebuildClassTree()
         };
 
     int added = 0;
-    for (const auto& r : roots) {
+    for (int r : roots) {
         if (auto* rootItem = makeNode(r)) {
             classModel_->appendRow(rootItem);
             ++added;
@@ -647,13 +1865,133 @@ void MainWindow::rebuildClassTree()
     }
 }
 
+void MainWindow::invalidateStructureTree()
+{
+    structureStale_ = true;
+    if (structTree_ && structTree_->isVisible()) rebuildStructureTree();
+}
+
+void MainWindow::rebuildStructureTree()
+{
+    structureStale_ = false;
+    structModel_->removeRows(0, structModel_->rowCount());
+    structure_.clear();
+    structIndex_.reset();
+
+    auto index = QSharedPointer<GfcIndex>::create();
+    GfcHierarchy::Stats st;
+    if (schema_.isEmpty() || !index->build(editor_->toPlainText().toUtf8(), &schema_) || !structure_.build(*index, schema_, &st)) {
+        auto* tip = new QStandardItem(QStringLiteral("无法建立空间结构（未加载 Schema 或文本无法分析）"));
+        tip->setEditable(false);
+        structModel_->appendRow(tip);
+        return;
+    }
+    structIndex_ = index;
+
+    for (int r : structure_.roots()) structModel_->appendRow(makeStructureItem(r));
+    if (!structure_.unassigned().isEmpty()) {
+        auto* group = new QStandardItem(QStringLiteral("未归属构件 (%1)").arg(structure_.unassigned().size()));
+        group->setEditable(false);
+        group->setData(NodeStructure, RoleNodeType);
+        group->setData(-1, RoleStructRow);
+        auto* pending = new QStandardItem(QStringLiteral("..."));
+        pending->setData(NodePending, RoleNodeType);
+        group->appendRow(pending);
+        structModel_->appendRow(group);
+    }
+    if (structModel_->rowCount() == 0) {
+        auto* tip = new QStandardItem(QStringLiteral("没有 GfcRelAggregates 聚合关系"));
+        tip->setEditable(false);
+        structModel_->appendRow(tip);
+    }
+    else if (structure_.roots().size() == 1) {
+        structTree_->expand(structModel_->index(0, 0));
+    }
+    if (st.unresolved > 0) {
+        statusBar()->showMessage(QStringLiteral("空间结构：%1 处聚合引用指向不存在的实例").arg(st.unresolved), 5000);
+    }
+}
+
+QStandardItem* MainWindow::makeStructureItem(int row)
+{
+    const GfcIndexEntry& en = structIndex_->at(row);
+    const int e = structIndex_->schemaEntity(en.cls);
+    QString text = QStringLiteral("#%1 %2").arg(en.id)
+        .arg(e >= 0 ? schema_.name(e) : QString::fromLatin1(structIndex_->className(en.cls)));
+    const QString name = structure_.name(row);
+    if (!name.isEmpty()) text += QStringLiteral(" “%1”").arg(name);
+    const int children = structure_.childCount(row);
+    if (children > 0) text += QStringLiteral(" (%1/%2)").arg(children).arg(structure_.descendantCount(row));
+
+    auto* item = new QStandardItem(text);
+    item->setEditable(false);
+    item->setData(NodeStructure, RoleNodeType);
+    item->setData(row, RoleStructRow);
+    if (children > 0) {
+        auto* pending = new QStandardItem(QStringLiteral("..."));
+        pending->setData(NodePending, RoleNodeType);
+        item->appendRow(pending);
+    }
+    return item;
+}
+
+void MainWindow::appendStructureChildren(QStandardItem* parent, int row, int from)
+{
+    constexpr int kBatch = 1000;   // 一次最多建这么多项，大楼层展开也不卡
+    const int total = row >= 0 ? structure_.childCount(row) : structure_.unassigned().size();
+    const int end = qMin(total, from + kBatch);
+    QList<QStandardItem*> items;
+    for (int k = from; k < end; ++k) {
+        items << makeStructureItem(row >= 0 ? structure_.child(row, k) : structure_.unassigned()[k]);
+    }
+    parent->appendRows(items);
+    if (end < total) {
+        auto* more = new QStandardItem(QStringLiteral("… 还有 %1 个，单击加载").arg(total - end));
+        more->setEditable(false);
+        more->setData(NodeMore, RoleNodeType);
+        more->setData(row, RoleStructRow);
+        more->setData(end, RoleStructNext);
+        parent->appendRow(more);
+    }
+}
+
+void MainWindow::onStructureExpanded(const QModelIndex& idx)
+{
+    QStandardItem* item = structModel_->itemFromIndex(idx);
+    if (!item || item->rowCount() != 1 || item->child(0)->data(RoleNodeType).toInt() != NodePending) return;
+    item->removeRow(0);
+    appendStructureChildren(item, item->data(RoleStructRow).toInt(), 0);
+}
+
+void MainWindow::onStructureClicked(const QModelIndex& idx)
+{
+    QStandardItem* item = structModel_->itemFromIndex(idx);
+    if (!item || !structIndex_) return;
+    const int type = item->data(RoleNodeType).toInt();
+    const int row = item->data(RoleStructRow).toInt();
+    if (type == NodeMore) {
+        QStandardItem* parent = item->parent();
+        if (!parent) return;
+        const int next = item->data(RoleStructNext).toInt();
+        parent->removeRow(item->row());
+        appendStructureChildren(parent, row, next);
+        return;
+    }
+    if (type != NodeStructure || row < 0) return;
+    const int pos = findInstancePosition(int(structIndex_->at(row).id));
+    if (pos < 0) return;
+    navigateTo(pos, false);
+    showInstanceByPos(pos, /*moveCaret=*/true);
+}
+
 void MainWindow::updateParentInstances(const QString& cls)
 {
-    const auto& ci = schema_.classes().value(cls);
-    if (!ci.parent.isEmpty()) {
-        classCounts_[ci.parent] += 1;
-        instancesByClass_[ci.parent].push_back({ -1, ci.parent, -1 });
-        updateParentInstances(ci.parent);
+    const int e = schema_.find(cls);
+    if (e >= 0 && schema_.parent(e) >= 0) {
+        const QString parent = schema_.name(schema_.parent(e));
+        classCounts_[parent] += 1;
+        instancesByClass_[parent].push_back({ -1, parent, -1 });
+        updateParentInstances(parent);
     }
 }
 
@@ -700,13 +2038,20 @@ void MainWindow::showClassProperties(const QString& cls)
     propTable_->setRowCount(0);
     propTable_->setHorizontalHeaderLabels({ QStringLiteral("属性定义"), QStringLiteral("备注") });
 
-    if (!schema_.classes().contains(cls)) return;
+    const int e = schema_.find(cls);
+    if (e < 0) return;
 
-    const auto& info = schema_.classes()[cls];
-    propTable_->setRowCount(info.attributes.size());
-    for (int i = 0; i < info.attributes.size(); ++i) {
-        auto* a0 = new QTableWidgetItem(info.attributes[i]);
-        auto* a1 = new QTableWidgetItem(QString());
+    // 展平属性：继承属性在前，备注列标出声明它的父类
+    const int n = schema_.attributeCount(e);
+    propTable_->setRowCount(n);
+    for (int i = 0; i < n; ++i) {
+        const CompiledAttr& a = schema_.attribute(e, i);
+        int owner = e;
+        while (schema_.parent(owner) >= 0 && i < schema_.attributeCount(schema_.parent(owner))) owner = schema_.parent(owner);
+
+        auto* a0 = new QTableWidgetItem(QStringLiteral("%1 : %2%3")
+            .arg(a.name, a.optional ? QStringLiteral("OPTIONAL ") : QString(), a.type));
+        auto* a1 = new QTableWidgetItem(owner == e ? QString() : QStringLiteral("继承自 %1").arg(schema_.name(owner)));
         a0->setFlags(a0->flags() & ~Qt::ItemIsEditable);
         propTable_->setItem(i, 0, a0);
         propTable_->setItem(i, 1, a1);
@@ -753,21 +2098,15 @@ void MainWindow::highlightRange(int start, int end)
 
 QString MainWindow::camelFromUpper(const QString& upper) const
 {
-    // 使用 lowerToCamel_ 建立的大小写无关映射（.exp 加载后 prepareSchemaIndex() 填充）
-    return lowerToCamel_.value(upper.toLower());
+    // 编译 Schema 的名称哈希本身大小写无关
+    return schema_.camelName(upper);
 }
 
 QStringList MainWindow::schemaAttrNames(const QString& camel) const
 {
-    QStringList names;
-    if (!schema_.classes().contains(camel)) return names;
-    const auto& attrs = schema_.classes()[camel].attributes; // "name : TYPE"
-    QRegularExpression nameRe(R"(^\s*([A-Za-z_][A-Za-z0-9_]*)\s*:)");
-    for (const QString& line : attrs) {
-        auto m = nameRe.match(line);
-        names << (m.hasMatch() ? m.captured(1) : line.trimmed());
-    }
-    return names;
+    // 展平后的属性名（含继承属性），与实例参数位置一一对应
+    const int e = schema_.find(camel);
+    return e >= 0 ? schema_.attributeNames(e) : QStringList();
 }
 
 void MainWindow::showParsedInstanceProperties(const ParsedInstance& pi, const QString& camel)
@@ -791,6 +2130,24 @@ void MainWindow::showParsedInstanceProperties(const ParsedInstance& pi, const QS
         auto* c1 = new QTableWidgetItem(v);
         c1->setFlags(c1->flags() & ~Qt::ItemIsEditable);
 
+        // 数值参数：提示解码结果；文本不是最短往返写法时给出规范形式
+        double real = 0;
+        QVector<double> reals;
+        const bool integral = !v.contains(QLatin1Char('.')) && !v.contains(QLatin1Char('E'), Qt::CaseInsensitive);
+        if (GfcParser::decodeReal(v, &real) && integral) {
+            c1->setToolTip(QStringLiteral("INTEGER %1").arg(v.trimmed()));
+        }
+        else if (GfcParser::decodeReal(v, &real)) {
+            const QString canon = GfcParser::formatReal(real);
+            c1->setToolTip(canon == v.trimmed() ? QStringLiteral("REAL %1").arg(canon)
+                                      : QStringLiteral("REAL %1（规范写法 %2）").arg(v.trimmed(), canon));
+        }
+        else if (GfcParser::decodeReals(v, &reals) && !reals.isEmpty()) {
+            QStringList parts;
+            for (double x : reals) parts << GfcParser::formatReal(x);
+            c1->setToolTip(QStringLiteral("REAL ×%1：%2").arg(reals.size()).arg(parts.join(QStringLiteral(", "))));
+        }
+
         //计算并保存该“第 i 个参数”的绝对区间（start,end）
         QPair<int, int> range = paramRangeInInstance(pi, i, whole);
         // 用 UserRole / UserRole+1 埋入
@@ -802,11 +2159,49 @@ void MainWindow::showParsedInstanceProperties(const ParsedInstance& pi, const QS
         propTable_->setItem(i, 0, c0);
         propTable_->setItem(i, 1, c1);
     }
+
+    // 构件：追加几何量（需先执行“计算构件几何量”）
+    const int e = schema_.find(camel);
+    const int element = schema_.find(QStringLiteral("GfcElement"));
+    if (e < 0 || element < 0 || !schema_.isSubtypeOf(e, element)) return;
+    QList<QPair<QString, QString>> extra;
+    const auto it = geometryById_.constFind(pi.index);
+    if (it == geometryById_.constEnd()) {
+        extra << qMakePair(QStringLiteral("几何"), QStringLiteral("（工具 → 计算构件几何量）"));
+    }
+    else {
+        const GfcElementGeometry& g = it.value();
+        extra << qMakePair(QStringLiteral("几何：体积"), QString::number(g.volume, 'g', 10))
+              << qMakePair(QStringLiteral("几何：表面积"), QString::number(g.area, 'g', 10));
+        if (!g.box.isEmpty()) {
+            extra << qMakePair(QStringLiteral("几何：包围盒"),
+                QStringLiteral("(%1, %2, %3) - (%4, %5, %6)")
+                    .arg(g.box.min[0], 0, 'g', 8).arg(g.box.min[1], 0, 'g', 8).arg(g.box.min[2], 0, 'g', 8)
+                    .arg(g.box.max[0], 0, 'g', 8).arg(g.box.max[1], 0, 'g', 8).arg(g.box.max[2], 0, 'g', 8));
+        }
+        if (g.skipped) {
+            extra << qMakePair(QStringLiteral("几何：跳过"),
+                QStringLiteral("%1 个形体（%2）").arg(g.skipped).arg(QString::fromLatin1(g.skippedClass)));
+        }
+    }
+    for (const auto& kv : extra) {
+        const int r = propTable_->rowCount();
+        propTable_->insertRow(r);
+        auto* c0 = new QTableWidgetItem(kv.first);
+        c0->setFlags(c0->flags() & ~Qt::ItemIsEditable);
+        c0->setData(Qt::UserRole, -1);
+        c0->setData(Qt::UserRole + 1, -1);
+        auto* c1 = new QTableWidgetItem(kv.second);
+        c1->setFlags(c1->flags() & ~Qt::ItemIsEditable);
+        propTable_->setItem(r, 0, c0);
+        propTable_->setItem(r, 1, c1);
+    }
 }
 
 
 void MainWindow::showInstanceByPos(int pos, bool moveCaret)
 {
+    GFC_PERF_SCOPE("属性刷新");
     ParsedInstance pi;
     const QString text = editor_->toPlainText();
     if (!GfcParser::parseInstanceAt(text, pos, &pi)) {
@@ -1114,6 +2509,9 @@ void MainWindow::enableGfcSyntaxColors()
         using QSyntaxHighlighter::QSyntaxHighlighter;
 
         void highlightBlock(const QString& text) override {
+            static const QString kPerfName = QStringLiteral("语法高亮");
+            PerfAccumulate perf(kPerfName);
+
             // --- 颜色风格 ---
             static const QTextCharFormat fmtStr = [] { QTextCharFormat f; f.setForeground(QColor(0, 128, 0));    return f; }(); // 字符串
             static const QTextCharFormat fmtNum = [] { QTextCharFormat f; f.setForeground(QColor(136, 0, 136));  return f; }(); // 数字
@@ -1230,6 +2628,130 @@ void MainWindow::toggleStatusbar(bool checked)
 {
     statusBar()->setVisible(checked);
 }
+void MainWindow::togglePerfDock(bool checked)
+{
+    if (auto dock = findChild<QDockWidget*>("dockPerf")) dock->setVisible(checked);
+}
+
+// ================== 性能面板 / Chrome Trace ==================
+void MainWindow::togglePerfRecording(bool checked)
+{
+    PerfTrace& pt = PerfTrace::instance();
+    if (checked) {
+        pt.setRecording(true);
+        statusBar()->showMessage(QStringLiteral("开始记录性能跟踪；再次点击菜单项停止并导出 JSON。"), 3000);
+        return;
+    }
+
+    pt.setRecording(false);
+    if (pt.recordedEventCount() == 0) {
+        statusBar()->showMessage(QStringLiteral("未记录到任何性能事件。"), 3000);
+        return;
+    }
+    const QString path = QFileDialog::getSaveFileName(this, QStringLiteral("导出性能跟踪"),
+        QStringLiteral("gfc_trace.json"), "Chrome Trace (*.json)");
+    if (path.isEmpty()) return;
+
+    QString err;
+    if (!pt.writeChromeTrace(path, &err)) {
+        QMessageBox::warning(this, QStringLiteral("导出失败"), err);
+        return;
+    }
+    statusBar()->showMessage(QStringLiteral("已导出性能跟踪：%1（可在 chrome://tracing 或 ui.perfetto.dev 打开）").arg(path), 4000);
+}
+
+void MainWindow::reportMemoryUsage()
+{
+    // 粗略估算：元素个数 × 近似单元大小（含 QString 头与 UTF-16 内容），用于比较各结构的相对占用
+    auto strBytes = [](const QString& s) -> qint64 { return 24 + qint64(s.capacity()) * 2; };
+    constexpr qint64 kHashNode = 32;
+
+    PerfTrace& pt = PerfTrace::instance();
+
+    const QTextDocument* doc = editor_->document();
+    pt.setMemory(QStringLiteral("文档 (QTextDocument)"),
+        qint64(doc->characterCount()) * 2 + qint64(doc->blockCount()) * 96);
+
+    qint64 inst = 0;
+    qint64 instCount = 0;
+    for (auto it = instancesByCamel_.cbegin(); it != instancesByCamel_.cend(); ++it) {
+        inst += kHashNode + strBytes(it.key()) + qint64(it.value().capacity()) * qint64(sizeof(GfcInstanceRef));
+        for (const auto& r : it.value()) inst += strBytes(r.cls);
+        instCount += it.value().size();
+    }
+    pt.setMemory(QStringLiteral("实例清单 (instancesByCamel_)"), inst);
+
+    qint64 counts = 0;
+    for (auto it = classCounts_.cbegin(); it != classCounts_.cend(); ++it) counts += kHashNode + strBytes(it.key());
+    for (auto it = directCountCamel_.cbegin(); it != directCountCamel_.cend(); ++it) counts += kHashNode + strBytes(it.key());
+    for (auto it = inclusiveCountCamel_.cbegin(); it != inclusiveCountCamel_.cend(); ++it) counts += kHashNode + strBytes(it.key());
+    pt.setMemory(QStringLiteral("类计数 (classCounts_/direct/inclusive)"), counts);
+
+    pt.setMemory(QStringLiteral("Schema (CompiledSchema)"), schema_.memoryBytes());
+
+    // 类树：每个类节点与实例节点各一个 QStandardItem（含显示文本与若干 role）
+    pt.setMemory(QStringLiteral("类树模型 (classModel_)"), (instCount + inclusiveCountCamel_.size()) * 160);
+}
+
+void MainWindow::refreshPerfDock()
+{
+    if (!perfTable_) return;
+    PerfTrace& pt = PerfTrace::instance();
+
+    const qint64 total = pt.lastOperationUs();
+    auto ms = [](qint64 us) { return QStringLiteral("%1 ms").arg(QString::number(us / 1000.0, 'f', 2)); };
+    auto pct = [total](qint64 us) {
+        return total > 0 ? QStringLiteral("%1%").arg(QString::number(100.0 * us / total, 'f', 1)) : QString();
+    };
+    auto size = [](qint64 bytes) {
+        if (bytes >= 1024 * 1024) return QStringLiteral("%1 MB").arg(QString::number(bytes / 1048576.0, 'f', 2));
+        return QStringLiteral("%1 KB").arg(QString::number(bytes / 1024.0, 'f', 1));
+    };
+
+    perfTable_->setRowCount(0);
+    auto addRow = [this](const QString& a, const QString& b, const QString& c, bool section) {
+        const int row = perfTable_->rowCount();
+        perfTable_->insertRow(row);
+        const QString cells[3] = { a, b, c };
+        for (int col = 0; col < 3; ++col) {
+            auto* it = new QTableWidgetItem(cells[col]);
+            if (section) {
+                QFont f = it->font();
+                f.setBold(true);
+                it->setFont(f);
+            }
+            perfTable_->setItem(row, col, it);
+        }
+    };
+
+    addRow(QStringLiteral("操作：%1").arg(pt.lastOperationName()), ms(total), QStringLiteral("100%"), true);
+    QVector<PerfSpan> spans = pt.lastSpans();   // 记录顺序为“结束先后”，展示时按开始时间排
+    std::sort(spans.begin(), spans.end(), [](const PerfSpan& x, const PerfSpan& y) { return x.startUs < y.startUs; });
+    for (const PerfSpan& s : spans) {
+        addRow(QString(s.depth * 2 + 2, QChar(' ')) + s.name, ms(s.durUs), pct(s.durUs), false);
+    }
+    for (const auto& a : pt.lastAccumulated()) {
+        addRow(QStringLiteral("  (累计) %1").arg(a.first), ms(a.second), pct(a.second), false);
+    }
+
+    const auto counters = pt.lastCounters();
+    if (!counters.isEmpty()) {
+        addRow(QStringLiteral("计数器"), QString(), QString(), true);
+        for (const auto& c : counters) addRow(QStringLiteral("  %1").arg(c.first), QString::number(c.second), QString(), false);
+    }
+
+    const auto mem = pt.lastMemory();
+    if (!mem.isEmpty()) {
+        qint64 memTotal = 0;
+        for (const auto& m : mem) memTotal += m.second;
+        addRow(QStringLiteral("内存（估算）"), size(memTotal), QString(), true);
+        for (const auto& m : mem) {
+            addRow(QStringLiteral("  %1").arg(m.first), size(m.second),
+                memTotal > 0 ? QStringLiteral("%1%").arg(QString::number(100.0 * m.second / memTotal, 'f', 1)) : QString(), false);
+        }
+    }
+    perfTable_->resizeColumnToContents(0);
+}
 
 // ================== 导航相关（原有） ==================
 void MainWindow::updateNavActions()
@@ -1389,6 +2911,60 @@ void MainWindow::runFindAll(const QString& pattern, QTextDocument::FindFlags fla
     statusBar()->showMessage(QStringLiteral("共找到 %1 处。").arg(row), 3000);
 }
 
+void MainWindow::showRowsInFindResults(const GfcIndex& index, const QVector<int>& rows, const QStringList& notes,
+                                       const QString& summary)
+{
+    if (!findResults_) return;
+    findResults_->setRowCount(0);
+
+    // 索引给的是 UTF-8 字节偏移，编辑器用 UTF-16 位置：按偏移升序扫一遍换算
+    const QByteArray& data = index.data();
+    const char* bytes = data.constData();
+    QVector<int> order(rows.size());
+    for (int i = 0; i < order.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](int a, int b) { return index.at(rows[a]).begin < index.at(rows[b]).begin; });
+    QVector<int> charPos(rows.size());
+    qint64 byte = 0;
+    int units = 0;
+    for (int i : order) {
+        const qint64 target = index.at(rows[i]).begin;
+        for (; byte < target; ++byte) {
+            const uchar c = uchar(bytes[byte]);
+            if ((c & 0xC0) != 0x80) units += c >= 0xF0 ? 2 : 1;
+        }
+        charPos[i] = units;
+    }
+
+    findResults_->setRowCount(rows.size());
+    for (int i = 0; i < rows.size(); ++i) {
+        const GfcIndexEntry& en = index.at(rows[i]);
+        const QTextBlock block = editor_->document()->findBlock(charPos[i]);
+        QString context = notes.value(i) + QString::fromUtf8(bytes + en.begin, int(en.end - en.begin));
+        if (context.size() > 200) context = context.left(200) + QStringLiteral("...");
+
+        auto* itLine = new QTableWidgetItem(QString::number(block.blockNumber() + 1));
+        auto* itCol = new QTableWidgetItem(QString::number(charPos[i] - block.position() + 1));
+        auto* itCtx = new QTableWidgetItem(context);
+        itLine->setData(Qt::UserRole, charPos[i]);
+        itLine->setData(Qt::UserRole + 1, QString::number(en.id).size() + 1);   // 选中 "#id"
+        for (QTableWidgetItem* it : { itLine, itCol, itCtx }) it->setFlags(it->flags() & ~Qt::ItemIsEditable);
+        findResults_->setItem(i, 0, itLine);
+        findResults_->setItem(i, 1, itCol);
+        findResults_->setItem(i, 2, itCtx);
+    }
+
+    if (auto dock = findChild<QDockWidget*>("dockFindResults")) {
+        dock->setVisible(true);
+        dock->raise();
+    }
+    if (!rows.isEmpty()) {
+        // 直接跳到第一个结果
+        navigateTo(charPos[0], false);
+        showInstanceByPos(charPos[0], true);
+    }
+    statusBar()->showMessage(summary, 8000);
+}
+
 // ================== （新增）双击结果行进行定位 ==================
 void MainWindow::onFindResultActivated(int row, int col)
 {
@@ -1654,9 +3230,23 @@ QString MainWindow::findSchemaExpNearCMake()
 }
 
 
-// 程序启动时自动加载 .exp
+// 程序启动时自动加载 Schema：优先使用构建期嵌入的编译 Schema，无需查找目录与解析 .exp
 void MainWindow::autoLoadSchemaOnStartup()
 {
+    {
+        PerfOperation op(QStringLiteral("加载内置 Schema"));
+        GFC_PERF_SCOPE("反序列化编译 Schema");
+        schema_.deserialize(CompiledSchema::embeddedBlob());
+    }
+    if (!schema_.isEmpty()) {
+        currentSchemaPath_ = QStringLiteral("GFC3X4（内置）");
+        rebuildClassTree();
+        updateWindowTitle();
+        statusBar()->showMessage(QStringLiteral("已加载内置 Schema（%1 个实体）").arg(schema_.entityCount()), 3000);
+        return;
+    }
+
+    // 回退：嵌入数据不可用时，在含 CMakeLists.txt 的目录附近找 .exp（经编译缓存加载）
     const QString path = findSchemaExpNearCMake();
     if (path.isEmpty()) {
         statusBar()->showMessage(QStringLiteral("未找到 Schema(.exp)。请将 .exp 放到含 CMakeLists.txt 的目录。"), 4000);
@@ -1665,7 +3255,7 @@ void MainWindow::autoLoadSchemaOnStartup()
     }
 
     QString err;
-    if (!schema_.parseFile(path, &err)) {
+    if (!SchemaCache::loadExp(path, &schema_, &err)) {
         QMessageBox::warning(this, QStringLiteral("解析 Schema 失败"),
             QStringLiteral("文件：%1\n错误：%2").arg(path, err));
         rebuildClassTree();
@@ -1673,8 +3263,6 @@ void MainWindow::autoLoadSchemaOnStartup()
     }
 
     currentSchemaPath_ = path;
-    children_ = schema_.buildChildrenMap();
-    prepareSchemaIndex();    // 你已有的大小写映射（lower -> CamelCase）
     rebuildClassTree();
 
     updateWindowTitle();
@@ -16,6 +16,10 @@
 #include <QFileInfo>
 #include <QCoreApplication>
 #include <QMessageBox>
+#include <QFutureWatcher>
+#include <QSharedPointer>
+#include <atomic>
+#include <functional>
 
 
 class QPlainTextEdit;
@@ -23,15 +27,25 @@ class QTreeView;
 class QTableWidget;
 class QStandardItemModel;
 class QLabel;
+class QProgressBar;
+class QToolButton;
+class GfcIndex;
 
 #include "expressparser.h"
+#include "gfcgeometry.h"
+#include "gfchierarchy.h"
+#include "gfcspatial.h"
+#include "gfcvalueindex.h"
 #include "gfcparser.h"
+#include "perftrace.h"
+#include "schemacache.h"
 
 class MainWindow : public QMainWindow
 {
     Q_OBJECT
 public:
     explicit MainWindow(QWidget* parent = nullptr);
+    ~MainWindow() override;
 
 private slots:
 
@@ -41,12 +55,31 @@ private slots:
     void saveGfc();
     void saveGfcAs();
     void openSchemaExp();
+    void mergeFiles();           // 多文件流式合并（编号重排，可合并共享实体）
+    void exportMesh();           // 构件网格化并导出 OBJ / STL（后台）
+    void exportTables();         // 按 Schema 属性名导出 NDJSON / 每类一个 CSV（后台）
+    void exportSqlite();         // 导出为 SQLite 数据库：每类一表、聚合引用链接表（后台）
 
     // 视图/工具
     void toggleClassDock(bool checked);
     void togglePropDock(bool checked);
     void toggleToolbar(bool checked);
     void toggleStatusbar(bool checked);
+    void togglePerfDock(bool checked);
+    void togglePerfRecording(bool checked);
+    void compareWithFile();      // 当前文档与另一文件做语义比较
+    void renumberInstances();    // 紧凑重新编号（文件顺序/拓扑顺序）
+    void purgeUnreachable();     // 清除从根类不可达的实例（预览后删除）
+    void dedupeInstances();      // 合并内容相同的实例（预览后合并）
+    void weldVertices();         // 按容差合并相近的 GfcVector2d/3d 点
+    void computeGeometry();      // 计算全部构件的体积/表面积/包围盒，结果显示在属性区
+    void spatialQuery();         // 按包围盒框选/点选/k 近邻查找构件，结果列在查找结果区
+    void showPropertyTable();    // 构件 × 属性透视表（可筛选、排序、导出 CSV）
+    void valueLookup();          // 按字符串取值（整值/词，可前缀）查找实例，结果列在查找结果区
+    void instanceQuery();        // 按查询语言（类 where 属性条件 / refs(...)）查找实例，结果列在查找结果区
+    void bulkEditAttribute();    // 对查询选中的实例统一设置某个属性（一次撤销）
+    void extractClosure();       // 选中实例及其引用闭包（可含关系）另存为独立的 GFC 文件
+    void quantityReport();       // 定额/清单/钢筋明细按组、楼层汇总并与汇总实例核对
 
     // 编辑
     void doFind();
@@ -70,6 +103,8 @@ private slots:
 
     void highlightRangeColored(int start, int end, const QColor& bg);
     void onPropTableCellClicked(int row, int col);
+    void onStructureExpanded(const QModelIndex& idx);   // 空间结构树：首次展开时加载子结点
+    void onStructureClicked(const QModelIndex& idx);
 private:
     QList<QString> recentFiles_;  // 用于存储最近打开的文件路径
     void updateRecentFilesMenu();  // 更新最近打开文件的菜单
@@ -80,6 +115,12 @@ private:
     QPointer<QTreeView> classTree_;
     QPointer<QTableWidget> propTable_;
     QPointer<QStandardItemModel> classModel_;
+    // 空间结构树（GfcRelAggregates）：按需展开；文本变动后标记过期，停靠窗可见时才重建
+    QPointer<QTreeView> structTree_;
+    QPointer<QStandardItemModel> structModel_;
+    QSharedPointer<GfcIndex> structIndex_;   // structure_ 的行号指向此索引
+    GfcHierarchy structure_;
+    bool structureStale_ = true;
     QLabel* lblPos_;
     QLabel* lblSize_;
     QString lastReplaceText_;
@@ -87,13 +128,50 @@ private:
     // （新增）查找结果列表
     QPointer<QTableWidget> findResults_;
 
+    // 性能停靠窗：最近一次操作的阶段分解 + 各结构内存估算
+    QPointer<QTableWidget> perfTable_;
+    QAction* actPerfRecord_{};
+    void refreshPerfDock();
+    void reportMemoryUsage();
+
+    // 后台任务（保存/合并/导出）：同一时间只运行一个，共用状态栏进度条与取消按钮；
+    // 工作函数只经 cancel 指针读取 jobCancel_，关闭窗口时先取消再等待，保证它不会悬空
+    using JobProgress = std::function<void(qint64 done, qint64 total)>;
+    using JobWork = std::function<QString(const std::atomic<bool>* cancel, const JobProgress& progress)>;
+    QFutureWatcher<QString>* jobWatcher_ = nullptr;    // 结果为错误信息，空串表示成功
+    std::atomic<bool> jobCancel_{ false };
+    QProgressBar* jobProgress_ = nullptr;
+    QToolButton* jobCancelBtn_ = nullptr;
+    QString jobName_;                                  // 如“保存”“导出网格”，用于提示与失败标题
+    std::function<void()> jobDone_;                    // 成功时在 GUI 线程调用
+    bool jobActive_ = false;                           // 从启动到 onJobFinished 处理完为止
+    bool jobFinishOnClose_ = false;                    // 关闭窗口时等它完成而不取消（保存）
+    bool jobBusy();                                    // 有任务在运行时提示并返回 true
+    bool startJob(const QString& name, const QString& message, JobWork work, std::function<void()> done,
+                  bool finishOnClose = false);
+    void onJobFinished();
+    void finishJobs();                                 // 取消（保存除外）并等待后台任务
+    // 汇总几何量结果：填入 geometryById_ 并显示按类统计
+    void showGeometryReport(const GfcIndex& index, const QVector<GfcElementGeometry>& results,
+                            const GfcGeometryEvaluator::Summary& sum);
+
     // 状态
     QString currentFilePath_;
     QString currentSchemaPath_;
-    ExpressParser schema_;
-    QHash<QString, QSet<QString>> children_; // 继承子类映射
+    CompiledSchema schema_;                  // 编译后的 Schema（内置或 .exp 编译缓存）
     QHash<QString, int> classCounts_;        // 该GFC中每类的直接实例数（不含子类）
+    QHash<qint64, GfcElementGeometry> geometryById_;   // 构件几何量（按 #id），文本变动后清空
+    GfcSpatialIndex spatial_;                // 构件空间索引，对应内容键 spatialKey_（内容变了才重建）
+    QByteArray spatialKey_;
+    QSharedPointer<GfcValueIndex> values_;   // 字符串取值倒排索引，对应内容键 valuesKey_（打开文件时后台预建）
+    QByteArray valuesKey_;
+    QSharedPointer<GfcIndex> docIndex_;      // 当前文本的索引与内容键（各查找命令共用），文本或 Schema 变动后清空
+    QByteArray docKey_;
+    quint64 docRevision_ = 0;                // 文本或 Schema 每变动一次加一，后台结果据此判断是否仍适用
     QString lastFindText_;
+    QString lastValueQuery_;
+    QString lastInstanceQuery_;
+    QString lastBulkAssignment_;
 
     // 导航状态
     QAction* actBack_{};
@@ -114,9 +192,16 @@ private:
 
     // 文件相关
     bool loadGfcFromFile(const QString& path);
-    bool saveGfcToFile(const QString& path);
+    // 后台保存：快照当前文本，并行编码后写临时文件并原子替换；becomeCurrent 为另存为时切换当前路径
+    bool saveGfcToFile(const QString& path, bool becomeCurrent = false);
+    void closeEvent(QCloseEvent* ev) override;
     void updateWindowTitle();
     void rebuildClassTree();                 // 依据 schema_ + classCounts_ 构树
+    void invalidateStructureTree();
+    void rebuildStructureTree();
+    QStandardItem* makeStructureItem(int row);
+    // 追加 row 的第 from 个起的一批子结点（row < 0 为未归属构件），余下的用“更多”结点占位
+    void appendStructureChildren(QStandardItem* parent, int row, int from);
     int  computeInclusiveCount(const QString& cls) const; // 递归计算含子类总数
 
     // 覆写事件过滤器：处理 Ctrl+点击、Ctrl+移动改鼠标样式
@@ -148,17 +233,18 @@ private:
         RoleClassName = Qt::UserRole + 1,
         RoleNodeType = Qt::UserRole + 2,
         RoleDocPos = Qt::UserRole + 3,
+        RoleStructRow = Qt::UserRole + 4,   // 空间结构结点：索引行号（-1 为未归属构件组）
+        RoleStructNext = Qt::UserRole + 5,  // “更多”结点：下一批起点
         NodeClass = 1,
-        NodeInstance = 2
+        NodeInstance = 2,
+        NodeStructure = 3,
+        NodeMore = 4,
+        NodePending = 5                     // 未展开结点下的占位
     };
 
     void updateParentInstances(const QString& cls);
 
-    // ==== 新增：用于大小写无关匹配（不改变展示用的驼峰原名） ====
-    // lower -> CamelCase(展示名)
-    QHash<QString, QString> lowerToCamel_;
-
-    // 计数（key 一律用 CamelCase，与 schema_.classes() 的 key 一致）
+    // 计数（key 一律用 CamelCase，与 schema_ 的实体名一致）
     QHash<QString, int> directCountCamel_;      // 本类直接实例数
     QHash<QString, int> inclusiveCountCamel_;   // 包含子类总数
 
@@ -166,10 +252,22 @@ private:
     QHash<QString, QVector<GfcInstanceRef>> instancesByCamel_;
 
     // ==== 辅助 ====
-    void prepareSchemaIndex();  // 从 schema_ 构建 lowerToCamel_
+    // 整篇替换为新文本（一次编辑块，可一步撤销），随后立即重算
+    void replaceDocumentText(const QByteArray& utf8);
+    // 当前文本建字节索引（用 schema_ 映射类）；失败时弹框
+    bool buildCurrentIndex(GfcIndex* index);
+    // 当前文本的索引（缓存，各命令共用，引用图按需补建）及其内容键；失败时弹框并返回空
+    QSharedPointer<GfcIndex> currentIndex(QByteArray* key = nullptr);
+    void invalidateDocumentCache();
+    void applyLoadedSchema(const QString& displayPath); // 换 Schema 后按当前文本重算并刷新树/标题
+    // 后台读入（或新建并写回）旁路索引中的取值索引；完成时内容未变才采用
+    void prewarmValueIndex(const QString& text);
 
     // （新增）把全文匹配结果填充到结果表（不改变原有查找/替换逻辑）
     void runFindAll(const QString& pattern, QTextDocument::FindFlags flags);
+    // 把索引中的若干实例（按给定顺序）列到结果表，notes 为各行附注（可空）
+    void showRowsInFindResults(const GfcIndex& index, const QVector<int>& rows, const QStringList& notes,
+                               const QString& summary);
 
     QTimer* editRefreshTimer_ = nullptr;  // ★ 新增：文本编辑防抖
     bool suppressReparse_ = false;        // ★ 新增：程序性改文本时抑制重算
@@ -0,0 +1,234 @@
+#include "perftrace.h"
+#include <QFile>
+#include <QThread>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QMutexLocker>
+
+static thread_local int tlsDepth = 0;
+
+static quint64 currentTid()
+{
+    return static_cast<quint64>(reinterpret_cast<quintptr>(QThread::currentThreadId()));
+}
+
+// 同名项累加；保持首次出现的顺序（停靠窗按阶段顺序展示）
+static void addOrAccumulate(QVector<QPair<QString, qint64>>& v, const QString& name, qint64 delta)
+{
+    for (auto& p : v) {
+        if (p.first == name) { p.second += delta; return; }
+    }
+    v.push_back({ name, delta });
+}
+
+static void setOrReplace(QVector<QPair<QString, qint64>>& v, const QString& name, qint64 value)
+{
+    for (auto& p : v) {
+        if (p.first == name) { p.second = value; return; }
+    }
+    v.push_back({ name, value });
+}
+
+PerfTrace::PerfTrace()
+{
+    clock_.start();
+}
+
+PerfTrace& PerfTrace::instance()
+{
+    static PerfTrace inst;
+    return inst;
+}
+
+void PerfTrace::beginOperation(const QString& name)
+{
+    QMutexLocker lock(&mutex_);
+    opName_ = name;
+    opStartUs_ = nowUs();
+    opSpans_.clear();
+    opAccum_.clear();
+    opCounters_.clear();
+    opActive_ = true;
+}
+
+void PerfTrace::endOperation()
+{
+    const qint64 end = nowUs();
+    QMutexLocker lock(&mutex_);
+    if (!opActive_) return;
+    opActive_ = false;
+
+    lastName_ = opName_;
+    lastDurUs_ = end - opStartUs_;
+    lastSpans_ = std::move(opSpans_);
+    lastAccum_ = std::move(opAccum_);
+    lastCounters_ = std::move(opCounters_);
+    opSpans_.clear();
+    opAccum_.clear();
+    opCounters_.clear();
+
+    if (recording_) {
+        PerfSpan op;
+        op.name = lastName_;
+        op.startUs = opStartUs_;
+        op.durUs = lastDurUs_;
+        op.tid = currentTid();
+        op.depth = -1;
+        traceSpans_.push_back(op);
+    }
+}
+
+void PerfTrace::addSpan(const char* name, qint64 startUs, qint64 durUs, int depth)
+{
+    PerfSpan s;
+    s.name = QString::fromUtf8(name);
+    s.startUs = startUs;
+    s.durUs = durUs;
+    s.tid = currentTid();
+    s.depth = depth;
+
+    QMutexLocker lock(&mutex_);
+    if (opActive_) opSpans_.push_back(s);
+    if (recording_) traceSpans_.push_back(s);
+}
+
+void PerfTrace::accumulate(const QString& name, qint64 durUs)
+{
+    if (!opActive_) return;
+    QMutexLocker lock(&mutex_);
+    if (opActive_) addOrAccumulate(opAccum_, name, durUs);
+}
+
+void PerfTrace::setCounter(const QString& name, qint64 value)
+{
+    if (!wantsSpans()) return;
+    const qint64 ts = nowUs();
+    QMutexLocker lock(&mutex_);
+    if (opActive_) setOrReplace(opCounters_, name, value);
+    if (recording_) traceCounters_.push_back({ name, ts, value });
+}
+
+void PerfTrace::setMemory(const QString& structure, qint64 bytes)
+{
+    QMutexLocker lock(&mutex_);
+    setOrReplace(memory_, structure, bytes);
+}
+
+void PerfTrace::setRecording(bool on)
+{
+    QMutexLocker lock(&mutex_);
+    if (on && !recording_) {
+        traceSpans_.clear();
+        traceCounters_.clear();
+    }
+    recording_ = on;
+}
+
+int PerfTrace::recordedEventCount() const
+{
+    QMutexLocker lock(&mutex_);
+    return traceSpans_.size() + traceCounters_.size();
+}
+
+bool PerfTrace::writeChromeTrace(const QString& path, QString* err) const
+{
+    // Trace Event Format：完整事件 ph="X"，计数器 ph="C"；Perfetto/chrome://tracing 均可直接打开
+    QJsonArray events;
+    {
+        QMutexLocker lock(&mutex_);
+        QJsonObject meta;
+        meta.insert("name", "process_name");
+        meta.insert("ph", "M");
+        meta.insert("pid", 1);
+        meta.insert("args", QJsonObject{ { "name", "GFCEditor" } });
+        events.append(meta);
+
+        for (const PerfSpan& s : traceSpans_) {
+            QJsonObject e;
+            e.insert("name", s.name);
+            e.insert("cat", s.depth < 0 ? "operation" : "stage");
+            e.insert("ph", "X");
+            e.insert("ts", double(s.startUs));
+            e.insert("dur", double(s.durUs));
+            e.insert("pid", 1);
+            e.insert("tid", double(s.tid));
+            events.append(e);
+        }
+        for (const PerfCounter& c : traceCounters_) {
+            QJsonObject e;
+            e.insert("name", c.name);
+            e.insert("ph", "C");
+            e.insert("ts", double(c.tsUs));
+            e.insert("pid", 1);
+            e.insert("args", QJsonObject{ { "value", double(c.value) } });
+            events.append(e);
+        }
+    }
+
+    QJsonObject root;
+    root.insert("traceEvents", events);
+    root.insert("displayTimeUnit", "ms");
+
+    QFile f(path);
+    if (!f.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        if (err) *err = QStringLiteral("无法写入文件：%1").arg(path);
+        return false;
+    }
+    f.write(QJsonDocument(root).toJson(QJsonDocument::Compact));
+    return true;
+}
+
+QString PerfTrace::lastOperationName() const
+{
+    QMutexLocker lock(&mutex_);
+    return lastName_;
+}
+
+qint64 PerfTrace::lastOperationUs() const
+{
+    QMutexLocker lock(&mutex_);
+    return lastDurUs_;
+}
+
+QVector<PerfSpan> PerfTrace::lastSpans() const
+{
+    QMutexLocker lock(&mutex_);
+    return lastSpans_;
+}
+
+QVector<QPair<QString, qint64>> PerfTrace::lastAccumulated() const
+{
+    QMutexLocker lock(&mutex_);
+    return lastAccum_;
+}
+
+QVector<QPair<QString, qint64>> PerfTrace::lastCounters() const
+{
+    QMutexLocker lock(&mutex_);
+    return lastCounters_;
+}
+
+QVector<QPair<QString, qint64>> PerfTrace::lastMemory() const
+{
+    QMutexLocker lock(&mutex_);
+    return memory_;
+}
+
+// ================== PerfScope ==================
+PerfScope::PerfScope(const char* name)
+    : name_(name)
+{
+    PerfTrace& t = PerfTrace::instance();
+    if (!t.wantsSpans()) return;
+    depth_ = tlsDepth++;
+    startUs_ = t.nowUs();
+}
+
+PerfScope::~PerfScope()
+{
+    if (startUs_ < 0) return;
+    --tlsDepth;
+    PerfTrace& t = PerfTrace::instance();
+    t.addSpan(name_, startUs_, t.nowUs() - startUs_, depth_);
+}
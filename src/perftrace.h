@@ -0,0 +1,127 @@
+#pragma once
+#include <QString>
+#include <QVector>
+#include <QPair>
+#include <QHash>
+#include <QMutex>
+#include <QElapsedTimer>
+#include <atomic>
+
+/**
+ * 轻量性能埋点：
+ * - PerfScope / GFC_PERF_SCOPE：作用域计时（构造开始、析构结束）
+ * - 计数器：setCounter("实例数", n)；累计项：accumulate("语法高亮", us)（适合每行都会调用的热点）
+ * - 每次“操作”（加载、重算等）单独成组，供“性能”停靠窗展示最近一次的分解
+ * - 开启记录后，所有区段累积下来，可导出为 Chrome/Perfetto trace（JSON）
+ * 未开启记录且无进行中的操作时，计时只读一次时钟，不加锁。
+ */
+
+struct PerfSpan {
+    QString name;
+    qint64 startUs = 0;   // 相对全局时钟起点（微秒）
+    qint64 durUs = 0;
+    quint64 tid = 0;
+    int depth = 0;        // 嵌套深度（0 为操作内最外层）
+};
+
+struct PerfCounter {
+    QString name;
+    qint64 tsUs = 0;
+    qint64 value = 0;
+};
+
+class PerfTrace {
+public:
+    static PerfTrace& instance();
+
+    // 操作分组：begin/end 之间的区段、计数器归入“最近一次操作”
+    void beginOperation(const QString& name);
+    void endOperation();
+    bool operationActive() const { return opActive_; }
+
+    qint64 nowUs() const { return clock_.nsecsElapsed() / 1000; }
+    bool wantsSpans() const { return opActive_ || recording_; }
+
+    void addSpan(const char* name, qint64 startUs, qint64 durUs, int depth);
+    void accumulate(const QString& name, qint64 durUs);
+    void setCounter(const QString& name, qint64 value);
+    void setMemory(const QString& structure, qint64 bytes);
+
+    // Chrome/Perfetto trace 记录
+    void setRecording(bool on);
+    bool isRecording() const { return recording_; }
+    int recordedEventCount() const;
+    bool writeChromeTrace(const QString& path, QString* err = nullptr) const;
+
+    // 最近一次操作（线程安全拷贝）
+    QString lastOperationName() const;
+    qint64 lastOperationUs() const;
+    QVector<PerfSpan> lastSpans() const;
+    QVector<QPair<QString, qint64>> lastAccumulated() const;
+    QVector<QPair<QString, qint64>> lastCounters() const;
+    QVector<QPair<QString, qint64>> lastMemory() const;
+
+private:
+    PerfTrace();
+
+    mutable QMutex mutex_;
+    QElapsedTimer clock_;
+    std::atomic<bool> opActive_{ false };
+    std::atomic<bool> recording_{ false };
+
+    QString opName_;
+    qint64 opStartUs_ = 0;
+    QVector<PerfSpan> opSpans_;
+    QVector<QPair<QString, qint64>> opAccum_;
+    QVector<QPair<QString, qint64>> opCounters_;
+
+    QString lastName_;
+    qint64 lastDurUs_ = 0;
+    QVector<PerfSpan> lastSpans_;
+    QVector<QPair<QString, qint64>> lastAccum_;
+    QVector<QPair<QString, qint64>> lastCounters_;
+    QVector<QPair<QString, qint64>> memory_;
+
+    QVector<PerfSpan> traceSpans_;       // 记录期间的全部区段
+    QVector<PerfCounter> traceCounters_;
+};
+
+class PerfScope {
+public:
+    explicit PerfScope(const char* name);
+    ~PerfScope();
+    PerfScope(const PerfScope&) = delete;
+    PerfScope& operator=(const PerfScope&) = delete;
+private:
+    const char* name_;
+    qint64 startUs_ = -1;   // -1 表示未启用（无操作且未记录）
+    int depth_ = 0;
+};
+
+// 操作分组的 RAII 包装：构造 beginOperation，析构 endOperation
+class PerfOperation {
+public:
+    explicit PerfOperation(const QString& name) { PerfTrace::instance().beginOperation(name); }
+    ~PerfOperation() { PerfTrace::instance().endOperation(); }
+    PerfOperation(const PerfOperation&) = delete;
+    PerfOperation& operator=(const PerfOperation&) = delete;
+};
+
+// 累计项的 RAII 包装：调用频繁的热点（如每个文本块的高亮）只汇总总耗时，不逐次记录区段
+class PerfAccumulate {
+public:
+    explicit PerfAccumulate(const QString& name)
+        : name_(name), startUs_(PerfTrace::instance().operationActive() ? PerfTrace::instance().nowUs() : -1) {}
+    ~PerfAccumulate() {
+        if (startUs_ >= 0) PerfTrace::instance().accumulate(name_, PerfTrace::instance().nowUs() - startUs_);
+    }
+    PerfAccumulate(const PerfAccumulate&) = delete;
+    PerfAccumulate& operator=(const PerfAccumulate&) = delete;
+private:
+    const QString name_;   // 按值保存：调用方可传临时串（隐式共享，拷贝只增引用计数）
+    qint64 startUs_;
+};
+
+#define GFC_PERF_CONCAT_(a, b) a##b
+#define GFC_PERF_CONCAT(a, b) GFC_PERF_CONCAT_(a, b)
+#define GFC_PERF_SCOPE(name) PerfScope GFC_PERF_CONCAT(perfScope_, __LINE__)(name)
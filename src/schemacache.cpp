@@ -0,0 +1,464 @@
+#include "schemacache.h"
+#include "expressparser.h"
+#include <QCryptographicHash>
+#include <QDataStream>
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QStandardPaths>
+#include <algorithm>
+#include <functional>
+
+// ================== 构建 ==================
+namespace {
+
+// 类型文本 → 基本类型；别名逐层展开（带深度上限防环），聚合前缀计入层数
+void resolveType(const ExpressParser& parser, QString type, CompiledAttr* a)
+{
+    static const QRegularExpression reAggr(R"(^(?:LIST|SET|ARRAY|BAG)\s*(?:\[[^\]]*\])?\s*OF\s+(?:UNIQUE\s+)?(.+)$)",
+                                           QRegularExpression::CaseInsensitiveOption);
+    for (int depth = 0; depth < 32; ++depth) {
+        type = type.trimmed();
+        const auto m = reAggr.match(type);
+        if (m.hasMatch()) {
+            ++a->aggregate;
+            type = m.captured(1);
+            continue;
+        }
+        const QString upper = type.section(QLatin1Char('('), 0, 0).trimmed().toUpper();
+        if (upper == QLatin1String("REAL") || upper == QLatin1String("NUMBER")) a->base = GfcBaseType::Real;
+        else if (upper == QLatin1String("INTEGER")) a->base = GfcBaseType::Integer;
+        else if (upper == QLatin1String("BOOLEAN")) a->base = GfcBaseType::Boolean;
+        else if (upper == QLatin1String("LOGICAL")) a->base = GfcBaseType::Logical;
+        else if (upper == QLatin1String("STRING")) a->base = GfcBaseType::String;
+        else if (upper == QLatin1String("BINARY")) a->base = GfcBaseType::Binary;
+        else if (parser.types().contains(type)) {
+            const ExpTypeInfo& t = parser.types()[type];
+            if (!t.enumValues.isEmpty()) a->base = GfcBaseType::Enum;
+            else if (!t.underlying.isEmpty()) {
+                type = t.underlying;
+                continue;
+            }
+        }
+        else if (parser.classes().contains(type)) a->base = GfcBaseType::Entity;
+        return;
+    }
+}
+
+} // namespace
+
+void CompiledSchema::clear()
+{
+    entities_.clear();
+    attrs_.clear();
+    childList_.clear();
+    hashSlots_.clear();
+    lowerNames_.clear();
+}
+
+bool CompiledSchema::buildFrom(const ExpressParser& parser)
+{
+    clear();
+    const auto& classes = parser.classes();
+    if (classes.isEmpty()) return false;
+
+    // 1) 实体按名称排序，保证序列化结果稳定
+    QStringList names = classes.keys();
+    std::sort(names.begin(), names.end());
+    QHash<QString, int> indexOf;
+    entities_.resize(names.size());
+    for (int i = 0; i < names.size(); ++i) {
+        entities_[i].name = names[i];
+        indexOf.insert(names[i], i);
+    }
+    for (int i = 0; i < names.size(); ++i) {
+        entities_[i].parent = indexOf.value(classes.value(names[i]).parent, -1);
+    }
+
+    // 2) 本类属性（"Name : [OPTIONAL] Type"）
+    static const QRegularExpression reAttr(R"(^\s*([A-Za-z_][A-Za-z0-9_]*)\s*:\s*(.+)$)");
+    QVector<QVector<CompiledAttr>> own(names.size());
+    for (int i = 0; i < names.size(); ++i) {
+        for (const QString& line : classes.value(names[i]).attributes) {
+            const auto m = reAttr.match(line);
+            if (!m.hasMatch()) continue;
+            CompiledAttr a;
+            a.name = m.captured(1);
+            a.type = m.captured(2).trimmed();
+            if (a.type.startsWith(QStringLiteral("OPTIONAL "), Qt::CaseInsensitive)) {
+                a.optional = true;
+                a.type = a.type.mid(9).trimmed();
+            }
+            resolveType(parser, a.type, &a);
+            own[i].push_back(a);
+        }
+    }
+
+    // 3) 展平：父链属性在前（与 .gfc 参数顺序一致），沿父链递归，带环保护
+    QVector<QVector<CompiledAttr>> flat(names.size());
+    QVector<char> state(names.size(), 0);   // 0 未处理 / 1 处理中 / 2 完成
+    std::function<void(int)> flatten = [&](int e) {
+        if (state[e] == 2) return;
+        if (state[e] == 1) { entities_[e].parent = -1; return; }   // 继承环：断开
+        state[e] = 1;
+        const int p = entities_[e].parent;
+        if (p >= 0) {
+            flatten(p);
+            if (entities_[e].parent >= 0) flat[e] = flat[p];
+        }
+        flat[e] += own[e];
+        state[e] = 2;
+    };
+    for (int i = 0; i < names.size(); ++i) flatten(i);
+
+    for (int i = 0; i < names.size(); ++i) {
+        CompiledEntity& ent = entities_[i];
+        ent.attrBegin = attrs_.size();
+        ent.attrCount = flat[i].size();
+        ent.ownAttrCount = own[i].size();
+        attrs_ += flat[i];
+    }
+
+    // 4) 子类表（CSR）
+    QVector<QVector<int>> kids(names.size());
+    for (int i = 0; i < names.size(); ++i) {
+        if (entities_[i].parent >= 0) kids[entities_[i].parent].push_back(i);
+    }
+    for (int i = 0; i < names.size(); ++i) {
+        entities_[i].childBegin = childList_.size();
+        entities_[i].childCount = kids[i].size();
+        childList_ += kids[i];
+    }
+
+    // 5) DFS 区间编号
+    int counter = 0;
+    std::function<void(int)> number = [&](int e) {
+        entities_[e].pre = counter++;
+        for (int c : kids[e]) number(c);
+        entities_[e].post = counter - 1;
+    };
+    for (int i = 0; i < names.size(); ++i) {
+        if (entities_[i].parent < 0) number(i);
+    }
+
+    buildHash();
+    return true;
+}
+
+// ================== 名称哈希 ==================
+quint32 CompiledSchema::hashLower(const char* p, int len)
+{
+    quint32 h = 2166136261u;
+    for (int i = 0; i < len; ++i) {
+        char c = p[i];
+        if (c >= 'A' && c <= 'Z') c = char(c - 'A' + 'a');
+        h ^= quint8(c);
+        h *= 16777619u;
+    }
+    return h;
+}
+
+void CompiledSchema::buildHash()
+{
+    lowerNames_.resize(entities_.size());
+    for (int i = 0; i < entities_.size(); ++i) lowerNames_[i] = entities_[i].name.toLatin1().toLower();
+
+    if (hashSlots_.isEmpty()) {
+        int cap = 16;
+        while (cap < entities_.size() * 2) cap <<= 1;
+        hashSlots_.fill(-1, cap);
+        const quint32 mask = quint32(cap - 1);
+        for (int i = 0; i < entities_.size(); ++i) {
+            quint32 s = hashLower(lowerNames_[i].constData(), lowerNames_[i].size()) & mask;
+            while (hashSlots_[s] >= 0) s = (s + 1) & mask;
+            hashSlots_[s] = i;
+        }
+    }
+}
+
+int CompiledSchema::find(const char* bytes, int len) const
+{
+    if (hashSlots_.isEmpty() || len <= 0) return -1;
+    const quint32 mask = quint32(hashSlots_.size() - 1);
+    quint32 s = hashLower(bytes, len) & mask;
+    for (;;) {
+        const int e = hashSlots_[s];
+        if (e < 0) return -1;
+        const QByteArray& n = lowerNames_[e];
+        if (n.size() == len) {
+            int i = 0;
+            for (; i < len; ++i) {
+                char c = bytes[i];
+                if (c >= 'A' && c <= 'Z') c = char(c - 'A' + 'a');
+                if (c != n[i]) break;
+            }
+            if (i == len) return e;
+        }
+        s = (s + 1) & mask;
+    }
+}
+
+int CompiledSchema::find(const QString& anyCase) const
+{
+    const QByteArray l1 = anyCase.toLatin1();
+    return find(l1.constData(), l1.size());
+}
+
+QString CompiledSchema::camelName(const QString& anyCase) const
+{
+    const int e = find(anyCase);
+    return e >= 0 ? entities_[e].name : QString();
+}
+
+bool CompiledSchema::isSubtypeOf(int e, int base) const
+{
+    if (e < 0 || base < 0) return false;
+    const CompiledEntity& b = entities_[base];
+    const int p = entities_[e].pre;
+    return b.pre <= p && p <= b.post;
+}
+
+QVector<int> CompiledSchema::roots() const
+{
+    QVector<int> r;
+    for (int i = 0; i < entities_.size(); ++i) {
+        if (entities_[i].parent < 0) r.push_back(i);
+    }
+    return r;
+}
+
+QVector<int> CompiledSchema::children(int e) const
+{
+    const CompiledEntity& ent = entities_[e];
+    return childList_.mid(ent.childBegin, ent.childCount);
+}
+
+int CompiledSchema::attributeIndex(int e, const QString& attrName) const
+{
+    const CompiledEntity& ent = entities_[e];
+    for (int i = 0; i < ent.attrCount; ++i) {
+        if (attrs_[ent.attrBegin + i].name.compare(attrName, Qt::CaseInsensitive) == 0) return i;
+    }
+    return -1;
+}
+
+QStringList CompiledSchema::attributeNames(int e) const
+{
+    QStringList out;
+    const CompiledEntity& ent = entities_[e];
+    for (int i = 0; i < ent.attrCount; ++i) out << attrs_[ent.attrBegin + i].name;
+    return out;
+}
+
+qint64 CompiledSchema::memoryBytes() const
+{
+    qint64 bytes = qint64(entities_.capacity()) * sizeof(CompiledEntity)
+        + qint64(attrs_.capacity()) * sizeof(CompiledAttr)
+        + qint64(childList_.capacity()) * sizeof(int)
+        + qint64(hashSlots_.capacity()) * sizeof(int);
+    for (const auto& e : entities_) bytes += e.name.capacity() * 2;
+    for (const auto& a : attrs_) bytes += (a.name.capacity() + a.type.capacity()) * 2;
+    for (const auto& n : lowerNames_) bytes += n.capacity();
+    return bytes;
+}
+
+// ================== 序列化 ==================
+// 布局（小端）：magic, version, nStrings, nEntities, nAttrs, nChildren, nSlots,
+// 字符串表（u32 长度 + UTF-8），实体记录，属性记录（名称、类型、可选、基本类型、聚合层数），子类数组，哈希槽
+QByteArray CompiledSchema::serialize() const
+{
+    QStringList strings;
+    QHash<QString, quint32> stringIds;
+    auto sid = [&](const QString& s) -> quint32 {
+        auto it = stringIds.constFind(s);
+        if (it != stringIds.constEnd()) return it.value();
+        const quint32 id = quint32(strings.size());
+        strings << s;
+        stringIds.insert(s, id);
+        return id;
+    };
+    QVector<quint32> entName(entities_.size());
+    for (int i = 0; i < entities_.size(); ++i) entName[i] = sid(entities_[i].name);
+    QVector<quint32> attrName(attrs_.size()), attrType(attrs_.size());
+    for (int i = 0; i < attrs_.size(); ++i) {
+        attrName[i] = sid(attrs_[i].name);
+        attrType[i] = sid(attrs_[i].type);
+    }
+
+    QByteArray out;
+    QDataStream ds(&out, QIODevice::WriteOnly);
+    ds.setByteOrder(QDataStream::LittleEndian);
+    ds << kMagic << kVersion
+       << quint32(strings.size()) << quint32(entities_.size()) << quint32(attrs_.size())
+       << quint32(childList_.size()) << quint32(hashSlots_.size());
+
+    for (const QString& s : strings) {
+        const QByteArray u = s.toUtf8();
+        ds << quint32(u.size());
+        ds.writeRawData(u.constData(), u.size());
+    }
+    for (int i = 0; i < entities_.size(); ++i) {
+        const CompiledEntity& e = entities_[i];
+        ds << entName[i] << qint32(e.parent) << qint32(e.attrBegin) << qint32(e.attrCount)
+           << qint32(e.ownAttrCount) << qint32(e.childBegin) << qint32(e.childCount)
+           << qint32(e.pre) << qint32(e.post);
+    }
+    for (int i = 0; i < attrs_.size(); ++i) {
+        ds << attrName[i] << attrType[i] << quint8(attrs_[i].optional ? 1 : 0) << quint8(attrs_[i].base)
+           << attrs_[i].aggregate;
+    }
+    for (int c : childList_) ds << qint32(c);
+    for (int s : hashSlots_) ds << qint32(s);
+    return out;
+}
+
+bool CompiledSchema::deserialize(const QByteArray& data, QString* err)
+{
+    clear();
+    QDataStream ds(data);
+    ds.setByteOrder(QDataStream::LittleEndian);
+
+    quint32 magic = 0, version = 0, nStr = 0, nEnt = 0, nAttr = 0, nChild = 0, nSlot = 0;
+    ds >> magic >> version >> nStr >> nEnt >> nAttr >> nChild >> nSlot;
+    if (ds.status() != QDataStream::Ok || magic != kMagic || version != kVersion) {
+        if (err) *err = QStringLiteral("不是有效的编译 Schema（版本不符或已损坏）");
+        return false;
+    }
+    // 粗略上限检查，防止损坏文件导致巨量分配
+    const quint32 limit = quint32(data.size());
+    if (nStr > limit || nEnt > limit || nAttr > limit || nChild > limit || nSlot > limit
+        || (nSlot & (nSlot - 1)) != 0) {
+        if (err) *err = QStringLiteral("编译 Schema 头部计数异常");
+        return false;
+    }
+
+    QStringList strings;
+    strings.reserve(int(nStr));
+    for (quint32 i = 0; i < nStr; ++i) {
+        quint32 len = 0;
+        ds >> len;
+        if (len > limit) { ds.setStatus(QDataStream::ReadCorruptData); break; }
+        QByteArray u(int(len), Qt::Uninitialized);
+        if (ds.readRawData(u.data(), int(len)) != int(len)) { ds.setStatus(QDataStream::ReadPastEnd); break; }
+        strings << QString::fromUtf8(u);
+    }
+    auto str = [&](quint32 id) { return id < quint32(strings.size()) ? strings[int(id)] : QString(); };
+
+    entities_.resize(int(nEnt));
+    for (auto& e : entities_) {
+        quint32 name = 0;
+        qint32 v[8] = {};
+        ds >> name;
+        for (auto& x : v) ds >> x;
+        e.name = str(name);
+        e.parent = v[0]; e.attrBegin = v[1]; e.attrCount = v[2]; e.ownAttrCount = v[3];
+        e.childBegin = v[4]; e.childCount = v[5]; e.pre = v[6]; e.post = v[7];
+    }
+    attrs_.resize(int(nAttr));
+    for (auto& a : attrs_) {
+        quint32 name = 0, type = 0;
+        quint8 opt = 0, base = 0;
+        ds >> name >> type >> opt >> base >> a.aggregate;
+        a.name = str(name);
+        a.type = str(type);
+        a.optional = opt != 0;
+        a.base = base <= quint8(GfcBaseType::Entity) ? GfcBaseType(base) : GfcBaseType::Unknown;
+    }
+    childList_.resize(int(nChild));
+    for (auto& c : childList_) { qint32 v = 0; ds >> v; c = v; }
+    hashSlots_.resize(int(nSlot));
+    for (auto& s : hashSlots_) { qint32 v = 0; ds >> v; s = v; }
+
+    // 逐项校验：下标、区间与继承编号都须自洽，否则 isSubtypeOf / attribute 会越界
+    bool ok = ds.status() == QDataStream::Ok;
+    for (const auto& e : entities_) {
+        if (!ok) break;
+        ok = e.attrBegin >= 0 && e.attrCount >= 0 && qint64(e.attrBegin) + e.attrCount <= nAttr
+            && e.ownAttrCount >= 0 && e.ownAttrCount <= e.attrCount
+            && e.childBegin >= 0 && e.childCount >= 0 && qint64(e.childBegin) + e.childCount <= nChild
+            && e.pre >= 0 && e.pre <= e.post && e.post < int(nEnt);
+        if (!ok || e.parent == -1) {
+            ok = ok && e.attrCount == e.ownAttrCount;
+            continue;
+        }
+        // 父类的先序号严格更小且子树区间包含本类：同时排除了继承环
+        ok = e.parent >= 0 && e.parent < int(nEnt);
+        if (!ok) break;
+        const CompiledEntity& p = entities_[e.parent];
+        ok = p.pre < e.pre && e.post <= p.post && e.attrCount == p.attrCount + e.ownAttrCount;
+    }
+    for (int c : childList_) ok = ok && c >= 0 && c < int(nEnt);
+    // 开放寻址须至少留一个空槽，否则 find() 查不到的名称会无限探测
+    bool emptySlot = false;
+    for (int s : hashSlots_) {
+        ok = ok && s >= -1 && s < int(nEnt);
+        emptySlot = emptySlot || s < 0;
+    }
+    ok = ok && (nSlot == 0 || emptySlot);
+    if (ok) {
+        buildHash();   // 槽位已读入，这里只补小写名称表
+        for (int i = 0; ok && i < entities_.size(); ++i) {
+            ok = find(lowerNames_[i].constData(), lowerNames_[i].size()) == i;
+        }
+    }
+    if (!ok) {
+        clear();
+        if (err) *err = QStringLiteral("编译 Schema 数据不完整");
+        return false;
+    }
+    return true;
+}
+
+// ================== 磁盘缓存 ==================
+QString SchemaCache::cacheDir()
+{
+    QString base = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if (base.isEmpty()) base = QDir::tempPath() + QStringLiteral("/GFCEditor");
+    return base + QStringLiteral("/schema");
+}
+
+bool SchemaCache::loadExp(const QString& expPath, CompiledSchema* out, QString* err, bool* fromCache)
+{
+    if (!out) return false;
+    if (fromCache) *fromCache = false;
+
+    QFile f(expPath);
+    if (!f.open(QIODevice::ReadOnly)) {
+        if (err) *err = QStringLiteral("无法打开EXP文件：%1").arg(expPath);
+        return false;
+    }
+    const QByteArray src = f.readAll();
+    f.close();
+
+    // 键包含格式版本：升级格式后旧缓存自然失效
+    QCryptographicHash h(QCryptographicHash::Sha1);
+    h.addData(src);
+    h.addData(QByteArray::number(CompiledSchema::kVersion));
+    const QString cachePath = cacheDir() + QLatin1Char('/') + QString::fromLatin1(h.result().toHex()) + QStringLiteral(".gfcs");
+
+    QFile cached(cachePath);
+    if (cached.open(QIODevice::ReadOnly)) {
+        if (out->deserialize(cached.readAll())) {
+            if (fromCache) *fromCache = true;
+            return true;
+        }
+    }
+
+    ExpressParser parser;
+    if (!parser.parseFile(expPath, err)) return false;
+    if (!out->buildFrom(parser)) {
+        if (err) *err = QStringLiteral("EXP 文件中未找到任何 ENTITY：%1").arg(expPath);
+        return false;
+    }
+
+    // 写缓存失败不影响本次加载
+    QDir().mkpath(cacheDir());
+    QSaveFile sf(cachePath);
+    if (sf.open(QIODevice::WriteOnly)) {
+        sf.write(out->serialize());
+        sf.commit();
+    }
+    return true;
+}
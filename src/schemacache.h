@@ -0,0 +1,107 @@
+#pragma once
+#include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QVector>
+
+class ExpressParser;
+
+/**
+ * 编译后的 Schema（紧凑二进制形式）：
+ * - 实体表：按名称排序，父类用下标表示
+ * - 展平属性：每个实体的属性区间已包含继承属性（父类在前），与 .gfc 参数位置一一对应
+ * - 继承区间：DFS 先序/后序编号，isSubtypeOf 为 O(1) 区间判断
+ * - 属性基本类型：编译时沿 TYPE 别名解析到 REAL/STRING/枚举/实体等，聚合记层数
+ * - 名称哈希：开放寻址表（FNV-1a，大小写无关），可直接用 .gfc 字节缓冲里的大写类名查找
+ * 序列化结果可嵌入可执行文件（构建期由 gfcschemac 生成），也可缓存到磁盘。
+ */
+
+// 属性类型经 TYPE 别名解析后的基本类型（聚合取元素类型）
+enum class GfcBaseType : quint8 {
+    Unknown = 0,   // 未定义或 SELECT
+    Real,
+    Integer,
+    Boolean,
+    Logical,
+    String,
+    Binary,
+    Enum,
+    Entity
+};
+
+struct CompiledAttr {
+    QString name;
+    QString type;          // 去掉 OPTIONAL 后的类型文本，如 "GfcDouble"、"LIST [0:?] OF GfcCoedgeList"
+    bool optional = false;
+    GfcBaseType base = GfcBaseType::Unknown;
+    quint8 aggregate = 0;  // LIST/SET/ARRAY/BAG 嵌套层数，0 为单值
+};
+
+struct CompiledEntity {
+    QString name;          // CamelCase，如 GfcExtrudedBody
+    int parent = -1;       // 无父类（或父类未定义）时为 -1
+    int attrBegin = 0;     // 在展平属性数组中的起点
+    int attrCount = 0;     // 含继承属性的总数
+    int ownAttrCount = 0;  // 其中本类声明的个数（位于区间末尾）
+    int childBegin = 0;    // 在子类数组中的起点
+    int childCount = 0;
+    int pre = 0;           // DFS 先序号
+    int post = 0;          // 子树内最大先序号
+};
+
+class CompiledSchema {
+public:
+    static constexpr quint32 kMagic = 0x53434647;   // "GFCS"
+    static constexpr quint32 kVersion = 2;
+
+    bool buildFrom(const ExpressParser& parser);
+    QByteArray serialize() const;
+    bool deserialize(const QByteArray& data, QString* err = nullptr);
+    void clear();
+
+    bool isEmpty() const { return entities_.isEmpty(); }
+    int entityCount() const { return entities_.size(); }
+    const CompiledEntity& entity(int e) const { return entities_[e]; }
+    const QString& name(int e) const { return entities_[e].name; }
+    int parent(int e) const { return entities_[e].parent; }
+
+    // 大小写无关查找；失败返回 -1
+    int find(const QString& anyCase) const;
+    int find(const char* bytes, int len) const;   // 如 .gfc 中的 "GFCVECTOR3D"
+    QString camelName(const QString& anyCase) const;  // 找不到返回空串
+
+    bool isSubtypeOf(int e, int base) const;       // e == base 也返回 true
+    QVector<int> roots() const;
+    QVector<int> children(int e) const;
+
+    int attributeCount(int e) const { return entities_[e].attrCount; }
+    const CompiledAttr& attribute(int e, int i) const { return attrs_[entities_[e].attrBegin + i]; }
+    int attributeIndex(int e, const QString& attrName) const;   // 大小写无关，-1 表示无
+    QStringList attributeNames(int e) const;
+
+    qint64 memoryBytes() const;
+
+    // 构建期嵌入的 Schema（由 gfcschemac 生成的源文件实现）
+    static QByteArray embeddedBlob();
+
+private:
+    QVector<CompiledEntity> entities_;
+    QVector<CompiledAttr> attrs_;
+    QVector<int> childList_;
+    QVector<int> hashSlots_;            // 实体下标，-1 为空槽；大小为 2 的幂
+    QVector<QByteArray> lowerNames_;    // 小写 latin1 名称，供字节级比较
+
+    static quint32 hashLower(const char* p, int len);
+    void buildHash();
+};
+
+/**
+ * 外部 .exp 的编译缓存：以文件内容 SHA-1 为键，首次加载时编译并写入
+ * <缓存目录>/schema/<sha1>.gfcs，之后直接读取二进制，不再逐行正则解析。
+ */
+class SchemaCache {
+public:
+    static bool loadExp(const QString& expPath, CompiledSchema* out,
+                        QString* err = nullptr, bool* fromCache = nullptr);
+    static QString cacheDir();
+};
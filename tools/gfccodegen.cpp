@@ -0,0 +1,195 @@
+// gfccodegen：构建期从 .exp 生成类型化 C++ 头文件
+// - 每个 ENTITY 一个 struct（字段含继承属性，父类在前，与实例参数位置一致）
+// - 每个 ENUMERATION OF 一个 enum class
+// - EntityTraits<E> 特化：按字段类型在编译期选定的解码/编码函数（运行时支持见 src/gfctyped.h）
+// 用法：gfccodegen <input.exp> <output.h>
+#include <QCoreApplication>
+#include <QRegularExpression>
+#include <QSaveFile>
+#include <QSet>
+#include <algorithm>
+#include <cstdio>
+
+#include "expressparser.h"
+#include "schemacache.h"
+
+namespace {
+
+struct Generator {
+    const ExpressParser& parser;
+    const CompiledSchema& schema;
+
+    // EXPRESS 类型文本 -> C++ 字段类型（不含 OPTIONAL）
+    QString cppType(const QString& expType, int depth = 0) const
+    {
+        static const QRegularExpression reAggr(
+            R"(^(LIST|SET|BAG|ARRAY)\s*\[[^\]]*\]\s*OF\s+(?:UNIQUE\s+)?(.+)$)",
+            QRegularExpression::CaseInsensitiveOption);
+        static const QRegularExpression reWidth(R"(\s*\(\s*\d+\s*\)\s*(FIXED)?\s*$)", QRegularExpression::CaseInsensitiveOption);
+
+        QString t = expType.trimmed();
+        if (depth > 16) return QStringLiteral("Raw");
+
+        const auto m = reAggr.match(t);
+        if (m.hasMatch()) return QStringLiteral("std::vector<%1>").arg(cppType(m.captured(2), depth + 1));
+
+        t.remove(reWidth);   // STRING(255) 等宽度修饰
+        const QString u = t.toUpper();
+        if (u == QLatin1String("STRING")) return QStringLiteral("std::string");
+        if (u == QLatin1String("REAL") || u == QLatin1String("NUMBER")) return QStringLiteral("double");
+        if (u == QLatin1String("INTEGER")) return QStringLiteral("std::int64_t");
+        if (u == QLatin1String("BOOLEAN") || u == QLatin1String("LOGICAL")) return QStringLiteral("bool");
+
+        const auto it = parser.types().constFind(t);
+        if (it != parser.types().constEnd()) {
+            if (!it->enumValues.isEmpty()) return it->name;
+            return cppType(it->underlying, depth + 1);
+        }
+        if (schema.find(t) >= 0) return QStringLiteral("Ref");
+        return QStringLiteral("Raw");
+    }
+
+    QByteArray generate() const
+    {
+        QByteArray o;
+        auto line = [&o](const QString& s) { o += s.toUtf8(); o += '\n'; };
+
+        line(QStringLiteral("// 由 gfccodegen 从 .exp 生成，请勿手动修改"));
+        line(QStringLiteral("#pragma once"));
+        line(QStringLiteral("#include \"gfctyped.h\""));
+        line(QString());
+        line(QStringLiteral("namespace gfc {"));
+        line(QString());
+
+        // ---- 枚举 ----
+        QStringList enumNames;
+        for (auto it = parser.types().cbegin(); it != parser.types().cend(); ++it) {
+            if (!it->enumValues.isEmpty()) enumNames << it.key();
+        }
+        std::sort(enumNames.begin(), enumNames.end());
+        for (const QString& name : enumNames) {
+            const QStringList& values = parser.types().value(name).enumValues;
+            line(QStringLiteral("enum class %1 : int {").arg(name));
+            for (int i = 0; i < values.size(); ++i) {
+                line(QStringLiteral("    %1%2").arg(values[i], i + 1 < values.size() ? QStringLiteral(",") : QString()));
+            }
+            line(QStringLiteral("};"));
+            line(QString());
+
+            QStringList quoted;
+            for (const QString& v : values) quoted << QStringLiteral("\"%1\"").arg(v);
+            line(QStringLiteral("template<> struct Codec<%1> {").arg(name));
+            line(QStringLiteral("    static constexpr std::string_view names[] = { %1 };").arg(quoted.join(QStringLiteral(", "))));
+            line(QStringLiteral("    static bool decode(ArgReader& r, %1& v) {").arg(name));
+            line(QStringLiteral("        std::string_view t;"));
+            line(QStringLiteral("        if (!r.readEnum(t)) return false;"));
+            line(QStringLiteral("        for (int i = 0; i < %1; ++i) {").arg(values.size()));
+            line(QStringLiteral("            if (names[i] == t) { v = %1(i); return true; }").arg(name));
+            line(QStringLiteral("        }"));
+            line(QStringLiteral("        return r.fail();"));
+            line(QStringLiteral("    }"));
+            line(QStringLiteral("    static void encode(ArgWriter& w, %1 v) { w.writeEnum(names[int(v)]); }").arg(name));
+            line(QStringLiteral("};"));
+            line(QString());
+        }
+
+        // ---- 实体 ----
+        QStringList entityList;
+        for (int e = 0; e < schema.entityCount(); ++e) {
+            const QString& name = schema.name(e);
+            entityList << name;
+
+            // 字段名：与类名、Field 或已用名冲突时加下划线（继承链里偶有同名属性）
+            QStringList fields;
+            QStringList types;
+            QSet<QString> used{ name, QStringLiteral("Field") };
+            for (int i = 0; i < schema.attributeCount(e); ++i) {
+                const CompiledAttr& a = schema.attribute(e, i);
+                QString f = a.name;
+                while (used.contains(f)) f += QLatin1Char('_');
+                used.insert(f);
+                fields << f;
+                const QString t = cppType(a.type);
+                types << (a.optional ? QStringLiteral("std::optional<%1>").arg(t) : t);
+            }
+
+            const int p = schema.parent(e);
+            line(p >= 0 ? QStringLiteral("// %1 : %2").arg(name, schema.name(p)) : QStringLiteral("// %1").arg(name));
+            line(QStringLiteral("struct %1 {").arg(name));
+            line(QStringLiteral("    enum class Field : int { %1 };").arg(fields.join(QStringLiteral(", "))));
+            for (int i = 0; i < fields.size(); ++i) {
+                line(QStringLiteral("    %1 %2{};").arg(types[i], fields[i]));
+            }
+            line(QStringLiteral("};"));
+            line(QString());
+
+            line(QStringLiteral("template<> struct EntityTraits<%1> {").arg(name));
+            line(QStringLiteral("    static constexpr std::string_view name = \"%1\";").arg(name));
+            line(QStringLiteral("    static constexpr std::string_view stepName = \"%1\";").arg(name.toUpper()));
+            line(QStringLiteral("    static constexpr int attributeCount = %1;").arg(fields.size()));
+            if (fields.isEmpty()) {
+                line(QStringLiteral("    static bool decodeFields(ArgReader& r, %1&) { return r.ok(); }").arg(name));
+                line(QStringLiteral("    static void encodeFields(ArgWriter&, const %1&) {}").arg(name));
+            }
+            else {
+                QStringList dec, enc;
+                for (const QString& f : fields) {
+                    dec << QStringLiteral("field(r, v.%1)").arg(f);
+                    enc << QStringLiteral("put(w, v.%1);").arg(f);
+                }
+                line(QStringLiteral("    static bool decodeFields(ArgReader& r, %1& v) {").arg(name));
+                line(QStringLiteral("        return %1;").arg(dec.join(QStringLiteral("\n            && "))));
+                line(QStringLiteral("    }"));
+                line(QStringLiteral("    static void encodeFields(ArgWriter& w, const %1& v) {").arg(name));
+                line(QStringLiteral("        %1").arg(enc.join(QStringLiteral("\n        "))));
+                line(QStringLiteral("    }"));
+            }
+            line(QStringLiteral("};"));
+            line(QString());
+        }
+
+        line(QStringLiteral("} // namespace gfc"));
+        line(QString());
+
+        // 供插件生成分派表：GFC_FOR_EACH_ENTITY(X) 依次展开 X(GfcXxx)
+        line(QStringLiteral("#define GFC_FOR_EACH_ENTITY(X) \\"));
+        for (int i = 0; i < entityList.size(); ++i) {
+            line(QStringLiteral("    X(%1)%2").arg(entityList[i], i + 1 < entityList.size() ? QStringLiteral(" \\") : QString()));
+        }
+        return o;
+    }
+};
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    const QStringList args = app.arguments();
+    if (args.size() != 3) {
+        std::fprintf(stderr, "usage: gfccodegen <input.exp> <output.h>\n");
+        return 2;
+    }
+
+    ExpressParser parser;
+    QString err;
+    if (!parser.parseFile(args[1], &err)) {
+        std::fprintf(stderr, "gfccodegen: %s\n", qPrintable(err));
+        return 1;
+    }
+    CompiledSchema schema;
+    if (!schema.buildFrom(parser)) {
+        std::fprintf(stderr, "gfccodegen: no ENTITY found in %s\n", qPrintable(args[1]));
+        return 1;
+    }
+
+    const QByteArray src = Generator{ parser, schema }.generate();
+
+    QSaveFile out(args[2]);
+    if (!out.open(QIODevice::WriteOnly) || out.write(src) != src.size() || !out.commit()) {
+        std::fprintf(stderr, "gfccodegen: cannot write %s\n", qPrintable(args[2]));
+        return 1;
+    }
+    std::printf("gfccodegen: %d entities, %d types\n", schema.entityCount(), int(parser.types().size()));
+    return 0;
+}
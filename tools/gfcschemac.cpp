@@ -0,0 +1,53 @@
+// gfcschemac：构建期把 .exp 编译为二进制 Schema，并生成嵌入用的 C++ 源文件
+// 用法：gfcschemac <input.exp> <output.cpp>
+#include <QCoreApplication>
+#include <QSaveFile>
+#include <cstdio>
+
+#include "expressparser.h"
+#include "schemacache.h"
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication app(argc, argv);
+    const QStringList args = app.arguments();
+    if (args.size() != 3) {
+        std::fprintf(stderr, "usage: gfcschemac <input.exp> <output.cpp>\n");
+        return 2;
+    }
+
+    ExpressParser parser;
+    QString err;
+    if (!parser.parseFile(args[1], &err)) {
+        std::fprintf(stderr, "gfcschemac: %s\n", qPrintable(err));
+        return 1;
+    }
+    CompiledSchema schema;
+    if (!schema.buildFrom(parser)) {
+        std::fprintf(stderr, "gfcschemac: no ENTITY found in %s\n", qPrintable(args[1]));
+        return 1;
+    }
+    const QByteArray blob = schema.serialize();
+
+    QByteArray src;
+    src += "// 由 gfcschemac 从 .exp 生成，请勿手动修改\n";
+    src += "#include \"schemacache.h\"\n\n";
+    src += "static const unsigned char kEmbeddedSchema[] = {\n";
+    for (int i = 0; i < blob.size(); ++i) {
+        if (i % 16 == 0) src += "    ";
+        src += QByteArray::number(quint8(blob[i]));
+        src += (i + 1 == blob.size()) ? "\n" : (i % 16 == 15 ? ",\n" : ",");
+    }
+    src += "};\n\n";
+    src += "QByteArray CompiledSchema::embeddedBlob()\n{\n";
+    src += "    return QByteArray::fromRawData(reinterpret_cast<const char*>(kEmbeddedSchema), int(sizeof(kEmbeddedSchema)));\n";
+    src += "}\n";
+
+    QSaveFile out(args[2]);
+    if (!out.open(QIODevice::WriteOnly) || out.write(src) != src.size() || !out.commit()) {
+        std::fprintf(stderr, "gfcschemac: cannot write %s\n", qPrintable(args[2]));
+        return 1;
+    }
+    std::printf("gfcschemac: %d entities, %d bytes\n", schema.entityCount(), int(blob.size()));
+    return 0;
+}